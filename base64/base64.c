@@ -0,0 +1,383 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file base64.c
+ * \brief
+ * Standard (RFC 4648) base64 encoder and decoder
+ *
+ * \notes
+ * The vector paths follow the pshufb based approach by W. Mula and D. Lemire
+ * ("Faster Base64 Encoding and Decoding Using AVX2 Instructions"). They only
+ * process whole blocks and stop at the first block containing anything but
+ * base64 alphabet characters; the scalar code handles the rest, including
+ * padding and error reporting.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "base64.h"
+
+#include <pthread.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BASE64_X86
+#include <immintrin.h>
+#endif
+
+#define BASE64_INVALID 0xFF
+
+// Encode whole blocks, returns number of consumed input bytes (multiple of 3)
+typedef size_t (*encode_blocks_t)(const unsigned char *in, size_t in_len, char *out);
+// Decode whole blocks, returns number of consumed input characters (multiple of 4)
+typedef size_t (*decode_blocks_t)(const char *in, size_t in_len, unsigned char *out, size_t out_len);
+
+static const char g_encode_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static unsigned char g_decode_table[256];
+
+static encode_blocks_t g_encode_blocks = NULL;
+static decode_blocks_t g_decode_blocks = NULL;
+
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+
+static size_t encode_blocks_scalar(const unsigned char *in, size_t in_len, char *out) {
+  size_t i = 0;
+
+  for (; in_len - i >= 3; i += 3, out += 4) {
+    unsigned int v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+
+    out[0] = g_encode_table[(v >> 18) & 0x3F];
+    out[1] = g_encode_table[(v >> 12) & 0x3F];
+    out[2] = g_encode_table[(v >> 6) & 0x3F];
+    out[3] = g_encode_table[v & 0x3F];
+  }
+
+  return i;
+}
+
+static size_t decode_blocks_scalar(const char *in, size_t in_len, unsigned char *out, size_t out_len) {
+  size_t i = 0;
+  size_t j = 0;
+
+  for (; in_len - i >= 4 && out_len - j >= 3; i += 4, j += 3) {
+    unsigned char a = g_decode_table[(unsigned char)in[i]];
+    unsigned char b = g_decode_table[(unsigned char)in[i + 1]];
+    unsigned char c = g_decode_table[(unsigned char)in[i + 2]];
+    unsigned char d = g_decode_table[(unsigned char)in[i + 3]];
+
+    if ((a | b | c | d) & 0xC0) {
+      break;
+    }
+
+    out[j] = (a << 2) | (b >> 4);
+    out[j + 1] = (b << 4) | (c >> 2);
+    out[j + 2] = (c << 6) | d;
+  }
+
+  return i;
+}
+
+#ifdef BASE64_X86
+__attribute__((target("ssse3"))) static inline __m128i encode_reshuffle_ssse3(__m128i in) {
+  // Spread each 3-byte group over 4 bytes, then move the 6-bit fields in place
+  __m128i t0, t1, t2, t3;
+
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+  return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3"))) static inline __m128i encode_translate_ssse3(__m128i indices) {
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12, then add the offset for that range
+  const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+
+  range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("ssse3"))) static size_t encode_blocks_ssse3(const unsigned char *in, size_t in_len, char *out) {
+  size_t i = 0;
+
+  // Reads 16 bytes, consumes 12
+  for (; in_len - i >= 16; i += 12, out += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+    v = encode_translate_ssse3(encode_reshuffle_ssse3(v));
+    _mm_storeu_si128((__m128i *)out, v);
+  }
+
+  return i + encode_blocks_scalar(in + i, in_len - i, out);
+}
+
+__attribute__((target("ssse3"))) static size_t decode_blocks_ssse3(const char *in, size_t in_len, unsigned char *out,
+                                                                   size_t out_len) {
+  const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B,
+                                       0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                       0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+  size_t j = 0;
+
+  // Reads 16 characters, writes 16 bytes of which 12 are valid
+  for (; in_len - i >= 16 && out_len - j >= 16; i += 16, j += 12) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(v, 4), nibble);
+    __m128i lo_nibbles = _mm_and_si128(v, nibble);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    __m128i roll;
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+      break;
+    }
+
+    roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), hi_nibbles));
+    v = _mm_add_epi8(v, roll);
+
+    // Pack four 6-bit fields into three bytes
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i *)(out + j), v);
+  }
+
+  return i + decode_blocks_scalar(in + i, in_len - i, out + j, out_len - j);
+}
+
+__attribute__((target("avx2"))) static size_t encode_blocks_avx2(const unsigned char *in, size_t in_len, char *out) {
+  const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4,
+                                           7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '+' - 62, '/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t i = 0;
+
+  // Reads 28 bytes, consumes 24; each lane holds 12 input bytes
+  for (; in_len - i >= 28; i += 24, out += 32) {
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+                                        _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+    __m256i range, less;
+
+    v = _mm256_shuffle_epi8(v, shuffle);
+    v = _mm256_or_si256(
+        _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040)),
+        _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010)));
+
+    range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+    less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+    range = _mm256_or_si256(range, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    v = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), v);
+
+    _mm256_storeu_si256((__m256i *)out, v);
+  }
+
+  // Avoid the AVX to SSE transition penalty in the tail
+  _mm256_zeroupper();
+
+  return i + encode_blocks_ssse3(in + i, in_len - i, out);
+}
+
+__attribute__((target("avx2"))) static size_t decode_blocks_avx2(const char *in, size_t in_len, unsigned char *out,
+                                                                 size_t out_len) {
+  const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A));
+  const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+  const __m256i lut_roll =
+      _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i pack = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  size_t i = 0;
+  size_t j = 0;
+
+  // Reads 32 characters, writes 32 bytes of which 24 are valid
+  for (; in_len - i >= 32 && out_len - j >= 32; i += 32, j += 24) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+    __m256i lo_nibbles = _mm256_and_si256(v, nibble);
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    __m256i roll;
+
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())) != -1) {
+      break;
+    }
+
+    roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), hi_nibbles));
+    v = _mm256_add_epi8(v, roll);
+
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, pack);
+    // Close the 4-byte gap between the lanes
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm256_storeu_si256((__m256i *)(out + j), v);
+  }
+
+  _mm256_zeroupper();
+
+  return i + decode_blocks_ssse3(in + i, in_len - i, out + j, out_len - j);
+}
+#endif
+
+static void base64_init(void) {
+  for (int i = 0; i < 256; i++) {
+    g_decode_table[i] = BASE64_INVALID;
+  }
+  for (int i = 0; i < 64; i++) {
+    g_decode_table[(unsigned char)g_encode_table[i]] = i;
+  }
+
+  g_encode_blocks = encode_blocks_scalar;
+  g_decode_blocks = decode_blocks_scalar;
+
+#ifdef BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    g_encode_blocks = encode_blocks_avx2;
+    g_decode_blocks = decode_blocks_avx2;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    g_encode_blocks = encode_blocks_ssse3;
+    g_decode_blocks = decode_blocks_ssse3;
+  }
+#endif
+}
+
+size_t base64_encoded_len(size_t in_len) { return (in_len + 2) / 3 * 4; }
+
+size_t base64_decoded_max_len(size_t in_len) { return in_len / 4 * 3; }
+
+int base64_encode(const unsigned char *in, size_t in_len, char *out, size_t out_len) {
+  size_t i, o;
+
+  if ((in == NULL && in_len > 0) || out == NULL || out_len < base64_encoded_len(in_len) + 1) {
+    return 1;
+  }
+
+  pthread_once(&g_init_once, base64_init);
+
+  i = g_encode_blocks(in, in_len, out);
+  o = i / 3 * 4;
+
+  if (in_len - i == 1) {
+    out[o] = g_encode_table[in[i] >> 2];
+    out[o + 1] = g_encode_table[(in[i] & 0x03) << 4];
+    out[o + 2] = '=';
+    out[o + 3] = '=';
+    o += 4;
+  } else if (in_len - i == 2) {
+    out[o] = g_encode_table[in[i] >> 2];
+    out[o + 1] = g_encode_table[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+    out[o + 2] = g_encode_table[(in[i + 1] & 0x0F) << 2];
+    out[o + 3] = '=';
+    o += 4;
+  }
+  out[o] = '\0';
+
+  return 0;
+}
+
+int base64_decode(const char *in, size_t in_len, unsigned char *out, size_t out_len, size_t *decoded_len) {
+  size_t pad = 0;
+  size_t full_len, len, i, j;
+  unsigned char a, b, c;
+
+  if (in == NULL || out == NULL || in_len % 4 != 0) {
+    return 1;
+  }
+
+  if (in_len > 0 && in[in_len - 1] == '=') pad++;
+  if (in_len > 1 && in[in_len - 2] == '=') pad++;
+
+  len = base64_decoded_max_len(in_len) - pad;
+  if (len > out_len) {
+    return 1;
+  }
+
+  pthread_once(&g_init_once, base64_init);
+
+  // Everything up to the last, possibly padded, quantum
+  full_len = pad > 0 ? in_len - 4 : in_len;
+  i = g_decode_blocks(in, full_len, out, len);
+  if (i != full_len) {
+    return 1;  // Invalid character
+  }
+  j = i / 4 * 3;
+
+  if (pad > 0) {
+    a = g_decode_table[(unsigned char)in[i]];
+    b = g_decode_table[(unsigned char)in[i + 1]];
+    c = pad == 2 ? 0 : g_decode_table[(unsigned char)in[i + 2]];
+    if (a == BASE64_INVALID || b == BASE64_INVALID || c == BASE64_INVALID) {
+      return 1;
+    }
+
+    out[j++] = (a << 2) | (b >> 4);
+    if (pad == 1) {
+      out[j++] = (b << 4) | (c >> 2);
+    }
+  }
+
+  if (decoded_len) *decoded_len = j;
+
+  return 0;
+}
+
+int base64_set_impl(base64_impl_e impl) {
+  pthread_once(&g_init_once, base64_init);
+
+  switch (impl) {
+    case BASE64_IMPL_AUTO:
+      base64_init();
+      return 0;
+    case BASE64_IMPL_SCALAR:
+      g_encode_blocks = encode_blocks_scalar;
+      g_decode_blocks = decode_blocks_scalar;
+      return 0;
+#ifdef BASE64_X86
+    case BASE64_IMPL_SSSE3:
+      if (!__builtin_cpu_supports("ssse3")) return 1;
+      g_encode_blocks = encode_blocks_ssse3;
+      g_decode_blocks = decode_blocks_ssse3;
+      return 0;
+    case BASE64_IMPL_AVX2:
+      if (!__builtin_cpu_supports("avx2")) return 1;
+      g_encode_blocks = encode_blocks_avx2;
+      g_decode_blocks = decode_blocks_avx2;
+      return 0;
+#endif
+    default:
+      return 1;
+  }
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file base64.h
+ * \brief
+ * Standard (RFC 4648) base64 encoder and decoder
+ *
+ * \notes
+ * On x86 the SSSE3 or AVX2 code path is selected at runtime, other targets
+ * use the portable scalar implementation. All implementations produce the
+ * same output and reject the same input.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _BASE64_H_
+#define _BASE64_H_
+
+#include <stddef.h>
+
+typedef enum {
+  BASE64_IMPL_AUTO,   /*!< fastest implementation supported by the CPU */
+  BASE64_IMPL_SCALAR, /*!< portable implementation */
+  BASE64_IMPL_SSSE3,  /*!< x86 SSSE3 */
+  BASE64_IMPL_AVX2,   /*!< x86 AVX2 */
+} base64_impl_e;
+
+/**
+ * @brief Length of encoded data, without null terminator
+ */
+size_t base64_encoded_len(size_t in_len);
+
+/**
+ * @brief Upper bound of decoded data length
+ */
+size_t base64_decoded_max_len(size_t in_len);
+
+/**
+ * @brief Encode data, with padding
+ *
+ * @param[in] in Data
+ * @param[in] in_len Data length
+ * @param[out] out Output buffer, null terminated on success
+ * @param[in] out_len Output buffer length, at least base64_encoded_len(in_len) + 1
+ *
+ * @return 0 on success, 1 on failure
+ */
+int base64_encode(const unsigned char *in, size_t in_len, char *out, size_t out_len);
+
+/**
+ * @brief Decode padded base64 text
+ *
+ * @param[in] in Base64 text, not necessarily null terminated
+ * @param[in] in_len Text length, multiple of 4
+ * @param[out] out Output buffer
+ * @param[in] out_len Output buffer length
+ * @param[out] decoded_len Number of decoded bytes, may be NULL
+ *
+ * @return 0 on success, 1 on invalid input or too small output buffer
+ */
+int base64_decode(const char *in, size_t in_len, unsigned char *out, size_t out_len, size_t *decoded_len);
+
+/**
+ * @brief Select implementation, mainly for testing and benchmarking
+ *
+ * @return 0 on success, 1 if the implementation is not supported on this CPU
+ */
+int base64_set_impl(base64_impl_e impl);
+
+#endif  // _BASE64_H_
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/unity.h"
+
+#include "base64.h"
+
+// Long enough for several AVX2 blocks and a scalar tail
+#define TEST_DATA_LEN 300
+#define TEST_TEXT_LEN (TEST_DATA_LEN / 3 * 4)
+
+static const base64_impl_e test_impls[] = {BASE64_IMPL_SCALAR, BASE64_IMPL_SSSE3, BASE64_IMPL_AVX2};
+static const char *test_impl_names[] = {"scalar", "ssse3", "avx2"};
+
+// RFC 4648 test vectors
+static const char *test_vectors[][2] = {{"", ""},
+                                        {"f", "Zg=="},
+                                        {"fo", "Zm8="},
+                                        {"foo", "Zm9v"},
+                                        {"foob", "Zm9vYg=="},
+                                        {"fooba", "Zm9vYmE="},
+                                        {"foobar", "Zm9vYmFy"}};
+
+static unsigned char test_data[TEST_DATA_LEN];
+static char test_text[TEST_TEXT_LEN + 1];
+
+// Decode with every implementation supported by the CPU, returns 1 only if all of them reject the text
+static int all_reject(const char *text, size_t text_len) {
+  unsigned char out[TEST_DATA_LEN];
+  int rejected = 0, impls = 0;
+
+  for (size_t i = 0; i < sizeof(test_impls) / sizeof(test_impls[0]); i++) {
+    if (base64_set_impl(test_impls[i]) != 0) continue;
+    impls++;
+    rejected += base64_decode(text, text_len, out, sizeof(out), NULL) != 0;
+  }
+  base64_set_impl(BASE64_IMPL_AUTO);
+
+  return rejected == impls;
+}
+
+void test_vectors_all_impls(void) {
+  for (size_t i = 0; i < sizeof(test_impls) / sizeof(test_impls[0]); i++) {
+    if (base64_set_impl(test_impls[i]) != 0) continue;
+
+    for (size_t j = 0; j < sizeof(test_vectors) / sizeof(test_vectors[0]); j++) {
+      const char *data = test_vectors[j][0], *text = test_vectors[j][1];
+      char encoded[16];
+      unsigned char decoded[16];
+      size_t decoded_len = 0;
+
+      TEST_ASSERT_EQUAL_INT(0, base64_encode((const unsigned char *)data, strlen(data), encoded, sizeof(encoded)));
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(text, encoded, test_impl_names[i]);
+      TEST_ASSERT_EQUAL_INT(0, base64_decode(text, strlen(text), decoded, sizeof(decoded), &decoded_len));
+      TEST_ASSERT_EQUAL_INT(strlen(data), decoded_len);
+      TEST_ASSERT_EQUAL_MEMORY(data, decoded, decoded_len);
+    }
+  }
+  base64_set_impl(BASE64_IMPL_AUTO);
+}
+
+void test_impls_agree(void) {
+  char expected[TEST_TEXT_LEN + 1];
+
+  // Every length, so each implementation hands a different tail to the scalar code
+  for (size_t len = 0; len <= TEST_DATA_LEN; len++) {
+    base64_set_impl(BASE64_IMPL_SCALAR);
+    TEST_ASSERT_EQUAL_INT(0, base64_encode(test_data, len, expected, sizeof(expected)));
+    TEST_ASSERT_EQUAL_INT(base64_encoded_len(len), strlen(expected));
+
+    for (size_t i = 0; i < sizeof(test_impls) / sizeof(test_impls[0]); i++) {
+      char encoded[TEST_TEXT_LEN + 1];
+      unsigned char decoded[TEST_DATA_LEN];
+      size_t decoded_len = 0;
+
+      if (base64_set_impl(test_impls[i]) != 0) continue;
+      TEST_ASSERT_EQUAL_INT(0, base64_encode(test_data, len, encoded, sizeof(encoded)));
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, encoded, test_impl_names[i]);
+      TEST_ASSERT_EQUAL_INT(0, base64_decode(encoded, strlen(encoded), decoded, sizeof(decoded), &decoded_len));
+      TEST_ASSERT_EQUAL_INT(len, decoded_len);
+      TEST_ASSERT_EQUAL_MEMORY(test_data, decoded, len);
+    }
+  }
+  base64_set_impl(BASE64_IMPL_AUTO);
+}
+
+void test_reject_invalid_characters(void) {
+  static const char invalid[] = {'!', '-', '_', '.', ' ', '\n', '\0', '=', (char)0x80, (char)0xff};
+  char text[TEST_TEXT_LEN + 1];
+
+  TEST_ASSERT_FALSE(all_reject(test_text, TEST_TEXT_LEN));
+
+  // At every position, so each SIMD lane and the scalar tail see them
+  for (size_t pos = 0; pos < TEST_TEXT_LEN; pos++) {
+    for (size_t i = 0; i < sizeof(invalid); i++) {
+      // Padding is valid in the last two positions
+      if (invalid[i] == '=' && pos >= TEST_TEXT_LEN - 2) continue;
+
+      memcpy(text, test_text, sizeof(text));
+      text[pos] = invalid[i];
+      TEST_ASSERT_TRUE_MESSAGE(all_reject(text, TEST_TEXT_LEN), "invalid character accepted");
+    }
+  }
+}
+
+void test_reject_bad_padding(void) {
+  static const char *texts[] = {"=", "==", "===", "====", "A===", "=AAA", "AA=A", "A=A=", "AA==AAAA", "Zg==Zg==",
+                                "Zm9", "Zm9vY", "Zg=", "Zg===", "Zm9v===="};
+
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    TEST_ASSERT_TRUE_MESSAGE(all_reject(texts[i], strlen(texts[i])), texts[i]);
+  }
+}
+
+void test_reject_small_buffers(void) {
+  unsigned char decoded[6];
+  char encoded[9];
+
+  TEST_ASSERT_EQUAL_INT(1, base64_encode((const unsigned char *)"foobar", 6, encoded, 8));
+  TEST_ASSERT_EQUAL_INT(0, base64_encode((const unsigned char *)"foobar", 6, encoded, 9));
+  TEST_ASSERT_EQUAL_INT(1, base64_decode("Zm9vYmFy", 8, decoded, 5, NULL));
+  TEST_ASSERT_EQUAL_INT(0, base64_decode("Zm9vYmE=", 8, decoded, 5, NULL));
+  TEST_ASSERT_EQUAL_INT(1, base64_decode(NULL, 0, decoded, sizeof(decoded), NULL));
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  srand(1);
+  for (int i = 0; i < TEST_DATA_LEN; i++) {
+    test_data[i] = rand();
+  }
+  base64_encode(test_data, TEST_DATA_LEN, test_text, sizeof(test_text));
+
+  RUN_TEST(test_vectors_all_impls);
+  RUN_TEST(test_impls_agree);
+  RUN_TEST(test_reject_invalid_characters);
+  RUN_TEST(test_reject_bad_padding);
+  RUN_TEST(test_reject_small_buffers);
+
+  return UNITY_END();
+}
@@ -0,0 +1,473 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file checkpoint.c
+ * \brief
+ * Persistent state used to resume incrementally after a restart
+ *
+ * \notes
+ * File format, one entry per line:
+ *   access_checkpoint 1
+ *   store_version <version>
+ *   wallet_unused_idx <index>
+ *   policies <count>
+ *   <policy ID>   (count lines)
+ *   end
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECKPOINT_PATH_LEN 256
+#define CHECKPOINT_LINE_LEN 128
+#define CHECKPOINT_FORMAT_VERSION 2
+
+static char g_path[CHECKPOINT_PATH_LEN] = {0};
+static char g_store_version[CHECKPOINT_STR_LEN] = {0};
+static uint64_t g_wallet_unused_idx = 0;
+static char *g_policy_ids = NULL;
+static int g_policy_ids_num = 0;
+static char *g_expired_ids = NULL;
+static int g_expired_ids_num = 0;
+static int g_has_policy_state = 0;
+static int g_save_failed = 0;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int read_line(FILE *f, char *line) {
+  size_t len;
+
+  if (fgets(line, CHECKPOINT_LINE_LEN, f) == NULL) {
+    return 1;
+  }
+
+  len = strlen(line);
+  if (len == 0 || line[len - 1] != '\n') {
+    return 1;  // Truncated or too long
+  }
+  line[len - 1] = '\0';
+
+  return 0;
+}
+
+static int load_ids(FILE *f, const char *name, char **ids, int *ids_num) {
+  char line[CHECKPOINT_LINE_LEN];
+  int count = 0;
+
+  if (read_line(f, line) != 0 || strncmp(line, name, strlen(name)) != 0 ||
+      sscanf(line + strlen(name), " %d", &count) != 1 || count < 0) {
+    return 1;
+  }
+
+  if (count > 0) {
+    *ids = calloc(count, CHECKPOINT_POL_ID_BUF_LEN);
+    if (*ids == NULL) {
+      return 1;
+    }
+  }
+
+  for (*ids_num = 0; *ids_num < count; (*ids_num)++) {
+    if (read_line(f, line) != 0 || strlen(line) != CHECKPOINT_POL_ID_LEN) {
+      return 1;
+    }
+    memcpy(&(*ids)[*ids_num * CHECKPOINT_POL_ID_BUF_LEN], line, CHECKPOINT_POL_ID_LEN);
+  }
+
+  return 0;
+}
+
+static int load(FILE *f) {
+  char line[CHECKPOINT_LINE_LEN];
+  int format = 0;
+
+  // Checkpoints of the first format have no expired policies
+  if (read_line(f, line) != 0 || sscanf(line, "access_checkpoint %d", &format) != 1 || format < 1 ||
+      format > CHECKPOINT_FORMAT_VERSION) {
+    return 1;
+  }
+
+  if (read_line(f, line) != 0 || strncmp(line, "store_version ", strlen("store_version ")) != 0 ||
+      strlen(line) - strlen("store_version ") >= CHECKPOINT_STR_LEN) {
+    return 1;
+  }
+  strcpy(g_store_version, line + strlen("store_version "));
+
+  if (read_line(f, line) != 0 || sscanf(line, "wallet_unused_idx %" SCNu64, &g_wallet_unused_idx) != 1) {
+    return 1;
+  }
+
+  if (load_ids(f, "policies", &g_policy_ids, &g_policy_ids_num) != 0) {
+    return 1;
+  }
+
+  if (format > 1 && load_ids(f, "expired", &g_expired_ids, &g_expired_ids_num) != 0) {
+    return 1;
+  }
+
+  if (read_line(f, line) != 0 || strcmp(line, "end") != 0) {
+    return 1;
+  }
+
+  return 0;
+}
+
+// Must be called with g_lock held
+// The renamed file is only durable once its directory entry is
+static int sync_dir(void) {
+  char dir[CHECKPOINT_PATH_LEN];
+  char *slash = NULL;
+  int fd, ret;
+
+  strcpy(dir, g_path);
+  slash = strrchr(dir, '/');
+  if (slash == NULL) {
+    strcpy(dir, ".");
+  } else {
+    slash[slash == dir ? 1 : 0] = '\0';
+  }
+
+  fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return 1;
+  }
+  ret = fsync(fd) == 0 ? 0 : 1;
+  close(fd);
+
+  return ret;
+}
+
+static int save(void) {
+  char tmp_path[CHECKPOINT_PATH_LEN + 4];
+  FILE *f = NULL;
+  int ret = 0;
+
+  if (g_path[0] == '\0') {
+    return 1;
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_path);
+  f = fopen(tmp_path, "w");
+  if (f == NULL) {
+    return 1;
+  }
+
+  fprintf(f, "access_checkpoint %d\n", CHECKPOINT_FORMAT_VERSION);
+  fprintf(f, "store_version %s\n", g_has_policy_state ? g_store_version : "0x0");
+  fprintf(f, "wallet_unused_idx %" PRIu64 "\n", g_wallet_unused_idx);
+  fprintf(f, "policies %d\n", g_policy_ids_num);
+  for (int i = 0; i < g_policy_ids_num; i++) {
+    fprintf(f, "%.*s\n", CHECKPOINT_POL_ID_LEN, &g_policy_ids[i * CHECKPOINT_POL_ID_BUF_LEN]);
+  }
+  fprintf(f, "expired %d\n", g_expired_ids_num);
+  for (int i = 0; i < g_expired_ids_num; i++) {
+    fprintf(f, "%.*s\n", CHECKPOINT_POL_ID_LEN, &g_expired_ids[i * CHECKPOINT_POL_ID_BUF_LEN]);
+  }
+  fprintf(f, "end\n");
+
+  if (fflush(f) != 0 || fsync(fileno(f)) != 0) {
+    ret = 1;
+  }
+  if (fclose(f) != 0) {
+    ret = 1;
+  }
+
+  if (ret != 0 || rename(tmp_path, g_path) != 0) {
+    remove(tmp_path);
+    g_save_failed = 1;
+    return 1;
+  }
+
+  g_save_failed = sync_dir();
+
+  return g_save_failed;
+}
+
+static void reset(void) {
+  free(g_policy_ids);
+  g_policy_ids = NULL;
+  g_policy_ids_num = 0;
+  free(g_expired_ids);
+  g_expired_ids = NULL;
+  g_expired_ids_num = 0;
+  g_store_version[0] = '\0';
+  g_wallet_unused_idx = 0;
+  g_has_policy_state = 0;
+  g_save_failed = 0;
+}
+
+int checkpoint_init(const char *path) {
+  FILE *f = NULL;
+  int ret = 1;
+
+  if (path == NULL || strlen(path) >= CHECKPOINT_PATH_LEN) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  reset();
+  strcpy(g_path, path);
+
+  f = fopen(path, "r");
+  if (f != NULL) {
+    if (load(f) == 0) {
+      g_has_policy_state = 1;
+      ret = 0;
+    } else {
+      reset();
+    }
+    fclose(f);
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+void checkpoint_deinit(void) {
+  pthread_mutex_lock(&g_lock);
+  reset();
+  g_path[0] = '\0';
+  pthread_mutex_unlock(&g_lock);
+}
+
+int checkpoint_get_policy_state(char *store_version, char **policy_ids, int *policy_ids_num) {
+  int ret = 1;
+
+  pthread_mutex_lock(&g_lock);
+  if (g_has_policy_state) {
+    *policy_ids = NULL;
+    *policy_ids_num = 0;
+    if (g_policy_ids_num > 0) {
+      *policy_ids = malloc(g_policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+    }
+    if (g_policy_ids_num == 0 || *policy_ids != NULL) {
+      if (g_policy_ids_num > 0) memcpy(*policy_ids, g_policy_ids, g_policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+      *policy_ids_num = g_policy_ids_num;
+      memcpy(store_version, g_store_version, CHECKPOINT_STR_LEN);
+      ret = 0;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+static int same_policy_state(const char *store_version, const char *policy_ids, int policy_ids_num) {
+  if (!g_has_policy_state || g_save_failed || policy_ids_num != g_policy_ids_num ||
+      strcmp(store_version, g_store_version) != 0) {
+    return 0;
+  }
+
+  for (int i = 0; i < policy_ids_num; i++) {
+    if (strncmp(&policy_ids[i * CHECKPOINT_POL_ID_BUF_LEN], &g_policy_ids[i * CHECKPOINT_POL_ID_BUF_LEN],
+                CHECKPOINT_POL_ID_BUF_LEN) != 0) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int checkpoint_set_policy_state(const char *store_version, const char *policy_ids, int policy_ids_num) {
+  char *ids = NULL;
+  int ret;
+
+  if (store_version == NULL || strlen(store_version) >= CHECKPOINT_STR_LEN || policy_ids_num < 0) {
+    return 1;
+  }
+
+  // Most syncs change nothing, skip rewriting and syncing the file then
+  pthread_mutex_lock(&g_lock);
+  ret = same_policy_state(store_version, policy_ids, policy_ids_num);
+  pthread_mutex_unlock(&g_lock);
+  if (ret) {
+    return 0;
+  }
+
+  if (policy_ids_num > 0) {
+    ids = malloc(policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+    if (ids == NULL) {
+      return 1;
+    }
+    memcpy(ids, policy_ids, policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  free(g_policy_ids);
+  g_policy_ids = ids;
+  g_policy_ids_num = policy_ids_num;
+  strcpy(g_store_version, store_version);
+  g_has_policy_state = 1;
+  ret = save();
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+static int find_id(const char *policy_id, const char *ids, int ids_num) {
+  for (int i = 0; i < ids_num; i++) {
+    if (memcmp(&ids[i * CHECKPOINT_POL_ID_BUF_LEN], policy_id, CHECKPOINT_POL_ID_LEN) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static int remove_id(const char *policy_id, char *ids, int *ids_num) {
+  int index = find_id(policy_id, ids, *ids_num);
+
+  if (index < 0) {
+    return 0;
+  }
+  memmove(&ids[index * CHECKPOINT_POL_ID_BUF_LEN], &ids[(index + 1) * CHECKPOINT_POL_ID_BUF_LEN],
+          (*ids_num - index - 1) * CHECKPOINT_POL_ID_BUF_LEN);
+  (*ids_num)--;
+
+  return 1;
+}
+
+int checkpoint_remove_policy(const char *policy_id, int reset_version) {
+  int removed = 0;
+  int ret = 0;
+
+  if (policy_id == NULL) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  removed = remove_id(policy_id, g_policy_ids, &g_policy_ids_num);
+  if (reset_version && g_has_policy_state && strcmp(g_store_version, "0x0") != 0) {
+    strcpy(g_store_version, "0x0");
+    removed = 1;
+  }
+  if (removed) {
+    ret = save();
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+int checkpoint_get_expired_policies(char **policy_ids, int *policy_ids_num) {
+  int ret = 0;
+
+  pthread_mutex_lock(&g_lock);
+  *policy_ids = NULL;
+  *policy_ids_num = 0;
+  if (g_expired_ids_num > 0) {
+    *policy_ids = malloc(g_expired_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+    if (*policy_ids != NULL) {
+      memcpy(*policy_ids, g_expired_ids, g_expired_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+      *policy_ids_num = g_expired_ids_num;
+    } else {
+      ret = 1;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+int checkpoint_expire_policy(const char *policy_id) {
+  int ret = 0;
+
+  if (policy_id == NULL) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  remove_id(policy_id, g_policy_ids, &g_policy_ids_num);
+  if (find_id(policy_id, g_expired_ids, g_expired_ids_num) < 0) {
+    char *ids = realloc(g_expired_ids, (g_expired_ids_num + 1) * CHECKPOINT_POL_ID_BUF_LEN);
+
+    if (ids == NULL) {
+      ret = 1;
+    } else {
+      g_expired_ids = ids;
+      memset(&g_expired_ids[g_expired_ids_num * CHECKPOINT_POL_ID_BUF_LEN], 0, CHECKPOINT_POL_ID_BUF_LEN);
+      memcpy(&g_expired_ids[g_expired_ids_num * CHECKPOINT_POL_ID_BUF_LEN], policy_id, CHECKPOINT_POL_ID_LEN);
+      g_expired_ids_num++;
+    }
+  }
+  if (save() != 0) {
+    ret = 1;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+int checkpoint_set_expired_policies(const char *policy_ids, int policy_ids_num) {
+  char *ids = NULL;
+  int ret;
+
+  if (policy_ids_num < 0) {
+    return 1;
+  }
+
+  if (policy_ids_num > 0) {
+    ids = malloc(policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+    if (ids == NULL) {
+      return 1;
+    }
+    memcpy(ids, policy_ids, policy_ids_num * CHECKPOINT_POL_ID_BUF_LEN);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  free(g_expired_ids);
+  g_expired_ids = ids;
+  g_expired_ids_num = policy_ids_num;
+  ret = save();
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
+
+uint64_t checkpoint_get_wallet_index(void) {
+  uint64_t unused_idx;
+
+  pthread_mutex_lock(&g_lock);
+  unused_idx = g_wallet_unused_idx;
+  pthread_mutex_unlock(&g_lock);
+
+  return unused_idx;
+}
+
+int checkpoint_set_wallet_index(uint64_t unused_idx) {
+  int ret;
+
+  pthread_mutex_lock(&g_lock);
+  g_wallet_unused_idx = unused_idx;
+  ret = save();
+  pthread_mutex_unlock(&g_lock);
+
+  return ret;
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file checkpoint.h
+ * \brief
+ * Persistent state used to resume incrementally after a restart
+ *
+ * \notes
+ * Holds the last acknowledged policy store version, the IDs of the policies
+ * installed by the policy loader, the IDs of policies that expired and must not
+ * be installed again, and the wallet's first unused address index.
+ * The file is rewritten atomically (temporary file and rename) on every
+ * update, so it is either the previous or the new state after a crash.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECKPOINT_STR_LEN 67
+#define CHECKPOINT_POL_ID_LEN 64
+#define CHECKPOINT_POL_ID_BUF_LEN (CHECKPOINT_POL_ID_LEN + 1)
+
+/**
+ * @brief Load checkpoint, missing or malformed file results in an empty state
+ *
+ * @param[in] path Checkpoint file path
+ *
+ * @return 0 if a checkpoint was restored, 1 otherwise
+ */
+int checkpoint_init(const char *path);
+
+/**
+ * @brief Release checkpoint state
+ */
+void checkpoint_deinit(void);
+
+/**
+ * @brief Get policy sync state
+ *
+ * @param[out] store_version Policy store version, CHECKPOINT_STR_LEN bytes
+ * @param[out] policy_ids Allocated array of CHECKPOINT_POL_ID_BUF_LEN sized null terminated IDs, freed by caller
+ * @param[out] policy_ids_num Number of IDs
+ *
+ * @return 0 on success, 1 if there is no saved state
+ */
+int checkpoint_get_policy_state(char *store_version, char **policy_ids, int *policy_ids_num);
+
+/**
+ * @brief Replace policy sync state and save checkpoint if the state changed
+ *
+ * @param[in] store_version Policy store version
+ * @param[in] policy_ids Array of CHECKPOINT_POL_ID_BUF_LEN sized IDs
+ * @param[in] policy_ids_num Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_set_policy_state(const char *store_version, const char *policy_ids, int policy_ids_num);
+
+/**
+ * @brief Remove a policy from the saved sync state and save checkpoint
+ *
+ * @param[in] policy_id Policy ID, CHECKPOINT_POL_ID_LEN characters
+ * @param[in] reset_version Also reset the policy store version, so the full list is requested after a restart
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_remove_policy(const char *policy_id, int reset_version);
+
+/**
+ * @brief Get IDs of policies which expired and must not be installed again
+ *
+ * @param[out] policy_ids Allocated array of CHECKPOINT_POL_ID_BUF_LEN sized null terminated IDs, freed by caller
+ * @param[out] policy_ids_num Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_get_expired_policies(char **policy_ids, int *policy_ids_num);
+
+/**
+ * @brief Move a policy from the saved sync state to the expired policies and save checkpoint
+ *
+ * @param[in] policy_id Policy ID, CHECKPOINT_POL_ID_LEN characters
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_expire_policy(const char *policy_id);
+
+/**
+ * @brief Replace expired policies and save checkpoint
+ *
+ * @param[in] policy_ids Array of CHECKPOINT_POL_ID_BUF_LEN sized IDs
+ * @param[in] policy_ids_num Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_set_expired_policies(const char *policy_ids, int policy_ids_num);
+
+/**
+ * @brief Get saved wallet unused address index, 0 if unknown
+ */
+uint64_t checkpoint_get_wallet_index(void);
+
+/**
+ * @brief Replace wallet unused address index and save checkpoint
+ *
+ * @return 0 on success, 1 on failure
+ */
+int checkpoint_set_wallet_index(uint64_t unused_idx);
+
+#endif  // _CHECKPOINT_H_
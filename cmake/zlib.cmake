@@ -0,0 +1,13 @@
+# fetch external libs
+include(ExternalProject)
+
+# fetch zlib
+include(FetchContent)
+FetchContent_Declare(
+        zlib
+        GIT_REPOSITORY https://github.com/madler/zlib.git
+        GIT_TAG v1.2.11
+)
+
+message(STATUS "Fetching zlib")
+FetchContent_MakeAvailable(zlib)
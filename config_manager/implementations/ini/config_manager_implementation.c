@@ -56,7 +56,9 @@ int config_manager_implementation_init_cb(void *in_parameter) {
     char *this_chunk = configuration->data + total_bytes_read;
     bytes_read = fread(this_chunk, 1, READ_CHUNK_SIZE, fp);
     for (int i = 0; i < bytes_read; i++) {
-      if (new_line == 1 && this_chunk[i] == '#') {  // comment line
+      if (new_line == 1 && this_chunk[i] == '\n') {  // empty line, sections are separated by them
+        continue;
+      } else if (new_line == 1 && this_chunk[i] == '#') {  // comment line
         comment_line = 1;
         new_line = 0;
       } else if (new_line == 1) {
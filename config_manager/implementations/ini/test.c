@@ -30,6 +30,8 @@ const char g_config_ini[] =
     "[module1]\n"
     "option1=va1ue\n"
     "option2=v4lue\n"
+    "\n"
+    "# sections are separated by empty lines\n"
     "[module2]\n"
     "option1=m2vlue\n"
     "option2=v8leu\n"
@@ -19,15 +19,20 @@
 
 #include <signal.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "access.h"
+#include "checkpoint.h"
 #include "config_manager.h"
 #include "dataset.h"
 #include "network.h"
+#include "pap_plugin_cache.h"
 #include "pap_plugin_posix.h"
+#include "pap_plugin_sqlite.h"
 #include "pep_plugin_print.h"
 #include "policy_loader.h"
+#include "policy_proxy.h"
 
 #define MAX_CLIENT_NAME 32
 #define MAX_STR_LEN 512
@@ -44,6 +49,30 @@ static network_ctx_t network_context;
 static access_ctx_t access_context;
 static wallet_ctx_t *wallet_context;
 
+// The PAP identifies policies by their binary ID, the loader by the hex string of it
+static void policy_id_to_hex(const char *policy_id, char *policy_id_hex) {
+  for (int i = 0; i < PAP_POL_ID_MAX_LEN; i++) {
+    sprintf(&policy_id_hex[2 * i], "%02x", (unsigned char)policy_id[i]);
+  }
+}
+
+// A queued policy the storage plugin kept failing to store is fetched again by the loader
+static void policy_store_failed(char *policy_id) {
+  char policy_id_hex[2 * PAP_POL_ID_MAX_LEN + 1] = {0};
+
+  policy_id_to_hex(policy_id, policy_id_hex);
+  policyloader_forget_policy(policy_id_hex);
+}
+
+// An expired policy the posix store evicted must not be served by the cache nor be fetched again by the loader
+static void policy_expired(char *policy_id) {
+  char policy_id_hex[2 * PAP_POL_ID_MAX_LEN + 1] = {0};
+
+  pap_plugin_cache_evict(policy_id);
+  policy_id_to_hex(policy_id, policy_id_hex);
+  policyloader_expire_policy(policy_id_hex);
+}
+
 int wallet_init() {
   char node_url[MAX_STR_LEN] = {0};
   char seed[SEED_LEN] = {0};
@@ -93,12 +122,21 @@ int main(int argc, char **argv) {
   int status = config_manager_get_option_int("config", "thread_sleep_period", &g_task_sleep_time);
   if (status != CONFIG_MANAGER_OK) g_task_sleep_time = 1000;  // 1 second
 
-  policyloader_start();
+  char checkpoint_file[MAX_STR_LEN] = {0};
+  if (config_manager_get_option_string("config", "checkpoint_file", checkpoint_file, MAX_STR_LEN) !=
+      CONFIG_MANAGER_OK)
+    strcpy(checkpoint_file, "checkpoint.txt");
+  checkpoint_init(checkpoint_file);
 
   access_init(&access_context);
   if (wallet_init() != 0) {
     printf("\nERROR[%s]: Wallet creation failed. Aborting.\n", __FUNCTION__);
+  } else if (checkpoint_get_wallet_index() > wallet_context->unused_idx) {
+    // Skip the address scan over indexes already used before the restart
+    wallet_context->unused_idx = checkpoint_get_wallet_index();
   }
+  // Saved whenever it changes, so after a crash the next start does not scan used addresses again
+  if (wallet_context != NULL) wallet_context->index_cb = checkpoint_set_wallet_index;
 
   // register plugins
   plugin_t plugin;
@@ -107,12 +145,36 @@ int main(int argc, char **argv) {
     access_register_pep_plugin(access_context, &plugin);
   }
 
-  if (plugin_init(&plugin, pap_plugin_posix_initializer, NULL) == 0) {
+  char pap_storage[MAX_STR_LEN] = {0};
+  int (*pap_initializer)(plugin_t *, void *) = pap_plugin_posix_initializer;
+  config_manager_get_option_string("pap", "storage", pap_storage, MAX_STR_LEN);
+  if (strcmp(pap_storage, "sqlite") == 0) pap_initializer = pap_plugin_sqlite_initializer;
+
+  // Policies are served from memory when hot, the cache forwards everything else to the storage plugin
+  plugin_t pap_storage_plugin;
+  if (plugin_init(&pap_storage_plugin, pap_initializer, NULL) == 0 &&
+      plugin_init(&plugin, pap_plugin_cache_initializer, &pap_storage_plugin) == 0) {
     access_register_pap_plugin(access_context, &plugin);
+    pap_plugin_cache_set_fail_cb(policy_store_failed);
+    // Calls reading the storage plugin directly first wait for the writes queued in the cache
+    if (pap_initializer == pap_plugin_posix_initializer) {
+      pap_plugin_posix_set_drain_cb(pap_plugin_cache_drain);
+    } else {
+      pap_plugin_sqlite_set_drain_cb(pap_plugin_cache_drain);
+    }
   }
 
   // end register plugins
 
+  // Policies are installed through the PAP plugin, so the loader starts once it is registered
+  policyloader_start();
+
+  // Expired policies leave the posix store in the background, once the cache and the loader can be told
+  if (pap_initializer == pap_plugin_posix_initializer) pap_plugin_posix_set_evict_cb(policy_expired);
+  if (policyproxy_start() != 0) {
+    fprintf(stderr, "Error starting policy proxy\n");
+  }
+
   network_init(&network_context);
 
   access_start(access_context);
@@ -126,12 +188,20 @@ int main(int argc, char **argv) {
   // Stop threads
   network_stop(network_context);
 
+  // The loader adds policies through the PAP, so it stops before the PAP is torn down. It aborts pending policy store
+  // requests, so proxy workers waiting on them return.
+  policyloader_stop();
+  policyproxy_stop();
+
   // Deinit modules
   access_deinit(access_context);
 
-  policyloader_stop();
-
+  if (wallet_context != NULL) {
+    checkpoint_set_wallet_index(wallet_context->unused_idx);
+  }
   wallet_destory(&wallet_context);
 
+  checkpoint_deinit();
+
   return 0;
 }
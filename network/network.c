@@ -52,7 +52,7 @@
 #include "pap_plugin.h"
 #include "pep.h"
 #include "pip.h"
-#include "policy_updater.h"
+#include "policy_loader.h"
 #include "utils.h"
 
 #define SEND_BUFF_LEN 4096
@@ -116,8 +116,6 @@ int network_init(network_ctx_t *network_context) {
   ctx->listenfd = 0;
   ctx->connfd = 0;
 
-  policyupdater_init();
-
   *network_context = (void *)ctx;
 
   logger_init_network(LOGGER_INFO);
@@ -191,6 +189,23 @@ static unsigned int calculate_decision(char **recv_data, network_ctx_internal_t
 
   if (request_code == COMMAND_RESOLVE) {
     char decision[BUF_LEN] = {0};
+    char policy_id[POL_ID_STR_LEN + 1] = {0};
+
+    for (int i = 0; i < num_of_tokens - 1; i++) {
+      if (memcmp(*recv_data + jsonhelper_get_token_start(i), "policy_id", strlen("policy_id")) == 0) {
+        if (jsonhelper_token_size(i + 1) == POL_ID_STR_LEN) {
+          memcpy(policy_id, *recv_data + jsonhelper_get_token_start(i + 1), POL_ID_STR_LEN);
+        }
+        break;
+      }
+    }
+
+    // Policy is not synced yet, fetch it now instead of denying access until the next sync. The wait is bounded, a
+    // slow policy store only delays this request by on_demand_wait_ms.
+    if (policy_id[0] != '\0' && !pap_has_policy(policy_id, POL_ID_STR_LEN)) {
+      policyloader_fetch_policy(policy_id);
+    }
+
     //@TODO: Should this be moved to access actor? Network should just send cb here to notify request.
     pep_request_access(*recv_data, (void *)decision);
 
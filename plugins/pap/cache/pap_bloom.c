@@ -0,0 +1,102 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_bloom.c
+ * \brief
+ * Bloom filter over policy IDs
+ *
+ * \notes
+ * Bit positions come from double hashing of one 64-bit FNV-1a hash.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "pap_bloom.h"
+
+#include <stdlib.h>
+
+#include "pap.h"
+
+#define PAP_BLOOM_BITS_PER_ID 10
+#define PAP_BLOOM_HASHES 7
+
+static void id_hashes(const char *policy_id, uint64_t *h1, uint64_t *h2) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (int i = 0; i < PAP_POL_ID_MAX_LEN; i++) {
+    hash ^= (unsigned char)policy_id[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  *h1 = hash;
+  *h2 = ((hash >> 32) | (hash << 32)) | 1;  // odd, so the probe sequence does not collapse
+}
+
+int pap_bloom_init(pap_bloom_t *bloom, int capacity) {
+  if (bloom == NULL || capacity <= 0) {
+    return 1;
+  }
+
+  bloom->num_bits = ((uint64_t)capacity * PAP_BLOOM_BITS_PER_ID + 63) & ~63ULL;
+  bloom->bits = calloc(bloom->num_bits / 64, sizeof(uint64_t));
+  bloom->capacity = capacity;
+  bloom->count = 0;
+
+  return bloom->bits == NULL ? 1 : 0;
+}
+
+void pap_bloom_release(pap_bloom_t *bloom) {
+  if (bloom == NULL) {
+    return;
+  }
+
+  free(bloom->bits);
+  bloom->bits = NULL;
+  bloom->num_bits = 0;
+  bloom->capacity = 0;
+  bloom->count = 0;
+}
+
+void pap_bloom_add(pap_bloom_t *bloom, const char *policy_id) {
+  uint64_t h1, h2;
+
+  id_hashes(policy_id, &h1, &h2);
+  for (int i = 0; i < PAP_BLOOM_HASHES; i++) {
+    uint64_t bit = (h1 + i * h2) % bloom->num_bits;
+    bloom->bits[bit / 64] |= 1ULL << (bit % 64);
+  }
+  bloom->count++;
+}
+
+int pap_bloom_maybe_has(const pap_bloom_t *bloom, const char *policy_id) {
+  uint64_t h1, h2;
+
+  id_hashes(policy_id, &h1, &h2);
+  for (int i = 0; i < PAP_BLOOM_HASHES; i++) {
+    uint64_t bit = (h1 + i * h2) % bloom->num_bits;
+    if ((bloom->bits[bit / 64] & (1ULL << (bit % 64))) == 0) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_bloom.h
+ * \brief
+ * Bloom filter over policy IDs
+ *
+ * \notes
+ * Sized for 10 bits per ID with 7 hashes, about 1% false positives at
+ * capacity. Removal is not supported, the owner rebuilds the filter.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+#ifndef _PAP_BLOOM_H_
+#define _PAP_BLOOM_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint64_t *bits;
+  uint64_t num_bits;
+  int capacity;
+  int count;
+} pap_bloom_t;
+
+/**
+ * @brief Allocate an empty filter for capacity IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int pap_bloom_init(pap_bloom_t *bloom, int capacity);
+
+void pap_bloom_release(pap_bloom_t *bloom);
+
+void pap_bloom_add(pap_bloom_t *bloom, const char *policy_id);
+
+/**
+ * @return 0 if the ID was never added, 1 if it may have been
+ */
+int pap_bloom_maybe_has(const pap_bloom_t *bloom, const char *policy_id);
+
+#endif  // _PAP_BLOOM_H_
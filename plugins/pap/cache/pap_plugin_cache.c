@@ -0,0 +1,878 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_plugin_cache.c
+ * \brief
+ * LRU cache of policies in front of another PAP plugin
+ *
+ * \notes
+ * Put and delete invalidate the entry before reaching the backend. A get
+ * that misses is filled from the backend and cached, unless a put or delete
+ * ran meanwhile, so a stale policy is never inserted.
+ *
+ * A Bloom filter over all stored IDs answers lookups of missing policies
+ * without the backend. Puts add to it, deletes leave stale bits behind until
+ * the filter is rebuilt from the backend listing.
+ *
+ * With write-behind enabled, puts and deletes land in a pending table that
+ * lookups consult first and return without waiting for the backend. Flusher
+ * threads drain it in order, writes to an ID that is still queued replace
+ * the queued one, and writes to the same ID are never flushed concurrently.
+ * A listing waits until the table is drained.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+/****************************************************************************
+ * INCLUDES
+ ****************************************************************************/
+#include "pap_plugin_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config_manager.h"
+#include "pap.h"
+#include "pap_bloom.h"
+#include "pap_plugin_object.h"
+#include "plugin_logger.h"
+
+/****************************************************************************
+ * MACROS
+ ****************************************************************************/
+#define PAP_CACHE_BUCKETS 4096
+#define PAP_CACHE_DEFAULT_BYTES (1024 * 1024)
+#define PAP_FILTER_MIN_CAPACITY 1024
+#define PAP_WB_DEFAULT_QUEUE 1024
+#define PAP_WB_DEFAULT_THREADS 4
+#define PAP_WB_MAX_THREADS 16
+#define PAP_WB_MAX_ATTEMPTS 5
+#define PAP_WB_RETRY_MIN_MS 100
+#define PAP_WB_RETRY_MAX_MS 5000
+
+/****************************************************************************
+ * LOCAL TYPES
+ ****************************************************************************/
+typedef struct pap_cache_entry {
+  pap_policy_t policy;  // owns policy_object.policy_object
+  size_t size;
+  struct pap_cache_entry* hash_next;
+  struct pap_cache_entry* lru_prev;  // towards the most recently used
+  struct pap_cache_entry* lru_next;
+} pap_cache_entry_t;
+
+typedef enum { PAP_WB_PUT, PAP_WB_DEL } pap_wb_op_e;
+
+typedef struct pap_wb_entry {
+  pap_policy_t policy;  // owns policy_object.policy_object, only the ID is used by deletes
+  pap_wb_op_e op;
+  int flushing;
+  int hashed;    // cleared once a newer write to the same ID replaces it in the pending table
+  int attempts;  // failed backend writes, the entry is not taken again before retry_at
+  struct timespec retry_at;
+  struct pap_wb_entry* hash_next;
+  struct pap_wb_entry* queue_prev;
+  struct pap_wb_entry* queue_next;
+} pap_wb_entry_t;
+
+/****************************************************************************
+ * LOCAL VARIABLES
+ ****************************************************************************/
+static pthread_mutex_t g_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static plugin_t g_backend;
+static pap_cache_entry_t* g_buckets[PAP_CACHE_BUCKETS];
+static pap_cache_entry_t* g_lru_head = NULL;
+static pap_cache_entry_t* g_lru_tail = NULL;
+static size_t g_max_bytes = PAP_CACHE_DEFAULT_BYTES;
+static unsigned long long g_generation = 0;  // bumped by every put and delete
+static pap_plugin_cache_stats_t g_stats;
+// Held shared by puts across the backend call, so a rebuild never misses a policy being stored
+static pthread_rwlock_t g_filter_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static pap_bloom_t g_filter;
+static int g_filter_deletes = 0;
+// Write-behind state, guarded by the cache lock
+static pap_wb_entry_t* g_pending[PAP_CACHE_BUCKETS];
+static pap_wb_entry_t* g_queue_head = NULL;
+static pap_wb_entry_t* g_queue_tail = NULL;
+static pap_wb_entry_t* g_flushing[PAP_WB_MAX_THREADS];
+static pthread_cond_t g_wb_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_wb_done = PTHREAD_COND_INITIALIZER;  // an entry left the pending table
+static pthread_t g_wb_threads[PAP_WB_MAX_THREADS];
+static int g_wb_num_threads = 0;
+static int g_wb_max = 0;  // 0 disables write-behind
+static int g_wb_count = 0;
+static int g_wb_end = 0;
+static pap_plugin_cache_fail_cb_t g_fail_cb = NULL;
+
+/****************************************************************************
+ * LOCAL FUNCTIONS
+ ****************************************************************************/
+static unsigned int id_hash(const char* policy_id) {
+  unsigned int hash = 2166136261u;
+
+  for (int i = 0; i < PAP_POL_ID_MAX_LEN; i++) {
+    hash = (hash ^ (unsigned char)policy_id[i]) * 16777619u;
+  }
+
+  return hash % PAP_CACHE_BUCKETS;
+}
+
+static pap_cache_entry_t** bucket_of(const char* policy_id) { return &g_buckets[id_hash(policy_id)]; }
+
+static void lru_unlink(pap_cache_entry_t* entry) {
+  if (entry->lru_prev != NULL) {
+    entry->lru_prev->lru_next = entry->lru_next;
+  } else {
+    g_lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != NULL) {
+    entry->lru_next->lru_prev = entry->lru_prev;
+  } else {
+    g_lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = NULL;
+  entry->lru_next = NULL;
+}
+
+static void lru_push_front(pap_cache_entry_t* entry) {
+  entry->lru_next = g_lru_head;
+  if (g_lru_head != NULL) g_lru_head->lru_prev = entry;
+  g_lru_head = entry;
+  if (g_lru_tail == NULL) g_lru_tail = entry;
+}
+
+static pap_cache_entry_t* cache_find(const char* policy_id) {
+  for (pap_cache_entry_t* entry = *bucket_of(policy_id); entry != NULL; entry = entry->hash_next) {
+    if (memcmp(entry->policy.policy_id, policy_id, PAP_POL_ID_MAX_LEN) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static void cache_remove(pap_cache_entry_t* entry) {
+  pap_cache_entry_t** link = bucket_of(entry->policy.policy_id);
+
+  while (*link != entry) link = &(*link)->hash_next;
+  *link = entry->hash_next;
+  lru_unlink(entry);
+
+  g_stats.bytes -= entry->size;
+  g_stats.entries--;
+  free(entry->policy.policy_object.policy_object);
+  free(entry);
+}
+
+static void cache_invalidate(const char* policy_id) {
+  pap_cache_entry_t* entry = cache_find(policy_id);
+
+  g_generation++;
+  if (entry != NULL) cache_remove(entry);
+}
+
+// Copy the policy fetched from the backend into the cache, evicting from the tail to stay within the size limit
+static void cache_insert(const char* policy_id, const pap_policy_t* policy) {
+  pap_cache_entry_t* entry = NULL;
+  size_t size = sizeof(pap_cache_entry_t) + policy->policy_object.policy_object_size;
+
+  if (size > g_max_bytes || cache_find(policy_id) != NULL) {
+    return;
+  }
+
+  entry = calloc(1, sizeof(pap_cache_entry_t));
+  if (entry == NULL) {
+    return;
+  }
+  entry->policy = *policy;
+  memcpy(entry->policy.policy_id, policy_id, PAP_POL_ID_MAX_LEN);
+  entry->policy.policy_object.policy_object = malloc(policy->policy_object.policy_object_size);
+  if (entry->policy.policy_object.policy_object == NULL) {
+    free(entry);
+    return;
+  }
+  memcpy(entry->policy.policy_object.policy_object, policy->policy_object.policy_object,
+         policy->policy_object.policy_object_size);
+  entry->size = size;
+
+  while (g_stats.bytes + size > g_max_bytes && g_lru_tail != NULL) {
+    cache_remove(g_lru_tail);
+    g_stats.evictions++;
+  }
+
+  entry->hash_next = *bucket_of(policy_id);
+  *bucket_of(policy_id) = entry;
+  lru_push_front(entry);
+  g_stats.bytes += size;
+  g_stats.entries++;
+}
+
+// Look the policy up and mark it most recently used, must be called with the cache lock held
+static pap_cache_entry_t* cache_get(const char* policy_id) {
+  pap_cache_entry_t* entry = g_max_bytes > 0 ? cache_find(policy_id) : NULL;
+
+  if (entry != NULL) {
+    lru_unlink(entry);
+    lru_push_front(entry);
+    g_stats.hits++;
+  } else {
+    g_stats.misses++;
+  }
+
+  return entry;
+}
+
+static void cache_clear() {
+  while (g_lru_tail != NULL) cache_remove(g_lru_tail);
+}
+
+static pap_wb_entry_t* pending_find(const char* policy_id) {
+  for (pap_wb_entry_t* entry = g_pending[id_hash(policy_id)]; entry != NULL; entry = entry->hash_next) {
+    if (memcmp(entry->policy.policy_id, policy_id, PAP_POL_ID_MAX_LEN) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static void pending_unlink(pap_wb_entry_t* entry) {
+  pap_wb_entry_t** link = &g_pending[id_hash(entry->policy.policy_id)];
+
+  while (*link != entry) link = &(*link)->hash_next;
+  *link = entry->hash_next;
+  entry->hashed = 0;
+}
+
+static void queue_unlink(pap_wb_entry_t* entry) {
+  if (entry->queue_prev != NULL) {
+    entry->queue_prev->queue_next = entry->queue_next;
+  } else {
+    g_queue_head = entry->queue_next;
+  }
+  if (entry->queue_next != NULL) {
+    entry->queue_next->queue_prev = entry->queue_prev;
+  } else {
+    g_queue_tail = entry->queue_prev;
+  }
+  entry->queue_prev = NULL;
+  entry->queue_next = NULL;
+}
+
+static void queue_append(pap_wb_entry_t* entry) {
+  entry->queue_prev = g_queue_tail;
+  entry->queue_next = NULL;
+  if (g_queue_tail != NULL) {
+    g_queue_tail->queue_next = entry;
+  } else {
+    g_queue_head = entry;
+  }
+  g_queue_tail = entry;
+}
+
+// A queued write coalesces with a newer one to the same ID, unless a flusher has already taken it
+static int pending_coalesces(const char* policy_id) {
+  pap_wb_entry_t* entry = pending_find(policy_id);
+
+  return entry != NULL && !entry->flushing;
+}
+
+// Wait until the pending table has room for a write, must be called with the cache lock held
+static void pending_wait_space(const char* policy_id) {
+  while (g_wb_count >= g_wb_max && !pending_coalesces(policy_id)) {
+    pthread_cond_wait(&g_wb_done, &g_cache_lock);
+  }
+}
+
+// Record a put or delete in the pending table and queue it for the flushers, must be called with the cache lock held
+static int pending_push(const pap_policy_t* policy, pap_wb_op_e op) {
+  pap_wb_entry_t* entry = pending_find(policy->policy_id);
+  char* object = NULL;
+
+  if (op == PAP_WB_PUT) {
+    object = malloc(policy->policy_object.policy_object_size);
+    if (object == NULL) {
+      log_error(plugin_logger_id, "[%s:%d] could not allocate memory.\n", __func__, __LINE__);
+      return -1;
+    }
+    memcpy(object, policy->policy_object.policy_object, policy->policy_object.policy_object_size);
+  }
+
+  if (entry != NULL && !entry->flushing) {
+    free(entry->policy.policy_object.policy_object);
+    g_stats.coalesced++;
+  } else {
+    // A write to the same ID being flushed is superseded, the flusher frees it when done
+    if (entry != NULL) pending_unlink(entry);
+
+    entry = calloc(1, sizeof(pap_wb_entry_t));
+    if (entry == NULL) {
+      log_error(plugin_logger_id, "[%s:%d] could not allocate memory.\n", __func__, __LINE__);
+      free(object);
+      return -1;
+    }
+    entry->hash_next = g_pending[id_hash(policy->policy_id)];
+    g_pending[id_hash(policy->policy_id)] = entry;
+    entry->hashed = 1;
+    queue_append(entry);
+    g_wb_count++;
+  }
+  // A newer write is tried right away, even if the one it replaces was waiting for a retry
+  entry->attempts = 0;
+
+  if (op == PAP_WB_PUT) {
+    entry->policy = *policy;
+    entry->policy.policy_object.policy_object = object;
+  } else {
+    memset(&entry->policy, 0, sizeof(pap_policy_t));
+    memcpy(entry->policy.policy_id, policy->policy_id, PAP_POL_ID_MAX_LEN);
+  }
+  entry->op = op;
+  pthread_cond_signal(&g_wb_ready);
+
+  return 0;
+}
+
+static int time_before(const struct timespec* a, const struct timespec* b) {
+  return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// Take the oldest queued write whose ID is not being flushed by another thread and which is not waiting for a
+// retry. retry_at is set to the earliest retry among the writes left waiting, if any.
+static pap_wb_entry_t* queue_take(int slot, struct timespec* retry_at, int* retry_pending) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  *retry_pending = 0;
+  for (pap_wb_entry_t* entry = g_queue_head; entry != NULL; entry = entry->queue_next) {
+    int busy = 0;
+
+    if (entry->attempts > 0 && time_before(&now, &entry->retry_at)) {
+      if (!*retry_pending || time_before(&entry->retry_at, retry_at)) *retry_at = entry->retry_at;
+      *retry_pending = 1;
+      continue;
+    }
+    for (int i = 0; i < g_wb_num_threads && !busy; i++) {
+      busy = g_flushing[i] != NULL && memcmp(g_flushing[i]->policy.policy_id, entry->policy.policy_id,
+                                             PAP_POL_ID_MAX_LEN) == 0;
+    }
+    if (!busy) {
+      queue_unlink(entry);
+      entry->flushing = 1;
+      g_flushing[slot] = entry;
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+// Queue a failed write again with exponential backoff, must be called with the cache lock held. Returns 0 if the
+// write was given up.
+static int retry_later(pap_wb_entry_t* entry) {
+  long delay_ms = PAP_WB_RETRY_MIN_MS;
+
+  if (++entry->attempts >= PAP_WB_MAX_ATTEMPTS) {
+    return 0;
+  }
+  for (int i = 1; i < entry->attempts && delay_ms < PAP_WB_RETRY_MAX_MS; i++) delay_ms *= 2;
+  if (delay_ms > PAP_WB_RETRY_MAX_MS) delay_ms = PAP_WB_RETRY_MAX_MS;
+
+  clock_gettime(CLOCK_REALTIME, &entry->retry_at);
+  entry->retry_at.tv_sec += delay_ms / 1000;
+  entry->retry_at.tv_nsec += (delay_ms % 1000) * 1000000L;
+  if (entry->retry_at.tv_nsec >= 1000000000L) {
+    entry->retry_at.tv_sec++;
+    entry->retry_at.tv_nsec -= 1000000000L;
+  }
+  entry->flushing = 0;
+  queue_append(entry);
+
+  return 1;
+}
+
+static void* flusher_thread(void* arg) {
+  int slot = (int)(intptr_t)arg;
+
+  pthread_mutex_lock(&g_cache_lock);
+  while (1) {
+    struct timespec retry_at;
+    int retry_pending;
+    pap_wb_entry_t* entry = queue_take(slot, &retry_at, &retry_pending);
+    char failed_id[PAP_POL_ID_MAX_LEN];
+    int failed = 0;
+    int ret;
+
+    if (entry == NULL) {
+      // Writes blocked behind another flusher are picked up by that flusher
+      if (g_wb_end && g_queue_head == NULL) break;
+      if (retry_pending) {
+        pthread_cond_timedwait(&g_wb_ready, &g_cache_lock, &retry_at);
+      } else {
+        pthread_cond_wait(&g_wb_ready, &g_cache_lock);
+      }
+      continue;
+    }
+    pthread_mutex_unlock(&g_cache_lock);
+
+    // Entries leave the pending table only under the filter lock, so a filter rebuild sees each write either in the
+    // backend listing or in the pending table
+    pthread_rwlock_rdlock(&g_filter_rwlock);
+    if (entry->op == PAP_WB_PUT) {
+      ret = plugin_call(&g_backend, PAP_PLUGIN_PUT_CB, &entry->policy);
+    } else {
+      ret = plugin_call(&g_backend, PAP_PLUGIN_DEL_CB, entry->policy.policy_id);
+    }
+
+    pthread_mutex_lock(&g_cache_lock);
+    g_flushing[slot] = NULL;
+    // A failed write stays pending and keeps serving reads until it is retried, unless a newer one replaced it
+    if (ret != 0 && entry->hashed && retry_later(entry)) {
+      log_error(plugin_logger_id, "[%s:%d] could not write policy to backend, retry %d.\n", __func__, __LINE__,
+                entry->attempts);
+      pthread_rwlock_unlock(&g_filter_rwlock);
+      pthread_cond_broadcast(&g_wb_ready);
+      continue;
+    }
+    if (ret != 0 && entry->hashed) {
+      log_error(plugin_logger_id, "[%s:%d] could not write policy to backend, giving up.\n", __func__, __LINE__);
+      failed = entry->op == PAP_WB_PUT;
+      memcpy(failed_id, entry->policy.policy_id, PAP_POL_ID_MAX_LEN);
+    }
+    if (entry->hashed) pending_unlink(entry);
+    pthread_rwlock_unlock(&g_filter_rwlock);
+
+    // Reported while still counted as pending, so a drain returns only once the failure is known
+    if (failed && g_fail_cb != NULL) {
+      pthread_mutex_unlock(&g_cache_lock);
+      g_fail_cb(failed_id);
+      pthread_mutex_lock(&g_cache_lock);
+    }
+    g_wb_count--;
+    pthread_cond_broadcast(&g_wb_done);
+    // A write to the same ID may have been waiting for this one
+    pthread_cond_broadcast(&g_wb_ready);
+
+    free(entry->policy.policy_object.policy_object);
+    free(entry);
+  }
+  pthread_mutex_unlock(&g_cache_lock);
+
+  return NULL;
+}
+
+static void write_behind_start(int num_threads) {
+  g_wb_end = 0;
+  g_wb_num_threads = 0;
+  for (int i = 0; i < num_threads; i++) {
+    if (pthread_create(&g_wb_threads[i], NULL, flusher_thread, (void*)(intptr_t)i) != 0) {
+      break;
+    }
+    g_wb_num_threads++;
+  }
+
+  // Without flushers every write goes straight to the backend
+  if (g_wb_num_threads == 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not start flusher threads.\n", __func__, __LINE__);
+    g_wb_max = 0;
+  }
+}
+
+// Flush all pending writes and stop the flushers
+static void write_behind_stop() {
+  pthread_mutex_lock(&g_cache_lock);
+  g_wb_end = 1;
+  pthread_cond_broadcast(&g_wb_ready);
+  pthread_mutex_unlock(&g_cache_lock);
+
+  for (int i = 0; i < g_wb_num_threads; i++) {
+    pthread_join(g_wb_threads[i], NULL);
+  }
+  g_wb_num_threads = 0;
+  g_wb_max = 0;
+}
+
+// Must be called with the cache lock held
+static int filter_may_have(const char* policy_id) {
+  if (g_filter.bits == NULL || pap_bloom_maybe_has(&g_filter, policy_id)) {
+    return 1;
+  }
+
+  g_stats.filtered++;
+  return 0;
+}
+
+// Must be called with the cache lock held
+static int filter_needs_rebuild() {
+  return g_filter.bits != NULL && (g_filter.count > g_filter.capacity || g_filter_deletes > g_filter.capacity / 2);
+}
+
+// Build a new filter from the backend listing, must be called with the filter lock held exclusively
+static void filter_rebuild() {
+  pap_policy_id_list_t* list = NULL;
+  pap_bloom_t filter;
+  int count = 0;
+
+  plugin_call(&g_backend, PAP_PLUGIN_GET_ALL_CB, &list);
+  for (pap_policy_id_list_t* elem = list; elem != NULL; elem = elem->next) count++;
+
+  // Leave room to grow before the next rebuild
+  if (pap_bloom_init(&filter, count * 2 > PAP_FILTER_MIN_CAPACITY ? count * 2 : PAP_FILTER_MIN_CAPACITY) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not allocate filter.\n", __func__, __LINE__);
+    filter.bits = NULL;
+  }
+
+  while (list != NULL) {
+    pap_policy_id_list_t* next = list->next;
+    if (filter.bits != NULL) pap_bloom_add(&filter, list->policy_id);
+    free(list);
+    list = next;
+  }
+
+  // Without a filter every lookup goes to the backend
+  pthread_mutex_lock(&g_cache_lock);
+  pap_bloom_release(&g_filter);
+  if (filter.bits != NULL) {
+    // Pending puts are not in the backend listing yet
+    for (int i = 0; i < PAP_CACHE_BUCKETS; i++) {
+      for (pap_wb_entry_t* entry = g_pending[i]; entry != NULL; entry = entry->hash_next) {
+        if (entry->op == PAP_WB_PUT) pap_bloom_add(&filter, entry->policy.policy_id);
+      }
+    }
+    g_filter = filter;
+  }
+  g_filter_deletes = 0;
+  pthread_mutex_unlock(&g_cache_lock);
+}
+
+static void filter_rebuild_if_needed() {
+  int rebuild;
+
+  pthread_rwlock_wrlock(&g_filter_rwlock);
+  pthread_mutex_lock(&g_cache_lock);
+  rebuild = filter_needs_rebuild();
+  pthread_mutex_unlock(&g_cache_lock);
+  if (rebuild) filter_rebuild();
+  pthread_rwlock_unlock(&g_filter_rwlock);
+}
+
+/****************************************************************************
+ * CALLBACK FUNCTIONS
+ ****************************************************************************/
+static int destroy_cb(plugin_t* plugin, void* data) {
+  write_behind_stop();
+
+  pthread_mutex_lock(&g_cache_lock);
+  cache_clear();
+  pap_bloom_release(&g_filter);
+  pthread_mutex_unlock(&g_cache_lock);
+
+  plugin_destroy(&g_backend);
+  free(plugin->callbacks);
+  return 0;
+}
+
+static int put_cb(plugin_t* plugin, void* data) {
+  pap_policy_t* policy = (pap_policy_t*)data;
+  int rebuild;
+  int ret;
+
+  if (g_wb_max > 0) {
+    pthread_mutex_lock(&g_cache_lock);
+    // Invalidate only once there is room, so no get can cache the old policy meanwhile
+    pending_wait_space(policy->policy_id);
+    cache_invalidate(policy->policy_id);
+    if (g_filter.bits != NULL) pap_bloom_add(&g_filter, policy->policy_id);
+    rebuild = filter_needs_rebuild();
+    ret = pending_push(policy, PAP_WB_PUT);
+    pthread_mutex_unlock(&g_cache_lock);
+
+    if (rebuild) filter_rebuild_if_needed();
+
+    return ret;
+  }
+
+  pthread_rwlock_rdlock(&g_filter_rwlock);
+  pthread_mutex_lock(&g_cache_lock);
+  cache_invalidate(policy->policy_id);
+  if (g_filter.bits != NULL) pap_bloom_add(&g_filter, policy->policy_id);
+  rebuild = filter_needs_rebuild();
+  pthread_mutex_unlock(&g_cache_lock);
+
+  ret = plugin_call(&g_backend, PAP_PLUGIN_PUT_CB, data);
+  pthread_rwlock_unlock(&g_filter_rwlock);
+
+  if (rebuild) filter_rebuild_if_needed();
+
+  return ret;
+}
+
+// Copies a stored policy into the caller's, leaves it empty if the object does not fit
+static void copy_policy(pap_policy_t* dst, pap_policy_t* src, int capacity) {
+  char* object = dst->policy_object.policy_object;
+
+  if (src->policy_object.policy_object_size > capacity) {
+    log_error(plugin_logger_id, "[%s:%d] policy does not fit the buffer.\n", __func__, __LINE__);
+    dst->policy_object.policy_object_size = 0;
+    return;
+  }
+  memcpy(object, src->policy_object.policy_object, src->policy_object.policy_object_size);
+  *dst = *src;
+  dst->policy_object.policy_object = object;
+}
+
+static int get_cb(plugin_t* plugin, void* data) {
+  pap_plugin_get_args_t* args = (pap_plugin_get_args_t*)data;
+  pap_cache_entry_t* entry = NULL;
+  pap_wb_entry_t* pending = NULL;
+  unsigned long long generation;
+  int capacity = pap_plugin_object_capacity(&args->policy->policy_object);
+  int ret;
+
+  args->policy->policy_object.policy_object_size = 0;
+  pthread_mutex_lock(&g_cache_lock);
+  if (!filter_may_have(args->policy_id)) {
+    pthread_mutex_unlock(&g_cache_lock);
+    return 0;
+  }
+  pending = pending_find(args->policy_id);
+  if (pending != NULL) {
+    if (pending->op == PAP_WB_PUT) {
+      copy_policy(args->policy, &pending->policy, capacity);
+    }
+    pthread_mutex_unlock(&g_cache_lock);
+    return 0;
+  }
+  entry = cache_get(args->policy_id);
+  if (entry != NULL) {
+    copy_policy(args->policy, &entry->policy, capacity);
+    pthread_mutex_unlock(&g_cache_lock);
+    return 0;
+  }
+  generation = g_generation;
+  pthread_mutex_unlock(&g_cache_lock);
+
+  // The backend bounds its copy by the same capacity
+  args->policy->policy_object.policy_object_size = capacity;
+  ret = plugin_call(&g_backend, PAP_PLUGIN_GET_CB, data);
+
+  // Backends leave the object empty when the policy is missing
+  if (args->policy->policy_object.policy_object_size > 0 && g_max_bytes > 0) {
+    pthread_mutex_lock(&g_cache_lock);
+    if (generation == g_generation) {
+      cache_insert(args->policy_id, args->policy);
+    }
+    pthread_mutex_unlock(&g_cache_lock);
+  }
+
+  return ret;
+}
+
+static int has_cb(plugin_t* plugin, void* data) {
+  pap_plugin_has_args_t* args = (pap_plugin_has_args_t*)data;
+  pap_wb_entry_t* pending = NULL;
+  int hit;
+
+  pthread_mutex_lock(&g_cache_lock);
+  if (!filter_may_have(args->policy_id)) {
+    pthread_mutex_unlock(&g_cache_lock);
+    args->does_have = false;
+    return 0;
+  }
+  pending = pending_find(args->policy_id);
+  if (pending != NULL) {
+    args->does_have = pending->op == PAP_WB_PUT;
+    pthread_mutex_unlock(&g_cache_lock);
+    return 0;
+  }
+  hit = cache_get(args->policy_id) != NULL;
+  pthread_mutex_unlock(&g_cache_lock);
+
+  if (hit) {
+    args->does_have = true;
+    return 0;
+  }
+
+  return plugin_call(&g_backend, PAP_PLUGIN_HAS_CB, data);
+}
+
+static int del_cb(plugin_t* plugin, void* data) {
+  char* policy_id = (char*)data;
+  int rebuild;
+  int ret;
+
+  if (g_wb_max > 0) {
+    pap_policy_t policy;
+
+    memset(&policy, 0, sizeof(pap_policy_t));
+    memcpy(policy.policy_id, policy_id, PAP_POL_ID_MAX_LEN);
+
+    pthread_mutex_lock(&g_cache_lock);
+    pending_wait_space(policy_id);
+    cache_invalidate(policy_id);
+    ret = pending_push(&policy, PAP_WB_DEL);
+  } else {
+    pthread_mutex_lock(&g_cache_lock);
+    cache_invalidate(policy_id);
+    pthread_mutex_unlock(&g_cache_lock);
+
+    ret = plugin_call(&g_backend, PAP_PLUGIN_DEL_CB, data);
+
+    pthread_mutex_lock(&g_cache_lock);
+  }
+  g_filter_deletes++;
+  rebuild = filter_needs_rebuild();
+  pthread_mutex_unlock(&g_cache_lock);
+
+  if (rebuild) filter_rebuild_if_needed();
+
+  return ret;
+}
+
+static int get_len_cb(plugin_t* plugin, void* data) {
+  pap_plugin_len_args_t* args = (pap_plugin_len_args_t*)data;
+  pap_cache_entry_t* entry = NULL;
+  pap_wb_entry_t* pending = NULL;
+  int ret = 0;
+
+  pthread_mutex_lock(&g_cache_lock);
+  if (!filter_may_have(args->policy_id)) {
+    pthread_mutex_unlock(&g_cache_lock);
+    args->len = 0;
+    return 0;
+  }
+  pending = pending_find(args->policy_id);
+  entry = pending == NULL ? cache_get(args->policy_id) : NULL;
+  if (pending != NULL) {
+    args->len = pending->op == PAP_WB_PUT ? pending->policy.policy_object.policy_object_size : 0;
+    pthread_mutex_unlock(&g_cache_lock);
+  } else if (entry != NULL) {
+    args->len = entry->policy.policy_object.policy_object_size;
+    pthread_mutex_unlock(&g_cache_lock);
+  } else {
+    pthread_mutex_unlock(&g_cache_lock);
+    ret = plugin_call(&g_backend, PAP_PLUGIN_GET_POL_OBJ_LEN_CB, data);
+  }
+
+  return ret;
+}
+
+static int get_all_cb(plugin_t* plugin, void* data) {
+  // The backend lists only what has been flushed
+  pap_plugin_cache_drain();
+
+  return plugin_call(&g_backend, PAP_PLUGIN_GET_ALL_CB, data);
+}
+
+int pap_plugin_cache_initializer(plugin_t* plugin, void* backend) {
+  int max_bytes = 0;
+  int wb_queue = 0;
+  int wb_threads = 0;
+
+  if (backend == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] missing backend plugin.\n", __func__, __LINE__);
+    return -1;
+  }
+
+  if (config_manager_get_option_int("pap", "cache_bytes", &max_bytes) != CONFIG_MANAGER_OK || max_bytes < 0) {
+    max_bytes = PAP_CACHE_DEFAULT_BYTES;
+  }
+  if (config_manager_get_option_int("pap", "write_behind_queue", &wb_queue) != CONFIG_MANAGER_OK || wb_queue < 0) {
+    wb_queue = PAP_WB_DEFAULT_QUEUE;
+  }
+  if (config_manager_get_option_int("pap", "write_behind_threads", &wb_threads) != CONFIG_MANAGER_OK ||
+      wb_threads <= 0) {
+    wb_threads = PAP_WB_DEFAULT_THREADS;
+  }
+  if (wb_threads > PAP_WB_MAX_THREADS) wb_threads = PAP_WB_MAX_THREADS;
+
+  pthread_mutex_lock(&g_cache_lock);
+  cache_clear();
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_max_bytes = max_bytes;
+  g_backend = *(plugin_t*)backend;
+  pap_bloom_release(&g_filter);
+  pthread_mutex_unlock(&g_cache_lock);
+
+  pthread_rwlock_wrlock(&g_filter_rwlock);
+  filter_rebuild();
+  pthread_rwlock_unlock(&g_filter_rwlock);
+
+  g_wb_max = wb_queue;
+  if (g_wb_max > 0) write_behind_start(wb_threads);
+
+  plugin->destroy = destroy_cb;
+  plugin->callbacks = malloc(sizeof(void*) * PAP_PLUGIN_CALLBACK_COUNT);
+  plugin->plugin_specific_data = NULL;
+  plugin->callbacks_num = PAP_PLUGIN_CALLBACK_COUNT;
+  plugin->callbacks[PAP_PLUGIN_PUT_CB] = put_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_CB] = get_cb;
+  plugin->callbacks[PAP_PLUGIN_HAS_CB] = has_cb;
+  plugin->callbacks[PAP_PLUGIN_DEL_CB] = del_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_POL_OBJ_LEN_CB] = get_len_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_ALL_CB] = get_all_cb;
+  return 0;
+}
+
+void pap_plugin_cache_evict(char* policy_id) {
+  int rebuild;
+
+  if (policy_id == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_cache_lock);
+  // A queued write is newer than the policy the backend dropped
+  if (pending_find(policy_id) == NULL) {
+    cache_invalidate(policy_id);
+    g_filter_deletes++;
+  }
+  rebuild = filter_needs_rebuild();
+  pthread_mutex_unlock(&g_cache_lock);
+
+  if (rebuild) filter_rebuild_if_needed();
+}
+
+void pap_plugin_cache_drain(void) {
+  pthread_mutex_lock(&g_cache_lock);
+  while (g_wb_count > 0) pthread_cond_wait(&g_wb_done, &g_cache_lock);
+  pthread_mutex_unlock(&g_cache_lock);
+}
+
+void pap_plugin_cache_set_fail_cb(pap_plugin_cache_fail_cb_t cb) {
+  pthread_mutex_lock(&g_cache_lock);
+  g_fail_cb = cb;
+  pthread_mutex_unlock(&g_cache_lock);
+}
+
+void pap_plugin_cache_get_stats(pap_plugin_cache_stats_t* stats) {
+  if (stats == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_cache_lock);
+  *stats = g_stats;
+  stats->pending = g_wb_count;
+  pthread_mutex_unlock(&g_cache_lock);
+}
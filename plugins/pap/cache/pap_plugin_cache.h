@@ -0,0 +1,86 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_plugin_cache.h
+ * \brief
+ * LRU cache of policies in front of another PAP plugin
+ *
+ * \notes
+ * The initializer takes the initialized backend plugin as user data and owns
+ * it from then on. Cache size in bytes is read from [pap] cache_bytes, 0
+ * disables caching. Lookups of IDs that were never stored are answered by a
+ * Bloom filter in either case.
+ *
+ * Puts and deletes return once they are visible to lookups and are written
+ * to the backend by [pap] write_behind_threads flushers. At most [pap]
+ * write_behind_queue writes are pending, 0 writes through to the backend.
+ * Destroying the plugin flushes all pending writes.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+#ifndef _PAP_PLUGIN_CACHE_H_
+#define _PAP_PLUGIN_CACHE_H_
+
+#include "pap_plugin.h"
+#include "plugin.h"
+
+typedef struct {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  unsigned long long filtered;  // lookups of missing policies answered by the filter
+  unsigned long long bytes;
+  int entries;
+  unsigned long long coalesced;  // queued writes replaced by a newer write to the same ID
+  int pending;                   // writes not yet flushed to the backend
+} pap_plugin_cache_stats_t;
+
+// Called with the ID of each queued policy the backend could not store after all retries
+typedef void (*pap_plugin_cache_fail_cb_t)(char *policy_id);
+
+int pap_plugin_cache_initializer(plugin_t *plugin, void *backend);
+
+/**
+ * @brief Drop a policy the backend deleted by itself, such as an expired one
+ */
+void pap_plugin_cache_evict(char *policy_id);
+
+/**
+ * @brief Wait until every queued write has reached the backend
+ *
+ * Register it as the drain callback of the backend, so calls that read the
+ * backend directly see every write acknowledged by the cache. Writes the
+ * backend keeps failing are waited for until they are given up and reported.
+ */
+void pap_plugin_cache_drain(void);
+
+/**
+ * @brief Set the callback reporting queued policies that were dropped because the backend kept failing
+ */
+void pap_plugin_cache_set_fail_cb(pap_plugin_cache_fail_cb_t cb);
+
+/**
+ * @brief Cache statistics since the plugin was initialized
+ */
+void pap_plugin_cache_get_stats(pap_plugin_cache_stats_t *stats);
+
+#endif  //_PAP_PLUGIN_CACHE_H_
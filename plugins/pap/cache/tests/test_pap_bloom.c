@@ -0,0 +1,126 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/unity.h"
+
+#include "pap.h"
+#include "pap_bloom.h"
+
+#define TEST_CAPACITY 10000
+// Twice the designed 1% at capacity, leaves room for the variance of one sample
+#define TEST_MAX_FALSE_POSITIVES (TEST_CAPACITY * 2 / 100)
+
+// Policy IDs are hashes, but sequential IDs differing in one byte must spread as well
+static void policy_id(int n, int sequential, char *id) {
+  if (sequential) {
+    memset(id, 0, PAP_POL_ID_MAX_LEN);
+    memcpy(id + PAP_POL_ID_MAX_LEN - sizeof(n), &n, sizeof(n));
+  } else {
+    srand(n + 1);
+    for (int i = 0; i < PAP_POL_ID_MAX_LEN; i++) id[i] = (char)rand();
+  }
+}
+
+// Fill a filter to capacity, check every added ID and count hits among as many IDs never added
+static int false_positives(int sequential) {
+  pap_bloom_t bloom;
+  char id[PAP_POL_ID_MAX_LEN];
+  int hits = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, pap_bloom_init(&bloom, TEST_CAPACITY));
+  for (int i = 0; i < TEST_CAPACITY; i++) {
+    policy_id(i, sequential, id);
+    pap_bloom_add(&bloom, id);
+  }
+  TEST_ASSERT_EQUAL_INT(TEST_CAPACITY, bloom.count);
+
+  for (int i = 0; i < TEST_CAPACITY; i++) {
+    policy_id(i, sequential, id);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, pap_bloom_maybe_has(&bloom, id), "added ID reported missing");
+  }
+  for (int i = TEST_CAPACITY; i < 2 * TEST_CAPACITY; i++) {
+    policy_id(i, sequential, id);
+    hits += pap_bloom_maybe_has(&bloom, id);
+  }
+  pap_bloom_release(&bloom);
+
+  return hits;
+}
+
+void test_init_rejects_invalid(void) {
+  pap_bloom_t bloom;
+
+  TEST_ASSERT_EQUAL_INT(1, pap_bloom_init(NULL, TEST_CAPACITY));
+  TEST_ASSERT_EQUAL_INT(1, pap_bloom_init(&bloom, 0));
+  TEST_ASSERT_EQUAL_INT(1, pap_bloom_init(&bloom, -1));
+}
+
+void test_empty_has_nothing(void) {
+  pap_bloom_t bloom;
+  char id[PAP_POL_ID_MAX_LEN];
+
+  TEST_ASSERT_EQUAL_INT(0, pap_bloom_init(&bloom, 1));
+  for (int i = 0; i < 100; i++) {
+    policy_id(i, 0, id);
+    TEST_ASSERT_EQUAL_INT(0, pap_bloom_maybe_has(&bloom, id));
+  }
+  pap_bloom_release(&bloom);
+}
+
+void test_false_positive_rate(void) {
+  TEST_ASSERT_TRUE(false_positives(0) <= TEST_MAX_FALSE_POSITIVES);
+}
+
+void test_false_positive_rate_sequential_ids(void) {
+  TEST_ASSERT_TRUE(false_positives(1) <= TEST_MAX_FALSE_POSITIVES);
+}
+
+void test_release(void) {
+  pap_bloom_t bloom;
+  char id[PAP_POL_ID_MAX_LEN];
+
+  TEST_ASSERT_EQUAL_INT(0, pap_bloom_init(&bloom, TEST_CAPACITY));
+  policy_id(0, 0, id);
+  pap_bloom_add(&bloom, id);
+  pap_bloom_release(&bloom);
+  TEST_ASSERT_NULL(bloom.bits);
+  TEST_ASSERT_EQUAL_INT(0, bloom.count);
+
+  // A released filter can be initialized again and starts empty
+  TEST_ASSERT_EQUAL_INT(0, pap_bloom_init(&bloom, TEST_CAPACITY));
+  TEST_ASSERT_EQUAL_INT(0, pap_bloom_maybe_has(&bloom, id));
+  pap_bloom_release(&bloom);
+  pap_bloom_release(&bloom);
+  pap_bloom_release(NULL);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init_rejects_invalid);
+  RUN_TEST(test_empty_has_nothing);
+  RUN_TEST(test_false_positive_rate);
+  RUN_TEST(test_false_positive_rate_sequential_ids);
+  RUN_TEST(test_release);
+
+  return UNITY_END();
+}
@@ -0,0 +1,181 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/unity.h"
+
+#include "pap_plugin_cache.h"
+
+#define TEST_OBJECT "{\"policy_object\":\"test\"}"
+// Attempts the cache makes before giving a queued write up
+#define TEST_WB_MAX_ATTEMPTS 5
+#define TEST_ALWAYS_FAIL -1
+
+// Backend storing a single policy, whose puts fail as many times as asked
+static char backend_id[PAP_POL_ID_MAX_LEN];
+static int backend_stored = 0;
+static int backend_puts = 0;
+static int backend_put_failures = 0;
+
+static char failed_id[PAP_POL_ID_MAX_LEN];
+static int failed_count = 0;
+
+static plugin_t cache;
+
+static int backend_destroy_cb(plugin_t *plugin, void *data) {
+  free(plugin->callbacks);
+  return 0;
+}
+
+static int backend_put_cb(plugin_t *plugin, void *data) {
+  pap_policy_t *policy = (pap_policy_t *)data;
+
+  backend_puts++;
+  if (backend_put_failures != 0) {
+    if (backend_put_failures > 0) backend_put_failures--;
+    return 1;
+  }
+  memcpy(backend_id, policy->policy_id, PAP_POL_ID_MAX_LEN);
+  backend_stored = 1;
+  return 0;
+}
+
+static int backend_has_cb(plugin_t *plugin, void *data) {
+  pap_plugin_has_args_t *args = (pap_plugin_has_args_t *)data;
+
+  args->does_have = backend_stored && memcmp(backend_id, args->policy_id, PAP_POL_ID_MAX_LEN) == 0;
+  return 0;
+}
+
+static int backend_get_all_cb(plugin_t *plugin, void *data) {
+  *(pap_policy_id_list_t **)data = NULL;
+  return 0;
+}
+
+static int backend_initializer(plugin_t *plugin, void *data) {
+  plugin->callbacks = calloc(PAP_PLUGIN_CALLBACK_COUNT, sizeof(void *));
+  if (plugin->callbacks == NULL) return -1;
+
+  plugin->destroy = backend_destroy_cb;
+  plugin->callbacks[PAP_PLUGIN_PUT_CB] = backend_put_cb;
+  plugin->callbacks[PAP_PLUGIN_HAS_CB] = backend_has_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_ALL_CB] = backend_get_all_cb;
+  plugin->callbacks_num = PAP_PLUGIN_CALLBACK_COUNT;
+  plugin->plugin_specific_data = NULL;
+
+  return 0;
+}
+
+static void store_failed(char *policy_id) {
+  memcpy(failed_id, policy_id, PAP_POL_ID_MAX_LEN);
+  failed_count++;
+}
+
+static void policy_id(char *id) {
+  for (int i = 0; i < PAP_POL_ID_MAX_LEN; i++) id[i] = (char)(i * 7 + 1);
+}
+
+static int put(void) {
+  pap_policy_t policy;
+  char object[] = TEST_OBJECT;
+
+  memset(&policy, 0, sizeof(policy));
+  policy_id(policy.policy_id);
+  policy.policy_object.policy_object = object;
+  policy.policy_object.policy_object_size = strlen(object);
+
+  return plugin_call(&cache, PAP_PLUGIN_PUT_CB, &policy);
+}
+
+static int has(void) {
+  char id[PAP_POL_ID_MAX_LEN];
+  pap_plugin_has_args_t args = {.policy_id = id, .does_have = false};
+
+  policy_id(id);
+  TEST_ASSERT_EQUAL_INT(0, plugin_call(&cache, PAP_PLUGIN_HAS_CB, &args));
+  return args.does_have;
+}
+
+void setUp(void) {
+  plugin_t backend;
+
+  backend_stored = 0;
+  backend_puts = 0;
+  backend_put_failures = 0;
+  failed_count = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, plugin_init(&backend, backend_initializer, NULL));
+  TEST_ASSERT_EQUAL_INT(0, plugin_init(&cache, pap_plugin_cache_initializer, &backend));
+  pap_plugin_cache_set_fail_cb(store_failed);
+}
+
+void tearDown(void) { plugin_destroy(&cache); }
+
+// A write the backend rejects a few times keeps serving reads and reaches the backend once a retry succeeds
+void test_write_behind_retry(void) {
+  char id[PAP_POL_ID_MAX_LEN];
+  pap_plugin_cache_stats_t stats;
+
+  backend_put_failures = 2;
+  TEST_ASSERT_EQUAL_INT(0, put());
+  TEST_ASSERT_TRUE(has());
+
+  pap_plugin_cache_drain();
+  TEST_ASSERT_EQUAL_INT(3, backend_puts);
+  TEST_ASSERT_TRUE(backend_stored);
+  policy_id(id);
+  TEST_ASSERT_EQUAL_MEMORY(id, backend_id, PAP_POL_ID_MAX_LEN);
+  TEST_ASSERT_EQUAL_INT(0, failed_count);
+
+  pap_plugin_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL_INT(0, stats.pending);
+  TEST_ASSERT_TRUE(has());
+}
+
+// A write the backend keeps rejecting is given up, reported and no longer served
+void test_write_behind_gives_up(void) {
+  char id[PAP_POL_ID_MAX_LEN];
+  pap_plugin_cache_stats_t stats;
+
+  backend_put_failures = TEST_ALWAYS_FAIL;
+  TEST_ASSERT_EQUAL_INT(0, put());
+  TEST_ASSERT_TRUE(has());
+
+  pap_plugin_cache_drain();
+  TEST_ASSERT_EQUAL_INT(TEST_WB_MAX_ATTEMPTS, backend_puts);
+  TEST_ASSERT_FALSE(backend_stored);
+  TEST_ASSERT_EQUAL_INT(1, failed_count);
+  policy_id(id);
+  TEST_ASSERT_EQUAL_MEMORY(id, failed_id, PAP_POL_ID_MAX_LEN);
+
+  pap_plugin_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL_INT(0, stats.pending);
+  TEST_ASSERT_FALSE(has());
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_write_behind_retry);
+  RUN_TEST(test_write_behind_gives_up);
+
+  return UNITY_END();
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_plugin_object.h
+ * \brief
+ * Policy object buffer contract shared by the PAP storage plugins
+ *
+ * \notes
+ * Callers of PAP_PLUGIN_GET_CB own the policy object buffer and declare its
+ * capacity in policy_object_size. On return it holds the object length, or 0
+ * if the policy is not stored or does not fit, in which case nothing is
+ * copied. Size the buffer from PAP_PLUGIN_GET_POL_OBJ_LEN_CB, a policy
+ * replaced in between by a larger one is then reported as not fitting.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+#ifndef _PAP_PLUGIN_OBJECT_H_
+#define _PAP_PLUGIN_OBJECT_H_
+
+#include "pap.h"
+
+/**
+ * @brief Capacity of the caller's object buffer in bytes, 0 if there is none
+ */
+static inline int pap_plugin_object_capacity(const pap_policy_object_t *policy_object) {
+  if (policy_object->policy_object == NULL || policy_object->policy_object_size < 0) {
+    return 0;
+  }
+  return policy_object->policy_object_size;
+}
+
+#endif  //_PAP_PLUGIN_OBJECT_H_
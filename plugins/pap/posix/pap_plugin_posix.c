@@ -32,25 +32,42 @@
  * 01.10.2018. Added new functions that work without JSON paresr.
  * 25.05.2020. Refactoring.
  * 15.07.2020. Renaming.
+ * 19.10.2026. Policies stored in a single indexed log.
  ****************************************************************************/
 /****************************************************************************
  * INCLUDES
  ****************************************************************************/
 #include "pap_plugin_posix.h"
 #include "plugin_logger.h"
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
+#include "config_manager.h"
 #include "pap.h"
+#include "pap_plugin_object.h"
+#include "policy_compiler.h"
+#include "policy_expiry.h"
+#include "policy_index.h"
+#include "policy_log.h"
 #include "utils.h"
+#include "worker_pool.h"
 
 /****************************************************************************
  * MACROS
  ****************************************************************************/
-#define STORAGE_SIGN_ALG_LEN 64
-#define STORAGE_HASH_FN_LEN 64
+#define POLICY_STORE_DIR "stored_policies"
+#define POLICY_COMMIT_DEFAULT_MS 10
+#define POLICY_COMMIT_DEFAULT_SIZE 64
+#define POLICY_INDEX_BATCH 256
+#define POLICY_EVALUATE_DEFAULT_MIN 32
+#define POLICY_EVALUATE_CHUNK 8
+#define POLICY_EVALUATE_QUEUE_LEN 256
+#define POLICY_EXPIRY_BATCH 64
+#define POLICY_EXPIRY_MAX_WAIT_S 3600
 
 #ifndef bool
 #define bool _Bool
@@ -71,192 +88,166 @@ typedef enum {
   STORAGE_ERROR,
 } storage_error_t;
 
+// Candidates of one request, evaluated by the caller and the pool workers. Each claims chunks of candidates until
+// all are claimed or the overriding decision is found, then the rest is skipped.
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+  const policycomp_request_t* request;
+  policycomp_decision_e overriding;
+  char* ids;
+  int count;
+  int next;     // first candidate not claimed yet
+  int running;  // tasks submitted to the pool and not finished
+  int settled;
+  int decided;  // candidate of the decision, -1 if none
+  policycomp_decision_e decision;
+  int uncompiled;  // candidates that must be evaluated from JSON
+} evaluate_batch_t;
+
 /****************************************************************************
- * MACROS
+ * LOCAL VARIABLES
  ****************************************************************************/
-#define RPI_MAX_STR_LEN 2 * 1024
-#define RPI_ACCESS_ERR -1
-#define RPI_POL_ID_MAX_LEN 32
-#define RPI_PUBLIC_KEY_LEN 32 * 2
-#define RPI_SIGNATURE_LEN 64 * 2
+// Policies are added from several verification threads. The lock covers the log append and the in-memory index. The
+// signature check runs in pap_add_policy before the put, compilation and checksums before the lock is taken.
+static pthread_mutex_t g_storage_lock = PTHREAD_MUTEX_INITIALIZER;
+static policylog_t* g_policy_log = NULL;
+static policyindex_t* g_policy_index = NULL;  // candidate policies by request attribute, rebuilt on open
+
+// Group commit: writers wait until the committer has synced their write, one sync covers every write appended
+// before it. A sync starts once no other writer is about to join the batch, group_commit_size writes wait or the
+// oldest has waited group_commit_ms. Writes arriving during a sync form the next batch.
+static pthread_mutex_t g_inflight_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_inflight = 0;  // writers between entering a callback and waiting for their commit
+static pthread_cond_t g_commit_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_durable_cond = PTHREAD_COND_INITIALIZER;
+static int g_commit_ms = POLICY_COMMIT_DEFAULT_MS;
+static int g_commit_size = POLICY_COMMIT_DEFAULT_SIZE;
+static int g_commit_waiting = 0;
+static unsigned long long g_write_seq = 0;
+static unsigned long long g_durable_seq = 0;
+static struct timespec g_commit_deadline;
+static pthread_t g_committer;
+static int g_committer_end = 0;
+
+// Requests with many candidates are evaluated in parallel on a pool shared by all requests
+static worker_pool_t* g_evaluate_pool = NULL;
+static int g_evaluate_min = POLICY_EVALUATE_DEFAULT_MIN;
+
+// Policies bounded in time are evicted once the time is past their bound. Request times are compared with the
+// wall clock, in seconds since the epoch. Eviction starts once the evict callback is registered, so no policy
+// leaves the store before the layers in front of it can be told.
+static policyexpiry_t* g_policy_expiry = NULL;
+static pthread_cond_t g_expiry_cond = PTHREAD_COND_INITIALIZER;
+static pap_plugin_posix_evict_cb_t g_evict_cb = NULL;
+static int g_expiry_enabled = 1;
+static int g_expiry_started = 0;
+static pthread_t g_expiry_thread;
+static int g_expiry_end = 0;
+
+static pap_plugin_posix_drain_cb_t g_drain_cb = NULL;
 
 /****************************************************************************
  * API FUNCTIONS
  ****************************************************************************/
-static bool posix_store_policy(char* policy_id, char* policy_object, int policy_object_size, char* policy_cost,
-                              char* signature, char* public_key, char* signature_algorithm, char* hash_function) {
-  char pol_path[RPI_MAX_STR_LEN] = {0};
-  char pol_id_str[RPI_POL_ID_MAX_LEN * 2 + 1] = {0};
-  FILE* f = NULL;
+// Track when a stored policy expires, policies without a compiled form never do
+static void track_expiry(const char* policy_id, const char* compiled, size_t compiled_len) {
+  int64_t not_after;
 
-  // Check input parameters
-  if ((policy_id == NULL) || (policy_object == NULL) || (policy_object_size == 0) || (policy_cost == NULL) ||
-      (signature == NULL) || (public_key == NULL) || (signature_algorithm == NULL) || (hash_function == NULL)) {
-    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
-    return FALSE;
+  if (compiled == NULL || policycomp_not_after(compiled, compiled_len, &not_after) != 0) {
+    policyexpiry_remove(g_policy_expiry, policy_id);
+    return;
   }
 
-  if (hex_to_str(policy_id, pol_id_str, RPI_POL_ID_MAX_LEN) != UTILS_STRING_SUCCESS) {
-    log_error(plugin_logger_id, "[%s:%d] could not convert hex value to string.\n", __func__, __LINE__);
-    return FALSE;
+  if (policyexpiry_set(g_policy_expiry, policy_id, not_after) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not track policy expiry.\n", __func__, __LINE__);
+    return;
   }
+  pthread_cond_signal(&g_expiry_cond);
+}
 
-  // Write policy data to a file
-  struct stat st = {0};
-  if (stat("stored_policies", &st) == -1) {
-    mkdir("stored_policies", 0700);
-  }
+// Policy metadata and checksums, built before the storage lock is taken
+static void posix_prepare_policy(char* policy_id, pap_policy_object_t* policy_object,
+                                 pap_policy_id_signature_t* policy_id_signature, pap_hash_functions_e hash_fn,
+                                 const char* compiled, size_t compiled_len, policylog_meta_t* meta,
+                                 policylog_checksum_t* checksum) {
+  memset(meta, 0, sizeof(*meta));
+  memcpy(meta->policy_id, policy_id, PAP_POL_ID_MAX_LEN);
+  strncpy(meta->cost, policy_object->cost, POLICYLOG_COST_LEN - 1);
+  memcpy(meta->signature, policy_id_signature->signature, PAP_SIGNATURE_LEN);
+  memcpy(meta->public_key, policy_id_signature->public_key, PAP_PUBLIC_KEY_LEN);
+  meta->signature_algorithm = policy_id_signature->signature_algorithm;
+  meta->hash_function = hash_fn;
+  meta->object_len = policy_object->policy_object_size;
+  meta->compiled_len = compiled_len;
+
+  policylog_checksum(meta, policy_object->policy_object, compiled, checksum);
+}
 
-  sprintf(pol_path, "stored_policies/%s.txt", pol_id_str);
-  f = fopen(pol_path, "w+");
-  if (f == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] invalid path to file.\n", __func__, __LINE__);
+static bool posix_store_policy(const policylog_meta_t* meta, const policylog_checksum_t* checksum, const char* object,
+                               const char* compiled) {
+  const char* policy_id = meta->policy_id;
+  policylog_view_t old;
+  bool replaced;
+
+  // The replaced policy stays pinned until its keys are removed from the index
+  replaced = policylog_view(g_policy_log, policy_id, &old) == 0;
+  if (policylog_put(g_policy_log, meta, object, compiled, checksum) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not store policy.\n", __func__, __LINE__);
+    if (replaced) policylog_view_release(&old);
     return FALSE;
   }
 
-  fwrite("policy id:", strlen("policy id:"), 1, f);
-  fwrite(pol_id_str, strlen(pol_id_str), 1, f);
-  fwrite("\npolicy object:", strlen("\npolicy object:"), 1, f);
-  fwrite(policy_object, policy_object_size, 1, f);
-  fwrite("\npolicy cost:", strlen("\npolicy cost:"), 1, f);
-  fwrite(policy_cost, strlen(policy_cost), 1, f);
-  fwrite("\npolicy id signature:", strlen("\npolicy id signature:"), 1, f);
-  fwrite(signature, RPI_SIGNATURE_LEN, 1, f);
-  fwrite("\npolicy id signature public key:", strlen("\npolicy id signature public key:"), 1, f);
-  fwrite(public_key, RPI_PUBLIC_KEY_LEN, 1, f);
-  fwrite("\npolicy id signature sign. algorithm:", strlen("\npolicy id signature sign. algorithm:"), 1, f);
-  fwrite(signature_algorithm, strlen(signature_algorithm), 1, f);
-  fwrite("\nhash function:", strlen("\nhash function:"), 1, f);
-  fwrite(hash_function, strlen(hash_function), 1, f);
-
-  fclose(f);
-
-  // Store policy ID in stored policies file
-  memset(pol_path, 0, RPI_MAX_STR_LEN * sizeof(char));
-  sprintf(pol_path, "stored_policies/stored_policies.txt");
-
-  f = fopen(pol_path, "a");
-  if (f == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] invalid path to stored_policies file.\n", __func__, __LINE__);
-    return FALSE;
+  if (replaced) {
+    policyindex_remove(g_policy_index, policy_id, old.compiled, old.compiled_len);
+    policylog_view_release(&old);
   }
-
-  fwrite(pol_id_str, strlen(pol_id_str), 1, f);
-  fwrite("|", strlen("|"), 1, f);
-
-  fclose(f);
+  if (policyindex_add(g_policy_index, policy_id, compiled, meta->compiled_len) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not index policy.\n", __func__, __LINE__);
+  }
+  track_expiry(policy_id, compiled, meta->compiled_len);
 
   return TRUE;
 }
 
-static bool posix_acquire_policy(char* policy_id, char* policy_object, int* policy_object_size, char* policy_cost,
-                                char* signature, char* public_key, char* signature_algorithm, char* hash_function) {
-  char pol_path[RPI_MAX_STR_LEN] = {0};
-  char pol_id_str[RPI_POL_ID_MAX_LEN * 2 + 1] = {0};
-  char* buffer;
-  char* substr;
-  int buff_len;
-  int substr_len;
-  FILE* f;
+static bool posix_acquire_policy(char* policy_id, pap_policy_object_t* policy_object,
+                                 pap_policy_id_signature_t* policy_id_signature, pap_hash_functions_e* hash_fn) {
+  policylog_meta_t meta;
 
   // Check input parameters
-  if ((policy_id == NULL) || (policy_object == NULL) || (policy_object_size == NULL) || (policy_cost == NULL) ||
-      (signature == NULL) || (public_key == NULL) || (signature_algorithm == NULL) || (hash_function == NULL)) {
+  if ((policy_id == NULL) || (policy_object->policy_object == NULL)) {
     log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  if (hex_to_str(policy_id, pol_id_str, RPI_POL_ID_MAX_LEN) != UTILS_STRING_SUCCESS) {
-    log_error(plugin_logger_id, "[%s:%d] could not convert hex value to string.\n", __func__, __LINE__);
+  if (policylog_get(g_policy_log, policy_id, &meta, policy_object->policy_object,
+                    pap_plugin_object_capacity(policy_object)) != 0) {
+    policy_object->policy_object_size = 0;
     return FALSE;
   }
 
-  // Open file
-  sprintf(pol_path, "stored_policies/%s.txt", pol_id_str);
-  f = fopen(pol_path, "r");
-  if (f == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] invalid path to file: %s.\n", __func__, __LINE__, pol_path);
-    return FALSE;
-  }
-
-  // Get file size
-  fseek(f, 0L, SEEK_END);
-  buff_len = ftell(f);
-  fseek(f, 0L, SEEK_SET);
-
-  // Write policy to a buffer
-  buffer = malloc(buff_len * sizeof(char));
-
-  fread(buffer, buff_len * sizeof(char), 1, f);
-  fclose(f);
-
-  // Set the arguments
-  substr = strstr(buffer, "policy object:");
-  substr_len = strstr(buffer, "\npolicy cost:") - (substr + strlen("policy object:"));
-  memcpy(policy_object, substr + strlen("policy object:"), substr_len);
-
-  *policy_object_size = substr_len;
-
-  substr = strstr(buffer, "policy cost:");
-  substr_len = strstr(buffer, "\npolicy id signature:") - (substr + strlen("policy cost:"));
-  memcpy(policy_cost, substr + strlen("policy cost:"), substr_len);
-
-  substr = strstr(buffer, "policy id signature:");
-  substr_len = strstr(buffer, "\npolicy id signature public key:") - (substr + strlen("policy id signature:"));
-  memcpy(signature, substr + strlen("policy id signature:"), substr_len);
-
-  substr = strstr(buffer, "policy id signature public key:");
-  substr_len =
-      strstr(buffer, "\npolicy id signature sign. algorithm:") - (substr + strlen("policy id signature public key:"));
-  memcpy(public_key, substr + strlen("policy id signature public key:"), substr_len);
-
-  substr = strstr(buffer, "policy id signature sign. algorithm:");
-  substr_len = strstr(buffer, "\nhash function:") - (substr + strlen("policy id signature sign. algorithm:"));
-  memcpy(signature_algorithm, substr + strlen("policy id signature sign. algorithm:"), substr_len);
-
-  substr = strstr(buffer, "hash function:");
-  substr_len = &buffer[buff_len] - (substr + strlen("hash function:"));
-  memcpy(hash_function, substr + strlen("hash function:"), substr_len);
-
-  free(buffer);
+  policy_object->policy_object_size = meta.object_len;
+  memcpy(policy_object->cost, meta.cost, MIN(sizeof(policy_object->cost), POLICYLOG_COST_LEN));
+  memcpy(policy_id_signature->signature, meta.signature, PAP_SIGNATURE_LEN);
+  memcpy(policy_id_signature->public_key, meta.public_key, PAP_PUBLIC_KEY_LEN);
+  policy_id_signature->signature_algorithm = meta.signature_algorithm;
+  *hash_fn = meta.hash_function;
 
   return TRUE;
 }
 
 static bool posix_check_if_stored_policy(char* policy_id) {
-  char pol_path[RPI_MAX_STR_LEN] = {0};
-  char pol_id_str[RPI_POL_ID_MAX_LEN * 2 + 1] = {0};
-
   // Check input parameters
   if (policy_id == NULL) {
     log_error(plugin_logger_id, "[%s:%d] null policy.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  if (hex_to_str(policy_id, pol_id_str, RPI_POL_ID_MAX_LEN) != UTILS_STRING_SUCCESS) {
-    log_error(plugin_logger_id, "[%s:%d] could not convert hex value to string.\n", __func__, __LINE__);
-    return FALSE;
-  }
-
-  sprintf(pol_path, "stored_policies/%s.txt", pol_id_str);
-
-  // Check file existance
-  if (access(pol_path, F_OK) != RPI_ACCESS_ERR) {
-    // File exists
-    return TRUE;
-  } else {
-    // File doesn't exist
-    return FALSE;
-  }
+  return policylog_has(g_policy_log, policy_id) ? TRUE : FALSE;
 }
 
 static bool posix_flush_policy(char* policy_id) {
-  char pol_path[RPI_MAX_STR_LEN] = {0};
-  char pol_id_str[RPI_POL_ID_MAX_LEN * 2 + 1] = {0};
-  char* stored_pol_buff = NULL;
-  char* stored_pol_buff_new = NULL;
-  int stored_pol_buff_len = 0;
-  FILE* f;
+  policylog_view_t old;
 
   // Check input parameters
   if (policy_id == NULL) {
@@ -264,168 +255,93 @@ static bool posix_flush_policy(char* policy_id) {
     return FALSE;
   }
 
-  if (hex_to_str(policy_id, pol_id_str, RPI_POL_ID_MAX_LEN) != UTILS_STRING_SUCCESS) {
-    log_error(plugin_logger_id, "[%s:%d] could not convert hex value to string.\n", __func__, __LINE__);
+  if (policylog_view(g_policy_log, policy_id, &old) != 0) {
     return FALSE;
   }
 
-  sprintf(pol_path, "stored_policies/%s.txt", pol_id_str);
-
-  if (remove(pol_path) == 0) {
-    // Remove policy ID from stored policies file
-    memset(pol_path, 0, RPI_MAX_STR_LEN * sizeof(char));
-    sprintf(pol_path, "stored_policies/stored_policies.txt");
-    f = fopen(pol_path, "r");
-    if (f == NULL) {
-      log_error(plugin_logger_id, "[%s:%d] invalid path to stored_policies file.\n", __func__, __LINE__);
-      return FALSE;
-    }
-
-    fseek(f, 0L, SEEK_END);
-    stored_pol_buff_len = ftell(f);
-    fseek(f, 0L, SEEK_SET);
-
-    stored_pol_buff = malloc(stored_pol_buff_len * sizeof(char));
-    stored_pol_buff_new = malloc((stored_pol_buff_len - (strlen(pol_id_str) + 1)) * sizeof(char));  // Add +1 for "|"
-
-    fread(stored_pol_buff, stored_pol_buff_len, 1, f);
-
-    fclose(f);
-
-    memcpy(stored_pol_buff_new, stored_pol_buff, (strstr(stored_pol_buff, pol_id_str) - stored_pol_buff));
-    memcpy(
-        &stored_pol_buff_new[strstr(stored_pol_buff, pol_id_str) - stored_pol_buff],
-        (strstr(stored_pol_buff, pol_id_str) + (strlen(pol_id_str) + 1)),  // Add +1 for "|"
-        (&stored_pol_buff[stored_pol_buff_len] - ((strstr(stored_pol_buff, pol_id_str) + (strlen(pol_id_str) + 1)))));
-
-    f = fopen(pol_path, "w");
-    if (f == NULL) {
-      log_error(plugin_logger_id, "[%s:%d] invalid path to file: %s.\n", __func__, __LINE__, pol_path);
-      return FALSE;
-    }
-
-    fwrite(stored_pol_buff_new, stored_pol_buff_len - (strlen(pol_id_str) + 1), 1, f);  // Add +1 for "|"
-
-    fclose(f);
-
-    free(stored_pol_buff);
-    free(stored_pol_buff_new);
-
-    // Success
-    return TRUE;
-  } else {
-    // Fail
+  if (policylog_del(g_policy_log, policy_id) != 0) {
+    policylog_view_release(&old);
     return FALSE;
   }
+
+  policyindex_remove(g_policy_index, policy_id, old.compiled, old.compiled_len);
+  policyexpiry_remove(g_policy_expiry, policy_id);
+  policylog_view_release(&old);
+
+  return TRUE;
 }
 
 static int posix_get_pol_obj_len(char* policy_id) {
-  char pol_path[RPI_MAX_STR_LEN] = {0};
-  char pol_id_str[RPI_POL_ID_MAX_LEN * 2 + 1] = {0};
-  char* buffer;
-  int buff_len;
-  int ret = 0;
-  FILE* f;
+  uint32_t len = 0;
 
   // Check input parameters
   if (policy_id == NULL) {
     log_error(plugin_logger_id, "[%s:%d] null policy.\n", __func__, __LINE__);
-    return ret;
-  }
-
-  if (hex_to_str(policy_id, pol_id_str, RPI_POL_ID_MAX_LEN) != UTILS_STRING_SUCCESS) {
-    log_error(plugin_logger_id, "[%s:%d] could not convert hex value to string.\n", __func__, __LINE__);
-    return ret;
+    return 0;
   }
 
-  // Open file
-  sprintf(pol_path, "stored_policies/%s.txt", pol_id_str);
-  f = fopen(pol_path, "r");
-  if (f == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] invalid path to file: %s.\n", __func__, __LINE__, pol_path);
-    return ret;
+  if (policylog_object_len(g_policy_log, policy_id, &len) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] policy is not stored.\n", __func__, __LINE__);
+    return 0;
   }
 
-  // Get file size
-  fseek(f, 0L, SEEK_END);
-  buff_len = ftell(f);
-  fseek(f, 0L, SEEK_SET);
-
-  // Write policy to a buffer
-  buffer = malloc(buff_len * sizeof(char));
-
-  fread(buffer, buff_len * sizeof(char), 1, f);
-  fclose(f);
-
-  ret = &buffer[buff_len] - (strstr(buffer, "policy object:") + strlen("policy object:"));
-
-  return ret;
+  return len;
 }
 
-static bool store_policy(char* policy_id, pap_policy_object_t policy_object,
-                         pap_policy_id_signature_t policy_id_signature, pap_hash_functions_e hash_fn) {
-  char sign_algorithm[STORAGE_SIGN_ALG_LEN] = {0};
-  char hash_function[STORAGE_HASH_FN_LEN] = {0};
-
-  // Check input parameter
-  if (policy_id == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] null policy.\n", __func__, __LINE__);
+static bool prepare_policy(char* policy_id, pap_policy_object_t policy_object,
+                           pap_policy_id_signature_t policy_id_signature, pap_hash_functions_e hash_fn,
+                           const char* compiled, size_t compiled_len, policylog_meta_t* meta,
+                           policylog_checksum_t* checksum) {
+  // Check input parameters
+  if ((policy_id == NULL) || (policy_object.policy_object == NULL) || (policy_object.policy_object_size <= 0)) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
     return FALSE;
   }
 
   // OPTIONAL: Policy ID signature can be validated here as additional level of security
 
-  // Set hash functions
-  if (hash_fn == PAP_SHA_256) {
-    memcpy(hash_function, "sha-256", strlen("sha-256"));
-  } else {
+  if (hash_fn != PAP_SHA_256) {
     log_error(plugin_logger_id, "[%s:%d] unsupported hash function.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  // Set policy ID signature algorithm
-  if (policy_id_signature.signature_algorithm == PAP_ECDSA) {
-    memcpy(sign_algorithm, "ECDSA", strlen("ECDSA"));
-  } else {
+  if (policy_id_signature.signature_algorithm != PAP_ECDSA) {
     log_error(plugin_logger_id, "[%s:%d] unsupported signature algorithm.\n", __func__, __LINE__);
     return FALSE;
   }
 
+  // Call function for preparing policy on used platform
+  posix_prepare_policy(policy_id, &policy_object, &policy_id_signature, hash_fn, compiled, compiled_len, meta,
+                       checksum);
+  return TRUE;
+}
+
+static bool store_policy(const policylog_meta_t* meta, const policylog_checksum_t* checksum, const char* object,
+                         const char* compiled) {
   // Call function for storing policy on used platform
-  return posix_store_policy(policy_id, policy_object.policy_object, policy_object.policy_object_size, policy_object.cost,
-                           policy_id_signature.signature, policy_id_signature.public_key, sign_algorithm,
-                           hash_function);
+  return posix_store_policy(meta, checksum, object, compiled);
 }
 
 static bool acquire_policy(char* policy_id, pap_policy_object_t* policy_object,
                            pap_policy_id_signature_t* policy_id_signature, pap_hash_functions_e* hash_fn) {
-  char sign_algorithm[STORAGE_SIGN_ALG_LEN] = {0};
-  char hash_function[STORAGE_HASH_FN_LEN] = {0};
-
   // Check input parameter
   if ((policy_id == NULL) || (policy_object == NULL) || (policy_id_signature == NULL) || (hash_fn == NULL)) {
     log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  // Call function for storing policy on used platform
-  if (posix_acquire_policy(policy_id, policy_object->policy_object, &(policy_object->policy_object_size),
-                          policy_object->cost, policy_id_signature->signature, policy_id_signature->public_key,
-                          sign_algorithm, hash_function) == FALSE) {
+  // Call function for acquiring policy on used platform
+  if (posix_acquire_policy(policy_id, policy_object, policy_id_signature, hash_fn) == FALSE) {
     log_error(plugin_logger_id, "[%s:%d] could not acquire policy from disk.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  if (memcmp(sign_algorithm, "ECDSA", strlen("ECDSA")) == 0) {
-    policy_id_signature->signature_algorithm = PAP_ECDSA;
-  } else {
+  if (policy_id_signature->signature_algorithm != PAP_ECDSA) {
     log_error(plugin_logger_id, "[%s:%d] unsuported signature algorithm.\n", __func__, __LINE__);
     return FALSE;
   }
 
-  if (memcmp(hash_function, "sha-256", strlen("sha-256")) == 0) {
-    *hash_fn = PAP_SHA_256;
-  } else {
+  if (*hash_fn != PAP_SHA_256) {
     log_error(plugin_logger_id, "[%s:%d] hash function.\n", __func__, __LINE__);
     return FALSE;
   }
@@ -468,79 +384,572 @@ static bool acquire_pol_obj_len(char* policy_id, int* pol_obj_len) {
   return TRUE;
 }
 
+static int append_policy_id(void* user, const char* policy_id) {
+  pap_policy_id_list_t*** tail = (pap_policy_id_list_t***)user;
+  pap_policy_id_list_t* elem = calloc(1, sizeof(pap_policy_id_list_t));
+
+  if (elem == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] out of memory.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  memcpy(elem->policy_id, policy_id, PAP_POL_ID_MAX_LEN);
+  **tail = elem;
+  *tail = &elem->next;
+
+  return 0;
+}
+
 // List must be freed bu the user
 static bool acquire_all_policies(pap_policy_id_list_t** pol_list_head) {
+  pap_policy_id_list_t** tail = pol_list_head;
+
+  // Append after an existing list
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+
   // Call function for acquring all policies
-  char pol_id_hex[PAP_POL_ID_MAX_LEN] = {0};
-  char* pol_id_buff = NULL;
-  char* tok = NULL;
-  int pol_id_buff_len = 0;
-  pap_policy_id_list_t* temp = NULL;
-  FILE* f;
-
-  f = fopen("stored_policies/stored_policies.txt", "r");
-  if (f == NULL) {
-    log_error(plugin_logger_id, "[%s:%d] file empty.\n", __func__, __LINE__);
-    return FALSE;
+  policylog_foreach(g_policy_log, append_policy_id, &tail);
+
+  return TRUE;
+}
+
+// Writes queued in front of the store must reach it before it is read directly
+static void drain_pending() {
+  pap_plugin_posix_drain_cb_t drain_cb;
+
+  pthread_mutex_lock(&g_storage_lock);
+  drain_cb = g_drain_cb;
+  pthread_mutex_unlock(&g_storage_lock);
+
+  if (drain_cb != NULL) drain_cb();
+}
+
+void pap_plugin_posix_set_drain_cb(pap_plugin_posix_drain_cb_t drain_cb) {
+  pthread_mutex_lock(&g_storage_lock);
+  g_drain_cb = drain_cb;
+  pthread_mutex_unlock(&g_storage_lock);
+}
+
+int pap_plugin_posix_view(char* policy_id, pap_plugin_posix_view_t* view) {
+  int ret;
+
+  if (policy_id == NULL || view == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  ret = policylog_view(g_policy_log, policy_id, view);
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return ret;
+}
+
+void pap_plugin_posix_view_release(pap_plugin_posix_view_t* view) {
+  pthread_mutex_lock(&g_storage_lock);
+  policylog_view_release(view);
+  pthread_mutex_unlock(&g_storage_lock);
+}
+
+int pap_plugin_posix_evaluate(char* policy_id, const policycomp_request_t* request, policycomp_decision_e* decision) {
+  pap_plugin_posix_view_t view;
+
+  if (policy_id == NULL || request == NULL || decision == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  if (pap_plugin_posix_view(policy_id, &view) != 0) {
+    return 1;
+  }
+
+  // The pinned policy is evaluated without holding the storage lock
+  if (view.compiled != NULL) {
+    *decision = policycomp_evaluate(view.compiled, view.compiled_len, request);
+  }
+  pap_plugin_posix_view_release(&view);
+
+  return view.compiled == NULL;
+}
+
+int pap_plugin_posix_list_ids(char** ids, int* count) {
+  uint32_t position = 0;
+
+  if (ids == NULL || count == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  *count = policylog_count(g_policy_log);
+  *ids = malloc((size_t)(*count > 0 ? *count : 1) * PAP_POL_ID_MAX_LEN);
+  if (*ids != NULL) {
+    *count = policylog_list(g_policy_log, *ids, &position, *count);
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return *ids == NULL ? 1 : 0;
+}
+
+void pap_plugin_posix_cursor_init(pap_plugin_posix_cursor_t* cursor) {
+  if (cursor == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_storage_lock);
+  cursor->position = 0;
+  cursor->generation = policylog_generation(g_policy_log);
+  pthread_mutex_unlock(&g_storage_lock);
+}
+
+int pap_plugin_posix_cursor_next(pap_plugin_posix_cursor_t* cursor, char* ids, int max_ids) {
+  int count;
+
+  if (cursor == NULL || ids == NULL || max_ids <= 0) {
+    return 0;
+  }
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  // Positions are index slots, which a grown index reassigns
+  if (policylog_generation(g_policy_log) != cursor->generation) {
+    count = -1;
+  } else {
+    count = policylog_list(g_policy_log, ids, &cursor->position, max_ids);
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return count;
+}
+
+int pap_plugin_posix_candidates(const policycomp_request_t* request, char** ids, int* count) {
+  int ret;
+
+  // Check input parameters
+  if (request == NULL || ids == NULL || count == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
   }
 
-  fseek(f, 0L, SEEK_END);
-  pol_id_buff_len = ftell(f);
-  fseek(f, 0L, SEEK_SET);
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  ret = policyindex_candidates(g_policy_index, request, ids, count);
+  pthread_mutex_unlock(&g_storage_lock);
 
-  pol_id_buff = calloc(pol_id_buff_len * sizeof(char), 1);
+  return ret;
+}
 
-  fread(pol_id_buff, pol_id_buff_len, 1, f);
+static void evaluate_chunks(evaluate_batch_t* batch) {
+  policylog_view_t views[POLICY_EVALUATE_CHUNK];
+
+  pthread_mutex_lock(&batch->lock);
+  while (!batch->settled && batch->next < batch->count) {
+    int first = batch->next;
+    int last = MIN(first + POLICY_EVALUATE_CHUNK, batch->count);
+    int overriding = -1;
+    int other = -1;
+    int uncompiled = 0;
+
+    batch->next = last;
+    pthread_mutex_unlock(&batch->lock);
+
+    // Pinned per chunk, candidates skipped after the decision is settled are never read. Checksums are verified
+    // without the storage lock, it would otherwise serialize most of the work.
+    pthread_mutex_lock(&g_storage_lock);
+    for (int i = first; i < last; i++) {
+      if (policylog_view_unchecked(g_policy_log, batch->ids + (size_t)i * POLICYINDEX_ID_LEN, &views[i - first]) != 0) {
+        views[i - first].pin = NULL;
+      }
+    }
+    pthread_mutex_unlock(&g_storage_lock);
 
-  fclose(f);
+    for (int i = first; i < last && overriding < 0; i++) {
+      policylog_view_t* view = &views[i - first];
+      policycomp_decision_e decision = POLICYCOMP_GAP;
 
-  tok = strtok(pol_id_buff, "|");
-  while (tok) {
-    pap_policy_id_list_t* elem = malloc(sizeof(pap_policy_id_list_t));
-    memset(elem, 0, sizeof(pap_policy_id_list_t));
-    memset(pol_id_hex, 0, PAP_POL_ID_MAX_LEN);
+      // Deleted since the candidates were listed
+      if (view->pin == NULL) continue;
+      if (policylog_view_check(view) != 0) {
+        log_error(plugin_logger_id, "[%s:%d] skipping corrupt policy.\n", __func__, __LINE__);
+        continue;
+      }
 
-    if (str_to_hex(tok, pol_id_hex, PAP_POL_ID_MAX_LEN * 2) != UTILS_STRING_SUCCESS) {
-      log_error(plugin_logger_id, "[%s:%d] could not convert string to hex value.\n", __func__, __LINE__);
-      return FALSE;
+      decision = view->compiled != NULL ? policycomp_evaluate(view->compiled, view->compiled_len, batch->request)
+                                        : POLICYCOMP_ERROR;
+      if (decision == batch->overriding || decision == POLICYCOMP_CONFLICT) {
+        overriding = i;
+      } else if (decision == POLICYCOMP_ERROR) {
+        uncompiled++;
+      } else if (decision != POLICYCOMP_GAP && other < 0) {
+        other = i;
+      }
     }
 
-    memcpy(elem->policy_id, pol_id_hex, PAP_POL_ID_MAX_LEN);
+    pthread_mutex_lock(&g_storage_lock);
+    for (int i = first; i < last; i++) {
+      if (views[i - first].pin != NULL) policylog_view_release(&views[i - first]);
+    }
+    pthread_mutex_unlock(&g_storage_lock);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->uncompiled += uncompiled;
+    if (overriding >= 0 && !batch->settled) {
+      batch->settled = 1;
+      batch->decided = overriding;
+      batch->decision = batch->overriding;
+    } else if (other >= 0 && batch->decided < 0) {
+      batch->decided = other;
+      batch->decision = batch->overriding == POLICYCOMP_DENY ? POLICYCOMP_GRANT : POLICYCOMP_DENY;
+    }
+  }
+  pthread_mutex_unlock(&batch->lock);
+}
 
-    if (*pol_list_head == NULL) {
-      *pol_list_head = elem;
-    } else {
-      temp = *pol_list_head;
-      while (temp->next != NULL) {
-        temp = temp->next;
+static void evaluate_task(void* arg) {
+  evaluate_batch_t* batch = (evaluate_batch_t*)arg;
+
+  evaluate_chunks(batch);
+
+  pthread_mutex_lock(&batch->lock);
+  if (--batch->running == 0) {
+    pthread_cond_signal(&batch->done);
+  }
+  pthread_mutex_unlock(&batch->lock);
+}
+
+int pap_plugin_posix_decide(const policycomp_request_t* request, pap_plugin_posix_combining_e combining,
+                            policycomp_decision_e* decision, char* policy_id) {
+  evaluate_batch_t batch;
+  int tasks = 0;
+
+  // Check input parameters
+  if (request == NULL || decision == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  memset(&batch, 0, sizeof(batch));
+  batch.request = request;
+  batch.overriding = combining == PAP_PLUGIN_POSIX_PERMIT_OVERRIDES ? POLICYCOMP_GRANT : POLICYCOMP_DENY;
+  batch.decided = -1;
+  batch.decision = POLICYCOMP_GAP;
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  if (policyindex_candidates(g_policy_index, request, &batch.ids, &batch.count) != 0) {
+    pthread_mutex_unlock(&g_storage_lock);
+    log_error(plugin_logger_id, "[%s:%d] could not list candidates.\n", __func__, __LINE__);
+    return 1;
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.done, NULL);
+
+  // The caller evaluates too, fanning out only pays off for many candidates
+  if (g_evaluate_pool != NULL && batch.count >= g_evaluate_min) {
+    tasks = MIN(worker_pool_size(g_evaluate_pool), (batch.count - 1) / POLICY_EVALUATE_CHUNK);
+  }
+  for (int i = 0; i < tasks; i++) {
+    pthread_mutex_lock(&batch.lock);
+    batch.running++;
+    pthread_mutex_unlock(&batch.lock);
+    if (worker_pool_submit(g_evaluate_pool, evaluate_task, &batch) != 0) {
+      pthread_mutex_lock(&batch.lock);
+      batch.running--;
+      pthread_mutex_unlock(&batch.lock);
+      break;
+    }
+  }
+
+  evaluate_chunks(&batch);
+
+  pthread_mutex_lock(&batch.lock);
+  while (batch.running > 0) {
+    pthread_cond_wait(&batch.done, &batch.lock);
+  }
+  pthread_mutex_unlock(&batch.lock);
+
+  *decision = batch.decision;
+  if (policy_id != NULL && batch.decided >= 0) {
+    memcpy(policy_id, batch.ids + (size_t)batch.decided * POLICYINDEX_ID_LEN, POLICYINDEX_ID_LEN);
+  }
+
+  free(batch.ids);
+  pthread_mutex_destroy(&batch.lock);
+  pthread_cond_destroy(&batch.done);
+
+  // Without the overriding decision, policies that were not compiled could still change the outcome
+  return !batch.settled && batch.uncompiled > 0;
+}
+
+static void inflight_enter() {
+  pthread_mutex_lock(&g_inflight_lock);
+  g_inflight++;
+  pthread_mutex_unlock(&g_inflight_lock);
+}
+
+// Must be called with the storage lock held
+static void inflight_leave() {
+  pthread_mutex_lock(&g_inflight_lock);
+  g_inflight--;
+  pthread_mutex_unlock(&g_inflight_lock);
+  pthread_cond_signal(&g_commit_cond);
+}
+
+static int inflight() {
+  int ret;
+
+  pthread_mutex_lock(&g_inflight_lock);
+  ret = g_inflight;
+  pthread_mutex_unlock(&g_inflight_lock);
+
+  return ret;
+}
+
+// Sync everything written so far and release the waiting writers. Must be called with the storage lock held, which
+// is released during the sync so the next batch can be written meanwhile.
+static void commit_sync() {
+  unsigned long long seq = g_write_seq;
+  int fd = policylog_sync_fd(g_policy_log);
+
+  g_commit_waiting = 0;
+  pthread_mutex_unlock(&g_storage_lock);
+  if (fd < 0 || fdatasync(fd) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not sync policy log.\n", __func__, __LINE__);
+  }
+  if (fd >= 0) close(fd);
+  pthread_mutex_lock(&g_storage_lock);
+
+  if (seq > g_durable_seq) {
+    g_durable_seq = seq;
+    pthread_cond_broadcast(&g_durable_cond);
+  }
+}
+
+// Block until the last write is durable, must be called with the storage lock held
+static void commit_wait() {
+  unsigned long long seq = ++g_write_seq;
+
+  if (g_commit_ms == 0) {
+    commit_sync();
+    return;
+  }
+
+  if (g_commit_waiting++ == 0) {
+    clock_gettime(CLOCK_REALTIME, &g_commit_deadline);
+    g_commit_deadline.tv_sec += g_commit_ms / 1000;
+    g_commit_deadline.tv_nsec += (long)(g_commit_ms % 1000) * 1000000L;
+    if (g_commit_deadline.tv_nsec >= 1000000000L) {
+      g_commit_deadline.tv_sec++;
+      g_commit_deadline.tv_nsec -= 1000000000L;
+    }
+  }
+  pthread_cond_signal(&g_commit_cond);
+
+  while (g_durable_seq < seq) {
+    pthread_cond_wait(&g_durable_cond, &g_storage_lock);
+  }
+}
+
+static void* committer_thread(void* arg) {
+  pthread_mutex_lock(&g_storage_lock);
+  while (!g_committer_end) {
+    if (g_commit_waiting == 0) {
+      pthread_cond_wait(&g_commit_cond, &g_storage_lock);
+    } else if (g_commit_waiting >= g_commit_size || inflight() == 0 ||
+               pthread_cond_timedwait(&g_commit_cond, &g_storage_lock, &g_commit_deadline) == ETIMEDOUT) {
+      commit_sync();
+    }
+  }
+  if (g_commit_waiting > 0) {
+    commit_sync();
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return NULL;
+}
+
+// Candidate index and expiry heap, both in memory only
+static int build_index() {
+  char ids[POLICY_INDEX_BATCH * POLICYLOG_ID_LEN];
+  uint32_t position = 0;
+  int count;
+
+  g_policy_index = policyindex_create();
+  g_policy_expiry = policyexpiry_create();
+  if (g_policy_index == NULL || g_policy_expiry == NULL) {
+    policyindex_destroy(&g_policy_index);
+    policyexpiry_destroy(&g_policy_expiry);
+    return 1;
+  }
+
+  while ((count = policylog_list(g_policy_log, ids, &position, POLICY_INDEX_BATCH)) > 0) {
+    for (int i = 0; i < count; i++) {
+      policylog_view_t view;
+
+      if (policylog_view(g_policy_log, ids + i * POLICYLOG_ID_LEN, &view) != 0) continue;
+      if (policyindex_add(g_policy_index, view.policy_id, view.compiled, view.compiled_len) != 0) {
+        policylog_view_release(&view);
+        policyindex_destroy(&g_policy_index);
+        policyexpiry_destroy(&g_policy_expiry);
+        return 1;
       }
+      track_expiry(view.policy_id, view.compiled, view.compiled_len);
+      policylog_view_release(&view);
+    }
+  }
+
+  return 0;
+}
+
+// Delete expired policies, returns their IDs
+static int evict_expired(char* ids, int max_ids) {
+  int64_t now = (int64_t)time(NULL);
+  int64_t not_after;
+  int count = 0;
 
-      temp->next = elem;
+  while (count < max_ids && policyexpiry_first(g_policy_expiry, ids + count * POLICYLOG_ID_LEN, &not_after) == 0 &&
+         not_after < now) {
+    char* policy_id = ids + count * POLICYLOG_ID_LEN;
+
+    // Also drops the policy from the heap, a policy that can not be deleted is not retried until it is stored again
+    if (posix_flush_policy(policy_id)) {
+      count++;
+    } else {
+      log_error(plugin_logger_id, "[%s:%d] could not evict expired policy.\n", __func__, __LINE__);
+      policyexpiry_remove(g_policy_expiry, policy_id);
     }
+  }
+
+  return count;
+}
+
+static void* expiry_thread(void* arg) {
+  char ids[POLICY_EXPIRY_BATCH * POLICYLOG_ID_LEN];
+
+  pthread_mutex_lock(&g_storage_lock);
+  while (!g_expiry_end) {
+    int64_t not_after;
+    int count = evict_expired(ids, POLICY_EXPIRY_BATCH);
+
+    if (count > 0) {
+      pap_plugin_posix_evict_cb_t evict_cb = g_evict_cb;
+
+      // Reported only once durable, a crash must not bring back a policy the loader was told is gone
+      commit_wait();
+
+      // Caches are told without the storage lock, they call into the store with their own lock held
+      pthread_mutex_unlock(&g_storage_lock);
+      log_info(plugin_logger_id, "[%s:%d] evicted %d expired policies.\n", __func__, __LINE__, count);
+      for (int i = 0; evict_cb != NULL && i < count; i++) {
+        evict_cb(ids + i * POLICYLOG_ID_LEN);
+      }
+      pthread_mutex_lock(&g_storage_lock);
+      continue;
+    }
+
+    if (policyexpiry_first(g_policy_expiry, NULL, &not_after) != 0) {
+      pthread_cond_wait(&g_expiry_cond, &g_storage_lock);
+    } else {
+      // Woken early by policies expiring sooner, and at least hourly in case the clock was set
+      struct timespec deadline = {0};
+      int64_t now = (int64_t)time(NULL);
 
-    tok = strtok(NULL, "|");
+      deadline.tv_sec = not_after - now < POLICY_EXPIRY_MAX_WAIT_S ? not_after + 1 : now + POLICY_EXPIRY_MAX_WAIT_S;
+      pthread_cond_timedwait(&g_expiry_cond, &g_storage_lock, &deadline);
+    }
   }
+  pthread_mutex_unlock(&g_storage_lock);
 
-  free(pol_id_buff);
+  return NULL;
+}
 
-  return TRUE;
+void pap_plugin_posix_set_evict_cb(pap_plugin_posix_evict_cb_t evict_cb) {
+  pthread_mutex_lock(&g_storage_lock);
+  g_evict_cb = evict_cb;
+  if (g_expiry_enabled && !g_expiry_started && g_policy_log != NULL) {
+    if (pthread_create(&g_expiry_thread, NULL, expiry_thread, NULL) == 0) {
+      g_expiry_started = 1;
+    } else {
+      log_error(plugin_logger_id, "[%s:%d] could not start expiry thread.\n", __func__, __LINE__);
+    }
+  }
+  pthread_mutex_unlock(&g_storage_lock);
 }
 
 static int destroy_cb(plugin_t* plugin, void* data) {
+  pthread_mutex_lock(&g_storage_lock);
+  g_committer_end = 1;
+  pthread_cond_signal(&g_commit_cond);
+  g_expiry_end = 1;
+  pthread_cond_signal(&g_expiry_cond);
+  pthread_mutex_unlock(&g_storage_lock);
+  if (g_commit_ms > 0) {
+    pthread_join(g_committer, NULL);
+  }
+  if (g_expiry_started) {
+    pthread_join(g_expiry_thread, NULL);
+    g_expiry_started = 0;
+  }
+
+  pthread_mutex_lock(&g_storage_lock);
+  policylog_close(&g_policy_log);
+  policyindex_destroy(&g_policy_index);
+  policyexpiry_destroy(&g_policy_expiry);
+  pthread_mutex_unlock(&g_storage_lock);
+  worker_pool_destroy(&g_evaluate_pool);
   free(plugin->callbacks);
   return 0;
 }
 
 static int put_cb(plugin_t* plugin, void* data) {
   pap_policy_t* policy = (pap_policy_t*)data;
-  store_policy(policy->policy_id, policy->policy_object, policy->policy_id_signature, policy->hash_function);
-  return 0;
+  char* compiled = NULL;
+  size_t compiled_len = 0;
+  policylog_meta_t meta;
+  policylog_checksum_t checksum;
+  bool stored;
+
+  // Compiled before taking the lock, policies the compiler rejects are evaluated from JSON
+  if (policy->policy_object.policy_object != NULL && policy->policy_object.policy_object_size > 0 &&
+      policycomp_compile(policy->policy_object.policy_object, policy->policy_object.policy_object_size, &compiled,
+                         &compiled_len) != 0) {
+    log_info(plugin_logger_id, "[%s:%d] storing policy without compiled form.\n", __func__, __LINE__);
+    compiled = NULL;
+    compiled_len = 0;
+  }
+
+  // Checked and checksummed before taking the lock as well, which leaves only the append and the index update under it
+  if (!prepare_policy(policy->policy_id, policy->policy_object, policy->policy_id_signature, policy->hash_function,
+                      compiled, compiled_len, &meta, &checksum)) {
+    free(compiled);
+    return 1;
+  }
+
+  inflight_enter();
+  pthread_mutex_lock(&g_storage_lock);
+  stored = store_policy(&meta, &checksum, policy->policy_object.policy_object, compiled);
+  inflight_leave();
+  if (stored) {
+    commit_wait();
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+  free(compiled);
+  return stored ? 0 : 1;
 }
 
 static int get_cb(plugin_t* plugin, void* data) {
   pap_plugin_get_args_t* args = (pap_plugin_get_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
   acquire_policy(args->policy_id, &args->policy->policy_object, &args->policy->policy_id_signature,
                  &args->policy->hash_function);
+  pthread_mutex_unlock(&g_storage_lock);
   strncpy(args->policy->policy_id, args->policy_id, PAP_POL_ID_MAX_LEN);
   args->policy->policy_id[PAP_POL_ID_MAX_LEN + 1] = 0;
   return 0;
@@ -548,30 +957,94 @@ static int get_cb(plugin_t* plugin, void* data) {
 
 static int has_cb(plugin_t* plugin, void* data) {
   pap_plugin_has_args_t* args = (pap_plugin_has_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
   args->does_have = check_if_stored_policy(args->policy_id);
+  pthread_mutex_unlock(&g_storage_lock);
   return 0;
 }
 
 static int del_cb(plugin_t* plugin, void* data) {
   char* policy_id = (char*)data;
-
-  flush_policy(policy_id);
+  bool flushed;
+
+  inflight_enter();
+  pthread_mutex_lock(&g_storage_lock);
+  flushed = flush_policy(policy_id);
+  inflight_leave();
+  if (flushed) {
+    commit_wait();
+  }
+  pthread_mutex_unlock(&g_storage_lock);
   return 0;
 }
 
 static int get_len_cb(plugin_t* plugin, void* data) {
   pap_plugin_len_args_t* args = (pap_plugin_len_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
   acquire_pol_obj_len(args->policy_id, &args->len);
+  pthread_mutex_unlock(&g_storage_lock);
   return 0;
 }
 
 static int get_all_cb(plugin_t* plugin, void* data) {
   pap_policy_id_list_t** id_list = (pap_policy_id_list_t**)data;
+
+  pthread_mutex_lock(&g_storage_lock);
   acquire_all_policies(id_list);
+  pthread_mutex_unlock(&g_storage_lock);
   return 0;
 }
 
 int pap_plugin_posix_initializer(plugin_t* plugin, void* data) {
+  if (config_manager_get_option_int("pap", "group_commit_ms", &g_commit_ms) != CONFIG_MANAGER_OK || g_commit_ms < 0) {
+    g_commit_ms = POLICY_COMMIT_DEFAULT_MS;
+  }
+  if (config_manager_get_option_int("pap", "group_commit_size", &g_commit_size) != CONFIG_MANAGER_OK ||
+      g_commit_size <= 0) {
+    g_commit_size = POLICY_COMMIT_DEFAULT_SIZE;
+  }
+  if (config_manager_get_option_int("pap", "evaluate_min_candidates", &g_evaluate_min) != CONFIG_MANAGER_OK ||
+      g_evaluate_min < 0) {
+    g_evaluate_min = POLICY_EVALUATE_DEFAULT_MIN;
+  }
+  if (config_manager_get_option_int("pap", "policy_expiry", &g_expiry_enabled) != CONFIG_MANAGER_OK) {
+    g_expiry_enabled = 1;
+  }
+
+  pthread_mutex_lock(&g_storage_lock);
+  if (g_policy_log == NULL) {
+    g_policy_log = policylog_open(POLICY_STORE_DIR);
+  }
+  if (g_policy_log != NULL && g_policy_index == NULL && build_index() != 0) {
+    policylog_close(&g_policy_log);
+  }
+  g_committer_end = 0;
+  g_expiry_end = 0;
+  pthread_mutex_unlock(&g_storage_lock);
+  if (g_policy_log == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] could not open policy store.\n", __func__, __LINE__);
+    return -1;
+  }
+
+  // A negative worker count evaluates every request on the calling thread
+  if (g_evaluate_pool == NULL) {
+    int evaluate_workers = 0;
+
+    if (config_manager_get_option_int("pap", "evaluate_workers", &evaluate_workers) != CONFIG_MANAGER_OK)
+      evaluate_workers = 0;  // One per CPU
+    if (evaluate_workers >= 0) {
+      g_evaluate_pool = worker_pool_create(evaluate_workers, POLICY_EVALUATE_QUEUE_LEN);
+    }
+  }
+
+  // With no latency budget every write syncs on its own and no committer is needed
+  if (g_commit_ms > 0 && pthread_create(&g_committer, NULL, committer_thread, NULL) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not start committer thread.\n", __func__, __LINE__);
+    g_commit_ms = 0;
+  }
+
   plugin->destroy = destroy_cb;
   plugin->callbacks = malloc(sizeof(void*) * PAP_PLUGIN_CALLBACK_COUNT);
   plugin->plugin_specific_data = NULL;
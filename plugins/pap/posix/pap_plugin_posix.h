@@ -35,9 +35,142 @@
 #ifndef _PAP_PLUGIN_POSIX_H_
 #define _PAP_PLUGIN_POSIX_H_
 
+#include <stdint.h>
+
 #include "pap_plugin.h"
 #include "plugin.h"
+#include "policy_compiler.h"
+#include "policy_log.h"
+
+// Policy object, cost, signature and compiled form read in place from the store
+typedef policylog_view_t pap_plugin_posix_view_t;
+
+typedef struct {
+  uint32_t position;
+  uint32_t generation;  // of the index the position refers to
+} pap_plugin_posix_cursor_t;
+
+// Called with the ID of each policy evicted after it expired
+typedef void (*pap_plugin_posix_evict_cb_t)(char *policy_id);
+
+// Called before reading the store directly, to flush writes queued in front of the plugin
+typedef void (*pap_plugin_posix_drain_cb_t)(void);
+
+typedef enum {
+  PAP_PLUGIN_POSIX_DENY_OVERRIDES,   /*!< deny if any candidate denies */
+  PAP_PLUGIN_POSIX_PERMIT_OVERRIDES, /*!< grant if any candidate grants */
+} pap_plugin_posix_combining_e;
 
 int pap_plugin_posix_initializer(plugin_t *plugin, void *user_data);
 
+/**
+ * @brief Pin a stored policy and point the view at it, without copying
+ *
+ * @param[in] policy_id Binary policy ID
+ * @param[out] view Policy fields, valid until pap_plugin_posix_view_release
+ *
+ * @return 0 on success, 1 if the policy is not stored
+ */
+int pap_plugin_posix_view(char *policy_id, pap_plugin_posix_view_t *view);
+
+void pap_plugin_posix_view_release(pap_plugin_posix_view_t *view);
+
+/**
+ * @brief Evaluate a stored policy from its compiled form
+ *
+ * @param[in] policy_id Binary policy ID
+ * @param[in] request Request attributes
+ * @param[out] decision Decision
+ *
+ * @return 0 on success, 1 if the policy is not stored or has no compiled form and must be evaluated from JSON
+ */
+int pap_plugin_posix_evaluate(char *policy_id, const policycomp_request_t *request, policycomp_decision_e *decision);
+
+/**
+ * @brief IDs of the stored policies that may apply to a request
+ *
+ * Policies are indexed by the subject, action or object values their compiled
+ * form restricts them to. The result may contain policies that do not apply,
+ * but never misses one that does.
+ *
+ * @param[in] request Request attributes
+ * @param[out] ids PAP_POL_ID_MAX_LEN bytes per ID, must be freed by the caller
+ * @param[out] count Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int pap_plugin_posix_candidates(const policycomp_request_t *request, char **ids, int *count);
+
+/**
+ * @brief Register a callback for expired policies, to drop them from caches in front of the plugin
+ *
+ * A policy expires once the wall clock is past the latest request time its
+ * time conditions allow, it is then deleted in the background. Expired
+ * policies are kept until the first call, so register the callback once the
+ * layers it tells are running. The callback is called once the deletion is
+ * durable.
+ *
+ * @param[in] evict_cb Callback, NULL to unregister
+ */
+void pap_plugin_posix_set_evict_cb(pap_plugin_posix_evict_cb_t evict_cb);
+
+/**
+ * @brief Register a callback flushing writes queued in front of the plugin
+ *
+ * Views, evaluation, candidate selection, decisions and ID listing read the
+ * store without going through the plugin callbacks. They call it first, so
+ * they see every write a cache in front of the plugin has acknowledged.
+ *
+ * @param[in] drain_cb Callback, NULL to unregister
+ */
+void pap_plugin_posix_set_drain_cb(pap_plugin_posix_drain_cb_t drain_cb);
+
+/**
+ * @brief Evaluate all candidate policies of a request and combine their decisions
+ *
+ * With enough candidates they are evaluated on the shared evaluation pool as
+ * well as the calling thread. Evaluation stops once a candidate yields the
+ * overriding decision, a conflict counts as overriding.
+ *
+ * @param[in] request Request attributes
+ * @param[in] combining Combining algorithm
+ * @param[out] decision POLICYCOMP_GRANT, POLICYCOMP_DENY or POLICYCOMP_GAP
+ * @param[out] policy_id Buffer for the ID of the deciding policy, may be NULL, not set on POLICYCOMP_GAP
+ *
+ * @return 0 on success, 1 if the decision also depends on policies that must be evaluated from JSON
+ */
+int pap_plugin_posix_decide(const policycomp_request_t *request, pap_plugin_posix_combining_e combining,
+                            policycomp_decision_e *decision, char *policy_id);
+
+/**
+ * @brief List all stored policy IDs in one contiguous buffer
+ *
+ * @param[out] ids PAP_POL_ID_MAX_LEN bytes per ID, must be freed by the caller
+ * @param[out] count Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int pap_plugin_posix_list_ids(char **ids, int *count);
+
+/**
+ * @brief Start iterating over stored policy IDs
+ */
+void pap_plugin_posix_cursor_init(pap_plugin_posix_cursor_t *cursor);
+
+/**
+ * @brief Copy the next batch of stored policy IDs
+ *
+ * Policies stored while iterating may be skipped, and policies deleted and
+ * stored again may be returned twice. Storing policies may also grow the
+ * index, which moves every ID; the cursor fails from then on and the
+ * iteration has to start over.
+ *
+ * @param[in,out] cursor Iteration state
+ * @param[out] ids Buffer for max_ids IDs of PAP_POL_ID_MAX_LEN bytes each
+ * @param[in] max_ids Buffer capacity in IDs
+ *
+ * @return number of IDs copied, 0 at the end, -1 if the index grew since the cursor was initialized
+ */
+int pap_plugin_posix_cursor_next(pap_plugin_posix_cursor_t *cursor, char *ids, int max_ids);
+
 #endif  //_PAP_PLUGIN_POSIX_H_
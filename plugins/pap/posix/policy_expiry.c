@@ -0,0 +1,253 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_expiry.c
+ * \brief
+ * Min-heap of policy expiry times
+ *
+ * \notes
+ * Items are found by ID through a chained hash table and know their heap
+ * position, so moving or removing a policy is logarithmic.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_expiry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define POLICYEXPIRY_INIT_CAPACITY 256
+
+typedef struct policyexpiry_item {
+  int64_t not_after;
+  char policy_id[POLICYEXPIRY_ID_LEN];
+  uint32_t position;
+  struct policyexpiry_item *next;
+} policyexpiry_item_t;
+
+struct policyexpiry {
+  policyexpiry_item_t **heap;
+  policyexpiry_item_t **buckets;
+  uint32_t capacity;  // heap slots and buckets, power of two
+  uint32_t count;
+};
+
+// FNV-1a, IDs are normally hashes already but nothing enforces that
+static uint64_t id_hash(const char *policy_id) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (int i = 0; i < POLICYEXPIRY_ID_LEN; i++) {
+    hash ^= (unsigned char)policy_id[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+static policyexpiry_item_t **bucket_of(policyexpiry_t *expiry, const char *policy_id) {
+  return &expiry->buckets[id_hash(policy_id) & (expiry->capacity - 1)];
+}
+
+static policyexpiry_item_t *find(policyexpiry_t *expiry, const char *policy_id) {
+  for (policyexpiry_item_t *item = *bucket_of(expiry, policy_id); item != NULL; item = item->next) {
+    if (memcmp(item->policy_id, policy_id, POLICYEXPIRY_ID_LEN) == 0) return item;
+  }
+
+  return NULL;
+}
+
+static void place(policyexpiry_t *expiry, policyexpiry_item_t *item, uint32_t position) {
+  expiry->heap[position] = item;
+  item->position = position;
+}
+
+static void sift_up(policyexpiry_t *expiry, policyexpiry_item_t *item) {
+  uint32_t position = item->position;
+
+  while (position > 0 && expiry->heap[(position - 1) / 2]->not_after > item->not_after) {
+    place(expiry, expiry->heap[(position - 1) / 2], position);
+    position = (position - 1) / 2;
+  }
+  place(expiry, item, position);
+}
+
+static void sift_down(policyexpiry_t *expiry, policyexpiry_item_t *item) {
+  uint32_t position = item->position;
+
+  while (2 * position + 1 < expiry->count) {
+    uint32_t child = 2 * position + 1;
+
+    if (child + 1 < expiry->count && expiry->heap[child + 1]->not_after < expiry->heap[child]->not_after) child++;
+    if (expiry->heap[child]->not_after >= item->not_after) break;
+    place(expiry, expiry->heap[child], position);
+    position = child;
+  }
+  place(expiry, item, position);
+}
+
+static int grow(policyexpiry_t *expiry) {
+  uint32_t capacity = expiry->capacity * 2;
+  policyexpiry_item_t **heap = realloc(expiry->heap, capacity * sizeof(policyexpiry_item_t *));
+  policyexpiry_item_t **buckets = NULL;
+
+  if (heap == NULL) {
+    return 1;
+  }
+  expiry->heap = heap;
+
+  buckets = calloc(capacity, sizeof(policyexpiry_item_t *));
+  if (buckets == NULL) {
+    return 1;
+  }
+
+  // Every item is in the heap, rehashing from it visits each once
+  for (uint32_t i = 0; i < expiry->count; i++) {
+    policyexpiry_item_t *item = expiry->heap[i];
+    policyexpiry_item_t **bucket = &buckets[id_hash(item->policy_id) & (capacity - 1)];
+
+    item->next = *bucket;
+    *bucket = item;
+  }
+
+  free(expiry->buckets);
+  expiry->buckets = buckets;
+  expiry->capacity = capacity;
+
+  return 0;
+}
+
+policyexpiry_t *policyexpiry_create(void) {
+  policyexpiry_t *expiry = calloc(1, sizeof(policyexpiry_t));
+
+  if (expiry == NULL) {
+    return NULL;
+  }
+
+  expiry->heap = calloc(POLICYEXPIRY_INIT_CAPACITY, sizeof(policyexpiry_item_t *));
+  expiry->buckets = calloc(POLICYEXPIRY_INIT_CAPACITY, sizeof(policyexpiry_item_t *));
+  if (expiry->heap == NULL || expiry->buckets == NULL) {
+    policyexpiry_destroy(&expiry);
+    return NULL;
+  }
+  expiry->capacity = POLICYEXPIRY_INIT_CAPACITY;
+
+  return expiry;
+}
+
+void policyexpiry_destroy(policyexpiry_t **expiry) {
+  if (expiry == NULL || *expiry == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < (*expiry)->count; i++) {
+    free((*expiry)->heap[i]);
+  }
+  free((*expiry)->heap);
+  free((*expiry)->buckets);
+  free(*expiry);
+  *expiry = NULL;
+}
+
+int policyexpiry_set(policyexpiry_t *expiry, const char *policy_id, int64_t not_after) {
+  policyexpiry_item_t *item = NULL;
+  policyexpiry_item_t **bucket = NULL;
+
+  if (expiry == NULL || policy_id == NULL) {
+    return 1;
+  }
+
+  item = find(expiry, policy_id);
+  if (item != NULL) {
+    int earlier = not_after < item->not_after;
+
+    item->not_after = not_after;
+    if (earlier) {
+      sift_up(expiry, item);
+    } else {
+      sift_down(expiry, item);
+    }
+    return 0;
+  }
+
+  if (expiry->count == expiry->capacity && grow(expiry) != 0) {
+    return 1;
+  }
+
+  item = malloc(sizeof(policyexpiry_item_t));
+  if (item == NULL) {
+    return 1;
+  }
+  item->not_after = not_after;
+  memcpy(item->policy_id, policy_id, POLICYEXPIRY_ID_LEN);
+  bucket = bucket_of(expiry, policy_id);
+  item->next = *bucket;
+  *bucket = item;
+
+  item->position = expiry->count++;
+  sift_up(expiry, item);
+
+  return 0;
+}
+
+void policyexpiry_remove(policyexpiry_t *expiry, const char *policy_id) {
+  policyexpiry_item_t **link = NULL;
+  policyexpiry_item_t *item = NULL;
+  policyexpiry_item_t *last = NULL;
+
+  if (expiry == NULL || policy_id == NULL) {
+    return;
+  }
+
+  for (link = bucket_of(expiry, policy_id); *link != NULL; link = &(*link)->next) {
+    if (memcmp((*link)->policy_id, policy_id, POLICYEXPIRY_ID_LEN) == 0) break;
+  }
+  if (*link == NULL) {
+    return;
+  }
+  item = *link;
+  *link = item->next;
+
+  // The last item takes the freed slot and moves whichever way restores the order
+  last = expiry->heap[--expiry->count];
+  if (last != item) {
+    last->position = item->position;
+    expiry->heap[last->position] = last;
+    if (last->not_after < item->not_after) {
+      sift_up(expiry, last);
+    } else {
+      sift_down(expiry, last);
+    }
+  }
+  free(item);
+}
+
+int policyexpiry_first(policyexpiry_t *expiry, char *policy_id, int64_t *not_after) {
+  if (expiry == NULL || expiry->count == 0) {
+    return 1;
+  }
+
+  if (policy_id != NULL) memcpy(policy_id, expiry->heap[0]->policy_id, POLICYEXPIRY_ID_LEN);
+  if (not_after != NULL) *not_after = expiry->heap[0]->not_after;
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_expiry.h
+ * \brief
+ * Min-heap of policy expiry times
+ *
+ * \notes
+ * Each policy is in the heap at most once, setting its time again moves it.
+ * Functions are not thread safe, the caller serializes access.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_EXPIRY_H_
+#define _POLICY_EXPIRY_H_
+
+#include <stdint.h>
+
+#define POLICYEXPIRY_ID_LEN 32
+
+typedef struct policyexpiry policyexpiry_t;
+
+/**
+ * @return empty heap, NULL on failure
+ */
+policyexpiry_t *policyexpiry_create(void);
+
+void policyexpiry_destroy(policyexpiry_t **expiry);
+
+/**
+ * @brief Add a policy or move it to a new expiry time
+ *
+ * @return 0 on success, 1 on failure
+ */
+int policyexpiry_set(policyexpiry_t *expiry, const char *policy_id, int64_t not_after);
+
+void policyexpiry_remove(policyexpiry_t *expiry, const char *policy_id);
+
+/**
+ * @brief Policy expiring first
+ *
+ * @param[in] expiry Heap
+ * @param[out] policy_id Buffer for POLICYEXPIRY_ID_LEN bytes
+ * @param[out] not_after Its expiry time
+ *
+ * @return 0 on success, 1 if the heap is empty
+ */
+int policyexpiry_first(policyexpiry_t *expiry, char *policy_id, int64_t *not_after);
+
+#endif  // _POLICY_EXPIRY_H_
@@ -0,0 +1,260 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_index.c
+ * \brief
+ * In-memory index from request subject, action and object to policy IDs
+ *
+ * \notes
+ * A chained hash table of (key hash, policy ID) pairs. A policy restricted
+ * to several values has one entry per value, unrestricted policies share
+ * the wildcard key.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_index.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POLICYINDEX_INIT_BUCKETS 1024
+#define POLICYINDEX_INIT_IDS 16
+
+typedef struct policyindex_entry {
+  uint64_t key;
+  char policy_id[POLICYINDEX_ID_LEN];
+  struct policyindex_entry *next;
+} policyindex_entry_t;
+
+struct policyindex {
+  policyindex_entry_t **buckets;
+  uint32_t bucket_count;  // power of two
+  uint32_t count;
+};
+
+// FNV-1a over the attribute and its value, the wildcard key has no value
+static uint64_t key_hash(policycomp_attr_e attr, const char *value, size_t value_len) {
+  uint64_t hash = 14695981039346656037ull;
+
+  hash = (hash ^ (uint8_t)attr) * 1099511628211ull;
+  for (size_t i = 0; i < value_len; i++) {
+    hash = (hash ^ (uint8_t)value[i]) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static policyindex_entry_t **bucket_of(policyindex_t *index, uint64_t key) {
+  return &index->buckets[key & (index->bucket_count - 1)];
+}
+
+// Keys of a policy, a single wildcard key if it is not restricted
+static int policy_keys(const char *compiled, size_t compiled_len, uint64_t *keys) {
+  policycomp_key_t values[POLICYCOMP_MAX_KEYS];
+  policycomp_attr_e attr;
+  int num_keys = 0;
+
+  if (compiled == NULL || policycomp_index_keys(compiled, compiled_len, &attr, values, &num_keys) != 0) {
+    keys[0] = key_hash(POLICYCOMP_ATTR_COUNT, NULL, 0);
+    return 1;
+  }
+
+  for (int i = 0; i < num_keys; i++) {
+    keys[i] = key_hash(attr, values[i].str, values[i].len);
+  }
+
+  return num_keys;
+}
+
+static int grow(policyindex_t *index) {
+  uint32_t bucket_count = index->bucket_count * 2;
+  policyindex_entry_t **buckets = calloc(bucket_count, sizeof(policyindex_entry_t *));
+
+  if (buckets == NULL) {
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < index->bucket_count; i++) {
+    policyindex_entry_t *entry = index->buckets[i];
+
+    while (entry != NULL) {
+      policyindex_entry_t *next = entry->next;
+      policyindex_entry_t **bucket = &buckets[entry->key & (bucket_count - 1)];
+
+      entry->next = *bucket;
+      *bucket = entry;
+      entry = next;
+    }
+  }
+
+  free(index->buckets);
+  index->buckets = buckets;
+  index->bucket_count = bucket_count;
+
+  return 0;
+}
+
+policyindex_t *policyindex_create(void) {
+  policyindex_t *index = calloc(1, sizeof(policyindex_t));
+
+  if (index == NULL) {
+    return NULL;
+  }
+
+  index->buckets = calloc(POLICYINDEX_INIT_BUCKETS, sizeof(policyindex_entry_t *));
+  if (index->buckets == NULL) {
+    free(index);
+    return NULL;
+  }
+  index->bucket_count = POLICYINDEX_INIT_BUCKETS;
+
+  return index;
+}
+
+void policyindex_destroy(policyindex_t **index) {
+  if (index == NULL || *index == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < (*index)->bucket_count; i++) {
+    policyindex_entry_t *entry = (*index)->buckets[i];
+
+    while (entry != NULL) {
+      policyindex_entry_t *next = entry->next;
+      free(entry);
+      entry = next;
+    }
+  }
+  free((*index)->buckets);
+  free(*index);
+  *index = NULL;
+}
+
+int policyindex_add(policyindex_t *index, const char *policy_id, const char *compiled, size_t compiled_len) {
+  uint64_t keys[POLICYCOMP_MAX_KEYS];
+  int num_keys;
+
+  if (index == NULL || policy_id == NULL) {
+    return 1;
+  }
+
+  num_keys = policy_keys(compiled, compiled_len, keys);
+  for (int i = 0; i < num_keys; i++) {
+    policyindex_entry_t **bucket = NULL;
+    policyindex_entry_t *entry = NULL;
+
+    // A table that can not grow only gets slower
+    if (index->count >= index->bucket_count) grow(index);
+
+    bucket = bucket_of(index, keys[i]);
+    for (entry = *bucket; entry != NULL; entry = entry->next) {
+      if (entry->key == keys[i] && memcmp(entry->policy_id, policy_id, POLICYINDEX_ID_LEN) == 0) break;
+    }
+    if (entry != NULL) continue;
+
+    entry = malloc(sizeof(policyindex_entry_t));
+    if (entry == NULL) {
+      return 1;
+    }
+    entry->key = keys[i];
+    memcpy(entry->policy_id, policy_id, POLICYINDEX_ID_LEN);
+    entry->next = *bucket;
+    *bucket = entry;
+    index->count++;
+  }
+
+  return 0;
+}
+
+void policyindex_remove(policyindex_t *index, const char *policy_id, const char *compiled, size_t compiled_len) {
+  uint64_t keys[POLICYCOMP_MAX_KEYS];
+  int num_keys;
+
+  if (index == NULL || policy_id == NULL) {
+    return;
+  }
+
+  num_keys = policy_keys(compiled, compiled_len, keys);
+  for (int i = 0; i < num_keys; i++) {
+    policyindex_entry_t **link = bucket_of(index, keys[i]);
+
+    while (*link != NULL) {
+      policyindex_entry_t *entry = *link;
+
+      if (entry->key == keys[i] && memcmp(entry->policy_id, policy_id, POLICYINDEX_ID_LEN) == 0) {
+        *link = entry->next;
+        free(entry);
+        index->count--;
+        break;
+      }
+      link = &entry->next;
+    }
+  }
+}
+
+int policyindex_candidates(policyindex_t *index, const policycomp_request_t *request, char **ids, int *count) {
+  static const policycomp_attr_e attrs[] = {POLICYCOMP_ATTR_SUBJECT_VALUE, POLICYCOMP_ATTR_ACTION_VALUE,
+                                            POLICYCOMP_ATTR_OBJECT_VALUE, POLICYCOMP_ATTR_COUNT};
+  int capacity = POLICYINDEX_INIT_IDS;
+
+  if (index == NULL || request == NULL || ids == NULL || count == NULL) {
+    return 1;
+  }
+
+  *count = 0;
+  *ids = malloc((size_t)capacity * POLICYINDEX_ID_LEN);
+  if (*ids == NULL) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+    uint64_t key;
+
+    // Policies restricted on an attribute the request lacks never apply
+    if (attrs[i] != POLICYCOMP_ATTR_COUNT && request->value[attrs[i]] == NULL) continue;
+
+    key = attrs[i] == POLICYCOMP_ATTR_COUNT
+              ? key_hash(POLICYCOMP_ATTR_COUNT, NULL, 0)
+              : key_hash(attrs[i], request->value[attrs[i]], request->value_len[attrs[i]]);
+    for (policyindex_entry_t *entry = *bucket_of(index, key); entry != NULL; entry = entry->next) {
+      if (entry->key != key) continue;
+
+      if (*count == capacity) {
+        char *new_ids = realloc(*ids, (size_t)capacity * 2 * POLICYINDEX_ID_LEN);
+
+        if (new_ids == NULL) {
+          free(*ids);
+          *ids = NULL;
+          return 1;
+        }
+        *ids = new_ids;
+        capacity *= 2;
+      }
+      memcpy(*ids + (size_t)*count * POLICYINDEX_ID_LEN, entry->policy_id, POLICYINDEX_ID_LEN);
+      (*count)++;
+    }
+  }
+
+  return 0;
+}
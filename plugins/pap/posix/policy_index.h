@@ -0,0 +1,84 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_index.h
+ * \brief
+ * In-memory index from request subject, action and object to policy IDs
+ *
+ * \notes
+ * Each policy is indexed under the attribute values it is restricted to, as
+ * derived from its compiled form. Policies that are not restricted, or have
+ * no compiled form, are candidates for every request. Keys are hashed, so a
+ * candidate may still not apply, evaluation decides. Functions are not
+ * thread safe, the caller serializes access.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_INDEX_H_
+#define _POLICY_INDEX_H_
+
+#include <stddef.h>
+
+#include "policy_compiler.h"
+
+#define POLICYINDEX_ID_LEN 32
+
+typedef struct policyindex policyindex_t;
+
+/**
+ * @return empty index, NULL on failure
+ */
+policyindex_t *policyindex_create(void);
+
+void policyindex_destroy(policyindex_t **index);
+
+/**
+ * @brief Index a policy
+ *
+ * @param[in] index Index
+ * @param[in] policy_id Binary policy ID
+ * @param[in] compiled Compiled policy, NULL if it has none
+ * @param[in] compiled_len Compiled policy length
+ *
+ * @return 0 on success, 1 on failure
+ */
+int policyindex_add(policyindex_t *index, const char *policy_id, const char *compiled, size_t compiled_len);
+
+/**
+ * @brief Remove a policy, given the same compiled form it was added with
+ */
+void policyindex_remove(policyindex_t *index, const char *policy_id, const char *compiled, size_t compiled_len);
+
+/**
+ * @brief IDs of the policies that may apply to a request
+ *
+ * @param[in] index Index
+ * @param[in] request Request attributes
+ * @param[out] ids POLICYINDEX_ID_LEN bytes per ID, must be freed by the caller
+ * @param[out] count Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int policyindex_candidates(policyindex_t *index, const policycomp_request_t *request, char **ids, int *count);
+
+#endif  // _POLICY_INDEX_H_
@@ -0,0 +1,989 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_log.c
+ * \brief
+ * Single-file policy store: append-only record log with an on-disk hash index
+ *
+ * \notes
+ * Every put and delete appends one record with a single write. The index maps
+ * a policy ID to the offset of its latest record, so a lookup is a probe in
+ * the mapped table and a get is a single read. Space of replaced and deleted
+ * records is reclaimed by rewriting the log once it is mostly dead.
+ *
+ * Views map the log read-only with room to grow. A mapping is reference
+ * counted, so it outlives remapping, compaction and close while pinned.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "plugin_logger.h"
+#include "zlib.h"
+
+#define POLICYLOG_RECORD_MAGIC 0x474c5050  // "PPLG"
+#define POLICYLOG_INDEX_MAGIC 0x58495050   // "PPIX"
+#define POLICYLOG_INDEX_VERSION 2
+#define POLICYLOG_INDEX_INIT_CAPACITY 1024
+#define POLICYLOG_MAX_OBJECT_LEN (16 * 1024 * 1024)
+#define POLICYLOG_COMPACT_MIN_DEAD (1024 * 1024)
+#define POLICYLOG_PATH_LEN 512
+#define POLICYLOG_MAP_MIN_LEN (1024 * 1024)
+
+#define POLICYLOG_RECORD_PUT 1
+#define POLICYLOG_RECORD_DEL 2
+#define POLICYLOG_RECORD_PUT_COMPILED 3
+#define POLICYLOG_RECORD_IS_PUT(type) ((type) == POLICYLOG_RECORD_PUT || (type) == POLICYLOG_RECORD_PUT_COMPILED)
+
+#define POLICYLOG_SLOT_EMPTY 0
+#define POLICYLOG_SLOT_DELETED UINT64_MAX
+#define POLICYLOG_SLOT_LIVE(slot) ((slot)->offset != POLICYLOG_SLOT_EMPTY && (slot)->offset != POLICYLOG_SLOT_DELETED)
+
+// Record header, followed by cost_len bytes of cost and object_len bytes of policy object. Fields are in host byte
+// order, the store never leaves the device.
+typedef struct {
+  uint32_t magic;
+  uint32_t crc;  // CRC-32 of everything after this field, payload included
+  uint8_t type;
+  uint8_t signature_algorithm;
+  uint8_t hash_function;
+  uint8_t cost_len;
+  uint32_t object_len;
+  char policy_id[POLICYLOG_ID_LEN];
+  char signature[POLICYLOG_SIGNATURE_LEN];
+  char public_key[POLICYLOG_PUBLIC_KEY_LEN];
+} policylog_record_t;
+
+// Follows the header of PUT_COMPILED records, whose compiled policy comes after the object. It has a CRC of its own,
+// so the policy can be read and checked without it.
+typedef struct {
+  uint32_t compiled_len;
+  uint32_t compiled_crc;
+} policylog_record_ext_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;  // power of two
+  uint32_t count;
+  uint32_t tombstones;
+  uint32_t clean;  // cleared while the store is open, an unclean index is rebuilt from the log
+  uint64_t log_size;
+  uint64_t dead_bytes;  // size of replaced and deleted records
+} policylog_index_header_t;
+
+typedef struct {
+  char policy_id[POLICYLOG_ID_LEN];
+  uint64_t offset;  // record offset + 1, POLICYLOG_SLOT_EMPTY or POLICYLOG_SLOT_DELETED
+  uint32_t record_len;
+  uint32_t object_len;
+  uint32_t compiled_len;
+  uint32_t reserved;
+} policylog_slot_t;
+
+typedef struct {
+  int fd;
+  size_t map_len;
+  policylog_index_header_t *header;
+  policylog_slot_t *slots;
+} policylog_index_t;
+
+typedef struct {
+  char *addr;
+  size_t len;
+  int refs;  // one for the store while it is current, one per view
+} policylog_map_t;
+
+struct policylog {
+  char dir[POLICYLOG_PATH_LEN];
+  char log_path[POLICYLOG_PATH_LEN];
+  char index_path[POLICYLOG_PATH_LEN];
+  char tmp_path[POLICYLOG_PATH_LEN];
+  int log_fd;
+  policylog_index_t index;
+  policylog_map_t *map;
+  uint32_t generation;  // bumped whenever IDs move to other index slots
+};
+
+static uint32_t record_crc(const policylog_record_t *rec, const policylog_record_ext_t *ext, const char *cost,
+                           const char *object) {
+  size_t skip = offsetof(policylog_record_t, type);
+  uLong crc = crc32(0L, Z_NULL, 0);
+
+  crc = crc32(crc, (const Bytef *)rec + skip, sizeof(policylog_record_t) - skip);
+  if (rec->type == POLICYLOG_RECORD_PUT_COMPILED) crc = crc32(crc, (const Bytef *)ext, sizeof(*ext));
+  // zlib returns 0 for a NULL buffer, whatever the running value
+  if (rec->cost_len > 0) crc = crc32(crc, (const Bytef *)cost, rec->cost_len);
+  if (rec->object_len > 0) crc = crc32(crc, (const Bytef *)object, rec->object_len);
+
+  return (uint32_t)crc;
+}
+
+static uint32_t compiled_crc(const char *compiled, uint32_t compiled_len) {
+  uLong crc = crc32(0L, Z_NULL, 0);
+
+  if (compiled_len > 0) crc = crc32(crc, (const Bytef *)compiled, compiled_len);
+
+  return (uint32_t)crc;
+}
+
+static size_t record_header_len(uint8_t type) {
+  return sizeof(policylog_record_t) + (type == POLICYLOG_RECORD_PUT_COMPILED ? sizeof(policylog_record_ext_t) : 0);
+}
+
+// FNV-1a, IDs are normally hashes already but nothing enforces that
+static uint64_t id_hash(const char *policy_id) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (int i = 0; i < POLICYLOG_ID_LEN; i++) {
+    hash ^= (unsigned char)policy_id[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+static size_t index_map_len(uint32_t capacity) {
+  return sizeof(policylog_index_header_t) + (size_t)capacity * sizeof(policylog_slot_t);
+}
+
+// Slot holding the ID, otherwise the slot where it is inserted. The load factor stays below one, so probing ends.
+static policylog_slot_t *index_find(policylog_index_t *index, const char *policy_id, int *found) {
+  uint32_t mask = index->header->capacity - 1;
+  uint32_t i = id_hash(policy_id) & mask;
+  policylog_slot_t *insert = NULL;
+
+  *found = 0;
+  while (1) {
+    policylog_slot_t *slot = &index->slots[i];
+
+    if (slot->offset == POLICYLOG_SLOT_EMPTY) {
+      return insert != NULL ? insert : slot;
+    } else if (slot->offset == POLICYLOG_SLOT_DELETED) {
+      if (insert == NULL) insert = slot;
+    } else if (memcmp(slot->policy_id, policy_id, POLICYLOG_ID_LEN) == 0) {
+      *found = 1;
+      return slot;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+static int index_map(policylog_index_t *index, int fd, size_t map_len) {
+  void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (map == MAP_FAILED) {
+    return 1;
+  }
+
+  index->fd = fd;
+  index->map_len = map_len;
+  index->header = (policylog_index_header_t *)map;
+  index->slots = (policylog_slot_t *)(index->header + 1);
+
+  return 0;
+}
+
+static void index_unmap(policylog_index_t *index) {
+  if (index->header != NULL) munmap(index->header, index->map_len);
+  if (index->fd >= 0) close(index->fd);
+  index->header = NULL;
+  index->slots = NULL;
+  index->fd = -1;
+}
+
+// Empty index in the temporary file, the caller renames it over the index
+static int index_create(policylog_t *log, uint32_t capacity, policylog_index_t *index) {
+  size_t map_len = index_map_len(capacity);
+  int fd = open(log->tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if (fd < 0) {
+    return 1;
+  }
+
+  // A new file reads as zeros, which marks every slot empty
+  if (ftruncate(fd, map_len) != 0 || index_map(index, fd, map_len) != 0) {
+    close(fd);
+    unlink(log->tmp_path);
+    return 1;
+  }
+
+  index->header->magic = POLICYLOG_INDEX_MAGIC;
+  index->header->version = POLICYLOG_INDEX_VERSION;
+  index->header->capacity = capacity;
+
+  return 0;
+}
+
+static int index_resize(policylog_t *log, uint32_t capacity) {
+  policylog_index_t index;
+  policylog_index_header_t *old = log->index.header;
+
+  if (index_create(log, capacity, &index) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not create index %s.\n", __func__, __LINE__, log->tmp_path);
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < old->capacity; i++) {
+    if (POLICYLOG_SLOT_LIVE(&log->index.slots[i])) {
+      int found;
+      *index_find(&index, log->index.slots[i].policy_id, &found) = log->index.slots[i];
+    }
+  }
+  index.header->count = old->count;
+  index.header->log_size = old->log_size;
+  index.header->dead_bytes = old->dead_bytes;
+
+  if (rename(log->tmp_path, log->index_path) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not replace index %s.\n", __func__, __LINE__, log->index_path);
+    index_unmap(&index);
+    unlink(log->tmp_path);
+    return 1;
+  }
+
+  index_unmap(&log->index);
+  log->index = index;
+  log->generation++;
+
+  return 0;
+}
+
+// Make room for one more ID, dropping tombstones and growing the table as needed
+static int index_reserve(policylog_t *log) {
+  policylog_index_header_t *header = log->index.header;
+  uint32_t capacity = header->capacity;
+
+  if ((uint64_t)(header->count + header->tombstones + 1) * 4 <= (uint64_t)capacity * 3) {
+    return 0;
+  }
+
+  while ((uint64_t)(header->count + 1) * 2 > capacity) capacity *= 2;
+
+  return index_resize(log, capacity);
+}
+
+// index_reserve must be called first
+static void index_set(policylog_t *log, const char *policy_id, uint64_t offset, uint32_t record_len,
+                      uint32_t object_len, uint32_t compiled_len) {
+  int found;
+  policylog_slot_t *slot = index_find(&log->index, policy_id, &found);
+
+  if (found) {
+    log->index.header->dead_bytes += slot->record_len;
+  } else {
+    if (slot->offset == POLICYLOG_SLOT_DELETED) log->index.header->tombstones--;
+    log->index.header->count++;
+    memcpy(slot->policy_id, policy_id, POLICYLOG_ID_LEN);
+  }
+
+  slot->offset = offset + 1;
+  slot->record_len = record_len;
+  slot->object_len = object_len;
+  slot->compiled_len = compiled_len;
+}
+
+static void index_unset(policylog_t *log, const char *policy_id, uint32_t del_record_len) {
+  int found;
+  policylog_slot_t *slot = index_find(&log->index, policy_id, &found);
+
+  log->index.header->dead_bytes += del_record_len;
+  if (found) {
+    log->index.header->dead_bytes += slot->record_len;
+    log->index.header->count--;
+    log->index.header->tombstones++;
+    slot->offset = POLICYLOG_SLOT_DELETED;
+  }
+}
+
+static int index_load(policylog_t *log, uint64_t log_size) {
+  policylog_index_header_t header;
+  struct stat st;
+  int fd = open(log->index_path, O_RDWR);
+
+  if (fd < 0) {
+    return 1;
+  }
+
+  if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      header.magic != POLICYLOG_INDEX_MAGIC || header.version != POLICYLOG_INDEX_VERSION || header.capacity == 0 ||
+      (header.capacity & (header.capacity - 1)) != 0 || (size_t)st.st_size != index_map_len(header.capacity) ||
+      !header.clean || header.log_size != log_size || index_map(&log->index, fd, st.st_size) != 0) {
+    close(fd);
+    return 1;
+  }
+
+  return 0;
+}
+
+// Replay the log into a new index. A torn or corrupt record ends the log, it and everything after it are dropped.
+static int index_rebuild(policylog_t *log, uint64_t log_size) {
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+  uint64_t offset = 0;
+  char *payload = NULL;
+  size_t payload_cap = 0;
+  FILE *f = NULL;
+
+  index_unmap(&log->index);
+  if (index_create(log, POLICYLOG_INDEX_INIT_CAPACITY, &log->index) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not create index %s.\n", __func__, __LINE__, log->tmp_path);
+    return 1;
+  }
+  if (rename(log->tmp_path, log->index_path) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not replace index %s.\n", __func__, __LINE__, log->index_path);
+    return 1;
+  }
+
+  f = fopen(log->log_path, "rb");
+  if (f == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] could not open %s.\n", __func__, __LINE__, log->log_path);
+    return 1;
+  }
+
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    size_t payload_len;
+    uint32_t record_len;
+
+    if (rec.magic != POLICYLOG_RECORD_MAGIC || rec.cost_len >= POLICYLOG_COST_LEN ||
+        rec.object_len > POLICYLOG_MAX_OBJECT_LEN ||
+        (!POLICYLOG_RECORD_IS_PUT(rec.type) && rec.type != POLICYLOG_RECORD_DEL)) {
+      break;
+    }
+    memset(&ext, 0, sizeof(ext));
+    if (rec.type == POLICYLOG_RECORD_PUT_COMPILED &&
+        (fread(&ext, sizeof(ext), 1, f) != 1 || ext.compiled_len > POLICYLOG_MAX_OBJECT_LEN)) {
+      break;
+    }
+    payload_len = (size_t)rec.cost_len + rec.object_len + ext.compiled_len;
+    record_len = record_header_len(rec.type) + payload_len;
+
+    if (payload_len > payload_cap) {
+      char *new_payload = realloc(payload, payload_len);
+      if (new_payload == NULL) {
+        break;
+      }
+      payload = new_payload;
+      payload_cap = payload_len;
+    }
+    if (payload_len > 0 && fread(payload, payload_len, 1, f) != 1) {
+      break;
+    }
+    if (record_crc(&rec, &ext, payload, payload + rec.cost_len) != rec.crc ||
+        compiled_crc(payload + rec.cost_len + rec.object_len, ext.compiled_len) != ext.compiled_crc) {
+      break;
+    }
+
+    if (POLICYLOG_RECORD_IS_PUT(rec.type)) {
+      if (index_reserve(log) != 0) {
+        fclose(f);
+        free(payload);
+        return 1;
+      }
+      index_set(log, rec.policy_id, offset, record_len, rec.object_len, ext.compiled_len);
+    } else {
+      index_unset(log, rec.policy_id, record_len);
+    }
+    offset += record_len;
+  }
+
+  fclose(f);
+  free(payload);
+
+  if (offset < log_size) {
+    log_error(plugin_logger_id, "[%s:%d] dropping %llu bytes of damaged log tail.\n", __func__, __LINE__,
+              (unsigned long long)(log_size - offset));
+    if (ftruncate(log->log_fd, offset) != 0) {
+      return 1;
+    }
+  }
+  log->index.header->log_size = offset;
+
+  return 0;
+}
+
+static void map_unref(policylog_map_t *map) {
+  if (map != NULL && --map->refs == 0) {
+    munmap(map->addr, map->len);
+    free(map);
+  }
+}
+
+// Current mapping covering the log up to end, replaced by a larger one when the log outgrew it
+static policylog_map_t *map_covering(policylog_t *log, uint64_t end) {
+  policylog_map_t *map = NULL;
+  size_t len = POLICYLOG_MAP_MIN_LEN;
+
+  if (log->map != NULL && end <= log->map->len) {
+    return log->map;
+  }
+
+  // Mapping past the end of the file is allowed, only appended records are ever read there
+  while (len < log->index.header->log_size * 2 || len < end) len *= 2;
+
+  map = calloc(1, sizeof(policylog_map_t));
+  if (map == NULL) {
+    return NULL;
+  }
+  map->addr = mmap(NULL, len, PROT_READ, MAP_SHARED, log->log_fd, 0);
+  if (map->addr == MAP_FAILED) {
+    log_error(plugin_logger_id, "[%s:%d] could not map %s.\n", __func__, __LINE__, log->log_path);
+    free(map);
+    return NULL;
+  }
+  map->len = len;
+  map->refs = 1;
+
+  map_unref(log->map);
+  log->map = map;
+
+  return map;
+}
+
+// Persist a created or renamed directory entry
+static int sync_dir(policylog_t *log) {
+  int fd = open(log->dir, O_RDONLY | O_DIRECTORY);
+  int ret;
+
+  if (fd < 0) {
+    return 1;
+  }
+  ret = fsync(fd) == 0 ? 0 : 1;
+  close(fd);
+
+  return ret;
+}
+
+static int log_append(policylog_t *log, const struct iovec *iov, int iov_cnt, uint32_t record_len) {
+  ssize_t written = writev(log->log_fd, iov, iov_cnt);
+
+  if (written != (ssize_t)record_len) {
+    log_error(plugin_logger_id, "[%s:%d] could not append to %s.\n", __func__, __LINE__, log->log_path);
+    // Cut off a partial record, so the next append starts at a record boundary
+    if (written > 0 && ftruncate(log->log_fd, log->index.header->log_size) != 0) {
+      log_error(plugin_logger_id, "[%s:%d] could not truncate %s.\n", __func__, __LINE__, log->log_path);
+    }
+    return 1;
+  }
+
+  log->index.header->log_size += record_len;
+
+  return 0;
+}
+
+// Copy live records to a new log. Slots keep their position, only their offsets change.
+static int compact(policylog_t *log) {
+  policylog_index_header_t *header = log->index.header;
+  uint64_t *offsets = NULL;
+  uint64_t new_size = 0;
+  char *buf = NULL;
+  size_t buf_cap = 0;
+  int fd = -1;
+  int ret = 1;
+
+  offsets = calloc(header->capacity, sizeof(uint64_t));
+  fd = open(log->tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+  if (offsets == NULL || fd < 0) {
+    goto done;
+  }
+
+  for (uint32_t i = 0; i < header->capacity; i++) {
+    policylog_slot_t *slot = &log->index.slots[i];
+
+    if (!POLICYLOG_SLOT_LIVE(slot)) continue;
+
+    if (slot->record_len > buf_cap) {
+      char *new_buf = realloc(buf, slot->record_len);
+      if (new_buf == NULL) {
+        goto done;
+      }
+      buf = new_buf;
+      buf_cap = slot->record_len;
+    }
+    if (pread(log->log_fd, buf, slot->record_len, slot->offset - 1) != slot->record_len ||
+        write(fd, buf, slot->record_len) != slot->record_len) {
+      goto done;
+    }
+    offsets[i] = new_size + 1;
+    new_size += slot->record_len;
+  }
+
+  if (fdatasync(fd) != 0 || rename(log->tmp_path, log->log_path) != 0) {
+    goto done;
+  }
+  // Without this the old log may come back after a power cut, which is harmless but wastes the compaction
+  sync_dir(log);
+
+  close(log->log_fd);
+  log->log_fd = fd;
+  fd = -1;
+  // Pinned views keep the old log mapped
+  map_unref(log->map);
+  log->map = NULL;
+  for (uint32_t i = 0; i < header->capacity; i++) {
+    if (POLICYLOG_SLOT_LIVE(&log->index.slots[i])) log->index.slots[i].offset = offsets[i];
+  }
+  log_info(plugin_logger_id, "[%s:%d] compacted policy log from %llu to %llu bytes.\n", __func__, __LINE__,
+           (unsigned long long)header->log_size, (unsigned long long)new_size);
+  header->log_size = new_size;
+  header->dead_bytes = 0;
+  ret = 0;
+
+done:
+  if (fd >= 0) {
+    close(fd);
+    unlink(log->tmp_path);
+  }
+  free(buf);
+  free(offsets);
+
+  return ret;
+}
+
+static void compact_if_needed(policylog_t *log) {
+  policylog_index_header_t *header = log->index.header;
+
+  if (header->dead_bytes >= POLICYLOG_COMPACT_MIN_DEAD && header->dead_bytes * 2 >= header->log_size) {
+    if (compact(log) != 0) {
+      log_error(plugin_logger_id, "[%s:%d] log compaction failed, keeping the old log.\n", __func__, __LINE__);
+    }
+  }
+}
+
+policylog_t *policylog_open(const char *dir) {
+  policylog_t *log = NULL;
+  struct stat st;
+
+  if (dir == NULL) {
+    return NULL;
+  }
+
+  if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+    log_error(plugin_logger_id, "[%s:%d] could not create %s.\n", __func__, __LINE__, dir);
+    return NULL;
+  }
+
+  log = calloc(1, sizeof(policylog_t));
+  if (log == NULL) {
+    return NULL;
+  }
+  log->index.fd = -1;
+  snprintf(log->dir, POLICYLOG_PATH_LEN, "%s", dir);
+  snprintf(log->log_path, POLICYLOG_PATH_LEN, "%s/policies.log", dir);
+  snprintf(log->index_path, POLICYLOG_PATH_LEN, "%s/policies.idx", dir);
+  snprintf(log->tmp_path, POLICYLOG_PATH_LEN, "%s/policies.tmp", dir);
+
+  log->log_fd = open(log->log_path, O_RDWR | O_CREAT | O_APPEND, 0600);
+  if (log->log_fd < 0 || fstat(log->log_fd, &st) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not open %s.\n", __func__, __LINE__, log->log_path);
+    policylog_close(&log);
+    return NULL;
+  }
+  if (st.st_size == 0) {
+    sync_dir(log);
+  }
+
+  if (index_load(log, st.st_size) != 0) {
+    log_info(plugin_logger_id, "[%s:%d] rebuilding policy index from %s.\n", __func__, __LINE__, log->log_path);
+    if (index_rebuild(log, st.st_size) != 0) {
+      policylog_close(&log);
+      return NULL;
+    }
+  }
+
+  // The dirty mark must reach the disk before the index is modified
+  log->index.header->clean = 0;
+  msync(log->index.header, sizeof(policylog_index_header_t), MS_SYNC);
+
+  return log;
+}
+
+void policylog_close(policylog_t **log) {
+  policylog_t *l = NULL;
+
+  if (log == NULL || *log == NULL) {
+    return;
+  }
+  l = *log;
+
+  // A clean index must not refer to records which are not on disk
+  if (l->index.header != NULL && fdatasync(l->log_fd) == 0 &&
+      msync(l->index.header, l->index.map_len, MS_SYNC) == 0) {
+    l->index.header->clean = 1;
+    msync(l->index.header, sizeof(policylog_index_header_t), MS_SYNC);
+  }
+
+  index_unmap(&l->index);
+  map_unref(l->map);
+  if (l->log_fd >= 0) close(l->log_fd);
+  free(l);
+  *log = NULL;
+}
+
+// Header of a put record, without its checksums
+static void put_record(const policylog_meta_t *meta, policylog_record_t *rec, policylog_record_ext_t *ext) {
+  memset(rec, 0, sizeof(*rec));
+  rec->magic = POLICYLOG_RECORD_MAGIC;
+  rec->type = meta->compiled_len > 0 ? POLICYLOG_RECORD_PUT_COMPILED : POLICYLOG_RECORD_PUT;
+  rec->signature_algorithm = meta->signature_algorithm;
+  rec->hash_function = meta->hash_function;
+  rec->cost_len = strnlen(meta->cost, POLICYLOG_COST_LEN - 1);
+  rec->object_len = meta->object_len;
+  memcpy(rec->policy_id, meta->policy_id, POLICYLOG_ID_LEN);
+  memcpy(rec->signature, meta->signature, POLICYLOG_SIGNATURE_LEN);
+  memcpy(rec->public_key, meta->public_key, POLICYLOG_PUBLIC_KEY_LEN);
+  ext->compiled_len = meta->compiled_len;
+}
+
+void policylog_checksum(const policylog_meta_t *meta, const char *object, const char *compiled,
+                        policylog_checksum_t *checksum) {
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+
+  put_record(meta, &rec, &ext);
+  ext.compiled_crc = compiled_crc(compiled, meta->compiled_len);
+  checksum->compiled_crc = ext.compiled_crc;
+  checksum->record_crc = record_crc(&rec, &ext, meta->cost, object);
+}
+
+int policylog_put(policylog_t *log, const policylog_meta_t *meta, const char *object, const char *compiled,
+                  const policylog_checksum_t *checksum) {
+  policylog_checksum_t computed;
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+  struct iovec iov[5];
+  int iov_cnt = 0;
+  uint64_t offset;
+  uint32_t record_len;
+
+  if (log == NULL || meta == NULL || (object == NULL && meta->object_len > 0) ||
+      (compiled == NULL && meta->compiled_len > 0) || meta->object_len > POLICYLOG_MAX_OBJECT_LEN ||
+      meta->compiled_len > POLICYLOG_MAX_OBJECT_LEN) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  if (checksum == NULL) {
+    policylog_checksum(meta, object, compiled, &computed);
+    checksum = &computed;
+  }
+  put_record(meta, &rec, &ext);
+  ext.compiled_crc = checksum->compiled_crc;
+  rec.crc = checksum->record_crc;
+
+  iov[iov_cnt].iov_base = &rec;
+  iov[iov_cnt++].iov_len = sizeof(rec);
+  if (rec.type == POLICYLOG_RECORD_PUT_COMPILED) {
+    iov[iov_cnt].iov_base = &ext;
+    iov[iov_cnt++].iov_len = sizeof(ext);
+  }
+  iov[iov_cnt].iov_base = (void *)meta->cost;
+  iov[iov_cnt++].iov_len = rec.cost_len;
+  iov[iov_cnt].iov_base = (void *)object;
+  iov[iov_cnt++].iov_len = rec.object_len;
+  iov[iov_cnt].iov_base = (void *)compiled;
+  iov[iov_cnt++].iov_len = meta->compiled_len;
+  record_len = record_header_len(rec.type) + rec.cost_len + rec.object_len + meta->compiled_len;
+
+  // Grow the index first, a record must not reach the log unless it can be indexed
+  if (index_reserve(log) != 0) {
+    return 1;
+  }
+
+  offset = log->index.header->log_size;
+  if (log_append(log, iov, iov_cnt, record_len) != 0) {
+    return 1;
+  }
+  index_set(log, rec.policy_id, offset, record_len, rec.object_len, meta->compiled_len);
+  compact_if_needed(log);
+
+  return 0;
+}
+
+int policylog_sync_fd(policylog_t *log) { return log == NULL ? -1 : dup(log->log_fd); }
+
+int policylog_get(policylog_t *log, const char *policy_id, policylog_meta_t *meta, char *object, size_t object_max) {
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+  policylog_slot_t *slot = NULL;
+  char cost[POLICYLOG_COST_LEN] = {0};
+  struct iovec iov[4];
+  int iov_cnt = 0;
+  uint8_t type;
+  size_t read_len;
+  size_t cost_len;
+  int found;
+
+  if (log == NULL || policy_id == NULL || meta == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  slot = index_find(&log->index, policy_id, &found);
+  if (!found) {
+    return 1;
+  }
+
+  // The compiled policy is left out, the extension carries its CRC
+  type = slot->compiled_len > 0 ? POLICYLOG_RECORD_PUT_COMPILED : POLICYLOG_RECORD_PUT;
+  read_len = slot->record_len - slot->compiled_len;
+  cost_len = read_len - record_header_len(type) - slot->object_len;
+  if (cost_len >= POLICYLOG_COST_LEN || slot->object_len > object_max || (object == NULL && slot->object_len > 0)) {
+    log_error(plugin_logger_id, "[%s:%d] policy does not fit the buffer.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  memset(&ext, 0, sizeof(ext));
+  iov[iov_cnt].iov_base = &rec;
+  iov[iov_cnt++].iov_len = sizeof(rec);
+  if (type == POLICYLOG_RECORD_PUT_COMPILED) {
+    iov[iov_cnt].iov_base = &ext;
+    iov[iov_cnt++].iov_len = sizeof(ext);
+  }
+  iov[iov_cnt].iov_base = cost;
+  iov[iov_cnt++].iov_len = cost_len;
+  iov[iov_cnt].iov_base = object;
+  iov[iov_cnt++].iov_len = slot->object_len;
+
+  if (preadv(log->log_fd, iov, iov_cnt, slot->offset - 1) != (ssize_t)read_len || rec.magic != POLICYLOG_RECORD_MAGIC ||
+      rec.type != type || rec.cost_len != cost_len || rec.object_len != slot->object_len ||
+      ext.compiled_len != slot->compiled_len || memcmp(rec.policy_id, policy_id, POLICYLOG_ID_LEN) != 0 ||
+      record_crc(&rec, &ext, cost, object) != rec.crc) {
+    log_error(plugin_logger_id, "[%s:%d] corrupt policy record in %s.\n", __func__, __LINE__, log->log_path);
+    return 1;
+  }
+
+  memcpy(meta->policy_id, rec.policy_id, POLICYLOG_ID_LEN);
+  memcpy(meta->cost, cost, POLICYLOG_COST_LEN);
+  memcpy(meta->signature, rec.signature, POLICYLOG_SIGNATURE_LEN);
+  memcpy(meta->public_key, rec.public_key, POLICYLOG_PUBLIC_KEY_LEN);
+  meta->signature_algorithm = rec.signature_algorithm;
+  meta->hash_function = rec.hash_function;
+  meta->object_len = rec.object_len;
+  meta->compiled_len = ext.compiled_len;
+
+  return 0;
+}
+
+// Checksums of a pinned record, reads only the mapping
+static int view_crc_ok(const policylog_view_t *view) {
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+  const char *base = view->policy_id - offsetof(policylog_record_t, policy_id);
+
+  memcpy(&rec, base, sizeof(rec));
+  memset(&ext, 0, sizeof(ext));
+  if (rec.type == POLICYLOG_RECORD_PUT_COMPILED) memcpy(&ext, base + sizeof(rec), sizeof(ext));
+
+  return record_crc(&rec, &ext, view->cost, view->object) == rec.crc &&
+         compiled_crc(view->compiled, view->compiled_len) == ext.compiled_crc;
+}
+
+int policylog_view_unchecked(policylog_t *log, const char *policy_id, policylog_view_t *view) {
+  policylog_record_t rec;
+  policylog_record_ext_t ext;
+  policylog_slot_t *slot = NULL;
+  policylog_map_t *map = NULL;
+  const char *base = NULL;
+  const char *payload = NULL;
+  int found;
+
+  if (log == NULL || policy_id == NULL || view == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  slot = index_find(&log->index, policy_id, &found);
+  if (!found) {
+    return 1;
+  }
+
+  map = map_covering(log, slot->offset - 1 + slot->record_len);
+  if (map == NULL) {
+    return 1;
+  }
+
+  // Records are not aligned, the header is copied, the payload is used in place
+  base = map->addr + slot->offset - 1;
+  memcpy(&rec, base, sizeof(rec));
+  memset(&ext, 0, sizeof(ext));
+  if (rec.type == POLICYLOG_RECORD_PUT_COMPILED) memcpy(&ext, base + sizeof(rec), sizeof(ext));
+  payload = base + record_header_len(rec.type);
+  if (rec.magic != POLICYLOG_RECORD_MAGIC || !POLICYLOG_RECORD_IS_PUT(rec.type) || rec.object_len != slot->object_len ||
+      ext.compiled_len != slot->compiled_len ||
+      record_header_len(rec.type) + rec.cost_len + rec.object_len + ext.compiled_len != slot->record_len ||
+      memcmp(rec.policy_id, policy_id, POLICYLOG_ID_LEN) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] corrupt policy record in %s.\n", __func__, __LINE__, log->log_path);
+    return 1;
+  }
+
+  view->policy_id = base + offsetof(policylog_record_t, policy_id);
+  view->signature = base + offsetof(policylog_record_t, signature);
+  view->public_key = base + offsetof(policylog_record_t, public_key);
+  view->cost = payload;
+  view->cost_len = rec.cost_len;
+  view->object = payload + rec.cost_len;
+  view->object_len = rec.object_len;
+  view->compiled = ext.compiled_len > 0 ? payload + rec.cost_len + rec.object_len : NULL;
+  view->compiled_len = ext.compiled_len;
+  view->signature_algorithm = rec.signature_algorithm;
+  view->hash_function = rec.hash_function;
+  view->pin = map;
+  map->refs++;
+
+  return 0;
+}
+
+int policylog_view(policylog_t *log, const char *policy_id, policylog_view_t *view) {
+  if (policylog_view_unchecked(log, policy_id, view) != 0) {
+    return 1;
+  }
+
+  if (!view_crc_ok(view)) {
+    log_error(plugin_logger_id, "[%s:%d] corrupt policy record in %s.\n", __func__, __LINE__, log->log_path);
+    policylog_view_release(view);
+    return 1;
+  }
+
+  return 0;
+}
+
+int policylog_view_check(const policylog_view_t *view) {
+  if (view == NULL || view->pin == NULL) {
+    return 1;
+  }
+
+  return view_crc_ok(view) ? 0 : 1;
+}
+
+void policylog_view_release(policylog_view_t *view) {
+  if (view == NULL || view->pin == NULL) {
+    return;
+  }
+
+  map_unref((policylog_map_t *)view->pin);
+  memset(view, 0, sizeof(policylog_view_t));
+}
+
+int policylog_has(policylog_t *log, const char *policy_id) {
+  int found = 0;
+
+  if (log != NULL && policy_id != NULL) {
+    index_find(&log->index, policy_id, &found);
+  }
+
+  return found;
+}
+
+int policylog_object_len(policylog_t *log, const char *policy_id, uint32_t *len) {
+  policylog_slot_t *slot = NULL;
+  int found;
+
+  if (log == NULL || policy_id == NULL || len == NULL) {
+    return 1;
+  }
+
+  slot = index_find(&log->index, policy_id, &found);
+  if (!found) {
+    return 1;
+  }
+  *len = slot->object_len;
+
+  return 0;
+}
+
+int policylog_del(policylog_t *log, const char *policy_id) {
+  policylog_record_t rec;
+  struct iovec iov;
+  int found;
+
+  if (log == NULL || policy_id == NULL) {
+    return 1;
+  }
+
+  index_find(&log->index, policy_id, &found);
+  if (!found) {
+    return 1;
+  }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.magic = POLICYLOG_RECORD_MAGIC;
+  rec.type = POLICYLOG_RECORD_DEL;
+  memcpy(rec.policy_id, policy_id, POLICYLOG_ID_LEN);
+  rec.crc = record_crc(&rec, NULL, NULL, NULL);
+  iov.iov_base = &rec;
+  iov.iov_len = sizeof(rec);
+
+  if (log_append(log, &iov, 1, sizeof(rec)) != 0) {
+    return 1;
+  }
+  index_unset(log, policy_id, sizeof(rec));
+  compact_if_needed(log);
+
+  return 0;
+}
+
+void policylog_foreach(policylog_t *log, policylog_foreach_cb_t cb, void *user) {
+  if (log == NULL || cb == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < log->index.header->capacity; i++) {
+    if (POLICYLOG_SLOT_LIVE(&log->index.slots[i]) && cb(user, log->index.slots[i].policy_id) != 0) {
+      break;
+    }
+  }
+}
+
+int policylog_list(policylog_t *log, char *ids, uint32_t *position, int max_ids) {
+  int count = 0;
+  uint32_t i;
+
+  if (log == NULL || ids == NULL || position == NULL) {
+    return 0;
+  }
+
+  for (i = *position; i < log->index.header->capacity && count < max_ids; i++) {
+    if (POLICYLOG_SLOT_LIVE(&log->index.slots[i])) {
+      memcpy(ids + (size_t)count * POLICYLOG_ID_LEN, log->index.slots[i].policy_id, POLICYLOG_ID_LEN);
+      count++;
+    }
+  }
+  *position = i;
+
+  return count;
+}
+
+uint32_t policylog_generation(policylog_t *log) { return log == NULL ? 0 : log->generation; }
+
+int policylog_count(policylog_t *log) { return log == NULL ? 0 : log->index.header->count; }
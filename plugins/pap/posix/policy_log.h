@@ -0,0 +1,226 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_log.h
+ * \brief
+ * Single-file policy store: append-only record log with an on-disk hash index
+ *
+ * \notes
+ * Records are appended to <dir>/policies.log and located through the memory
+ * mapped open-addressing table in <dir>/policies.idx, keyed by the binary
+ * policy ID. The index is rebuilt from the log when it is missing or was not
+ * closed cleanly. Writes are made durable by syncing policylog_sync_fd, the
+ * caller decides how to group them. Functions are not thread safe, the caller
+ * serializes access. A policy may carry its compiled form, stored after the
+ * object and only exposed through views.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_LOG_H_
+#define _POLICY_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POLICYLOG_ID_LEN 32
+#define POLICYLOG_COST_LEN 20
+#define POLICYLOG_SIGNATURE_LEN 64
+#define POLICYLOG_PUBLIC_KEY_LEN 32
+
+typedef struct policylog policylog_t;
+
+typedef struct {
+  char policy_id[POLICYLOG_ID_LEN];
+  char cost[POLICYLOG_COST_LEN];  // null terminated
+  char signature[POLICYLOG_SIGNATURE_LEN];
+  char public_key[POLICYLOG_PUBLIC_KEY_LEN];
+  uint8_t signature_algorithm;
+  uint8_t hash_function;
+  uint32_t object_len;
+  uint32_t compiled_len;  // 0 if the policy is stored without a compiled form
+} policylog_meta_t;
+
+// Read-only view into the mapped log, valid until released
+typedef struct {
+  const char *policy_id;
+  const char *object;
+  uint32_t object_len;
+  const char *cost;  // not null terminated
+  uint32_t cost_len;
+  const char *compiled;  // NULL if the policy is stored without a compiled form
+  uint32_t compiled_len;
+  const char *signature;
+  const char *public_key;
+  uint8_t signature_algorithm;
+  uint8_t hash_function;
+  void *pin;
+} policylog_view_t;
+
+// Checksums of a policy record, see policylog_checksum
+typedef struct {
+  uint32_t record_crc;
+  uint32_t compiled_crc;
+} policylog_checksum_t;
+
+typedef int (*policylog_foreach_cb_t)(void *user, const char *policy_id);
+
+/**
+ * @brief Open the store in a directory, creating it if needed
+ *
+ * @return store, NULL on failure
+ */
+policylog_t *policylog_open(const char *dir);
+
+/**
+ * @brief Flush the index, mark it clean and release the store
+ */
+void policylog_close(policylog_t **log);
+
+/**
+ * @brief Append a policy, replacing a stored policy with the same ID
+ *
+ * @param[in] log Store
+ * @param[in] meta Policy ID, cost, signature, the object and compiled form lengths
+ * @param[in] object Policy object, meta->object_len bytes
+ * @param[in] compiled Compiled form of the policy, meta->compiled_len bytes, stored after the object
+ * @param[in] checksum Checksums from policylog_checksum for the same policy, NULL to compute them here
+ *
+ * @return 0 on success, 1 on failure
+ */
+int policylog_put(policylog_t *log, const policylog_meta_t *meta, const char *object, const char *compiled,
+                  const policylog_checksum_t *checksum);
+
+/**
+ * @brief Checksum a policy for policylog_put
+ *
+ * Does not touch the store, so callers can run it before taking their lock.
+ */
+void policylog_checksum(const policylog_meta_t *meta, const char *object, const char *compiled,
+                        policylog_checksum_t *checksum);
+
+/**
+ * @brief Duplicate the log descriptor, fdatasync on it makes every record appended so far durable
+ *
+ * The caller can sync without holding its lock. Compaction may replace the
+ * log meanwhile, it syncs the records it copies itself.
+ *
+ * @return descriptor to be closed by the caller, -1 on failure
+ */
+int policylog_sync_fd(policylog_t *log);
+
+/**
+ * @brief Read a policy with a single read, without its compiled form
+ *
+ * @param[in] log Store
+ * @param[in] policy_id Binary policy ID
+ * @param[out] meta Policy metadata
+ * @param[out] object Buffer for the policy object
+ * @param[in] object_max Buffer length
+ *
+ * @return 0 on success, 1 if the policy is not stored, does not fit or is corrupt
+ */
+int policylog_get(policylog_t *log, const char *policy_id, policylog_meta_t *meta, char *object, size_t object_max);
+
+/**
+ * @brief Pin a policy in the mapped log without copying it
+ *
+ * The view stays valid after the policy is replaced or deleted, the log is
+ * compacted or the store is closed, until policylog_view_release.
+ *
+ * @return 0 on success, 1 if the policy is not stored or is corrupt
+ */
+int policylog_view(policylog_t *log, const char *policy_id, policylog_view_t *view);
+
+/**
+ * @brief Pin a policy like policylog_view, without verifying its checksums
+ *
+ * For callers that pin many policies under their lock and verify them with
+ * policylog_view_check after releasing it.
+ *
+ * @return 0 on success, 1 if the policy is not stored or its record is malformed
+ */
+int policylog_view_unchecked(policylog_t *log, const char *policy_id, policylog_view_t *view);
+
+/**
+ * @brief Verify the checksums of a pinned policy, may run concurrently with the other store functions
+ *
+ * @return 0 if the policy is intact, 1 if it is corrupt
+ */
+int policylog_view_check(const policylog_view_t *view);
+
+/**
+ * @brief Unpin a view, serialized with the other store functions like all of them
+ */
+void policylog_view_release(policylog_view_t *view);
+
+/**
+ * @return 1 if the policy is stored, 0 otherwise
+ */
+int policylog_has(policylog_t *log, const char *policy_id);
+
+/**
+ * @brief Policy object length, answered from the index without I/O
+ *
+ * @return 0 on success, 1 if the policy is not stored
+ */
+int policylog_object_len(policylog_t *log, const char *policy_id, uint32_t *len);
+
+/**
+ * @brief Delete a policy
+ *
+ * @return 0 on success, 1 if the policy is not stored or the log write failed
+ */
+int policylog_del(policylog_t *log, const char *policy_id);
+
+/**
+ * @brief Call cb for every stored policy ID, stops when cb returns non-zero
+ */
+void policylog_foreach(policylog_t *log, policylog_foreach_cb_t cb, void *user);
+
+/**
+ * @brief Copy stored policy IDs into a contiguous buffer, resuming at a position
+ *
+ * Positions are index slots, iterating from 0 until no IDs are returned visits
+ * every ID once as long as the store is not modified in between. Positions
+ * are meaningless once policylog_generation changes.
+ *
+ * @param[in] log Store
+ * @param[out] ids Buffer for max_ids IDs of POLICYLOG_ID_LEN bytes each
+ * @param[in,out] position Where to resume, 0 to start
+ * @param[in] max_ids Buffer capacity in IDs
+ *
+ * @return number of IDs copied, 0 at the end
+ */
+int policylog_list(policylog_t *log, char *ids, uint32_t *position, int max_ids);
+
+/**
+ * @brief Counter bumped whenever the index is rebuilt and IDs move to other slots
+ */
+uint32_t policylog_generation(policylog_t *log);
+
+/**
+ * @brief Number of stored policies
+ */
+int policylog_count(policylog_t *log);
+
+#endif  // _POLICY_LOG_H_
@@ -161,6 +161,7 @@ bool test_policy_storage() {
   }
 
   policy.policy_object.policy_object = policy_object_buff;
+  policy.policy_object.policy_object_size = buff_len;
   // Recover policy
   if (ret && (pap_get_policy(policy_id, TEST_POL_ID_MAX_LEN, &policy) == PAP_ERROR)) {
     printf("\nSTORAGE TEST FAILED - Couldn't add policy\n");
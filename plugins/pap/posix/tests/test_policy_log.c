@@ -0,0 +1,334 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "unity/unity.h"
+
+#include "policy_log.h"
+
+#define TEST_OBJECT_LEN 1000
+// Large enough for the dead records to pass the compaction threshold
+#define TEST_BIG_OBJECT_LEN (100 * 1024)
+#define TEST_BIG_POLICIES 24
+// Enough policies for the index to grow from its initial 1024 slots
+#define TEST_LIST_POLICIES 600
+#define TEST_LIST_ADDED 1000
+#define TEST_LIST_BATCH 64
+
+static char test_dir[] = "/tmp/test_policy_log.XXXXXX";
+static char test_log_path[64];
+static char test_index_path[64];
+static char *test_object = NULL;
+
+static void policy_id(int n, char *id) {
+  for (int i = 0; i < POLICYLOG_ID_LEN; i++) id[i] = (char)(n * 31 + i * 7);
+  // Distinct beyond 256 policies
+  id[0] ^= (char)(n >> 8);
+  id[1] ^= (char)(n >> 16);
+}
+
+static void fill_object(int n, char *object, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) object[i] = 'a' + (n + i) % 26;
+}
+
+static int put(policylog_t *log, int n, uint32_t len) {
+  policylog_meta_t meta;
+
+  memset(&meta, 0, sizeof(meta));
+  policy_id(n, meta.policy_id);
+  strcpy(meta.cost, "0.0");
+  meta.object_len = len;
+  fill_object(n, test_object, len);
+
+  return policylog_put(log, &meta, test_object, NULL, NULL);
+}
+
+// 1 if the policy is stored with the expected object
+static int stored(policylog_t *log, int n, uint32_t len) {
+  char id[POLICYLOG_ID_LEN];
+  char *expected = malloc(len), *object = malloc(len);
+  policylog_meta_t meta;
+  int ret;
+
+  policy_id(n, id);
+  fill_object(n, expected, len);
+  ret = policylog_has(log, id) && policylog_get(log, id, &meta, object, len) == 0 && meta.object_len == len &&
+        memcmp(object, expected, len) == 0 && strcmp(meta.cost, "0.0") == 0;
+  free(expected);
+  free(object);
+
+  return ret;
+}
+
+static int del(policylog_t *log, int n) {
+  char id[POLICYLOG_ID_LEN];
+
+  policy_id(n, id);
+  return policylog_del(log, id);
+}
+
+static off_t file_size(const char *path) {
+  struct stat st;
+
+  return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+void setUp(void) {
+  unlink(test_log_path);
+  unlink(test_index_path);
+}
+
+void tearDown(void) {}
+
+void test_put_get_del_reopen(void) {
+  policylog_t *log = policylog_open(test_dir);
+
+  TEST_ASSERT_NOT_NULL(log);
+  for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL_INT(0, put(log, i, TEST_OBJECT_LEN));
+  TEST_ASSERT_EQUAL_INT(0, put(log, 4, TEST_OBJECT_LEN / 2));
+  TEST_ASSERT_EQUAL_INT(0, del(log, 7));
+  TEST_ASSERT_EQUAL_INT(1, del(log, 7));
+  TEST_ASSERT_EQUAL_INT(9, policylog_count(log));
+  policylog_close(&log);
+  TEST_ASSERT_NULL(log);
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(9, policylog_count(log));
+  TEST_ASSERT_TRUE(stored(log, 4, TEST_OBJECT_LEN / 2));
+  TEST_ASSERT_FALSE(stored(log, 7, TEST_OBJECT_LEN));
+  for (int i = 0; i < 10; i++) {
+    if (i != 4 && i != 7) TEST_ASSERT_TRUE(stored(log, i, TEST_OBJECT_LEN));
+  }
+  policylog_close(&log);
+}
+
+void test_torn_tail_truncated(void) {
+  policylog_t *log = policylog_open(test_dir);
+  off_t intact_len, torn_len;
+
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(0, put(log, 0, TEST_OBJECT_LEN));
+  TEST_ASSERT_EQUAL_INT(0, put(log, 1, TEST_OBJECT_LEN));
+  policylog_close(&log);
+  intact_len = file_size(test_log_path);
+
+  // A crash in the middle of the third append leaves part of its record
+  log = policylog_open(test_dir);
+  TEST_ASSERT_EQUAL_INT(0, put(log, 2, TEST_OBJECT_LEN));
+  policylog_close(&log);
+  torn_len = intact_len + (file_size(test_log_path) - intact_len) / 2;
+  TEST_ASSERT_EQUAL_INT(0, truncate(test_log_path, torn_len));
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(intact_len, file_size(test_log_path));
+  TEST_ASSERT_EQUAL_INT(2, policylog_count(log));
+  TEST_ASSERT_TRUE(stored(log, 0, TEST_OBJECT_LEN));
+  TEST_ASSERT_TRUE(stored(log, 1, TEST_OBJECT_LEN));
+  TEST_ASSERT_FALSE(stored(log, 2, TEST_OBJECT_LEN));
+
+  // Appends continue at the record boundary
+  TEST_ASSERT_EQUAL_INT(0, put(log, 3, TEST_OBJECT_LEN));
+  policylog_close(&log);
+  log = policylog_open(test_dir);
+  TEST_ASSERT_EQUAL_INT(3, policylog_count(log));
+  TEST_ASSERT_TRUE(stored(log, 3, TEST_OBJECT_LEN));
+  policylog_close(&log);
+}
+
+void test_garbage_tail_truncated(void) {
+  policylog_t *log = policylog_open(test_dir);
+  off_t intact_len;
+  FILE *f = NULL;
+
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(0, put(log, 0, TEST_OBJECT_LEN));
+  policylog_close(&log);
+  intact_len = file_size(test_log_path);
+
+  f = fopen(test_log_path, "ab");
+  TEST_ASSERT_NOT_NULL(f);
+  fwrite(test_object, 1, 100, f);
+  fclose(f);
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(intact_len, file_size(test_log_path));
+  TEST_ASSERT_TRUE(stored(log, 0, TEST_OBJECT_LEN));
+  policylog_close(&log);
+}
+
+void test_dirty_index_rebuilt(void) {
+  policylog_t *log = NULL;
+  pid_t pid = fork();
+  int status = 0;
+
+  // The child stops without closing the store, as in a crash
+  if (pid == 0) {
+    log = policylog_open(test_dir);
+    for (int i = 0; log != NULL && i < 10; i++) put(log, i, TEST_OBJECT_LEN);
+    del(log, 3);
+    _exit(0);
+  }
+  TEST_ASSERT_TRUE(pid > 0);
+  TEST_ASSERT_EQUAL_INT(pid, waitpid(pid, &status, 0));
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(9, policylog_count(log));
+  TEST_ASSERT_FALSE(stored(log, 3, TEST_OBJECT_LEN));
+  for (int i = 0; i < 10; i++) {
+    if (i != 3) TEST_ASSERT_TRUE(stored(log, i, TEST_OBJECT_LEN));
+  }
+  policylog_close(&log);
+}
+
+void test_corrupt_index_rebuilt(void) {
+  policylog_t *log = policylog_open(test_dir);
+  int fd;
+
+  TEST_ASSERT_NOT_NULL(log);
+  for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL_INT(0, put(log, i, TEST_OBJECT_LEN));
+  policylog_close(&log);
+
+  fd = open(test_index_path, O_WRONLY);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL_INT(64, write(fd, test_object, 64));
+  close(fd);
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(5, policylog_count(log));
+  for (int i = 0; i < 5; i++) TEST_ASSERT_TRUE(stored(log, i, TEST_OBJECT_LEN));
+  policylog_close(&log);
+}
+
+void test_compaction(void) {
+  policylog_t *log = policylog_open(test_dir);
+  char *expected = malloc(TEST_BIG_OBJECT_LEN);
+  policylog_view_t view;
+  char id[POLICYLOG_ID_LEN];
+  off_t full_len;
+
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_NOT_NULL(expected);
+  for (int i = 0; i < TEST_BIG_POLICIES; i++) TEST_ASSERT_EQUAL_INT(0, put(log, i, TEST_BIG_OBJECT_LEN));
+  full_len = file_size(test_log_path);
+
+  // A pinned policy stays readable while the log is replaced underneath
+  policy_id(TEST_BIG_POLICIES - 1, id);
+  TEST_ASSERT_EQUAL_INT(0, policylog_view(log, id, &view));
+
+  // Compaction starts once half of the log is dead, without it the log would only grow
+  for (int i = 0; i < TEST_BIG_POLICIES * 3 / 4; i++) TEST_ASSERT_EQUAL_INT(0, del(log, i));
+  TEST_ASSERT_TRUE(file_size(test_log_path) < full_len * 3 / 4);
+
+  fill_object(TEST_BIG_POLICIES - 1, expected, TEST_BIG_OBJECT_LEN);
+  TEST_ASSERT_EQUAL_INT(TEST_BIG_OBJECT_LEN, view.object_len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, view.object, TEST_BIG_OBJECT_LEN);
+  TEST_ASSERT_EQUAL_INT(0, policylog_view_check(&view));
+  policylog_view_release(&view);
+
+  TEST_ASSERT_EQUAL_INT(TEST_BIG_POLICIES / 4, policylog_count(log));
+  for (int i = 0; i < TEST_BIG_POLICIES; i++) {
+    TEST_ASSERT_EQUAL_INT(i >= TEST_BIG_POLICIES * 3 / 4, stored(log, i, TEST_BIG_OBJECT_LEN));
+  }
+  TEST_ASSERT_EQUAL_INT(0, put(log, 0, TEST_OBJECT_LEN));
+  policylog_close(&log);
+
+  log = policylog_open(test_dir);
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_EQUAL_INT(TEST_BIG_POLICIES / 4 + 1, policylog_count(log));
+  TEST_ASSERT_TRUE(stored(log, 0, TEST_OBJECT_LEN));
+  TEST_ASSERT_TRUE(stored(log, TEST_BIG_POLICIES - 1, TEST_BIG_OBJECT_LEN));
+  policylog_close(&log);
+  free(expected);
+}
+
+// Listing positions hold while policies are stored and deleted, until the index grows
+void test_list_generation(void) {
+  policylog_t *log = policylog_open(test_dir);
+  char *ids = malloc((size_t)TEST_LIST_BATCH * POLICYLOG_ID_LEN);
+  uint32_t generation, position = 0;
+  int count = 0, n;
+
+  TEST_ASSERT_NOT_NULL(log);
+  TEST_ASSERT_NOT_NULL(ids);
+  for (int i = 0; i < TEST_LIST_POLICIES; i++) TEST_ASSERT_EQUAL_INT(0, put(log, i, TEST_OBJECT_LEN / 10));
+  generation = policylog_generation(log);
+
+  TEST_ASSERT_EQUAL_INT(TEST_LIST_BATCH, policylog_list(log, ids, &position, TEST_LIST_BATCH));
+  TEST_ASSERT_EQUAL_INT(0, del(log, 0));
+  TEST_ASSERT_EQUAL_INT(0, put(log, 0, TEST_OBJECT_LEN / 10));
+  TEST_ASSERT_EQUAL_INT(generation, policylog_generation(log));
+
+  position = 0;
+  while ((n = policylog_list(log, ids, &position, TEST_LIST_BATCH)) > 0) count += n;
+  TEST_ASSERT_EQUAL_INT(TEST_LIST_POLICIES, count);
+
+  // Rehashes every stored ID into new slots
+  for (int i = 0; i < TEST_LIST_ADDED; i++) {
+    TEST_ASSERT_EQUAL_INT(0, put(log, TEST_LIST_POLICIES + i, TEST_OBJECT_LEN / 10));
+  }
+  TEST_ASSERT_TRUE(policylog_generation(log) != generation);
+
+  position = 0;
+  count = 0;
+  while ((n = policylog_list(log, ids, &position, TEST_LIST_BATCH)) > 0) count += n;
+  TEST_ASSERT_EQUAL_INT(TEST_LIST_POLICIES + TEST_LIST_ADDED, count);
+  for (int i = 0; i < TEST_LIST_POLICIES + TEST_LIST_ADDED; i++) {
+    TEST_ASSERT_TRUE(stored(log, i, TEST_OBJECT_LEN / 10));
+  }
+
+  policylog_close(&log);
+  free(ids);
+}
+
+int main() {
+  if (mkdtemp(test_dir) == NULL) {
+    return 1;
+  }
+  snprintf(test_log_path, sizeof(test_log_path), "%s/policies.log", test_dir);
+  snprintf(test_index_path, sizeof(test_index_path), "%s/policies.idx", test_dir);
+  test_object = malloc(TEST_BIG_OBJECT_LEN);
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_put_get_del_reopen);
+  RUN_TEST(test_torn_tail_truncated);
+  RUN_TEST(test_garbage_tail_truncated);
+  RUN_TEST(test_dirty_index_rebuilt);
+  RUN_TEST(test_corrupt_index_rebuilt);
+  RUN_TEST(test_compaction);
+  RUN_TEST(test_list_generation);
+
+  setUp();
+  rmdir(test_dir);
+  free(test_object);
+
+  return UNITY_END();
+}
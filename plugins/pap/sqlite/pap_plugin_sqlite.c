@@ -0,0 +1,664 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_plugin_sqlite.c
+ * \brief
+ * Policy storage interface backed by SQLite
+ *
+ * \notes
+ * The database runs in WAL mode and every statement is prepared once. Writes
+ * are grouped into one transaction and return once it is committed. It is
+ * committed when no other write is about to join it, after
+ * sqlite_batch_size writes or after sqlite_batch_ms milliseconds, whichever
+ * comes first. A write in a transaction that fails to commit fails too.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+/****************************************************************************
+ * INCLUDES
+ ****************************************************************************/
+#include "pap_plugin_sqlite.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config_manager.h"
+#include "pap.h"
+#include "pap_plugin_object.h"
+#include "plugin_logger.h"
+#include "sqlite3.h"
+
+/****************************************************************************
+ * MACROS
+ ****************************************************************************/
+#define SQLITE_DB_PATH_LEN 256
+#define SQLITE_DEFAULT_DB "stored_policies.db"
+#define SQLITE_DEFAULT_BATCH_SIZE 64
+#define SQLITE_DEFAULT_BATCH_MS 20
+
+#ifndef bool
+#define bool _Bool
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/****************************************************************************
+ * LOCAL TYPES
+ ****************************************************************************/
+typedef enum {
+  SQLITE_STMT_PUT,
+  SQLITE_STMT_GET,
+  SQLITE_STMT_HAS,
+  SQLITE_STMT_DEL,
+  SQLITE_STMT_LEN,
+  SQLITE_STMT_ALL,
+  SQLITE_STMT_NUM,
+  SQLITE_STMT_NEXT,
+  SQLITE_STMT_COUNT
+} sqlite_stmt_e;
+
+// Transaction shared by a batch of writes, freed by the last writer to learn its outcome
+typedef struct {
+  int writers;  // writes waiting for the commit
+  int done;
+  int failed;
+} sqlite_batch_t;
+
+/****************************************************************************
+ * LOCAL VARIABLES
+ ****************************************************************************/
+static const char* g_schema =
+    "CREATE TABLE IF NOT EXISTS policies ("
+    "id BLOB PRIMARY KEY, "
+    "object BLOB NOT NULL, "
+    "cost TEXT NOT NULL, "
+    "signature BLOB NOT NULL, "
+    "public_key BLOB NOT NULL, "
+    "signature_algorithm INTEGER NOT NULL, "
+    "hash_function INTEGER NOT NULL) WITHOUT ROWID";
+
+static const char* g_stmt_sql[SQLITE_STMT_COUNT] = {
+    "INSERT OR REPLACE INTO policies (id, object, cost, signature, public_key, signature_algorithm, hash_function) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?)",
+    "SELECT object, cost, signature, public_key, signature_algorithm, hash_function FROM policies WHERE id = ?",
+    "SELECT 1 FROM policies WHERE id = ?",
+    "DELETE FROM policies WHERE id = ?",
+    "SELECT length(object) FROM policies WHERE id = ?",
+    "SELECT id FROM policies",
+    "SELECT count(*) FROM policies",
+    "SELECT id FROM policies WHERE id > ? ORDER BY id LIMIT ?"};
+
+// Callbacks come from several verification threads, the connection is used under the lock
+static pthread_mutex_t g_storage_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_batch_cond = PTHREAD_COND_INITIALIZER;
+static sqlite3* g_db = NULL;
+static sqlite3_stmt* g_stmt[SQLITE_STMT_COUNT] = {0};
+static int g_batch_size = SQLITE_DEFAULT_BATCH_SIZE;
+static int g_batch_ms = SQLITE_DEFAULT_BATCH_MS;
+static sqlite_batch_t* g_batch = NULL;  // open transaction, NULL if none
+static int g_batch_pending = 0;
+static struct timespec g_batch_deadline;
+static pthread_cond_t g_batch_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t g_inflight_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_inflight = 0;  // writers between entering a callback and waiting for their commit
+static pthread_t g_committer;
+static int g_committer_end = 0;
+static pap_plugin_sqlite_drain_cb_t g_drain_cb = NULL;
+
+/****************************************************************************
+ * LOCAL FUNCTIONS
+ ****************************************************************************/
+static sqlite3_stmt* stmt_get(sqlite_stmt_e id) {
+  sqlite3_reset(g_stmt[id]);
+  sqlite3_clear_bindings(g_stmt[id]);
+  return g_stmt[id];
+}
+
+static bool exec_sql(const char* sql) {
+  char* err = NULL;
+
+  if (sqlite3_exec(g_db, sql, NULL, NULL, &err) != SQLITE_OK) {
+    log_error(plugin_logger_id, "[%s:%d] %s: %s.\n", __func__, __LINE__, sql, err != NULL ? err : "");
+    sqlite3_free(err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void inflight_enter() {
+  pthread_mutex_lock(&g_inflight_lock);
+  g_inflight++;
+  pthread_mutex_unlock(&g_inflight_lock);
+}
+
+// Must be called with the storage lock held
+static void inflight_leave() {
+  pthread_mutex_lock(&g_inflight_lock);
+  g_inflight--;
+  pthread_mutex_unlock(&g_inflight_lock);
+  pthread_cond_signal(&g_batch_cond);
+}
+
+static int inflight() {
+  int ret;
+
+  pthread_mutex_lock(&g_inflight_lock);
+  ret = g_inflight;
+  pthread_mutex_unlock(&g_inflight_lock);
+
+  return ret;
+}
+
+// Commit the open transaction and release its writers, must be called with the storage lock held
+static void batch_commit() {
+  sqlite_batch_t* batch = g_batch;
+
+  if (batch == NULL) {
+    return;
+  }
+
+  // A failed commit may leave the transaction open, its writes are then discarded
+  batch->failed = !exec_sql("COMMIT");
+  if (batch->failed && !sqlite3_get_autocommit(g_db)) {
+    exec_sql("ROLLBACK");
+  }
+  batch->done = 1;
+  if (batch->writers == 0) {
+    free(batch);
+  }
+  g_batch = NULL;
+  g_batch_pending = 0;
+  pthread_cond_broadcast(&g_batch_done);
+}
+
+// Open a transaction for the next write, must be called with the storage lock held
+static bool batch_begin() {
+  if (g_batch != NULL) {
+    return TRUE;
+  }
+
+  g_batch = calloc(1, sizeof(sqlite_batch_t));
+  if (g_batch == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] could not allocate memory.\n", __func__, __LINE__);
+    return FALSE;
+  }
+  if (!exec_sql("BEGIN")) {
+    free(g_batch);
+    g_batch = NULL;
+    return FALSE;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &g_batch_deadline);
+  g_batch_deadline.tv_sec += g_batch_ms / 1000;
+  g_batch_deadline.tv_nsec += (long)(g_batch_ms % 1000) * 1000000L;
+  if (g_batch_deadline.tv_nsec >= 1000000000L) {
+    g_batch_deadline.tv_sec++;
+    g_batch_deadline.tv_nsec -= 1000000000L;
+  }
+  pthread_cond_signal(&g_batch_cond);
+
+  return TRUE;
+}
+
+// Block until the transaction of a finished write is committed, must be called with the storage lock held. Returns
+// FALSE if the commit failed.
+static bool batch_wait() {
+  sqlite_batch_t* batch = g_batch;
+  bool committed;
+
+  batch->writers++;
+  if (++g_batch_pending >= g_batch_size || g_batch_ms == 0) {
+    batch_commit();
+  } else {
+    pthread_cond_signal(&g_batch_cond);
+  }
+  while (!batch->done) {
+    pthread_cond_wait(&g_batch_done, &g_storage_lock);
+  }
+  committed = !batch->failed;
+  if (--batch->writers == 0) {
+    free(batch);
+  }
+
+  return committed;
+}
+
+static void* committer_thread(void* arg) {
+  pthread_mutex_lock(&g_storage_lock);
+  while (!g_committer_end) {
+    if (g_batch == NULL) {
+      pthread_cond_wait(&g_batch_cond, &g_storage_lock);
+    } else if (inflight() == 0 ||
+               pthread_cond_timedwait(&g_batch_cond, &g_storage_lock, &g_batch_deadline) == ETIMEDOUT) {
+      batch_commit();
+    }
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return NULL;
+}
+
+static bool sqlite_store_policy(pap_policy_t* policy) {
+  sqlite3_stmt* stmt = NULL;
+  int cost_len = strnlen(policy->policy_object.cost, sizeof(policy->policy_object.cost));
+  int rc;
+
+  if (policy->hash_function != PAP_SHA_256) {
+    log_error(plugin_logger_id, "[%s:%d] unsupported hash function.\n", __func__, __LINE__);
+    return FALSE;
+  }
+
+  if (policy->policy_id_signature.signature_algorithm != PAP_ECDSA) {
+    log_error(plugin_logger_id, "[%s:%d] unsupported signature algorithm.\n", __func__, __LINE__);
+    return FALSE;
+  }
+
+  if (!batch_begin()) {
+    return FALSE;
+  }
+
+  stmt = stmt_get(SQLITE_STMT_PUT);
+  sqlite3_bind_blob(stmt, 1, policy->policy_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  sqlite3_bind_blob(stmt, 2, policy->policy_object.policy_object, policy->policy_object.policy_object_size,
+                    SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, policy->policy_object.cost, cost_len, SQLITE_STATIC);
+  sqlite3_bind_blob(stmt, 4, policy->policy_id_signature.signature, PAP_SIGNATURE_LEN, SQLITE_STATIC);
+  sqlite3_bind_blob(stmt, 5, policy->policy_id_signature.public_key, PAP_PUBLIC_KEY_LEN, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 6, policy->policy_id_signature.signature_algorithm);
+  sqlite3_bind_int(stmt, 7, policy->hash_function);
+  rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  if (rc != SQLITE_DONE) {
+    log_error(plugin_logger_id, "[%s:%d] could not store policy: %s.\n", __func__, __LINE__, sqlite3_errmsg(g_db));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static bool sqlite_acquire_policy(char* policy_id, pap_policy_t* policy) {
+  sqlite3_stmt* stmt = stmt_get(SQLITE_STMT_GET);
+  int capacity = pap_plugin_object_capacity(&policy->policy_object);
+  bool ret = FALSE;
+
+  policy->policy_object.policy_object_size = 0;
+  sqlite3_bind_blob(stmt, 1, policy_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) <= capacity) {
+    policy->policy_object.policy_object_size = sqlite3_column_bytes(stmt, 0);
+    memcpy(policy->policy_object.policy_object, sqlite3_column_blob(stmt, 0), policy->policy_object.policy_object_size);
+    memset(policy->policy_object.cost, 0, sizeof(policy->policy_object.cost));
+    strncpy(policy->policy_object.cost, (const char*)sqlite3_column_text(stmt, 1),
+            sizeof(policy->policy_object.cost) - 1);
+    if (sqlite3_column_bytes(stmt, 2) == PAP_SIGNATURE_LEN && sqlite3_column_bytes(stmt, 3) == PAP_PUBLIC_KEY_LEN) {
+      memcpy(policy->policy_id_signature.signature, sqlite3_column_blob(stmt, 2), PAP_SIGNATURE_LEN);
+      memcpy(policy->policy_id_signature.public_key, sqlite3_column_blob(stmt, 3), PAP_PUBLIC_KEY_LEN);
+      policy->policy_id_signature.signature_algorithm = sqlite3_column_int(stmt, 4);
+      policy->hash_function = sqlite3_column_int(stmt, 5);
+      ret = TRUE;
+    }
+  }
+  sqlite3_reset(stmt);
+
+  if (!ret) {
+    policy->policy_object.policy_object_size = 0;
+    log_error(plugin_logger_id, "[%s:%d] could not acquire policy.\n", __func__, __LINE__);
+  }
+
+  return ret;
+}
+
+static bool sqlite_check_if_stored_policy(char* policy_id) {
+  sqlite3_stmt* stmt = stmt_get(SQLITE_STMT_HAS);
+  bool ret;
+
+  sqlite3_bind_blob(stmt, 1, policy_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  ret = sqlite3_step(stmt) == SQLITE_ROW ? TRUE : FALSE;
+  sqlite3_reset(stmt);
+
+  return ret;
+}
+
+static bool sqlite_flush_policy(char* policy_id) {
+  sqlite3_stmt* stmt = NULL;
+  int rc;
+
+  if (!batch_begin()) {
+    return FALSE;
+  }
+
+  stmt = stmt_get(SQLITE_STMT_DEL);
+  sqlite3_bind_blob(stmt, 1, policy_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  return (rc == SQLITE_DONE && sqlite3_changes(g_db) > 0) ? TRUE : FALSE;
+}
+
+static int sqlite_get_pol_obj_len(char* policy_id) {
+  sqlite3_stmt* stmt = stmt_get(SQLITE_STMT_LEN);
+  int ret = 0;
+
+  sqlite3_bind_blob(stmt, 1, policy_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    ret = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+
+  return ret;
+}
+
+// List must be freed by the user
+static bool sqlite_acquire_all_policies(pap_policy_id_list_t** pol_list_head) {
+  sqlite3_stmt* stmt = stmt_get(SQLITE_STMT_ALL);
+  pap_policy_id_list_t** tail = pol_list_head;
+  bool ret = TRUE;
+
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    pap_policy_id_list_t* elem = NULL;
+
+    if (sqlite3_column_bytes(stmt, 0) != PAP_POL_ID_MAX_LEN) continue;
+
+    elem = calloc(1, sizeof(pap_policy_id_list_t));
+    if (elem == NULL) {
+      ret = FALSE;
+      break;
+    }
+    memcpy(elem->policy_id, sqlite3_column_blob(stmt, 0), PAP_POL_ID_MAX_LEN);
+    *tail = elem;
+    tail = &elem->next;
+  }
+  sqlite3_reset(stmt);
+
+  return ret;
+}
+
+static void sqlite_close() {
+  for (int i = 0; i < SQLITE_STMT_COUNT; i++) {
+    sqlite3_finalize(g_stmt[i]);
+    g_stmt[i] = NULL;
+  }
+  sqlite3_close(g_db);
+  g_db = NULL;
+}
+
+static bool sqlite_open() {
+  char db_path[SQLITE_DB_PATH_LEN] = {0};
+
+  if (config_manager_get_option_string("pap", "sqlite_db", db_path, SQLITE_DB_PATH_LEN) != CONFIG_MANAGER_OK) {
+    strcpy(db_path, SQLITE_DEFAULT_DB);
+  }
+  if (config_manager_get_option_int("pap", "sqlite_batch_size", &g_batch_size) != CONFIG_MANAGER_OK ||
+      g_batch_size <= 0) {
+    g_batch_size = SQLITE_DEFAULT_BATCH_SIZE;
+  }
+  if (config_manager_get_option_int("pap", "sqlite_batch_ms", &g_batch_ms) != CONFIG_MANAGER_OK || g_batch_ms < 0) {
+    g_batch_ms = SQLITE_DEFAULT_BATCH_MS;
+  }
+
+  if (sqlite3_open(db_path, &g_db) != SQLITE_OK) {
+    log_error(plugin_logger_id, "[%s:%d] could not open %s: %s.\n", __func__, __LINE__, db_path,
+              sqlite3_errmsg(g_db));
+    sqlite_close();
+    return FALSE;
+  }
+
+  // WAL lets a commit append to the log instead of rewriting pages, NORMAL syncs only at checkpoints
+  if (!exec_sql("PRAGMA journal_mode=WAL") || !exec_sql("PRAGMA synchronous=NORMAL") || !exec_sql(g_schema)) {
+    sqlite_close();
+    return FALSE;
+  }
+
+  for (int i = 0; i < SQLITE_STMT_COUNT; i++) {
+    if (sqlite3_prepare_v2(g_db, g_stmt_sql[i], -1, &g_stmt[i], NULL) != SQLITE_OK) {
+      log_error(plugin_logger_id, "[%s:%d] could not prepare statement: %s.\n", __func__, __LINE__,
+                sqlite3_errmsg(g_db));
+      sqlite_close();
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+// Writes queued in front of the database must reach it before it is read directly
+static void drain_pending() {
+  pap_plugin_sqlite_drain_cb_t drain_cb;
+
+  pthread_mutex_lock(&g_storage_lock);
+  drain_cb = g_drain_cb;
+  pthread_mutex_unlock(&g_storage_lock);
+
+  if (drain_cb != NULL) drain_cb();
+}
+
+/****************************************************************************
+ * API FUNCTIONS
+ ****************************************************************************/
+void pap_plugin_sqlite_set_drain_cb(pap_plugin_sqlite_drain_cb_t drain_cb) {
+  pthread_mutex_lock(&g_storage_lock);
+  g_drain_cb = drain_cb;
+  pthread_mutex_unlock(&g_storage_lock);
+}
+
+int pap_plugin_sqlite_list_ids(char** ids, int* count) {
+  sqlite3_stmt* stmt = NULL;
+  int num = 0;
+
+  if (ids == NULL || count == NULL) {
+    log_error(plugin_logger_id, "[%s:%d] bad input parameter.\n", __func__, __LINE__);
+    return 1;
+  }
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  stmt = stmt_get(SQLITE_STMT_NUM);
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    num = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+
+  *count = 0;
+  *ids = malloc((size_t)(num > 0 ? num : 1) * PAP_POL_ID_MAX_LEN);
+  if (*ids != NULL) {
+    stmt = stmt_get(SQLITE_STMT_ALL);
+    while (*count < num && sqlite3_step(stmt) == SQLITE_ROW) {
+      if (sqlite3_column_bytes(stmt, 0) != PAP_POL_ID_MAX_LEN) continue;
+      memcpy(*ids + (size_t)*count * PAP_POL_ID_MAX_LEN, sqlite3_column_blob(stmt, 0), PAP_POL_ID_MAX_LEN);
+      (*count)++;
+    }
+    sqlite3_reset(stmt);
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+
+  return *ids == NULL ? 1 : 0;
+}
+
+void pap_plugin_sqlite_cursor_init(pap_plugin_sqlite_cursor_t* cursor) {
+  if (cursor != NULL) memset(cursor, 0, sizeof(pap_plugin_sqlite_cursor_t));
+}
+
+int pap_plugin_sqlite_cursor_next(pap_plugin_sqlite_cursor_t* cursor, char* ids, int max_ids) {
+  sqlite3_stmt* stmt = NULL;
+  int count = 0;
+
+  if (cursor == NULL || ids == NULL || max_ids <= 0) {
+    return 0;
+  }
+
+  drain_pending();
+  pthread_mutex_lock(&g_storage_lock);
+  stmt = stmt_get(SQLITE_STMT_NEXT);
+  // An empty blob sorts before every ID
+  if (cursor->started) {
+    sqlite3_bind_blob(stmt, 1, cursor->last_id, PAP_POL_ID_MAX_LEN, SQLITE_STATIC);
+  } else {
+    sqlite3_bind_zeroblob(stmt, 1, 0);
+  }
+  sqlite3_bind_int(stmt, 2, max_ids);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (sqlite3_column_bytes(stmt, 0) != PAP_POL_ID_MAX_LEN) continue;
+    memcpy(ids + (size_t)count * PAP_POL_ID_MAX_LEN, sqlite3_column_blob(stmt, 0), PAP_POL_ID_MAX_LEN);
+    count++;
+  }
+  sqlite3_reset(stmt);
+  pthread_mutex_unlock(&g_storage_lock);
+
+  if (count > 0) {
+    memcpy(cursor->last_id, ids + (size_t)(count - 1) * PAP_POL_ID_MAX_LEN, PAP_POL_ID_MAX_LEN);
+    cursor->started = 1;
+  }
+
+  return count;
+}
+
+/****************************************************************************
+ * CALLBACK FUNCTIONS
+ ****************************************************************************/
+static int destroy_cb(plugin_t* plugin, void* data) {
+  pthread_mutex_lock(&g_storage_lock);
+  g_committer_end = 1;
+  pthread_cond_signal(&g_batch_cond);
+  pthread_mutex_unlock(&g_storage_lock);
+  pthread_join(g_committer, NULL);
+
+  pthread_mutex_lock(&g_storage_lock);
+  batch_commit();
+  sqlite_close();
+  pthread_mutex_unlock(&g_storage_lock);
+
+  free(plugin->callbacks);
+  return 0;
+}
+
+static int put_cb(plugin_t* plugin, void* data) {
+  pap_policy_t* policy = (pap_policy_t*)data;
+  bool stored;
+
+  inflight_enter();
+  pthread_mutex_lock(&g_storage_lock);
+  stored = sqlite_store_policy(policy);
+  inflight_leave();
+  if (stored) {
+    stored = batch_wait();
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+  return stored ? 0 : 1;
+}
+
+static int get_cb(plugin_t* plugin, void* data) {
+  pap_plugin_get_args_t* args = (pap_plugin_get_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
+  sqlite_acquire_policy(args->policy_id, args->policy);
+  pthread_mutex_unlock(&g_storage_lock);
+  memcpy(args->policy->policy_id, args->policy_id, PAP_POL_ID_MAX_LEN);
+  args->policy->policy_id[PAP_POL_ID_MAX_LEN + 1] = 0;
+  return 0;
+}
+
+static int has_cb(plugin_t* plugin, void* data) {
+  pap_plugin_has_args_t* args = (pap_plugin_has_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
+  args->does_have = sqlite_check_if_stored_policy(args->policy_id);
+  pthread_mutex_unlock(&g_storage_lock);
+  return 0;
+}
+
+static int del_cb(plugin_t* plugin, void* data) {
+  char* policy_id = (char*)data;
+  bool flushed;
+  bool committed = TRUE;
+
+  inflight_enter();
+  pthread_mutex_lock(&g_storage_lock);
+  flushed = sqlite_flush_policy(policy_id);
+  inflight_leave();
+  // Deleting a policy that is not stored is not an error, a delete that is not committed is
+  if (flushed) {
+    committed = batch_wait();
+  }
+  pthread_mutex_unlock(&g_storage_lock);
+  return committed ? 0 : 1;
+}
+
+static int get_len_cb(plugin_t* plugin, void* data) {
+  pap_plugin_len_args_t* args = (pap_plugin_len_args_t*)data;
+
+  pthread_mutex_lock(&g_storage_lock);
+  args->len = sqlite_get_pol_obj_len(args->policy_id);
+  pthread_mutex_unlock(&g_storage_lock);
+  return 0;
+}
+
+static int get_all_cb(plugin_t* plugin, void* data) {
+  pap_policy_id_list_t** id_list = (pap_policy_id_list_t**)data;
+
+  pthread_mutex_lock(&g_storage_lock);
+  sqlite_acquire_all_policies(id_list);
+  pthread_mutex_unlock(&g_storage_lock);
+  return 0;
+}
+
+int pap_plugin_sqlite_initializer(plugin_t* plugin, void* data) {
+  pthread_mutex_lock(&g_storage_lock);
+  if (g_db != NULL || !sqlite_open()) {
+    pthread_mutex_unlock(&g_storage_lock);
+    log_error(plugin_logger_id, "[%s:%d] could not open policy database.\n", __func__, __LINE__);
+    return -1;
+  }
+  g_committer_end = 0;
+  pthread_mutex_unlock(&g_storage_lock);
+
+  if (pthread_create(&g_committer, NULL, committer_thread, NULL) != 0) {
+    log_error(plugin_logger_id, "[%s:%d] could not start committer thread.\n", __func__, __LINE__);
+    pthread_mutex_lock(&g_storage_lock);
+    sqlite_close();
+    pthread_mutex_unlock(&g_storage_lock);
+    return -1;
+  }
+
+  plugin->destroy = destroy_cb;
+  plugin->callbacks = malloc(sizeof(void*) * PAP_PLUGIN_CALLBACK_COUNT);
+  plugin->plugin_specific_data = NULL;
+  plugin->callbacks_num = PAP_PLUGIN_CALLBACK_COUNT;
+  plugin->callbacks[PAP_PLUGIN_PUT_CB] = put_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_CB] = get_cb;
+  plugin->callbacks[PAP_PLUGIN_HAS_CB] = has_cb;
+  plugin->callbacks[PAP_PLUGIN_DEL_CB] = del_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_POL_OBJ_LEN_CB] = get_len_cb;
+  plugin->callbacks[PAP_PLUGIN_GET_ALL_CB] = get_all_cb;
+  return 0;
+}
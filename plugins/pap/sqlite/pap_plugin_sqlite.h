@@ -0,0 +1,90 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_plugin_sqlite.h
+ * \brief
+ * Policy storage interface backed by SQLite
+ *
+ * \notes
+ * Database path and write batching are read from the [pap] section of the
+ * configuration: sqlite_db, sqlite_batch_size and sqlite_batch_ms.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+#ifndef _PAP_PLUGIN_SQLITE_H_
+#define _PAP_PLUGIN_SQLITE_H_
+
+#include "pap.h"
+#include "pap_plugin.h"
+#include "plugin.h"
+
+typedef struct {
+  char last_id[PAP_POL_ID_MAX_LEN];
+  int started;
+} pap_plugin_sqlite_cursor_t;
+
+// Called before reading the database directly, to flush writes queued in front of the plugin
+typedef void (*pap_plugin_sqlite_drain_cb_t)(void);
+
+int pap_plugin_sqlite_initializer(plugin_t *plugin, void *user_data);
+
+/**
+ * @brief Register a callback flushing writes queued in front of the plugin
+ *
+ * ID listing reads the database without going through the plugin callbacks.
+ * It calls the callback first, so it sees every write a cache in front of
+ * the plugin has acknowledged.
+ *
+ * @param[in] drain_cb Callback, NULL to unregister
+ */
+void pap_plugin_sqlite_set_drain_cb(pap_plugin_sqlite_drain_cb_t drain_cb);
+
+/**
+ * @brief List all stored policy IDs in one contiguous buffer
+ *
+ * @param[out] ids PAP_POL_ID_MAX_LEN bytes per ID, must be freed by the caller
+ * @param[out] count Number of IDs
+ *
+ * @return 0 on success, 1 on failure
+ */
+int pap_plugin_sqlite_list_ids(char **ids, int *count);
+
+/**
+ * @brief Start iterating over stored policy IDs
+ */
+void pap_plugin_sqlite_cursor_init(pap_plugin_sqlite_cursor_t *cursor);
+
+/**
+ * @brief Copy the next batch of stored policy IDs, in ID order
+ *
+ * Iteration resumes after the last returned ID, so every policy stored for
+ * the whole iteration is returned exactly once.
+ *
+ * @param[in,out] cursor Iteration state
+ * @param[out] ids Buffer for max_ids IDs of PAP_POL_ID_MAX_LEN bytes each
+ * @param[in] max_ids Buffer capacity in IDs
+ *
+ * @return number of IDs copied, 0 at the end
+ */
+int pap_plugin_sqlite_cursor_next(pap_plugin_sqlite_cursor_t *cursor, char *ids, int max_ids);
+
+#endif  //_PAP_PLUGIN_SQLITE_H_
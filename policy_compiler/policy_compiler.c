@@ -0,0 +1,1106 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_compiler.c
+ * \brief
+ * Compact binary form of policy objects and its evaluator
+ *
+ * \notes
+ * Layout: header, node array, string pool. Every node records the index of
+ * the node following its subtree, so evaluation skips the remaining
+ * children of a decided and/or without visiting them. Strings are
+ * unescaped into the pool and referenced by offset and length.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_compiler.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POLICYCOMP_MAGIC 0x504d4350  // "PCMP"
+#define POLICYCOMP_VERSION 1
+#define POLICYCOMP_NONE UINT32_MAX
+#define POLICYCOMP_MAX_DEPTH 32
+#define POLICYCOMP_MAX_NODES 65536
+#define POLICYCOMP_NUMBER_LEN 64
+#define POLICYCOMP_ATTR_PREFIX "request."
+#define POLICYCOMP_ATTR_OTHER 0xffff  // attribute outside the interned set, named in the pool
+
+/* POLICYCOMP_OPS */
+#define POLICYCOMP_OP_AND (1)
+#define POLICYCOMP_OP_OR (2)
+#define POLICYCOMP_OP_NOT (3)
+#define POLICYCOMP_OP_EQ (4)
+#define POLICYCOMP_OP_NEQ (5)
+#define POLICYCOMP_OP_LT (6)
+#define POLICYCOMP_OP_LEQ (7)
+#define POLICYCOMP_OP_GT (8)
+#define POLICYCOMP_OP_GEQ (9)
+#define POLICYCOMP_OP_ATTR (10)
+#define POLICYCOMP_OP_CONST (11)
+
+#define POLICYCOMP_IS_COMPARISON(op) ((op) >= POLICYCOMP_OP_EQ && (op) <= POLICYCOMP_OP_GEQ)
+#define POLICYCOMP_IS_OPERAND(op) ((op) == POLICYCOMP_OP_ATTR || (op) == POLICYCOMP_OP_CONST)
+
+/* POLICYCOMP_TYPES */
+#define POLICYCOMP_TYPE_STR (1)
+#define POLICYCOMP_TYPE_TIME (2)
+#define POLICYCOMP_TYPE_INT (3)
+#define POLICYCOMP_TYPE_FLOAT (4)
+#define POLICYCOMP_TYPE_BOOL (5)
+
+#define POLICYCOMP_IS_WHITESPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+typedef struct {
+  uint32_t offset;
+  uint32_t len;
+} policycomp_span_t;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t node_count;
+  uint32_t pool_len;
+  uint32_t goc_root;  // POLICYCOMP_NONE for an empty condition
+  uint32_t doc_root;
+  policycomp_span_t obligation_grant;
+  policycomp_span_t obligation_deny;
+} policycomp_header_t;
+
+typedef struct {
+  uint8_t op;
+  uint8_t type;   // declared type of an operand
+  uint16_t attr;  // policycomp_attr_e or POLICYCOMP_ATTR_OTHER
+  uint32_t next;  // index of the node after this subtree
+  union {
+    int64_t i;
+    double f;
+    policycomp_span_t str;  // string constant or name of an attribute outside the interned set
+  } value;
+} policycomp_node_t;
+
+typedef struct {
+  const char *json;
+  size_t len;
+  size_t pos;
+  int depth;
+  policycomp_node_t *nodes;
+  uint32_t node_count;
+  uint32_t node_cap;
+  char *pool;
+  uint32_t pool_len;
+  uint32_t pool_cap;
+} policycomp_ctx_t;
+
+// Compiled policy checked for consistent sizes, nodes are still checked one by one as they are visited
+typedef struct {
+  policycomp_header_t header;
+  const char *nodes;
+  const char *pool;
+} policycomp_program_t;
+
+typedef struct {
+  uint8_t type;
+  const char *str;
+  size_t len;
+  int64_t i;
+  double f;
+} policycomp_value_t;
+
+static const char *g_attr_names[POLICYCOMP_ATTR_COUNT] = {
+    "request.subject.value", "request.subject.type", "request.object.value", "request.object.type",
+    "request.action.value",  "request.action.type",  "request.time.value",   "request.time.type",
+};
+
+static int span_is(const char *str, size_t len, const char *literal) {
+  return strlen(literal) == len && memcmp(str, literal, len) == 0;
+}
+
+/****************************************************************************
+ * Compiler
+ ****************************************************************************/
+static void skip_whitespace(policycomp_ctx_t *ctx) {
+  while (ctx->pos < ctx->len && POLICYCOMP_IS_WHITESPACE(ctx->json[ctx->pos])) ctx->pos++;
+}
+
+// Consume c after optional whitespace
+static int expect(policycomp_ctx_t *ctx, char c) {
+  skip_whitespace(ctx);
+  if (ctx->pos >= ctx->len || ctx->json[ctx->pos] != c) {
+    return 1;
+  }
+  ctx->pos++;
+
+  return 0;
+}
+
+static int peek(policycomp_ctx_t *ctx, char c) {
+  skip_whitespace(ctx);
+  return ctx->pos < ctx->len && ctx->json[ctx->pos] == c;
+}
+
+// Raw string contents between the quotes, escapes included
+static int parse_string(policycomp_ctx_t *ctx, const char **str, size_t *len) {
+  size_t start;
+
+  if (expect(ctx, '"') != 0) {
+    return 1;
+  }
+
+  start = ctx->pos;
+  while (ctx->pos < ctx->len && ctx->json[ctx->pos] != '"') {
+    ctx->pos += ctx->json[ctx->pos] == '\\' ? 2 : 1;
+  }
+  if (ctx->pos >= ctx->len) {
+    return 1;
+  }
+
+  *str = ctx->json + start;
+  *len = ctx->pos - start;
+  ctx->pos++;
+
+  return 0;
+}
+
+// Number, true, false or null
+static int parse_primitive(policycomp_ctx_t *ctx, const char **str, size_t *len) {
+  size_t start;
+
+  skip_whitespace(ctx);
+  start = ctx->pos;
+  while (ctx->pos < ctx->len && ctx->json[ctx->pos] != ',' && ctx->json[ctx->pos] != '}' &&
+         ctx->json[ctx->pos] != ']' && !POLICYCOMP_IS_WHITESPACE(ctx->json[ctx->pos])) {
+    ctx->pos++;
+  }
+  if (ctx->pos == start) {
+    return 1;
+  }
+
+  *str = ctx->json + start;
+  *len = ctx->pos - start;
+
+  return 0;
+}
+
+static int skip_value(policycomp_ctx_t *ctx) {
+  const char *str = NULL;
+  size_t len = 0;
+  char close;
+
+  if (peek(ctx, '"')) {
+    return parse_string(ctx, &str, &len);
+  }
+  if (!peek(ctx, '{') && !peek(ctx, '[')) {
+    return parse_primitive(ctx, &str, &len);
+  }
+
+  close = ctx->json[ctx->pos] == '{' ? '}' : ']';
+  ctx->pos++;
+  if (++ctx->depth > POLICYCOMP_MAX_DEPTH) {
+    return 1;
+  }
+  while (!peek(ctx, close)) {
+    if (close == '}' && (parse_string(ctx, &str, &len) != 0 || expect(ctx, ':') != 0)) {
+      return 1;
+    }
+    if (skip_value(ctx) != 0) {
+      return 1;
+    }
+    if (!peek(ctx, close) && expect(ctx, ',') != 0) {
+      return 1;
+    }
+  }
+  ctx->pos++;
+  ctx->depth--;
+
+  return 0;
+}
+
+static int pool_reserve(policycomp_ctx_t *ctx, size_t len) {
+  if (ctx->pool_len + len > ctx->pool_cap) {
+    size_t new_cap = ctx->pool_cap == 0 ? 256 : ctx->pool_cap;
+    char *new_pool = NULL;
+
+    while (new_cap < ctx->pool_len + len) new_cap *= 2;
+    if (new_cap > UINT32_MAX) {
+      return 1;
+    }
+    new_pool = realloc(ctx->pool, new_cap);
+    if (new_pool == NULL) {
+      return 1;
+    }
+    ctx->pool = new_pool;
+    ctx->pool_cap = new_cap;
+  }
+
+  return 0;
+}
+
+static int pool_add_raw(policycomp_ctx_t *ctx, const char *str, size_t len, policycomp_span_t *span) {
+  if (pool_reserve(ctx, len) != 0) {
+    return 1;
+  }
+
+  memcpy(ctx->pool + ctx->pool_len, str, len);
+  span->offset = ctx->pool_len;
+  span->len = len;
+  ctx->pool_len += len;
+
+  return 0;
+}
+
+// Unescape a JSON string into the pool, \u escapes are not used by policies and are rejected
+static int pool_add_string(policycomp_ctx_t *ctx, const char *str, size_t len, policycomp_span_t *span) {
+  char *out = NULL;
+
+  if (pool_reserve(ctx, len) != 0) {
+    return 1;
+  }
+
+  span->offset = ctx->pool_len;
+  out = ctx->pool + ctx->pool_len;
+  for (size_t i = 0; i < len; i++) {
+    char c = str[i];
+
+    if (c == '\\') {
+      if (++i >= len) {
+        return 1;
+      }
+      switch (str[i]) {
+        case '"':
+        case '\\':
+        case '/':
+          c = str[i];
+          break;
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        default:
+          return 1;
+      }
+    }
+    *out++ = c;
+  }
+  span->len = out - (ctx->pool + ctx->pool_len);
+  ctx->pool_len += span->len;
+
+  return 0;
+}
+
+static int push_node(policycomp_ctx_t *ctx, uint32_t *index) {
+  if (ctx->node_count == ctx->node_cap) {
+    uint32_t new_cap = ctx->node_cap == 0 ? 16 : ctx->node_cap * 2;
+    policycomp_node_t *new_nodes = NULL;
+
+    if (ctx->node_count >= POLICYCOMP_MAX_NODES) {
+      return 1;
+    }
+    new_nodes = realloc(ctx->nodes, new_cap * sizeof(policycomp_node_t));
+    if (new_nodes == NULL) {
+      return 1;
+    }
+    ctx->nodes = new_nodes;
+    ctx->node_cap = new_cap;
+  }
+
+  *index = ctx->node_count++;
+  memset(&ctx->nodes[*index], 0, sizeof(policycomp_node_t));
+
+  return 0;
+}
+
+static int parse_int(const char *str, size_t len, int64_t *value) {
+  char buf[POLICYCOMP_NUMBER_LEN];
+  char *end = NULL;
+
+  if (len == 0 || len >= sizeof(buf)) {
+    return 1;
+  }
+  memcpy(buf, str, len);
+  buf[len] = '\0';
+  *value = strtoll(buf, &end, 10);
+
+  return *end != '\0';
+}
+
+static int parse_float(const char *str, size_t len, double *value) {
+  char buf[POLICYCOMP_NUMBER_LEN];
+  char *end = NULL;
+
+  if (len == 0 || len >= sizeof(buf)) {
+    return 1;
+  }
+  memcpy(buf, str, len);
+  buf[len] = '\0';
+  *value = strtod(buf, &end);
+
+  return *end != '\0';
+}
+
+static int parse_bool(const char *str, size_t len, int64_t *value) {
+  if (span_is(str, len, "true")) {
+    *value = 1;
+  } else if (span_is(str, len, "false")) {
+    *value = 0;
+  } else {
+    return 1;
+  }
+
+  return 0;
+}
+
+static int lookup_op(const char *str, size_t len, uint8_t *op) {
+  static const char *names[] = {"and", "or", "not", "eq", "neq", "lt", "leq", "gt", "geq"};
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (span_is(str, len, names[i])) {
+      *op = POLICYCOMP_OP_AND + i;
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static int compile_operand(policycomp_ctx_t *ctx, policycomp_node_t *node, const char *type, size_t type_len,
+                           const char *value, size_t value_len) {
+  if (span_is(type, type_len, "str")) {
+    node->type = POLICYCOMP_TYPE_STR;
+  } else if (span_is(type, type_len, "time")) {
+    node->type = POLICYCOMP_TYPE_TIME;
+  } else if (span_is(type, type_len, "int")) {
+    node->type = POLICYCOMP_TYPE_INT;
+  } else if (span_is(type, type_len, "float")) {
+    node->type = POLICYCOMP_TYPE_FLOAT;
+  } else if (span_is(type, type_len, "bool") || span_is(type, type_len, "boolean")) {
+    node->type = POLICYCOMP_TYPE_BOOL;
+  } else {
+    return 1;
+  }
+
+  // Values naming a request attribute are looked up at evaluation, whatever the declared type
+  if (value_len > strlen(POLICYCOMP_ATTR_PREFIX) &&
+      memcmp(value, POLICYCOMP_ATTR_PREFIX, strlen(POLICYCOMP_ATTR_PREFIX)) == 0) {
+    node->op = POLICYCOMP_OP_ATTR;
+    node->attr = POLICYCOMP_ATTR_OTHER;
+    for (int i = 0; i < POLICYCOMP_ATTR_COUNT; i++) {
+      if (span_is(value, value_len, g_attr_names[i])) node->attr = i;
+    }
+    return node->attr == POLICYCOMP_ATTR_OTHER ? pool_add_string(ctx, value, value_len, &node->value.str) : 0;
+  }
+
+  node->op = POLICYCOMP_OP_CONST;
+  switch (node->type) {
+    case POLICYCOMP_TYPE_STR:
+      return pool_add_string(ctx, value, value_len, &node->value.str);
+    case POLICYCOMP_TYPE_TIME:
+    case POLICYCOMP_TYPE_INT:
+      return parse_int(value, value_len, &node->value.i);
+    case POLICYCOMP_TYPE_FLOAT:
+      return parse_float(value, value_len, &node->value.f);
+    default:
+      return parse_bool(value, value_len, &node->value.i);
+  }
+}
+
+// Compile {"attribute_list":[...],"operation":"..."} or {"type":"...","value":...}, members in any order
+static int compile_node(policycomp_ctx_t *ctx) {
+  const char *op = NULL, *type = NULL, *value = NULL;
+  size_t op_len = 0, type_len = 0, value_len = 0;
+  int has_list = 0;
+  int children = 0;
+  uint32_t index;
+  uint8_t op_code = 0;
+
+  if (expect(ctx, '{') != 0 || ++ctx->depth > POLICYCOMP_MAX_DEPTH || push_node(ctx, &index) != 0) {
+    return 1;
+  }
+
+  while (!peek(ctx, '}')) {
+    const char *key = NULL;
+    size_t key_len = 0;
+    int ret;
+
+    if (parse_string(ctx, &key, &key_len) != 0 || expect(ctx, ':') != 0) {
+      return 1;
+    }
+
+    if (span_is(key, key_len, "attribute_list")) {
+      if (expect(ctx, '[') != 0) {
+        return 1;
+      }
+      has_list = 1;
+      while (!peek(ctx, ']')) {
+        if (compile_node(ctx) != 0 || (!peek(ctx, ']') && expect(ctx, ',') != 0)) {
+          return 1;
+        }
+        children++;
+      }
+      ret = expect(ctx, ']');
+    } else if (span_is(key, key_len, "operation")) {
+      ret = parse_string(ctx, &op, &op_len);
+    } else if (span_is(key, key_len, "type")) {
+      ret = parse_string(ctx, &type, &type_len);
+    } else if (span_is(key, key_len, "value")) {
+      ret = peek(ctx, '"') ? parse_string(ctx, &value, &value_len) : parse_primitive(ctx, &value, &value_len);
+    } else {
+      ret = skip_value(ctx);
+    }
+    if (ret != 0 || (!peek(ctx, '}') && expect(ctx, ',') != 0)) {
+      return 1;
+    }
+  }
+  ctx->pos++;
+  ctx->depth--;
+  ctx->nodes[index].next = ctx->node_count;
+
+  if (!has_list) {
+    return type == NULL || value == NULL || compile_operand(ctx, &ctx->nodes[index], type, type_len, value, value_len);
+  }
+
+  if (op == NULL || lookup_op(op, op_len, &op_code) != 0 || children == 0 ||
+      (op_code == POLICYCOMP_OP_NOT && children != 1)) {
+    return 1;
+  }
+  if (POLICYCOMP_IS_COMPARISON(op_code)) {
+    // Comparisons take two operands, the second starts where the first ends
+    if (children != 2 || !POLICYCOMP_IS_OPERAND(ctx->nodes[index + 1].op) ||
+        !POLICYCOMP_IS_OPERAND(ctx->nodes[ctx->nodes[index + 1].next].op)) {
+      return 1;
+    }
+  }
+  ctx->nodes[index].op = op_code;
+
+  return 0;
+}
+
+static int compile_condition(policycomp_ctx_t *ctx, uint32_t *root) {
+  size_t start;
+
+  skip_whitespace(ctx);
+  start = ctx->pos;
+  if (expect(ctx, '{') != 0) {
+    return 1;
+  }
+
+  // An empty condition never holds
+  if (peek(ctx, '}')) {
+    ctx->pos++;
+    *root = POLICYCOMP_NONE;
+    return 0;
+  }
+
+  ctx->pos = start;
+  *root = ctx->node_count;
+
+  return compile_node(ctx);
+}
+
+static int compile_policy(policycomp_ctx_t *ctx, policycomp_header_t *header, int *found) {
+  if (expect(ctx, '{') != 0 || ++ctx->depth > POLICYCOMP_MAX_DEPTH) {
+    return 1;
+  }
+
+  while (!peek(ctx, '}')) {
+    const char *key = NULL;
+    size_t key_len = 0;
+    int ret;
+
+    if (parse_string(ctx, &key, &key_len) != 0 || expect(ctx, ':') != 0) {
+      return 1;
+    }
+
+    if (span_is(key, key_len, "policy_object")) {
+      ret = compile_policy(ctx, header, found);
+    } else if (span_is(key, key_len, "policy_goc")) {
+      ret = compile_condition(ctx, &header->goc_root);
+      *found = 1;
+    } else if (span_is(key, key_len, "policy_doc")) {
+      ret = compile_condition(ctx, &header->doc_root);
+      *found = 1;
+    } else if (span_is(key, key_len, "obligation_grant") || span_is(key, key_len, "obligation_deny")) {
+      // Obligations are passed on to the PEP as they are
+      policycomp_span_t *span =
+          span_is(key, key_len, "obligation_grant") ? &header->obligation_grant : &header->obligation_deny;
+      size_t start;
+
+      skip_whitespace(ctx);
+      start = ctx->pos;
+      ret = skip_value(ctx);
+      if (ret == 0) ret = pool_add_raw(ctx, ctx->json + start, ctx->pos - start, span);
+    } else {
+      ret = skip_value(ctx);
+    }
+    if (ret != 0 || (!peek(ctx, '}') && expect(ctx, ',') != 0)) {
+      return 1;
+    }
+  }
+  ctx->pos++;
+  ctx->depth--;
+
+  return 0;
+}
+
+int policycomp_compile(const char *json, size_t json_len, char **compiled, size_t *compiled_len) {
+  policycomp_ctx_t ctx;
+  policycomp_header_t header;
+  size_t nodes_len;
+  int found = 0;
+  int ret = 1;
+
+  if (json == NULL || compiled == NULL || compiled_len == NULL) {
+    return 1;
+  }
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.json = json;
+  ctx.len = json_len;
+  memset(&header, 0, sizeof(header));
+  header.magic = POLICYCOMP_MAGIC;
+  header.version = POLICYCOMP_VERSION;
+  header.goc_root = POLICYCOMP_NONE;
+  header.doc_root = POLICYCOMP_NONE;
+
+  if (compile_policy(&ctx, &header, &found) != 0 || !found) {
+    goto done;
+  }
+
+  header.node_count = ctx.node_count;
+  header.pool_len = ctx.pool_len;
+  nodes_len = (size_t)ctx.node_count * sizeof(policycomp_node_t);
+  *compiled_len = sizeof(header) + nodes_len + ctx.pool_len;
+  *compiled = malloc(*compiled_len);
+  if (*compiled == NULL) {
+    goto done;
+  }
+  memcpy(*compiled, &header, sizeof(header));
+  if (nodes_len > 0) memcpy(*compiled + sizeof(header), ctx.nodes, nodes_len);
+  if (ctx.pool_len > 0) memcpy(*compiled + sizeof(header) + nodes_len, ctx.pool, ctx.pool_len);
+  ret = 0;
+
+done:
+  free(ctx.nodes);
+  free(ctx.pool);
+
+  return ret;
+}
+
+/****************************************************************************
+ * Evaluator
+ ****************************************************************************/
+static int program_load(const char *compiled, size_t compiled_len, policycomp_program_t *program) {
+  policycomp_header_t *header = &program->header;
+
+  if (compiled == NULL || compiled_len < sizeof(policycomp_header_t)) {
+    return 1;
+  }
+
+  // The compiled policy may sit at any offset of a mapped log, fixed-size parts are copied out
+  memcpy(header, compiled, sizeof(policycomp_header_t));
+  if (header->magic != POLICYCOMP_MAGIC || header->version != POLICYCOMP_VERSION ||
+      header->node_count > POLICYCOMP_MAX_NODES ||
+      compiled_len != sizeof(policycomp_header_t) + (size_t)header->node_count * sizeof(policycomp_node_t) +
+                          header->pool_len ||
+      (header->goc_root != POLICYCOMP_NONE && header->goc_root >= header->node_count) ||
+      (header->doc_root != POLICYCOMP_NONE && header->doc_root >= header->node_count) ||
+      (uint64_t)header->obligation_grant.offset + header->obligation_grant.len > header->pool_len ||
+      (uint64_t)header->obligation_deny.offset + header->obligation_deny.len > header->pool_len) {
+    return 1;
+  }
+
+  program->nodes = compiled + sizeof(policycomp_header_t);
+  program->pool = program->nodes + (size_t)header->node_count * sizeof(policycomp_node_t);
+
+  return 0;
+}
+
+static int node_at(const policycomp_program_t *program, uint32_t index, policycomp_node_t *node) {
+  if (index >= program->header.node_count) {
+    return 1;
+  }
+
+  memcpy(node, program->nodes + (size_t)index * sizeof(policycomp_node_t), sizeof(policycomp_node_t));
+
+  return node->next <= index || node->next > program->header.node_count;
+}
+
+static int pool_string(const policycomp_program_t *program, policycomp_span_t span, const char **str, size_t *len) {
+  if ((uint64_t)span.offset + span.len > program->header.pool_len) {
+    return 1;
+  }
+
+  *str = program->pool + span.offset;
+  *len = span.len;
+
+  return 0;
+}
+
+// 0 if the operand has a value, 1 if the request lacks the attribute, -1 if the node is malformed
+static int operand_value(const policycomp_program_t *program, const policycomp_node_t *node,
+                         const policycomp_request_t *request, policycomp_value_t *value) {
+  memset(value, 0, sizeof(*value));
+
+  if (node->op == POLICYCOMP_OP_ATTR) {
+    value->type = POLICYCOMP_TYPE_STR;
+    if (node->attr < POLICYCOMP_ATTR_COUNT) {
+      value->str = request->value[node->attr];
+      value->len = request->value_len[node->attr];
+      return value->str == NULL;
+    }
+    if (node->attr != POLICYCOMP_ATTR_OTHER || pool_string(program, node->value.str, &value->str, &value->len) != 0) {
+      return -1;
+    }
+    if (request->resolve == NULL) {
+      return 1;
+    }
+    return request->resolve(request->user, value->str, value->len, &value->str, &value->len) != 0;
+  }
+
+  if (node->op != POLICYCOMP_OP_CONST) {
+    return -1;
+  }
+  value->type = node->type;
+  switch (node->type) {
+    case POLICYCOMP_TYPE_STR:
+      return pool_string(program, node->value.str, &value->str, &value->len) != 0 ? -1 : 0;
+    case POLICYCOMP_TYPE_FLOAT:
+      value->f = node->value.f;
+      return 0;
+    case POLICYCOMP_TYPE_TIME:
+    case POLICYCOMP_TYPE_INT:
+    case POLICYCOMP_TYPE_BOOL:
+      value->i = node->value.i;
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+// Request attributes are strings, they take the type of the constant they are compared with
+static int coerce(policycomp_value_t *value, uint8_t type) {
+  if (value->type != POLICYCOMP_TYPE_STR || type == POLICYCOMP_TYPE_STR) {
+    return 0;
+  }
+
+  value->type = type;
+  switch (type) {
+    case POLICYCOMP_TYPE_FLOAT:
+      return parse_float(value->str, value->len, &value->f);
+    case POLICYCOMP_TYPE_BOOL:
+      return parse_bool(value->str, value->len, &value->i);
+    default:
+      return parse_int(value->str, value->len, &value->i);
+  }
+}
+
+static int compare(uint8_t op, int order) {
+  switch (op) {
+    case POLICYCOMP_OP_EQ:
+      return order == 0;
+    case POLICYCOMP_OP_NEQ:
+      return order != 0;
+    case POLICYCOMP_OP_LT:
+      return order < 0;
+    case POLICYCOMP_OP_LEQ:
+      return order <= 0;
+    case POLICYCOMP_OP_GT:
+      return order > 0;
+    default:
+      return order >= 0;
+  }
+}
+
+static int eval_comparison(const policycomp_program_t *program, uint32_t index, uint8_t op,
+                           const policycomp_request_t *request) {
+  policycomp_node_t left_node, right_node;
+  policycomp_value_t left, right;
+  int left_ret, right_ret;
+  int order;
+
+  if (node_at(program, index + 1, &left_node) != 0 || node_at(program, left_node.next, &right_node) != 0) {
+    return -1;
+  }
+  left_ret = operand_value(program, &left_node, request, &left);
+  right_ret = operand_value(program, &right_node, request, &right);
+  if (left_ret < 0 || right_ret < 0) {
+    return -1;
+  }
+  if (left_ret > 0 || right_ret > 0) {
+    return 0;
+  }
+
+  if (coerce(&left, right.type) != 0 || coerce(&right, left.type) != 0) {
+    return 0;
+  }
+
+  if (left.type == POLICYCOMP_TYPE_STR) {
+    size_t len = left.len < right.len ? left.len : right.len;
+
+    order = memcmp(left.str, right.str, len);
+    if (order == 0) order = (left.len > right.len) - (left.len < right.len);
+  } else if (left.type == POLICYCOMP_TYPE_FLOAT || right.type == POLICYCOMP_TYPE_FLOAT) {
+    double l = left.type == POLICYCOMP_TYPE_FLOAT ? left.f : (double)left.i;
+    double r = right.type == POLICYCOMP_TYPE_FLOAT ? right.f : (double)right.i;
+
+    order = (l > r) - (l < r);
+  } else {
+    order = (left.i > right.i) - (left.i < right.i);
+  }
+
+  return compare(op, order);
+}
+
+// 1 if the condition holds, 0 if not, -1 if the compiled policy is malformed
+static int eval_node(const policycomp_program_t *program, uint32_t index, int depth,
+                     const policycomp_request_t *request) {
+  policycomp_node_t node;
+
+  if (depth > POLICYCOMP_MAX_DEPTH || node_at(program, index, &node) != 0) {
+    return -1;
+  }
+
+  if (POLICYCOMP_IS_COMPARISON(node.op)) {
+    return eval_comparison(program, index, node.op, request);
+  }
+
+  if (node.op == POLICYCOMP_OP_NOT) {
+    int ret = eval_node(program, index + 1, depth + 1, request);
+    return ret < 0 ? ret : !ret;
+  }
+
+  if (node.op == POLICYCOMP_OP_AND || node.op == POLICYCOMP_OP_OR) {
+    uint32_t child = index + 1;
+
+    while (child < node.next) {
+      policycomp_node_t child_node;
+      int ret = eval_node(program, child, depth + 1, request);
+
+      if (ret < 0) {
+        return ret;
+      }
+      // The rest of the children can not change the result
+      if (ret == (node.op == POLICYCOMP_OP_OR)) {
+        return ret;
+      }
+      if (node_at(program, child, &child_node) != 0) {
+        return -1;
+      }
+      child = child_node.next;
+    }
+    return node.op == POLICYCOMP_OP_AND;
+  }
+
+  return -1;
+}
+
+static int eval_condition(const policycomp_program_t *program, uint32_t root, const policycomp_request_t *request) {
+  return root == POLICYCOMP_NONE ? 0 : eval_node(program, root, 0, request);
+}
+
+policycomp_decision_e policycomp_evaluate(const char *compiled, size_t compiled_len,
+                                          const policycomp_request_t *request) {
+  policycomp_program_t program;
+  int goc, doc;
+
+  if (request == NULL || program_load(compiled, compiled_len, &program) != 0) {
+    return POLICYCOMP_ERROR;
+  }
+
+  goc = eval_condition(&program, program.header.goc_root, request);
+  doc = eval_condition(&program, program.header.doc_root, request);
+  if (goc < 0 || doc < 0) {
+    return POLICYCOMP_ERROR;
+  }
+
+  if (goc && doc) {
+    return POLICYCOMP_CONFLICT;
+  } else if (goc) {
+    return POLICYCOMP_GRANT;
+  } else if (doc) {
+    return POLICYCOMP_DENY;
+  }
+
+  return POLICYCOMP_GAP;
+}
+
+/****************************************************************************
+ * Index keys
+ ****************************************************************************/
+static int add_key(policycomp_key_t *keys, int *num_keys, const char *str, size_t len) {
+  for (int i = 0; i < *num_keys; i++) {
+    if (keys[i].len == len && memcmp(keys[i].str, str, len) == 0) {
+      return 0;
+    }
+  }
+  if (*num_keys == POLICYCOMP_MAX_KEYS) {
+    return 1;
+  }
+
+  keys[*num_keys].str = str;
+  keys[*num_keys].len = len;
+  (*num_keys)++;
+
+  return 0;
+}
+
+// Add the values attr must equal for the condition to hold: 1 if it is restricted, 0 if not, -1 if malformed
+static int restrict_node(const policycomp_program_t *program, uint32_t index, int depth, uint16_t attr,
+                         policycomp_key_t *keys, int *num_keys) {
+  policycomp_node_t node;
+
+  if (depth > POLICYCOMP_MAX_DEPTH || node_at(program, index, &node) != 0) {
+    return -1;
+  }
+
+  if (node.op == POLICYCOMP_OP_EQ) {
+    policycomp_node_t left, right;
+    const policycomp_node_t *constant = NULL;
+    const char *str = NULL;
+    size_t len = 0;
+
+    if (node_at(program, index + 1, &left) != 0 || node_at(program, left.next, &right) != 0) {
+      return -1;
+    }
+    // Only string constants compare byte for byte with the request value
+    if (left.op == POLICYCOMP_OP_ATTR && left.attr == attr) {
+      constant = &right;
+    } else if (right.op == POLICYCOMP_OP_ATTR && right.attr == attr) {
+      constant = &left;
+    }
+    if (constant == NULL || constant->op != POLICYCOMP_OP_CONST || constant->type != POLICYCOMP_TYPE_STR) {
+      return 0;
+    }
+    if (pool_string(program, constant->value.str, &str, &len) != 0) {
+      return -1;
+    }
+    return add_key(keys, num_keys, str, len) == 0;
+  }
+
+  if (node.op == POLICYCOMP_OP_AND) {
+    // Every child holds, the most restrictive one is enough
+    policycomp_key_t best_keys[POLICYCOMP_MAX_KEYS];
+    int best_num_keys = -1;
+
+    for (uint32_t child = index + 1; child < node.next;) {
+      policycomp_key_t child_keys[POLICYCOMP_MAX_KEYS];
+      policycomp_node_t child_node;
+      int child_num_keys = 0;
+      int ret = restrict_node(program, child, depth + 1, attr, child_keys, &child_num_keys);
+
+      if (ret < 0 || node_at(program, child, &child_node) != 0) {
+        return -1;
+      }
+      if (ret > 0 && (best_num_keys < 0 || child_num_keys < best_num_keys)) {
+        memcpy(best_keys, child_keys, child_num_keys * sizeof(policycomp_key_t));
+        best_num_keys = child_num_keys;
+      }
+      child = child_node.next;
+    }
+    for (int i = 0; i < best_num_keys; i++) {
+      if (add_key(keys, num_keys, best_keys[i].str, best_keys[i].len) != 0) {
+        return 0;
+      }
+    }
+    return best_num_keys >= 0;
+  }
+
+  if (node.op == POLICYCOMP_OP_OR) {
+    // Some child holds, each of them must be restricted
+    for (uint32_t child = index + 1; child < node.next;) {
+      policycomp_node_t child_node;
+      int ret = restrict_node(program, child, depth + 1, attr, keys, num_keys);
+
+      if (ret <= 0 || node_at(program, child, &child_node) != 0) {
+        return ret < 0 ? -1 : 0;
+      }
+      child = child_node.next;
+    }
+    return 1;
+  }
+
+  return node.op == POLICYCOMP_OP_NOT || POLICYCOMP_IS_COMPARISON(node.op) ? 0 : -1;
+}
+
+int policycomp_index_keys(const char *compiled, size_t compiled_len, policycomp_attr_e *attr, policycomp_key_t *keys,
+                          int *num_keys) {
+  static const policycomp_attr_e attrs[] = {POLICYCOMP_ATTR_SUBJECT_VALUE, POLICYCOMP_ATTR_ACTION_VALUE,
+                                            POLICYCOMP_ATTR_OBJECT_VALUE};
+  policycomp_program_t program;
+  int found = 0;
+
+  if (attr == NULL || keys == NULL || num_keys == NULL || program_load(compiled, compiled_len, &program) != 0) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+    policycomp_key_t attr_keys[POLICYCOMP_MAX_KEYS];
+    int attr_num_keys = 0;
+    int restricted = 1;
+
+    // The policy applies when either condition holds, an empty condition never does
+    if (program.header.goc_root != POLICYCOMP_NONE) {
+      restricted = restrict_node(&program, program.header.goc_root, 0, attrs[i], attr_keys, &attr_num_keys);
+    }
+    if (restricted > 0 && program.header.doc_root != POLICYCOMP_NONE) {
+      restricted = restrict_node(&program, program.header.doc_root, 0, attrs[i], attr_keys, &attr_num_keys);
+    }
+    if (restricted < 0) {
+      return 1;
+    }
+
+    if (restricted > 0 && (!found || attr_num_keys < *num_keys)) {
+      memcpy(keys, attr_keys, attr_num_keys * sizeof(policycomp_key_t));
+      *num_keys = attr_num_keys;
+      *attr = attrs[i];
+      found = 1;
+    }
+  }
+
+  return !found;
+}
+
+// Latest request time a condition can hold at, 1 if it is bounded, 0 if not, -1 if the program is malformed
+static int bound_node(const policycomp_program_t *program, uint32_t index, int depth, int64_t *bound) {
+  policycomp_node_t node;
+
+  if (depth > POLICYCOMP_MAX_DEPTH || node_at(program, index, &node) != 0) {
+    return -1;
+  }
+
+  if (node.op == POLICYCOMP_OP_EQ || node.op == POLICYCOMP_OP_LT || node.op == POLICYCOMP_OP_LEQ ||
+      node.op == POLICYCOMP_OP_GT || node.op == POLICYCOMP_OP_GEQ) {
+    policycomp_node_t left, right;
+    const policycomp_node_t *constant = NULL;
+    uint8_t op = node.op;
+
+    if (node_at(program, index + 1, &left) != 0 || node_at(program, left.next, &right) != 0) {
+      return -1;
+    }
+    // With the constant on the left the comparison is mirrored
+    if (left.op == POLICYCOMP_OP_ATTR && left.attr == POLICYCOMP_ATTR_TIME_VALUE) {
+      constant = &right;
+    } else if (right.op == POLICYCOMP_OP_ATTR && right.attr == POLICYCOMP_ATTR_TIME_VALUE) {
+      constant = &left;
+      if (op == POLICYCOMP_OP_GT) op = POLICYCOMP_OP_LT;
+      else if (op == POLICYCOMP_OP_GEQ) op = POLICYCOMP_OP_LEQ;
+      else if (op == POLICYCOMP_OP_LT) op = POLICYCOMP_OP_GT;
+      else if (op == POLICYCOMP_OP_LEQ) op = POLICYCOMP_OP_GEQ;
+    }
+    if (constant == NULL || constant->op != POLICYCOMP_OP_CONST ||
+        (constant->type != POLICYCOMP_TYPE_TIME && constant->type != POLICYCOMP_TYPE_INT) ||
+        (op != POLICYCOMP_OP_EQ && op != POLICYCOMP_OP_LT && op != POLICYCOMP_OP_LEQ) ||
+        (op == POLICYCOMP_OP_LT && constant->value.i == INT64_MIN)) {
+      return 0;
+    }
+    *bound = op == POLICYCOMP_OP_LT ? constant->value.i - 1 : constant->value.i;
+    return 1;
+  }
+
+  if (node.op == POLICYCOMP_OP_AND || node.op == POLICYCOMP_OP_OR) {
+    // Every child of an and holds, the earliest bound is enough, some child of an or holds, each must be bounded
+    int bounded = 0;
+
+    for (uint32_t child = index + 1; child < node.next;) {
+      policycomp_node_t child_node;
+      int64_t child_bound = 0;
+      int ret = bound_node(program, child, depth + 1, &child_bound);
+
+      if (ret < 0 || node_at(program, child, &child_node) != 0) {
+        return -1;
+      }
+      if (node.op == POLICYCOMP_OP_OR && ret == 0) {
+        return 0;
+      }
+      if (ret > 0 && (!bounded || (node.op == POLICYCOMP_OP_AND ? child_bound < *bound : child_bound > *bound))) {
+        *bound = child_bound;
+        bounded = 1;
+      }
+      child = child_node.next;
+    }
+    return bounded;
+  }
+
+  return node.op == POLICYCOMP_OP_NOT || POLICYCOMP_IS_COMPARISON(node.op) ? 0 : -1;
+}
+
+int policycomp_not_after(const char *compiled, size_t compiled_len, int64_t *not_after) {
+  policycomp_program_t program;
+  int found = 0;
+
+  if (not_after == NULL || program_load(compiled, compiled_len, &program) != 0) {
+    return 1;
+  }
+
+  // The policy applies when either condition holds, both must be bounded
+  for (int i = 0; i < 2; i++) {
+    uint32_t root = i == 0 ? program.header.goc_root : program.header.doc_root;
+    int64_t bound = 0;
+
+    if (root == POLICYCOMP_NONE) continue;
+    if (bound_node(&program, root, 0, &bound) <= 0) {
+      return 1;
+    }
+    if (!found || bound > *not_after) *not_after = bound;
+    found = 1;
+  }
+
+  return !found;
+}
+
+int policycomp_obligation(const char *compiled, size_t compiled_len, policycomp_decision_e decision,
+                          const char **obligation, size_t *obligation_len) {
+  policycomp_program_t program;
+  policycomp_span_t span;
+
+  if (obligation == NULL || obligation_len == NULL || program_load(compiled, compiled_len, &program) != 0) {
+    return 1;
+  }
+
+  if (decision == POLICYCOMP_GRANT) {
+    span = program.header.obligation_grant;
+  } else if (decision == POLICYCOMP_DENY) {
+    span = program.header.obligation_deny;
+  } else {
+    return 1;
+  }
+  if (span.len == 0) {
+    return 1;
+  }
+
+  return pool_string(&program, span, obligation, obligation_len);
+}
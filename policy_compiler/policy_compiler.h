@@ -0,0 +1,148 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_compiler.h
+ * \brief
+ * Compact binary form of policy objects and its evaluator
+ *
+ * \notes
+ * A policy is compiled once when it is stored. Conditions become a flat
+ * array of nodes in prefix order, request attributes are replaced by
+ * interned IDs and constants are decoded, so evaluation neither parses
+ * JSON nor compares attribute names. The compiled form uses host byte
+ * order and does not need to be aligned, it is evaluated in place.
+ *
+ * Policies using operations or types the compiler does not know are
+ * rejected, they are evaluated from JSON as before.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_COMPILER_H_
+#define _POLICY_COMPILER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POLICYCOMP_MAX_KEYS 16
+
+typedef enum {
+  POLICYCOMP_ATTR_SUBJECT_VALUE, /*!< request.subject.value */
+  POLICYCOMP_ATTR_SUBJECT_TYPE,  /*!< request.subject.type */
+  POLICYCOMP_ATTR_OBJECT_VALUE,  /*!< request.object.value */
+  POLICYCOMP_ATTR_OBJECT_TYPE,   /*!< request.object.type */
+  POLICYCOMP_ATTR_ACTION_VALUE,  /*!< request.action.value */
+  POLICYCOMP_ATTR_ACTION_TYPE,   /*!< request.action.type */
+  POLICYCOMP_ATTR_TIME_VALUE,    /*!< request.time.value */
+  POLICYCOMP_ATTR_TIME_TYPE,     /*!< request.time.type */
+  POLICYCOMP_ATTR_COUNT,
+} policycomp_attr_e;
+
+typedef enum {
+  POLICYCOMP_GAP,      /*!< neither condition holds */
+  POLICYCOMP_GRANT,    /*!< only policy_goc holds */
+  POLICYCOMP_DENY,     /*!< only policy_doc holds */
+  POLICYCOMP_CONFLICT, /*!< both conditions hold */
+  POLICYCOMP_ERROR,    /*!< malformed compiled policy */
+} policycomp_decision_e;
+
+/**
+ * @brief Resolve a request attribute outside the interned set
+ *
+ * @return 0 if the request has the attribute, 1 otherwise
+ */
+typedef int (*policycomp_resolve_cb_t)(void *user, const char *name, size_t name_len, const char **value,
+                                       size_t *value_len);
+
+typedef struct {
+  const char *str;
+  size_t len;
+} policycomp_key_t;
+
+typedef struct {
+  const char *value[POLICYCOMP_ATTR_COUNT];  // NULL if the request lacks the attribute
+  size_t value_len[POLICYCOMP_ATTR_COUNT];
+  policycomp_resolve_cb_t resolve;  // may be NULL
+  void *user;
+} policycomp_request_t;
+
+/**
+ * @brief Compile a policy object
+ *
+ * @param[in] json Policy object, or a policy with a policy_object member
+ * @param[in] json_len JSON length
+ * @param[out] compiled Compiled policy, to be freed by the caller
+ * @param[out] compiled_len Compiled policy length
+ *
+ * @return 0 on success, 1 if the policy can not be compiled
+ */
+int policycomp_compile(const char *json, size_t json_len, char **compiled, size_t *compiled_len);
+
+/**
+ * @brief Evaluate a compiled policy against a request
+ *
+ * Comparisons with attributes missing from the request are false.
+ */
+policycomp_decision_e policycomp_evaluate(const char *compiled, size_t compiled_len,
+                                          const policycomp_request_t *request);
+
+/**
+ * @brief Values of a request attribute the policy is restricted to
+ *
+ * A policy can only be granted or denied for requests whose subject, action
+ * or object value equals one of the keys. The attribute with the fewest keys
+ * is chosen. Keys point into the compiled policy.
+ *
+ * @param[in] compiled Compiled policy
+ * @param[in] compiled_len Compiled policy length
+ * @param[out] attr Restricted attribute
+ * @param[out] keys Buffer for POLICYCOMP_MAX_KEYS keys, none are set if the policy never applies
+ * @param[out] num_keys Number of keys
+ *
+ * @return 0 on success, 1 if the policy is not restricted or is malformed
+ */
+int policycomp_index_keys(const char *compiled, size_t compiled_len, policycomp_attr_e *attr, policycomp_key_t *keys,
+                          int *num_keys);
+
+/**
+ * @brief Latest request time the policy can be granted or denied at
+ *
+ * Derived from comparisons of request.time.value with time or integer
+ * constants. The policy has expired once the request time is past it.
+ *
+ * @param[in] compiled Compiled policy
+ * @param[in] compiled_len Compiled policy length
+ * @param[out] not_after Latest request time
+ *
+ * @return 0 on success, 1 if the policy is not bounded in time or is malformed
+ */
+int policycomp_not_after(const char *compiled, size_t compiled_len, int64_t *not_after);
+
+/**
+ * @brief Obligation of a decision, as the JSON text of the policy
+ *
+ * @return 0 on success, 1 if the decision has no obligation
+ */
+int policycomp_obligation(const char *compiled, size_t compiled_len, policycomp_decision_e decision,
+                          const char **obligation, size_t *obligation_len);
+
+#endif  // _POLICY_COMPILER_H_
@@ -0,0 +1,392 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/unity.h"
+
+#include "policy_compiler.h"
+
+// Operands and conditions in the policy format of the validator test set
+#define TEST_ATTR(name) "{\"type\":\"str\",\"value\":\"request." name "\"}"
+#define TEST_CONST(type, value) "{\"type\":\"" type "\",\"value\":\"" value "\"}"
+#define TEST_COND(op, left, right) "{\"attribute_list\":[" left "," right "],\"operation\":\"" op "\"}"
+#define TEST_EQ(name, value) TEST_COND("eq", TEST_ATTR(name), TEST_CONST("str", value))
+#define TEST_LIST2(op, a, b) "{\"attribute_list\":[" a "," b "],\"operation\":\"" op "\"}"
+#define TEST_LIST3(op, a, b, c) "{\"attribute_list\":[" a "," b "," c "],\"operation\":\"" op "\"}"
+#define TEST_NOT(a) "{\"attribute_list\":[" a "],\"operation\":\"not\"}"
+#define TEST_POLICY(doc, goc)                          \
+  "{\"policy_object\":{\"policy_doc\":" doc ",\"policy_goc\":" goc \
+  ",\"obligation_deny\":{},\"obligation_grant\":{\"type\":\"log\"}},\"cost\":\"0.0\",\"hash_function\":\"sha-256\"}"
+
+#define TEST_SUBJECT "0x8a5c1c0d6cf2b8e04a14f2a51ad3f11c9ab1b3e1"
+#define TEST_OBJECT "0x21b2c4d25ab43ac4a7ba1b2c16de82c8afd6e5b1"
+
+typedef struct {
+  const char *subject;
+  const char *object;
+  const char *action;
+  const char *time;
+  policycomp_decision_e expected;
+} test_request_t;
+
+typedef struct {
+  const char *policy;
+  test_request_t requests[4];
+} test_policy_t;
+
+static char const *test_other_name = "request.location.value";
+static char const *test_other_value = "lab";
+
+// Policies like the ones in the validator test set, each with requests covering its decisions
+static const test_policy_t test_set[] = {
+    {TEST_POLICY("{}", TEST_LIST3("and", TEST_EQ("subject.value", TEST_SUBJECT), TEST_EQ("object.value", TEST_OBJECT),
+                                  TEST_EQ("action.value", "open_door"))),
+     {{TEST_SUBJECT, TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "close_door", "1600000000", POLICYCOMP_GAP},
+      {"0x0", TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GAP},
+      {NULL, TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GAP}}},
+    {TEST_POLICY(TEST_LIST2("and", TEST_EQ("subject.value", TEST_SUBJECT),
+                            TEST_COND("gt", TEST_ATTR("time.value"), TEST_CONST("time", "1700000000"))),
+                 TEST_LIST2("and", TEST_EQ("subject.value", TEST_SUBJECT),
+                            TEST_COND("leq", TEST_ATTR("time.value"), TEST_CONST("time", "1700000000")))),
+     {{TEST_SUBJECT, TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", "1700000000", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", "1700000001", POLICYCOMP_DENY},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", "soon", POLICYCOMP_GAP}}},
+    {TEST_POLICY(TEST_EQ("action.value", "open_trunk"),
+                 TEST_LIST2("or", TEST_EQ("action.value", "open_trunk"), TEST_EQ("action.value", "open_door"))),
+     {{TEST_SUBJECT, TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "open_trunk", "1600000000", POLICYCOMP_CONFLICT},
+      {TEST_SUBJECT, TEST_OBJECT, "start_engine", "1600000000", POLICYCOMP_GAP},
+      {TEST_SUBJECT, TEST_OBJECT, NULL, "1600000000", POLICYCOMP_GAP}}},
+    {TEST_POLICY("{}", TEST_LIST3("and", TEST_NOT(TEST_EQ("subject.type", "guest")),
+                                  TEST_COND("geq", TEST_CONST("int", "1800000000"), TEST_ATTR("time.value")),
+                                  TEST_COND("eq", TEST_CONST("str", "request.location.value"),
+                                            TEST_CONST("str", "lab")))),
+     {{TEST_SUBJECT, TEST_OBJECT, "open_door", "1800000000", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", "1800000001", POLICYCOMP_GAP},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", "-5", POLICYCOMP_GRANT},
+      {TEST_SUBJECT, TEST_OBJECT, "open_door", NULL, POLICYCOMP_GAP}}},
+};
+
+static int resolve_other(void *user, const char *name, size_t name_len, const char **value, size_t *value_len) {
+  if (name_len != strlen(test_other_name) || memcmp(name, test_other_name, name_len) != 0) {
+    return 1;
+  }
+  *value = test_other_value;
+  *value_len = strlen(test_other_value);
+
+  return 0;
+}
+
+static void set_attr(policycomp_request_t *request, policycomp_attr_e attr, const char *value) {
+  request->value[attr] = value;
+  request->value_len[attr] = value != NULL ? strlen(value) : 0;
+}
+
+static policycomp_decision_e evaluate(const char *compiled, size_t compiled_len, const test_request_t *test) {
+  policycomp_request_t request;
+
+  memset(&request, 0, sizeof(request));
+  set_attr(&request, POLICYCOMP_ATTR_SUBJECT_VALUE, test->subject);
+  set_attr(&request, POLICYCOMP_ATTR_SUBJECT_TYPE, "user");
+  set_attr(&request, POLICYCOMP_ATTR_OBJECT_VALUE, test->object);
+  set_attr(&request, POLICYCOMP_ATTR_ACTION_VALUE, test->action);
+  set_attr(&request, POLICYCOMP_ATTR_TIME_VALUE, test->time);
+  request.resolve = resolve_other;
+
+  return policycomp_evaluate(compiled, compiled_len, &request);
+}
+
+static void compile(const char *json, char **compiled, size_t *compiled_len) {
+  TEST_ASSERT_EQUAL_INT(0, policycomp_compile(json, strlen(json), compiled, compiled_len));
+  TEST_ASSERT_NOT_NULL(*compiled);
+}
+
+void test_evaluate_test_set(void) {
+  for (size_t i = 0; i < sizeof(test_set) / sizeof(test_set[0]); i++) {
+    char *compiled = NULL;
+    size_t compiled_len = 0;
+
+    compile(test_set[i].policy, &compiled, &compiled_len);
+    for (int j = 0; j < 4; j++) {
+      const test_request_t *request = &test_set[i].requests[j];
+
+      TEST_ASSERT_EQUAL_INT(request->expected, evaluate(compiled, compiled_len, request));
+    }
+    free(compiled);
+  }
+}
+
+void test_obligations(void) {
+  char *compiled = NULL;
+  size_t compiled_len = 0;
+  const char *obligation = NULL;
+  size_t obligation_len = 0;
+
+  compile(test_set[0].policy, &compiled, &compiled_len);
+  TEST_ASSERT_EQUAL_INT(0,
+                        policycomp_obligation(compiled, compiled_len, POLICYCOMP_GRANT, &obligation, &obligation_len));
+  TEST_ASSERT_EQUAL_INT(strlen("{\"type\":\"log\"}"), obligation_len);
+  TEST_ASSERT_EQUAL_MEMORY("{\"type\":\"log\"}", obligation, obligation_len);
+  TEST_ASSERT_EQUAL_INT(0,
+                        policycomp_obligation(compiled, compiled_len, POLICYCOMP_DENY, &obligation, &obligation_len));
+  TEST_ASSERT_EQUAL_INT(2, obligation_len);
+  TEST_ASSERT_EQUAL_INT(1, policycomp_obligation(compiled, compiled_len, POLICYCOMP_GAP, &obligation, &obligation_len));
+  free(compiled);
+}
+
+void test_compile_rejects(void) {
+  static const char *policies[] = {
+      "{\"policy_object\":{}}",
+      "{\"policy_goc\":" TEST_COND("like", TEST_ATTR("action.value"), TEST_CONST("str", "a")) "}",
+      "{\"policy_goc\":" TEST_COND("eq", TEST_ATTR("action.value"), TEST_CONST("regex", "a")) "}",
+      "{\"policy_goc\":{\"attribute_list\":[" TEST_ATTR("action.value") "],\"operation\":\"eq\"}}",
+      "{\"policy_goc\":" TEST_LIST2("not", TEST_EQ("action.value", "a"), TEST_EQ("action.value", "b")) "}",
+      "{\"policy_goc\":{\"attribute_list\":[],\"operation\":\"and\"}}",
+      "{\"policy_goc\":" TEST_COND("lt", TEST_ATTR("time.value"), TEST_CONST("time", "soon")) "}",
+      "{\"policy_goc\":" TEST_EQ("action.value", "a"),
+  };
+  char *compiled = NULL;
+  size_t compiled_len = 0;
+
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    TEST_ASSERT_EQUAL_INT(1, policycomp_compile(policies[i], strlen(policies[i]), &compiled, &compiled_len));
+  }
+}
+
+void test_evaluate_rejects_corrupt(void) {
+  test_request_t request = {TEST_SUBJECT, TEST_OBJECT, "open_door", "1600000000", POLICYCOMP_GRANT};
+  char *compiled = NULL;
+  size_t compiled_len = 0;
+
+  compile(test_set[0].policy, &compiled, &compiled_len);
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ERROR, evaluate(compiled, compiled_len / 2, &request));
+  compiled[0] ^= 0xff;
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ERROR, evaluate(compiled, compiled_len, &request));
+  free(compiled);
+}
+
+static int compare_keys(const void *a, const void *b) {
+  const policycomp_key_t *x = (const policycomp_key_t *)a, *y = (const policycomp_key_t *)b;
+  int order = memcmp(x->str, y->str, x->len < y->len ? x->len : y->len);
+
+  return order != 0 ? order : (x->len > y->len) - (x->len < y->len);
+}
+
+// Index keys of the policy as a sorted, comma separated list, the order of keys is not specified
+static int index_keys(const char *doc, const char *goc, policycomp_attr_e *attr, char *list) {
+  char json[2048];
+  char *compiled = NULL;
+  size_t compiled_len = 0;
+  policycomp_key_t keys[POLICYCOMP_MAX_KEYS];
+  int num_keys = 0;
+  int ret;
+
+  snprintf(json, sizeof(json), "{\"policy_object\":{\"policy_doc\":%s,\"policy_goc\":%s}}", doc, goc);
+  compile(json, &compiled, &compiled_len);
+  ret = policycomp_index_keys(compiled, compiled_len, attr, keys, &num_keys);
+  list[0] = '\0';
+  if (ret == 0) {
+    qsort(keys, num_keys, sizeof(policycomp_key_t), compare_keys);
+    for (int i = 0; i < num_keys; i++) {
+      sprintf(list + strlen(list), "%s%.*s", i > 0 ? "," : "", (int)keys[i].len, keys[i].str);
+    }
+  }
+  free(compiled);
+
+  return ret;
+}
+
+void test_index_keys_and(void) {
+  policycomp_attr_e attr;
+  char keys[512];
+
+  // The attribute with the fewest keys is chosen
+  TEST_ASSERT_EQUAL_INT(0, index_keys("{}",
+                                      TEST_LIST2("and",
+                                                 TEST_LIST2("or", TEST_EQ("subject.value", "s1"),
+                                                            TEST_EQ("subject.value", "s2")),
+                                                 TEST_EQ("action.value", "open")),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ATTR_ACTION_VALUE, attr);
+  TEST_ASSERT_EQUAL_STRING("open", keys);
+
+  // Within an and the most restrictive child is enough
+  TEST_ASSERT_EQUAL_INT(0, index_keys("{}",
+                                      TEST_LIST3("and",
+                                                 TEST_LIST2("or", TEST_EQ("object.value", "o1"),
+                                                            TEST_EQ("object.value", "o2")),
+                                                 TEST_EQ("object.value", "o2"),
+                                                 TEST_COND("lt", TEST_ATTR("time.value"), TEST_CONST("time", "5"))),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ATTR_OBJECT_VALUE, attr);
+  TEST_ASSERT_EQUAL_STRING("o2", keys);
+
+  // The constant may be on either side
+  TEST_ASSERT_EQUAL_INT(0, index_keys("{}", TEST_COND("eq", TEST_CONST("str", "s1"), TEST_ATTR("subject.value")),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ATTR_SUBJECT_VALUE, attr);
+  TEST_ASSERT_EQUAL_STRING("s1", keys);
+}
+
+void test_index_keys_or(void) {
+  policycomp_attr_e attr;
+  char keys[512];
+
+  TEST_ASSERT_EQUAL_INT(0, index_keys("{}",
+                                      TEST_LIST3("or", TEST_EQ("subject.value", "s2"), TEST_EQ("subject.value", "s1"),
+                                                 TEST_LIST2("and", TEST_EQ("subject.value", "s3"),
+                                                            TEST_EQ("action.value", "open"))),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ATTR_SUBJECT_VALUE, attr);
+  TEST_ASSERT_EQUAL_STRING("s1,s2,s3", keys);
+
+  // Every child of an or must be restricted
+  TEST_ASSERT_EQUAL_INT(1, index_keys("{}",
+                                      TEST_LIST2("or", TEST_EQ("subject.value", "s1"),
+                                                 TEST_COND("lt", TEST_ATTR("time.value"), TEST_CONST("time", "5"))),
+                                      &attr, keys));
+
+  // The policy applies when either condition holds, keys of both are needed
+  TEST_ASSERT_EQUAL_INT(0, index_keys(TEST_EQ("action.value", "close"), TEST_EQ("action.value", "open"), &attr, keys));
+  TEST_ASSERT_EQUAL_INT(POLICYCOMP_ATTR_ACTION_VALUE, attr);
+  TEST_ASSERT_EQUAL_STRING("close,open", keys);
+  TEST_ASSERT_EQUAL_INT(1, index_keys(TEST_EQ("subject.value", "s1"), TEST_EQ("action.value", "open"), &attr, keys));
+}
+
+void test_index_keys_not(void) {
+  policycomp_attr_e attr;
+  char keys[512];
+
+  TEST_ASSERT_EQUAL_INT(1, index_keys("{}", TEST_NOT(TEST_EQ("subject.value", "s1")), &attr, keys));
+  TEST_ASSERT_EQUAL_INT(1, index_keys("{}", TEST_COND("neq", TEST_ATTR("subject.value"), TEST_CONST("str", "s1")),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_INT(0, index_keys("{}",
+                                      TEST_LIST2("and", TEST_NOT(TEST_EQ("subject.value", "s1")),
+                                                 TEST_EQ("subject.value", "s2")),
+                                      &attr, keys));
+  TEST_ASSERT_EQUAL_STRING("s2", keys);
+  TEST_ASSERT_EQUAL_INT(1, index_keys("{}",
+                                      TEST_LIST2("or", TEST_NOT(TEST_EQ("subject.value", "s1")),
+                                                 TEST_EQ("subject.value", "s2")),
+                                      &attr, keys));
+  // Only string constants compare byte for byte with the request value
+  TEST_ASSERT_EQUAL_INT(1, index_keys("{}", TEST_COND("eq", TEST_ATTR("subject.value"), TEST_CONST("int", "1")),
+                                      &attr, keys));
+}
+
+static int not_after(const char *doc, const char *goc, int64_t *bound) {
+  char json[2048];
+  char *compiled = NULL;
+  size_t compiled_len = 0;
+  int ret;
+
+  snprintf(json, sizeof(json), "{\"policy_object\":{\"policy_doc\":%s,\"policy_goc\":%s}}", doc, goc);
+  compile(json, &compiled, &compiled_len);
+  ret = policycomp_not_after(compiled, compiled_len, bound);
+  free(compiled);
+
+  return ret;
+}
+
+#define TEST_TIME(op, value) TEST_COND(op, TEST_ATTR("time.value"), TEST_CONST("time", value))
+#define TEST_TIME_MIRRORED(op, value) TEST_COND(op, TEST_CONST("time", value), TEST_ATTR("time.value"))
+
+void test_not_after_comparisons(void) {
+  int64_t bound = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME("leq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(100, bound);
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME("lt", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(99, bound);
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME("eq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(100, bound);
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_COND("leq", TEST_ATTR("time.value"), TEST_CONST("int", "7")), &bound));
+  TEST_ASSERT_EQUAL_INT(7, bound);
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_TIME("geq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_TIME("gt", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_TIME("neq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_EQ("subject.value", "s1"), &bound));
+}
+
+void test_not_after_mirrored(void) {
+  int64_t bound = 0;
+
+  // 100 >= time is the same as time <= 100
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME_MIRRORED("geq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(100, bound);
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME_MIRRORED("gt", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(99, bound);
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME_MIRRORED("eq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(100, bound);
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_TIME_MIRRORED("leq", "100"), &bound));
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_TIME_MIRRORED("lt", "100"), &bound));
+}
+
+void test_not_after_and_or_not(void) {
+  int64_t bound = 0;
+
+  // Every child of an and holds, the earliest bound is enough
+  TEST_ASSERT_EQUAL_INT(
+      0, not_after("{}",
+                   TEST_LIST3("and", TEST_TIME("geq", "10"), TEST_TIME("leq", "300"), TEST_TIME_MIRRORED("gt", "200")),
+                   &bound));
+  TEST_ASSERT_EQUAL_INT(199, bound);
+
+  // Some child of an or holds, the latest bound applies and every child must be bounded
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_LIST2("or", TEST_TIME("leq", "300"), TEST_TIME_MIRRORED("geq", "400")),
+                                     &bound));
+  TEST_ASSERT_EQUAL_INT(400, bound);
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_LIST2("or", TEST_TIME("leq", "300"), TEST_EQ("subject.value", "s1")),
+                                     &bound));
+
+  // A negated bound is a lower bound
+  TEST_ASSERT_EQUAL_INT(1, not_after("{}", TEST_NOT(TEST_TIME("gt", "100")), &bound));
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_LIST2("and", TEST_NOT(TEST_TIME("gt", "100")), TEST_TIME("lt", "50")),
+                                     &bound));
+  TEST_ASSERT_EQUAL_INT(49, bound);
+
+  // The policy applies when either condition holds, both must be bounded
+  TEST_ASSERT_EQUAL_INT(0, not_after(TEST_TIME("leq", "500"), TEST_TIME_MIRRORED("geq", "300"), &bound));
+  TEST_ASSERT_EQUAL_INT(500, bound);
+  TEST_ASSERT_EQUAL_INT(1, not_after(TEST_EQ("subject.value", "s1"), TEST_TIME("leq", "300"), &bound));
+  TEST_ASSERT_EQUAL_INT(0, not_after("{}", TEST_TIME("leq", "300"), &bound));
+  TEST_ASSERT_EQUAL_INT(300, bound);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_evaluate_test_set);
+  RUN_TEST(test_obligations);
+  RUN_TEST(test_compile_rejects);
+  RUN_TEST(test_evaluate_rejects_corrupt);
+  RUN_TEST(test_index_keys_and);
+  RUN_TEST(test_index_keys_or);
+  RUN_TEST(test_index_keys_not);
+  RUN_TEST(test_not_after_comparisons);
+  RUN_TEST(test_not_after_mirrored);
+  RUN_TEST(test_not_after_and_or_not);
+
+  return UNITY_END();
+}
@@ -23,19 +23,26 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "base64.h"
+#include "checkpoint.h"
 #include "config_manager.h"
-#include "json_helper.h"
 #include "pap.h"
 #include "time_manager.h"
 #include "utils.h"
 
+#include "bounded_queue.h"
+#include "policy_stream_parser.h"
 #include "policy_updater.h"
+#include "worker_pool.h"
 
-#define POLICY_LOADER_REPLY_LIST_SIZE (2048)
+#define POLICY_LOADER_MAX_LIST_VALUE_LEN (1024)
 
-#define POLICY_LOADER_REPLY_POLICY_SIZE (2048)
+#define POLICY_LOADER_MAX_POLICY_LEN (64 * 1024)
+
+#define POLICY_LOADER_MAX_RESPONSE_LEN (POLICY_LOADER_MAX_POLICY_LEN + 4 * 1024)
 
 /* POLICY_LOADER_STAGES */
 #define POLICY_LOADER_ERROR (0)
@@ -52,19 +59,26 @@
 #define FALSE (0)
 #endif
 
-#define POLICY_LOADER_TOK_NUM 256
 #define POLICY_LOADER_POL_ID_BUF_LEN 64
 #define POLICY_LOADER_STR_LEN 67
 #define POLICY_LOADER_POL_FULLY_RETRIEVED 2
-#define POLICY_LOADER_ARRAY_TOK_IDX 2
 #define POLICY_LOADER_TIME_BUF_LEN 80
 #define POLICY_LOADER_MAX_GET_TRY 3
 #define POLICY_LOADER_PUBLIC_KEY_LEN 32
 #define POLICY_LOADER_PUBLIC_KEY_B64_LEN 44
 #define POLICY_LOADER_SIGNATURE_LEN 64
 
-#define POLICY_LOADER_POL_RESPONSE_TYPE_ARRAY 2
-#define POLICY_LOADER_POL_RESPONSE_TYPE_STRING 3
+#define POLICY_LOADER_PARSE_QUEUE_LEN 16
+#define POLICY_LOADER_MISS_CACHE_LEN 32
+#define POLICY_LOADER_MISS_TTL_MS 30000
+#define POLICY_LOADER_ON_DEMAND_WAIT_MS 200
+#define POLICY_LOADER_ON_DEMAND_WORKERS 2
+#define POLICY_LOADER_ON_DEMAND_MAX 8
+#define POLICY_LOADER_VERIFY_QUEUE_LEN 64
+#define POLICY_LOADER_POLL_PERIOD_MS 5000
+#define POLICY_LOADER_LONG_POLL_S 30
+#define POLICY_LOADER_BACKOFF_MIN_MS 1000
+#define POLICY_LOADER_BACKOFF_MAX_MS 60000
 
 static const char POLICY_LOADER_response[] = "response";
 static const char POLICY_LOADER_policy_store_id[] = "policyStoreId";
@@ -77,33 +91,40 @@ static const char POLICY_LOADER_QuotationMark = '"';
 static const char POLICY_LOADER_Colon = ':';
 static const char POLICY_LOADER_Space = ' ';
 
-static char g_policy_list[POLICY_LOADER_REPLY_LIST_SIZE] = {
-    0,
-};
-static unsigned int g_policy_list_len = 0;
 static unsigned int g_new_policy_list = 0;
 
-static char g_policy[POLICY_LOADER_REPLY_POLICY_SIZE] = {
-    0,
-};
-
 static char g_owner_public_key[POLICY_LOADER_PUBLIC_KEY_B64_LEN + 1] = {0};
 
 static char g_action_ps[] = "<policy service connection>";
 
 static int g_task_sleep_time = -1;
 
+static int g_long_poll_s = POLICY_LOADER_LONG_POLL_S;
+static int g_backoff_min_ms = POLICY_LOADER_BACKOFF_MIN_MS;
+static int g_backoff_max_ms = POLICY_LOADER_BACKOFF_MAX_MS;
+static int g_backoff_ms = 0;
+static int g_next_request_delay_ms = 0;
+
 static int g_end;
 
 static pthread_t g_thread;
 
-static jsmn_parser p;
-static jsmntok_t t[POLICY_LOADER_TOK_NUM];
-static int r = 0;
+static worker_pool_t *g_verify_pool = NULL;
+
+static policyloader_stats_t g_stats;
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static int cycle_fsm();
 static unsigned int receive_policies(void);
 
+static long long time_now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static long long time_now_ms() { return time_now_us() / 1000; }
+
 static char *find_char(char char_to_find, char *start_p, char *end_p, int skip) {
   char *ret = NULL;
 
@@ -205,139 +226,140 @@ static int parse_policy_updater_response(char **start_p, char **end_p, char *end
   return 0;
 }
 
-static int b64_isvalidchar(char c) {
-  if (c >= '0' && c <= '9') return 1;
-  if (c >= 'A' && c <= 'Z') return 1;
-  if (c >= 'a' && c <= 'z') return 1;
-  if (c == '+' || c == '/' || c == '=') return 1;
-  return 0;
+typedef struct {
+  policystream_t parser;
+  char signature[POLICY_LOADER_SIGNATURE_LEN];
+  int has_signature;
+  char *policy;
+  size_t policy_len;
+  int error;
+} policy_loader_policy_t;
+
+static int parser_chunk_cb(void *user, const char *chunk, int chunk_len) {
+  return policystream_feed((policystream_t *)user, chunk, chunk_len);
 }
 
-static int b64_decode(const char *in, int in_len, unsigned char *out, int out_len) {
-  int i, j, v;
-  int b64invs[] = {62, -1, -1, -1, 63, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1,
-                   -1, -1, 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16, 17,
-                   18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1, -1, 26, 27, 28, 29, 30, 31,
-                   32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51};
+static int policy_value_cb(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                           size_t value_len) {
+  policy_loader_policy_t *policy = (policy_loader_policy_t *)user;
 
-  if (in == NULL || out == NULL) return 0;
-
-  for (i = 0; i < in_len; i++) {
-    if (!b64_isvalidchar(in[i])) return 0;
+  if (strcmp(key, "error") == 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] Policy not found!\n", __func__, __LINE__);
+    policy->error = 1;
+  } else if (strcmp(key, "signature") == 0 && type == POLICYSTREAM_STRING && !policy->has_signature) {
+    size_t signature_len = 0;
+
+    if (base64_decode(value, value_len, (unsigned char *)policy->signature, POLICY_LOADER_SIGNATURE_LEN,
+                      &signature_len) != 0 ||
+        signature_len != POLICY_LOADER_SIGNATURE_LEN) {
+      log_error(policy_loader_logger_id, "[%s:%d] Invalid policy signature\n", __func__, __LINE__);
+      policy->error = 1;
+    } else {
+      policy->has_signature = 1;
+    }
+  } else if (strcmp(key, "policy") == 0 && index < 0 && type != POLICYSTREAM_ARRAY_END && policy->policy == NULL) {
+    policy->policy = malloc(value_len);
+    if (policy->policy == NULL) {
+      policy->error = 1;
+    } else {
+      memcpy(policy->policy, value, value_len);
+      policy->policy_len = value_len;
+    }
   }
 
-  for (i = 0, j = 0; i < in_len, j < out_len; i += 4, j += 3) {
-    v = b64invs[in[i] - 43];
-    v = (v << 6) | b64invs[in[i + 1] - 43];
-    v = in[i + 2] == '=' ? v << 6 : (v << 6) | b64invs[in[i + 2] - 43];
-    v = in[i + 3] == '=' ? v << 6 : (v << 6) | b64invs[in[i + 3] - 43];
+  return policy->error;
+}
 
-    out[j] = (v >> 16) & 0xFF;
-    if (in[i + 2] != '=') out[j + 1] = (v >> 8) & 0xFF;
-    if (in[i + 3] != '=') out[j + 2] = v & 0xFF;
-  }
+static char g_policy_store_version[POLICY_LOADER_STR_LEN] = "0x0";
+static char g_pending_store_version[POLICY_LOADER_STR_LEN] = "0x0";
+static char g_device_id[POLICY_LOADER_STR_LEN] = "123";
 
-  return 1;
-}
+static int num_of_policies = 0;
+static int g_new_policy_list_parsed = 0;
 
-static int parse_policy_struct(const char *p_policy, char **signed_policy_buff, size_t *o_policy_len) {
-  int policy_len = 0;
-  char *policy_buff = NULL;
-  char *policy_signature_buff = NULL;
-  char policy_signature_decoded[POLICY_LOADER_SIGNATURE_LEN] = {0};
-  int policy_signature_len = 0;
-  int policy_retrieved = 0;
+typedef struct {
+  char id[POLICY_LOADER_POL_ID_BUF_LEN + 1];
+} policy_loader_id_t;
 
-  jsmn_init(&p);
-  r = jsmn_parse(&p, p_policy, strlen(p_policy), t, POLICY_LOADER_TOK_NUM);
+// ID arrays are exchanged with the checkpoint as they are, without copying
+_Static_assert(sizeof(policy_loader_id_t) == CHECKPOINT_POL_ID_BUF_LEN,
+               "policy_loader_id_t must have the layout of a checkpoint policy ID");
 
-  if (r < 0) {
-    log_error(policy_loader_logger_id, "[%s:%d] Failed to parse policy JSON: %d\n", __func__, __LINE__, r);
-    return 0;
-  }
+// Sorted IDs of the policies installed in the PAP by previous syncs
+static policy_loader_id_t *g_local_ids = NULL;
+static int g_local_ids_num = 0;
 
-  /* Assume the top-level element is an object */
-  if (r < 1 || t[0].type != JSMN_OBJECT) {
-    log_error(policy_loader_logger_id, "[%s:%d] Object expected in policy\n", __func__, __LINE__);
-    return 0;
-  }
+// Sorted IDs from the last policy list received from the policy store
+static policy_loader_id_t *g_remote_ids = NULL;
+static int g_remote_ids_num = 0;
 
-  if (memcmp(p_policy + t[1].start, "error", strlen("error")) == 0) {
-    log_error(policy_loader_logger_id, "[%s:%d] Policy not found!\n", __func__, __LINE__);
-  } else {
-    for (int i = 0; i < r; i++) {
-      if (memcmp(p_policy + t[i].start, "signature", strlen("signature")) == 0 &&
-          (t[i].end - t[i].start) == strlen("signature")) {
-        policy_signature_len = t[i + 1].end - t[i + 1].start;
-        policy_signature_buff = calloc(policy_signature_len + 1, 1);
-        memcpy(policy_signature_buff, p_policy + t[i + 1].start, policy_signature_len);
-        if (!b64_decode(policy_signature_buff, policy_signature_len, policy_signature_decoded,
-                        POLICY_LOADER_SIGNATURE_LEN))
-          return 0;
-        policy_retrieved++;
-        break;
-      }
-    }
-    for (int i = 0; i < r; i++) {
-      if (memcmp(p_policy + t[i].start, "policy", strlen("policy")) == 0 &&
-          (t[i].end - t[i].start) == strlen("policy")) {
-        policy_len = t[i + 1].end - t[i + 1].start;
-        policy_buff = calloc(policy_len + 1, 1);
-        memcpy(policy_buff, p_policy + t[i + 1].start, policy_len);
-        policy_retrieved++;
-        break;
-      }
-    }
+static int compare_policy_ids(const void *a, const void *b) {
+  return memcmp(((const policy_loader_id_t *)a)->id, ((const policy_loader_id_t *)b)->id,
+                POLICY_LOADER_POL_ID_BUF_LEN);
+}
+
+static int find_policy_id(const char *policy_id, const policy_loader_id_t *ids, int ids_num) {
+  if (ids == NULL || ids_num == 0) {
+    return FALSE;
   }
 
-  if (policy_retrieved == POLICY_LOADER_POL_FULLY_RETRIEVED) {
-    log_info(policy_loader_logger_id, "[%s:%d] Policy loaded.\n", __func__, __LINE__);
-    *signed_policy_buff = calloc(POLICY_LOADER_SIGNATURE_LEN + policy_len + 1, 1);
-    *o_policy_len = POLICY_LOADER_SIGNATURE_LEN + policy_len + 1;
-    memcpy(*signed_policy_buff, policy_signature_decoded, POLICY_LOADER_SIGNATURE_LEN);
-    memcpy(&(*signed_policy_buff)[POLICY_LOADER_SIGNATURE_LEN], policy_buff, policy_len);
+  return bsearch(policy_id, ids, ids_num, sizeof(policy_loader_id_t), compare_policy_ids) != NULL;
+}
+
+static int g_remote_ids_cap = 0;
+static int g_list_is_array = 0;
+
+static int append_remote_id(const char *policy_id, size_t policy_id_len) {
+  if (g_remote_ids_num == g_remote_ids_cap) {
+    int new_cap = g_remote_ids_cap == 0 ? POLICY_LOADER_POL_ID_BUF_LEN : g_remote_ids_cap * 2;
+    policy_loader_id_t *ids = realloc(g_remote_ids, new_cap * sizeof(policy_loader_id_t));
+
+    if (ids == NULL) {
+      log_error(policy_loader_logger_id, "[%s:%d] could not allocate policy ID list.\n", __func__, __LINE__);
+      return 1;
+    }
+    g_remote_ids = ids;
+    g_remote_ids_cap = new_cap;
   }
 
-  free(policy_signature_buff);
-  free(policy_buff);
+  memset(g_remote_ids[g_remote_ids_num].id, 0, POLICY_LOADER_POL_ID_BUF_LEN + 1);
+  memcpy(g_remote_ids[g_remote_ids_num].id, policy_id, MIN(policy_id_len, POLICY_LOADER_POL_ID_BUF_LEN));
+  g_remote_ids_num++;
 
-  return policy_retrieved == POLICY_LOADER_POL_FULLY_RETRIEVED;
+  return 0;
 }
 
-static char g_policy_store_version[POLICY_LOADER_STR_LEN] = "0x0";
-static char g_device_id[POLICY_LOADER_STR_LEN] = "123";
+// Policy IDs are collected as they arrive, so the list size is not limited by a receive buffer
+static int policy_list_value_cb(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                                size_t value_len) {
+  if (strcmp(key, POLICY_LOADER_response) == 0) {
+    if (type == POLICYSTREAM_ARRAY_END) {
+      g_list_is_array = 1;
+    } else if (index >= 0 && type == POLICYSTREAM_STRING) {
+      return append_remote_id(value, value_len);
+    } else if (index < 0 && type == POLICYSTREAM_STRING) {
+      if (value_len == strlen("ok") && memcmp(value, "ok", strlen("ok")) == 0) {
+        log_info(policy_loader_logger_id, "[%s:%d] policy store up to date.\n", __func__, __LINE__);
+      } else {
+        log_error(policy_loader_logger_id, "[%s:%d] unkonwn response!\n", __func__, __LINE__);
+      }
+    }
+  } else if (strcmp(key, POLICY_LOADER_policy_store_id) == 0 && type == POLICYSTREAM_STRING) {
+    // Version is committed only once the whole list is in the PAP
+    memset(g_pending_store_version, 0, POLICY_LOADER_STR_LEN);
+    memcpy(g_pending_store_version, value, MIN(value_len, POLICY_LOADER_STR_LEN - 1));
+  }
 
-static int num_of_policies = 0;
+  return 0;
+}
 
 static void parse_policy_service_list() {
-  int policy_list = jsonhelper_parser_init(g_policy_list);
-
-  if (policy_list > 0) {
-    int response = jsonhelper_get_value(g_policy_list, 0, "response");
-    if (response != -1) {
-      int response_type = jsonhelper_get_token_type(response);
-      if (response_type == POLICY_LOADER_POL_RESPONSE_TYPE_ARRAY) {
-        // should resolve policyID list
-        num_of_policies = jsonhelper_array_size(POLICY_LOADER_ARRAY_TOK_IDX);
-
-        int ps_id = jsonhelper_get_value(g_policy_list, 0, "policyStoreId");
-        memcpy(g_policy_store_version, g_policy_list + jsonhelper_get_token_start(ps_id), POLICY_LOADER_STR_LEN - 1);
-        memcpy(g_policy_store_version + (POLICY_LOADER_STR_LEN - 1), "\0", 1);
-      } else if (response_type == POLICY_LOADER_POL_RESPONSE_TYPE_STRING) {
-        if (memcmp(g_policy_list + jsonhelper_get_token_start(response), "ok", strlen("ok")) == 0) {
-          log_info(policy_loader_logger_id, "[%s:%d] policy store up to date.\n", __func__, __LINE__);
-        } else {
-          log_error(policy_loader_logger_id, "[%s:%d] unkonwn response!\n", __func__, __LINE__);
-        }
-      }
-    } else {
-      char buf[POLICY_LOADER_TIME_BUF_LEN];
-
-      timemanager_get_time_string(buf, POLICY_LOADER_TIME_BUF_LEN);
-      log_error(policy_loader_logger_id, "[%s:%d] response from policy service not received.\n", __func__, __LINE__);
+  if (g_list_is_array) {
+    if (g_remote_ids_num > 0) {
+      qsort(g_remote_ids, g_remote_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
     }
-  } else {
-    log_error(policy_loader_logger_id, "[%s:%d] error during parsing.\n", __func__, __LINE__);
+    num_of_policies = g_remote_ids_num;
+    g_new_policy_list_parsed = 1;
   }
 }
 
@@ -367,45 +389,754 @@ static unsigned int fsm_get_policy_list_done(void) {
   return ret;
 }
 
+typedef struct {
+  policy_loader_id_t *id;
+  char *response;
+  size_t response_len;
+  size_t response_cap;
+  char *signed_policy;
+  size_t signed_policy_len;
+  const char *owner_public_key;
+  int status;
+} policy_loader_job_t;
+
+static void stage_account(policyloader_stage_stats_t *stage, int failed, long long busy_us, long long wait_us) {
+  pthread_mutex_lock(&g_stats_lock);
+  if (failed) {
+    stage->failed++;
+  } else {
+    stage->done++;
+  }
+  stage->busy_us += busy_us;
+  stage->wait_us += wait_us;
+  pthread_mutex_unlock(&g_stats_lock);
+}
+
+static int response_chunk_cb(void *user, const char *chunk, int chunk_len) {
+  policy_loader_job_t *job = (policy_loader_job_t *)user;
+
+  if (job->response_len + chunk_len > POLICY_LOADER_MAX_RESPONSE_LEN) {
+    return 1;
+  }
+
+  if (job->response_len + chunk_len > job->response_cap) {
+    size_t new_cap = job->response_cap == 0 ? POLICY_LOADER_MAX_LIST_VALUE_LEN : job->response_cap * 2;
+    char *response = NULL;
+
+    while (new_cap < job->response_len + chunk_len) new_cap *= 2;
+    new_cap = MIN(new_cap, POLICY_LOADER_MAX_RESPONSE_LEN);
+
+    response = realloc(job->response, new_cap);
+    if (response == NULL) {
+      return 1;
+    }
+    job->response = response;
+    job->response_cap = new_cap;
+  }
+
+  memcpy(&job->response[job->response_len], chunk, chunk_len);
+  job->response_len += chunk_len;
+
+  return 0;
+}
+
+// Fetch stage, only downloads the response so the next request can go out while it is parsed
+static int fetch_policy(policy_loader_job_t *job) {
+  if (policyupdater_get_policy_stream(job->id->id, response_chunk_cb, job) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] Failed to receive policy\n", __func__, __LINE__);
+    return 1;
+  }
+
+  return 0;
+}
+
+// Parse stage, builds the signed policy (signature followed by policy) expected by pap_add_policy
+static int parse_policy(policy_loader_job_t *job) {
+  policy_loader_policy_t policy = {0};
+  int ret = 1;
+
+  policystream_init(&policy.parser, POLICY_LOADER_MAX_POLICY_LEN, policy_value_cb, &policy);
+
+  if (policystream_feed(&policy.parser, job->response, job->response_len) != 0 ||
+      policystream_finish(&policy.parser) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] Failed to parse policy\n", __func__, __LINE__);
+  } else if (!policy.error && policy.has_signature && policy.policy != NULL) {
+    log_info(policy_loader_logger_id, "[%s:%d] Policy loaded.\n", __func__, __LINE__);
+    job->signed_policy = calloc(POLICY_LOADER_SIGNATURE_LEN + policy.policy_len + 1, 1);
+    if (job->signed_policy != NULL) {
+      job->signed_policy_len = POLICY_LOADER_SIGNATURE_LEN + policy.policy_len + 1;
+      memcpy(job->signed_policy, policy.signature, POLICY_LOADER_SIGNATURE_LEN);
+      memcpy(&job->signed_policy[POLICY_LOADER_SIGNATURE_LEN], policy.policy, policy.policy_len);
+      ret = 0;
+    }
+  }
+
+  policystream_release(&policy.parser);
+  free(policy.policy);
+  free(job->response);
+  job->response = NULL;
+
+  return ret;
+}
+
+// Verify and store stage, pap_add_policy verifies the owner's signature before the policy is stored. Only the
+// signature checks run concurrently, stores are serialized by the storage plugin.
+static void verify_and_store_task(void *arg) {
+  policy_loader_job_t *job = (policy_loader_job_t *)arg;
+  long long started = time_now_us();
+
+  if (pap_add_policy(job->signed_policy, job->signed_policy_len, NULL, (char *)job->owner_public_key) == PAP_ERROR) {
+    job->status = 1;
+  } else {
+    job->status = 0;
+  }
+
+  free(job->signed_policy);
+  job->signed_policy = NULL;
+
+  stage_account(&g_stats.verify, job->status, time_now_us() - started, 0);
+}
+
+static void parse_and_submit(policy_loader_job_t *job, long long wait_us) {
+  long long started = time_now_us();
+  long long submitted;
+
+  if (parse_policy(job) != 0) {
+    stage_account(&g_stats.parse, 1, time_now_us() - started, wait_us);
+    return;
+  }
+
+  // Blocks while the verify queue is full, which throttles the fetch stage in turn
+  submitted = time_now_us();
+  if (g_verify_pool == NULL || worker_pool_submit(g_verify_pool, verify_and_store_task, job) != 0) {
+    verify_and_store_task(job);
+  }
+
+  stage_account(&g_stats.parse, 0, submitted - started, wait_us + time_now_us() - submitted);
+}
+
+static void *parse_thread_function(void *arg) {
+  bounded_queue_t *queue = (bounded_queue_t *)arg;
+  policy_loader_job_t *job = NULL;
+
+  while (1) {
+    long long wait_started = time_now_us();
+
+    if (bounded_queue_pop(queue, &job) != 0) {
+      break;
+    }
+
+    parse_and_submit(job, time_now_us() - wait_started);
+  }
+
+  return NULL;
+}
+
+static void log_stage_stats(const char *name, policyloader_stage_stats_t *stage) {
+  log_info(policy_loader_logger_id, "[%s:%d] %s stage: %d done, %d failed, %lld ms busy, %lld ms waiting.\n", __func__,
+           __LINE__, name, stage->done, stage->failed, stage->busy_us / 1000, stage->wait_us / 1000);
+}
+
+typedef struct policy_loader_flight {
+  char id[POLICY_LOADER_POL_ID_BUF_LEN + 1];
+  int waiters;  // requests waiting for the result, and the fetch task until it is done
+  int done;
+  int status;
+  pthread_cond_t cond;
+  struct policy_loader_flight *next;
+} policy_loader_flight_t;
+
+typedef struct {
+  char id[POLICY_LOADER_POL_ID_BUF_LEN + 1];
+  long long failed_at_ms;
+} policy_loader_miss_t;
+
+// On-demand fetches in progress, at most one per policy ID and POLICY_LOADER_ON_DEMAND_MAX in total. They run on
+// their own pool, so a request waits at most g_on_demand_wait_ms for the policy store.
+static policy_loader_flight_t *g_flights = NULL;
+static int g_flights_num = 0;
+static worker_pool_t *g_fetch_pool = NULL;
+static int g_on_demand_wait_ms = POLICY_LOADER_ON_DEMAND_WAIT_MS;
+// Recent failed on-demand fetches, so requests for unknown IDs do not all reach the policy store
+static policy_loader_miss_t g_misses[POLICY_LOADER_MISS_CACHE_LEN];
+static int g_misses_next = 0;
+// Policies installed on demand, handed over to the loader thread at the next sync
+static policy_loader_id_t *g_on_demand_ids = NULL;
+static int g_on_demand_ids_num = 0;
+// Policies the PAP lost after they were installed, removed from the local set by the loader thread
+static policy_loader_id_t *g_forgotten_ids = NULL;
+static int g_forgotten_ids_num = 0;
+static int g_forgotten_refetch = 0;
+// Sorted IDs of policies the PAP evicted after they expired, they are never fetched again
+static policy_loader_id_t *g_expired_ids = NULL;
+static int g_expired_ids_num = 0;
+static pthread_mutex_t g_flights_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int is_hex_policy_id(const char *policy_id) {
+  for (int i = 0; i < POLICY_LOADER_POL_ID_BUF_LEN; i++) {
+    char c = policy_id[i];
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) return FALSE;
+  }
+
+  return TRUE;
+}
+
+// Must be called with g_flights_lock held
+static int recently_missed(const char *policy_id) {
+  long long now = time_now_ms();
+
+  for (int i = 0; i < POLICY_LOADER_MISS_CACHE_LEN; i++) {
+    if (g_misses[i].failed_at_ms != 0 && now - g_misses[i].failed_at_ms < POLICY_LOADER_MISS_TTL_MS &&
+        memcmp(g_misses[i].id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static int install_policy(const char *policy_id) {
+  char owner_public_key[POLICY_LOADER_PUBLIC_KEY_LEN] = {0};
+  policy_loader_id_t id = {0};
+  policy_loader_job_t job = {0};
+  int ret = 1;
+
+  if (base64_decode(g_owner_public_key, POLICY_LOADER_PUBLIC_KEY_B64_LEN, (unsigned char *)owner_public_key,
+                    POLICY_LOADER_PUBLIC_KEY_LEN, NULL) != 0) {
+    return 1;
+  }
+
+  memcpy(id.id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN);
+  job.id = &id;
+
+  if (fetch_policy(&job) == 0 && parse_policy(&job) == 0 &&
+      pap_add_policy(job.signed_policy, job.signed_policy_len, NULL, owner_public_key) != PAP_ERROR) {
+    ret = 0;
+  }
+
+  free(job.response);
+  free(job.signed_policy);
+
+  return ret;
+}
+
+// Must be called with g_flights_lock held
+static void flight_release(policy_loader_flight_t *flight) {
+  if (--flight->waiters == 0) {
+    pthread_cond_destroy(&flight->cond);
+    free(flight);
+  }
+}
+
+static void fetch_policy_task(void *arg) {
+  policy_loader_flight_t *flight = (policy_loader_flight_t *)arg;
+  int status;
+
+  log_info(policy_loader_logger_id, "[%s:%d] fetching policy %s on demand.\n", __func__, __LINE__, flight->id);
+  status = install_policy(flight->id);
+
+  pthread_mutex_lock(&g_flights_lock);
+  for (policy_loader_flight_t **p = &g_flights; *p != NULL; p = &(*p)->next) {
+    if (*p == flight) {
+      *p = flight->next;
+      break;
+    }
+  }
+  g_flights_num--;
+
+  if (status == 0) {
+    policy_loader_id_t *ids = realloc(g_on_demand_ids, (g_on_demand_ids_num + 1) * sizeof(policy_loader_id_t));
+    if (ids != NULL) {
+      g_on_demand_ids = ids;
+      memcpy(&g_on_demand_ids[g_on_demand_ids_num++], flight->id, sizeof(policy_loader_id_t));
+    }
+  } else {
+    memcpy(g_misses[g_misses_next].id, flight->id, POLICY_LOADER_POL_ID_BUF_LEN + 1);
+    g_misses[g_misses_next].failed_at_ms = time_now_ms();
+    g_misses_next = (g_misses_next + 1) % POLICY_LOADER_MISS_CACHE_LEN;
+  }
+
+  flight->status = status;
+  flight->done = 1;
+  pthread_cond_broadcast(&flight->cond);
+  flight_release(flight);
+  pthread_mutex_unlock(&g_flights_lock);
+}
+
+int policyloader_fetch_policy(const char *policy_id) {
+  policy_loader_flight_t *flight = NULL;
+  struct timespec deadline;
+  int status = 1;
+
+  if (policy_id == NULL || strlen(policy_id) < POLICY_LOADER_POL_ID_BUF_LEN || !is_hex_policy_id(policy_id)) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_flights_lock);
+
+  if (recently_missed(policy_id) || find_policy_id(policy_id, g_expired_ids, g_expired_ids_num)) {
+    pthread_mutex_unlock(&g_flights_lock);
+    return 1;
+  }
+
+  for (flight = g_flights; flight != NULL; flight = flight->next) {
+    if (memcmp(flight->id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN) == 0) break;
+  }
+
+  if (flight == NULL) {
+    // Requests beyond the limit are decided without the policy, it arrives with the next sync
+    if (g_fetch_pool == NULL || g_flights_num >= POLICY_LOADER_ON_DEMAND_MAX) {
+      pthread_mutex_unlock(&g_flights_lock);
+      return 1;
+    }
+
+    flight = calloc(1, sizeof(policy_loader_flight_t));
+    if (flight == NULL) {
+      pthread_mutex_unlock(&g_flights_lock);
+      return 1;
+    }
+    memcpy(flight->id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN);
+    pthread_cond_init(&flight->cond, NULL);
+
+    // The queue holds POLICY_LOADER_ON_DEMAND_MAX tasks, so submitting does not block
+    flight->waiters = 1;
+    if (worker_pool_submit(g_fetch_pool, fetch_policy_task, flight) != 0) {
+      pthread_cond_destroy(&flight->cond);
+      free(flight);
+      pthread_mutex_unlock(&g_flights_lock);
+      return 1;
+    }
+    flight->next = g_flights;
+    g_flights = flight;
+    g_flights_num++;
+  }
+
+  // Wait for the result only briefly, the fetch goes on for later requests
+  flight->waiters++;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += g_on_demand_wait_ms / 1000;
+  deadline.tv_nsec += (long)(g_on_demand_wait_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (!flight->done) {
+    if (pthread_cond_timedwait(&flight->cond, &g_flights_lock, &deadline) != 0) break;
+  }
+
+  status = flight->done ? flight->status : 1;
+  flight_release(flight);
+  pthread_mutex_unlock(&g_flights_lock);
+
+  return status;
+}
+
+static void remove_policy_id(const char *policy_id, policy_loader_id_t *ids, int *ids_num) {
+  for (int i = 0; i < *ids_num; i++) {
+    if (memcmp(ids[i].id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN) == 0) {
+      memmove(&ids[i], &ids[i + 1], (*ids_num - i - 1) * sizeof(policy_loader_id_t));
+      (*ids_num)--;
+      return;
+    }
+  }
+}
+
+int policyloader_forget_policy(const char *policy_id) {
+  policy_loader_id_t *ids = NULL;
+
+  if (policy_id == NULL || strlen(policy_id) < POLICY_LOADER_POL_ID_BUF_LEN || !is_hex_policy_id(policy_id)) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_flights_lock);
+  ids = realloc(g_forgotten_ids, (g_forgotten_ids_num + 1) * sizeof(policy_loader_id_t));
+  if (ids == NULL) {
+    pthread_mutex_unlock(&g_flights_lock);
+    return 1;
+  }
+  g_forgotten_ids = ids;
+  memset(&g_forgotten_ids[g_forgotten_ids_num], 0, sizeof(policy_loader_id_t));
+  memcpy(g_forgotten_ids[g_forgotten_ids_num++].id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN);
+  g_forgotten_refetch = 1;
+  remove_policy_id(policy_id, g_on_demand_ids, &g_on_demand_ids_num);
+
+  // Saved right away, a restart before the next sync must not trust the lost policy to be held
+  if (checkpoint_remove_policy(policy_id, TRUE) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] could not save checkpoint.\n", __func__, __LINE__);
+  }
+  pthread_mutex_unlock(&g_flights_lock);
+
+  log_info(policy_loader_logger_id, "[%s:%d] policy %.*s lost by the PAP.\n", __func__, __LINE__,
+           POLICY_LOADER_POL_ID_BUF_LEN, policy_id);
+
+  return 0;
+}
+
+int policyloader_expire_policy(const char *policy_id) {
+  policy_loader_id_t *ids = NULL;
+
+  if (policy_id == NULL || strlen(policy_id) < POLICY_LOADER_POL_ID_BUF_LEN || !is_hex_policy_id(policy_id)) {
+    return 1;
+  }
+
+  pthread_mutex_lock(&g_flights_lock);
+  if (!find_policy_id(policy_id, g_expired_ids, g_expired_ids_num)) {
+    ids = realloc(g_expired_ids, (g_expired_ids_num + 1) * sizeof(policy_loader_id_t));
+    if (ids == NULL) {
+      pthread_mutex_unlock(&g_flights_lock);
+      return 1;
+    }
+    g_expired_ids = ids;
+    memset(&g_expired_ids[g_expired_ids_num], 0, sizeof(policy_loader_id_t));
+    memcpy(g_expired_ids[g_expired_ids_num++].id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN);
+    qsort(g_expired_ids, g_expired_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
+  }
+
+  ids = realloc(g_forgotten_ids, (g_forgotten_ids_num + 1) * sizeof(policy_loader_id_t));
+  if (ids != NULL) {
+    g_forgotten_ids = ids;
+    memset(&g_forgotten_ids[g_forgotten_ids_num], 0, sizeof(policy_loader_id_t));
+    memcpy(g_forgotten_ids[g_forgotten_ids_num++].id, policy_id, POLICY_LOADER_POL_ID_BUF_LEN);
+  }
+  remove_policy_id(policy_id, g_on_demand_ids, &g_on_demand_ids_num);
+
+  if (checkpoint_expire_policy(policy_id) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] could not save checkpoint.\n", __func__, __LINE__);
+  }
+  pthread_mutex_unlock(&g_flights_lock);
+
+  log_info(policy_loader_logger_id, "[%s:%d] policy %.*s expired.\n", __func__, __LINE__, POLICY_LOADER_POL_ID_BUF_LEN,
+           policy_id);
+
+  return 0;
+}
+
+static int is_expired(const char *policy_id) {
+  int expired;
+
+  pthread_mutex_lock(&g_flights_lock);
+  expired = find_policy_id(policy_id, g_expired_ids, g_expired_ids_num);
+  pthread_mutex_unlock(&g_flights_lock);
+
+  return expired;
+}
+
+// Expired policies which left the policy list can not come back, they are no longer tracked
+static void prune_expired_ids(void) {
+  int kept = 0;
+
+  pthread_mutex_lock(&g_flights_lock);
+  for (int i = 0; i < g_expired_ids_num; i++) {
+    if (find_policy_id(g_expired_ids[i].id, g_remote_ids, g_remote_ids_num)) {
+      memmove(&g_expired_ids[kept++], &g_expired_ids[i], sizeof(policy_loader_id_t));
+    }
+  }
+  if (kept != g_expired_ids_num) {
+    g_expired_ids_num = kept;
+    if (checkpoint_set_expired_policies((const char *)g_expired_ids, g_expired_ids_num) != 0) {
+      log_error(policy_loader_logger_id, "[%s:%d] could not save checkpoint.\n", __func__, __LINE__);
+    }
+  }
+  pthread_mutex_unlock(&g_flights_lock);
+}
+
+// Drop forgotten policies from the local set, so the next sync fetches them again. Must be called from the loader
+// thread with g_flights_lock held.
+static void apply_forgotten_ids(void) {
+  for (int i = 0; i < g_forgotten_ids_num; i++) {
+    remove_policy_id(g_forgotten_ids[i].id, g_local_ids, &g_local_ids_num);
+  }
+  if (g_forgotten_refetch) {
+    strcpy(g_policy_store_version, "0x0");
+  }
+  free(g_forgotten_ids);
+  g_forgotten_ids = NULL;
+  g_forgotten_ids_num = 0;
+  g_forgotten_refetch = 0;
+}
+
+// Track policies installed on demand like synced ones, so they are removed once they leave the policy list.
+// Policies the PAP lost since the last sync are dropped, so they are fetched again.
+static void merge_on_demand_ids(void) {
+  policy_loader_id_t *ids = NULL;
+  int added = 0;
+
+  pthread_mutex_lock(&g_flights_lock);
+  if (g_on_demand_ids_num > 0) {
+    ids = realloc(g_local_ids, (g_local_ids_num + g_on_demand_ids_num) * sizeof(policy_loader_id_t));
+  }
+  if (ids != NULL) {
+    g_local_ids = ids;
+    for (int i = 0; i < g_on_demand_ids_num; i++) {
+      if (!find_policy_id(g_on_demand_ids[i].id, g_local_ids, g_local_ids_num)) {
+        memcpy(&g_local_ids[g_local_ids_num + added++], &g_on_demand_ids[i], sizeof(policy_loader_id_t));
+      }
+    }
+    g_local_ids_num += added;
+    qsort(g_local_ids, g_local_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
+    free(g_on_demand_ids);
+    g_on_demand_ids = NULL;
+    g_on_demand_ids_num = 0;
+  }
+  apply_forgotten_ids();
+  pthread_mutex_unlock(&g_flights_lock);
+}
+
+// Missing policies go through a pipeline of fetch (this thread), parse (own thread) and verify/store (worker pool)
+// stages connected by bounded queues, so network waits, parsing and signature checks overlap
 static unsigned int receive_policies(void) {
   unsigned int ret = POLICY_LOADER_ERROR;
   char owner_public_key[POLICY_LOADER_PUBLIC_KEY_LEN] = {0};
-  char *policy_buff = NULL;
-  int policy_len = 0;
-  int status = 0;
+  policy_loader_id_t *held_ids = NULL;
+  policy_loader_job_t *jobs = NULL;
+  bounded_queue_t parse_queue;
+  pthread_t parse_thread;
+  int parse_threaded = 0;
+  int jobs_num = 0;
+  int held_ids_num = 0;
+  int fetched = 0;
+  int failed = 0;
+  int removed = 0;
+
+  if (!g_new_policy_list_parsed) {
+    return ret;
+  }
+  g_new_policy_list_parsed = 0;
 
-  while (num_of_policies > 0) {
-    int current_policy = num_of_policies - 1;
+  if (base64_decode(g_owner_public_key, POLICY_LOADER_PUBLIC_KEY_B64_LEN, (unsigned char *)owner_public_key,
+                    POLICY_LOADER_PUBLIC_KEY_LEN, NULL) != 0)
+    return ret;
 
-    policyupdater_get_policy(g_policy_list + jsonhelper_get_token_start(3 + current_policy), g_policy);
-    int status = parse_policy_struct(g_policy, &policy_buff, &policy_len);
-    if (status == 1) {
-      if (!b64_decode(g_owner_public_key, POLICY_LOADER_PUBLIC_KEY_B64_LEN, owner_public_key,
-                      POLICY_LOADER_PUBLIC_KEY_LEN))
-        return 0;
-      pap_add_policy(policy_buff, policy_len, NULL, owner_public_key);
+  jobs = calloc(g_remote_ids_num > 0 ? g_remote_ids_num : 1, sizeof(policy_loader_job_t));
+  if (g_remote_ids_num > 0) {
+    held_ids = malloc(g_remote_ids_num * sizeof(policy_loader_id_t));
+  }
+  if (jobs == NULL || (g_remote_ids_num > 0 && held_ids == NULL)) {
+    log_error(policy_loader_logger_id, "[%s:%d] could not allocate policy ID list.\n", __func__, __LINE__);
+    free(jobs);
+    free(held_ids);
+    return ret;
+  }
+
+  merge_on_demand_ids();
+  prune_expired_ids();
+
+  // Flush policies which disappeared from the list
+  for (int i = 0; i < g_local_ids_num; i++) {
+    if (!find_policy_id(g_local_ids[i].id, g_remote_ids, g_remote_ids_num)) {
+      pap_remove_policy(g_local_ids[i].id, POLICY_LOADER_POL_ID_BUF_LEN);
+      removed++;
     }
-    if (policy_buff != NULL) {
-      free(policy_buff);
+  }
+
+  pthread_mutex_lock(&g_stats_lock);
+  memset(&g_stats.fetch, 0, sizeof(g_stats.fetch));
+  memset(&g_stats.parse, 0, sizeof(g_stats.parse));
+  memset(&g_stats.verify, 0, sizeof(g_stats.verify));
+  pthread_mutex_unlock(&g_stats_lock);
+
+  if (bounded_queue_init(&parse_queue, POLICY_LOADER_PARSE_QUEUE_LEN, sizeof(policy_loader_job_t *)) == 0) {
+    if (pthread_create(&parse_thread, NULL, parse_thread_function, &parse_queue) == 0) {
+      parse_threaded = 1;
+    } else {
+      bounded_queue_destroy(&parse_queue);
     }
+  }
 
-    num_of_policies -= 1;
+  // Fetch only policies the PAP does not already hold
+  for (int i = 0; i < g_remote_ids_num; i++) {
+    char *policy_id = g_remote_ids[i].id;
+    policy_loader_job_t *job = NULL;
+    long long started, fetched_at;
 
-    ret = POLICY_LOADER_GET_PSS;
+    if (find_policy_id(policy_id, g_local_ids, g_local_ids_num) ||
+        pap_has_policy(policy_id, POLICY_LOADER_POL_ID_BUF_LEN)) {
+      memcpy(&held_ids[held_ids_num++], &g_remote_ids[i], sizeof(policy_loader_id_t));
+      continue;
+    }
+    if (is_expired(policy_id)) {
+      continue;
+    }
+
+    job = &jobs[jobs_num++];
+    job->id = &g_remote_ids[i];
+    job->owner_public_key = owner_public_key;
+    job->status = 1;
+
+    started = time_now_us();
+    if (g_end || fetch_policy(job) != 0) {
+      stage_account(&g_stats.fetch, 1, time_now_us() - started, 0);
+      continue;
+    }
+
+    fetched_at = time_now_us();
+    if (!parse_threaded || bounded_queue_push(&parse_queue, &job) != 0) {
+      parse_and_submit(job, 0);
+    }
+    stage_account(&g_stats.fetch, 0, fetched_at - started, time_now_us() - fetched_at);
+  }
+
+  if (parse_threaded) {
+    bounded_queue_close(&parse_queue);
+    pthread_join(parse_thread, NULL);
+    bounded_queue_destroy(&parse_queue);
   }
+  worker_pool_wait(g_verify_pool);
+
+  for (int i = 0; i < jobs_num; i++) {
+    if (jobs[i].status == 0) {
+      memcpy(&held_ids[held_ids_num++], jobs[i].id, sizeof(policy_loader_id_t));
+      fetched++;
+    } else {
+      failed++;
+    }
+    free(jobs[i].response);
+    free(jobs[i].signed_policy);
+  }
+  free(jobs);
+
+  if (held_ids_num > 0) {
+    qsort(held_ids, held_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
+  }
+  free(g_local_ids);
+  g_local_ids = held_ids;
+  g_local_ids_num = held_ids_num;
+  num_of_policies = 0;
+
+  // Keep the old version on failure, so the list is requested again in the next cycle
+  if (failed == 0) {
+    memcpy(g_policy_store_version, g_pending_store_version, POLICY_LOADER_STR_LEN);
+  }
+
+  // Policies lost during the sync are left out, they are already removed from the saved state. The checkpoint is
+  // only rewritten if policies were fetched or removed or the store version changed.
+  pthread_mutex_lock(&g_flights_lock);
+  apply_forgotten_ids();
+  if (checkpoint_set_policy_state(g_policy_store_version, (const char *)g_local_ids, g_local_ids_num) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] could not save checkpoint.\n", __func__, __LINE__);
+  }
+  pthread_mutex_unlock(&g_flights_lock);
+
+  log_info(policy_loader_logger_id, "[%s:%d] policy sync: %d fetched, %d removed, %d failed.\n", __func__, __LINE__,
+           fetched, removed, failed);
+  pthread_mutex_lock(&g_stats_lock);
+  if (jobs_num > 0) {
+    log_stage_stats("fetch", &g_stats.fetch);
+    log_stage_stats("parse", &g_stats.parse);
+    log_stage_stats("verify", &g_stats.verify);
+  }
+  g_stats.syncs++;
+  g_stats.policies = g_local_ids_num;
+  g_stats.in_sync = failed == 0;
+  pthread_mutex_unlock(&g_stats_lock);
+
+  ret = POLICY_LOADER_GET_PSS;
+
   return ret;
 }
 
+static int g_validate_restored_ids = 0;
+
+// Resume from the state of the last run, so the first list request only returns changes
+static void restore_checkpoint(void) {
+  char *ids = NULL;
+  int ids_num = 0;
+
+  if (checkpoint_get_expired_policies(&ids, &ids_num) == 0) {
+    pthread_mutex_lock(&g_flights_lock);
+    free(g_expired_ids);
+    g_expired_ids = (policy_loader_id_t *)ids;
+    g_expired_ids_num = ids_num;
+    if (g_expired_ids_num > 0) {
+      qsort(g_expired_ids, g_expired_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
+    }
+    pthread_mutex_unlock(&g_flights_lock);
+  }
+
+  if (checkpoint_get_policy_state(g_policy_store_version, &ids, &ids_num) != 0) {
+    return;
+  }
+
+  free(g_local_ids);
+  g_local_ids = (policy_loader_id_t *)ids;
+  g_local_ids_num = ids_num;
+  if (g_local_ids_num > 0) {
+    qsort(g_local_ids, g_local_ids_num, sizeof(policy_loader_id_t), compare_policy_ids);
+  }
+  g_validate_restored_ids = ids_num > 0;
+
+  log_info(policy_loader_logger_id, "[%s:%d] resuming from policy store version %s with %d policies.\n", __func__,
+           __LINE__, g_policy_store_version, g_local_ids_num);
+}
+
+// Restored policies may be gone if the PAP storage was wiped, fall back to a full sync in that case. Policies the
+// PAP evicted after they expired are expected to be gone.
+static void validate_restored_ids(void) {
+  int held_ids_num = 0;
+  int missing = 0;
+
+  for (int i = 0; i < g_local_ids_num; i++) {
+    if (pap_has_policy(g_local_ids[i].id, POLICY_LOADER_POL_ID_BUF_LEN)) {
+      memmove(&g_local_ids[held_ids_num++], &g_local_ids[i], sizeof(policy_loader_id_t));
+    } else if (!is_expired(g_local_ids[i].id)) {
+      missing++;
+    }
+  }
+  g_local_ids_num = held_ids_num;
+
+  if (missing > 0) {
+    log_info(policy_loader_logger_id, "[%s:%d] %d restored policies missing, requesting full policy list.\n", __func__,
+             __LINE__, missing);
+    strcpy(g_policy_store_version, "0x0");
+  }
+  g_validate_restored_ids = 0;
+}
+
 static unsigned int fsm_init(void) {
   unsigned int ret = POLICY_LOADER_ERROR;
 
-  // TODO: Initialize all
+  if (g_validate_restored_ids) {
+    validate_restored_ids();
+  }
 
   ret = POLICY_LOADER_GET_PL;
 
   return ret;
 }
 
+static void request_policy_list(void) {
+  long long started = time_now_ms();
+  policystream_t parser;
+  int status = 0;
+
+  g_remote_ids_num = 0;
+  g_list_is_array = 0;
+  policystream_init(&parser, POLICY_LOADER_MAX_LIST_VALUE_LEN, policy_list_value_cb, NULL);
+
+  status = policyupdater_wait_policy_list_stream(g_policy_store_version, g_device_id, g_long_poll_s, parser_chunk_cb,
+                                                 &parser);
+  if (status == 0 && policystream_finish(&parser) != 0) {
+    log_error(policy_loader_logger_id, "[%s:%d] error during parsing.\n", __func__, __LINE__);
+    status = 1;
+  }
+  policystream_release(&parser);
+
+  g_new_policy_list = status == 0;
+
+  if (status != 0) {
+    // Exponential backoff with jitter, so devices do not retry in lockstep after a store outage
+    g_backoff_ms = g_backoff_ms == 0 ? g_backoff_min_ms : MIN(g_backoff_ms * 2, g_backoff_max_ms);
+    g_next_request_delay_ms = g_backoff_ms / 2 + rand() % (g_backoff_ms / 2 + 1);
+    log_error(policy_loader_logger_id, "[%s:%d] policy list request failed, retry in %d ms.\n", __func__, __LINE__,
+              g_next_request_delay_ms);
+  } else {
+    // A held long-poll is re-issued right away, a store without long-poll support is polled once per period
+    long long elapsed = time_now_ms() - started;
+    g_backoff_ms = 0;
+    g_next_request_delay_ms = elapsed < POLICY_LOADER_POLL_PERIOD_MS ? POLICY_LOADER_POLL_PERIOD_MS - elapsed : 0;
+  }
+}
+
 static unsigned int g_policy_updater_fsm_state = POLICY_LOADER_INIT;
 
 static int cycle_fsm() {
@@ -413,8 +1144,10 @@ static int cycle_fsm() {
 
   switch (g_policy_updater_fsm_state) {
     case POLICY_LOADER_GET_PL:
-      policyupdater_get_policy_list(g_policy_store_version, g_device_id, g_policy_list, &g_policy_list_len,
-                                    &g_new_policy_list);
+      pthread_mutex_lock(&g_flights_lock);
+      apply_forgotten_ids();
+      pthread_mutex_unlock(&g_flights_lock);
+      request_policy_list();
       next_state = POLICY_LOADER_GET_PL_DONE;
       break;
     case POLICY_LOADER_GET_PL_DONE:
@@ -436,35 +1169,84 @@ static int cycle_fsm() {
 static void *policy_loader_thread_function(void *arg);
 
 int policyloader_start() {
+  logger_helper_init(LOGGER_INFO);
+  logger_init_policy_loader(LOGGER_INFO);
+
   config_manager_get_option_string("config", "device_id", g_device_id, POLICY_LOADER_STR_LEN);
   int status = config_manager_get_option_int("config", "thread_sleep_period", &g_task_sleep_time);
   if (status != CONFIG_MANAGER_OK) g_task_sleep_time = 1000;  // 1 second
   // Owner's public key should be stored on device, after owner is assigned to a device
   config_manager_get_option_string("config", "owner_public_key", g_owner_public_key,
                                    POLICY_LOADER_PUBLIC_KEY_B64_LEN + 1);
+  if (config_manager_get_option_int("pap", "long_poll_timeout", &g_long_poll_s) != CONFIG_MANAGER_OK)
+    g_long_poll_s = POLICY_LOADER_LONG_POLL_S;
+  if (config_manager_get_option_int("pap", "backoff_min_ms", &g_backoff_min_ms) != CONFIG_MANAGER_OK)
+    g_backoff_min_ms = POLICY_LOADER_BACKOFF_MIN_MS;
+  if (config_manager_get_option_int("pap", "backoff_max_ms", &g_backoff_max_ms) != CONFIG_MANAGER_OK)
+    g_backoff_max_ms = POLICY_LOADER_BACKOFF_MAX_MS;
+  if (g_backoff_min_ms < 2) g_backoff_min_ms = 2;
+  if (g_backoff_max_ms < g_backoff_min_ms) g_backoff_max_ms = g_backoff_min_ms;
+
+  srand(time(NULL) ^ getpid());
+
+  int verify_workers = 0;
+  if (config_manager_get_option_int("pap", "verify_workers", &verify_workers) != CONFIG_MANAGER_OK)
+    verify_workers = 0;  // One per CPU
+  g_verify_pool = worker_pool_create(verify_workers, POLICY_LOADER_VERIFY_QUEUE_LEN);
+
+  if (config_manager_get_option_int("pap", "on_demand_wait_ms", &g_on_demand_wait_ms) != CONFIG_MANAGER_OK ||
+      g_on_demand_wait_ms < 0)
+    g_on_demand_wait_ms = POLICY_LOADER_ON_DEMAND_WAIT_MS;
+  pthread_mutex_lock(&g_flights_lock);
+  g_fetch_pool = worker_pool_create(POLICY_LOADER_ON_DEMAND_WORKERS, POLICY_LOADER_ON_DEMAND_MAX);
+  pthread_mutex_unlock(&g_flights_lock);
+
+  restore_checkpoint();
+  // The loader owns the policy updater configuration, the proxy started after it shares it
+  policyupdater_init();
 
   g_end = 0;
   pthread_create(&g_thread, NULL, policy_loader_thread_function, NULL);
 
-  logger_helper_init(LOGGER_INFO);
-  logger_init_policy_loader(LOGGER_INFO);
-
   return 0;
 }
 
 int policyloader_stop() {
   g_end = 1;
+  policyupdater_abort();
   pthread_join(g_thread, NULL);
+  worker_pool_destroy(&g_verify_pool);
+
+  // No new on-demand fetches, the ones in progress were aborted with the other requests
+  pthread_mutex_lock(&g_flights_lock);
+  worker_pool_t *fetch_pool = g_fetch_pool;
+  g_fetch_pool = NULL;
+  pthread_mutex_unlock(&g_flights_lock);
+  worker_pool_destroy(&fetch_pool);
   return 0;
 }
 
+static void sleep_ms(int delay_ms) {
+  long long wake_up = time_now_ms() + delay_ms;
+
+  while (!g_end && time_now_ms() < wake_up) {
+    usleep(g_task_sleep_time);
+  }
+}
+
 static void *policy_loader_thread_function(void *arg) {
-  int period_counter = 0;
   while (!g_end) {
-    if (period_counter++ == (5000000 / g_task_sleep_time) || (5000000 / g_task_sleep_time) == 0) {  // 5 seconds
-      period_counter = 0;
-      cycle_fsm();
+    cycle_fsm();
+    if (g_policy_updater_fsm_state == POLICY_LOADER_GET_PL) {
+      sleep_ms(g_next_request_delay_ms);
     }
-    usleep(g_task_sleep_time);
   }
+
+  return NULL;
+}
+
+void policyloader_get_stats(policyloader_stats_t *stats) {
+  pthread_mutex_lock(&g_stats_lock);
+  memcpy(stats, &g_stats, sizeof(policyloader_stats_t));
+  pthread_mutex_unlock(&g_stats_lock);
 }
@@ -20,7 +20,66 @@
 #ifndef _POLICY_LOADER_H_
 #define _POLICY_LOADER_H_
 
+typedef struct {
+  int done;           /*!< items passed on to the next stage */
+  int failed;         /*!< items dropped by this stage */
+  long long busy_us;  /*!< time spent working on items */
+  long long wait_us;  /*!< time spent waiting for the neighbouring stages */
+} policyloader_stage_stats_t;
+
+typedef struct {
+  policyloader_stage_stats_t fetch;
+  policyloader_stage_stats_t parse;
+  policyloader_stage_stats_t verify; /*!< busy time is summed over all verify workers */
+  int syncs;                         /*!< completed sync rounds */
+  int policies;                      /*!< policies held after the last sync */
+  int in_sync;                       /*!< last sync installed every listed policy */
+} policyloader_stats_t;
+
 int policyloader_start();
 int policyloader_stop();
 
+/**
+ * @brief Fetch a policy missing from the PAP right away, instead of waiting for the next sync
+ *
+ * The fetch runs in the background and the caller waits for it at most on_demand_wait_ms
+ * (200 ms by default). A fetch still running after that installs the policy for later
+ * requests. Concurrent calls for the same policy share a single request to the policy store,
+ * and at most 8 policies are fetched at once. Policies which could not be fetched are not
+ * requested again for 30 seconds, expired ones never.
+ *
+ * @param[in] policy_id Policy ID, 64 hex characters
+ *
+ * @return 0 if the policy was installed in the PAP within the wait, 1 otherwise
+ */
+int policyloader_fetch_policy(const char *policy_id);
+
+/**
+ * @brief Forget a policy the PAP lost after it was installed, so the next sync fetches it again
+ *
+ * Safe to call from any thread, the policy is removed from the saved sync state right away.
+ *
+ * @param[in] policy_id Policy ID, 64 hex characters
+ *
+ * @return 0 on success, 1 otherwise
+ */
+int policyloader_forget_policy(const char *policy_id);
+
+/**
+ * @brief Forget a policy the PAP evicted after it expired, it is never fetched again
+ *
+ * Safe to call from any thread, the policy is moved to the expired policies of the saved sync
+ * state right away. It stays there while the policy store lists it.
+ *
+ * @param[in] policy_id Policy ID, 64 hex characters
+ *
+ * @return 0 on success, 1 otherwise
+ */
+int policyloader_expire_policy(const char *policy_id);
+
+/**
+ * @brief Get ingestion pipeline statistics of the last policy sync
+ */
+void policyloader_get_stats(policyloader_stats_t *stats);
+
 #endif
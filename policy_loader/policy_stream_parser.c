@@ -0,0 +1,382 @@
+/*
+ * This file is part of the IOTA Access distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_stream_parser.c
+ * \brief
+ * Incremental parser for policy store responses
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_stream_parser.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POLICYSTREAM_VALUE_INIT_LEN 256
+
+/* POLICYSTREAM_STATES */
+#define POLICYSTREAM_START (0)
+#define POLICYSTREAM_KEY_OR_END (1)
+#define POLICYSTREAM_KEY (2)
+#define POLICYSTREAM_COLON (3)
+#define POLICYSTREAM_VALUE (4)
+#define POLICYSTREAM_STRING_VALUE (5)
+#define POLICYSTREAM_PRIMITIVE_VALUE (6)
+#define POLICYSTREAM_RAW_VALUE (7)
+#define POLICYSTREAM_ELEMENT (8)
+#define POLICYSTREAM_AFTER_VALUE (9)
+#define POLICYSTREAM_DONE (10)
+#define POLICYSTREAM_NEXT_KEY (11)
+#define POLICYSTREAM_FIRST_ELEMENT (12)
+
+#define POLICYSTREAM_IS_WHITESPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+static int append_value(policystream_t *ps, char c) {
+  if (ps->value_len == ps->value_cap) {
+    size_t new_cap = ps->value_cap == 0 ? POLICYSTREAM_VALUE_INIT_LEN : ps->value_cap * 2;
+    char *new_value = NULL;
+
+    if (new_cap > ps->value_max) new_cap = ps->value_max;
+    if (new_cap <= ps->value_len) {
+      return 1;  // Value exceeds the limit
+    }
+
+    new_value = realloc(ps->value, new_cap);
+    if (new_value == NULL) {
+      return 1;
+    }
+    ps->value = new_value;
+    ps->value_cap = new_cap;
+  }
+
+  ps->value[ps->value_len++] = c;
+
+  return 0;
+}
+
+// Track a character of a string, returns -1 on an invalid character, 1 on the closing quote and 0 otherwise
+static int string_char(policystream_t *ps, char c) {
+  if (ps->hex_left > 0) {
+    if (!isxdigit((unsigned char)c)) {
+      return -1;
+    }
+    ps->hex_left--;
+  } else if (ps->escape) {
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        break;
+      case 'u':
+        ps->hex_left = 4;
+        break;
+      default:
+        return -1;
+    }
+    ps->escape = 0;
+  } else if (c == '\\') {
+    ps->escape = 1;
+  } else if (c == '"') {
+    return 1;
+  } else if ((unsigned char)c < 0x20) {
+    return -1;  // Control characters must be escaped
+  }
+
+  return 0;
+}
+
+static int is_primitive_start(char c) {
+  return c == 't' || c == 'f' || c == 'n' || c == '-' || isdigit((unsigned char)c);
+}
+
+static size_t skip_digits(const char *value, size_t len, size_t i) {
+  while (i < len && isdigit((unsigned char)value[i])) i++;
+
+  return i;
+}
+
+// Check a primitive against the JSON literals and number grammar
+static int is_valid_primitive(const char *value, size_t len) {
+  size_t i = 0, digits = 0;
+
+  if ((len == 4 && memcmp(value, "true", 4) == 0) || (len == 5 && memcmp(value, "false", 5) == 0) ||
+      (len == 4 && memcmp(value, "null", 4) == 0)) {
+    return 1;
+  }
+
+  if (i < len && value[i] == '-') i++;
+  if (i < len && value[i] == '0') {
+    i++;
+  } else if (i < len && value[i] >= '1' && value[i] <= '9') {
+    i = skip_digits(value, len, i);
+  } else {
+    return 0;
+  }
+
+  if (i < len && value[i] == '.') {
+    digits = ++i;
+    i = skip_digits(value, len, i);
+    if (i == digits) return 0;
+  }
+
+  if (i < len && (value[i] == 'e' || value[i] == 'E')) {
+    i++;
+    if (i < len && (value[i] == '+' || value[i] == '-')) i++;
+    digits = i;
+    i = skip_digits(value, len, i);
+    if (i == digits) return 0;
+  }
+
+  return i == len;
+}
+
+static int emit_value(policystream_t *ps, policystream_type_e type) {
+  int index = ps->return_state == POLICYSTREAM_ELEMENT ? ps->index++ : -1;
+  int ret = ps->cb(ps->user, ps->key, index, type, ps->value, ps->value_len);
+
+  ps->value_len = 0;
+  ps->state = POLICYSTREAM_AFTER_VALUE;
+
+  return ret;
+}
+
+// Start a value, which is either a member of the top-level object or an element of its array
+static int start_value(policystream_t *ps, char c) {
+  ps->value_len = 0;
+  ps->escape = 0;
+  ps->hex_left = 0;
+
+  if (c == '"') {
+    ps->state = POLICYSTREAM_STRING_VALUE;
+  } else if (c == '{' || c == '[') {
+    ps->state = POLICYSTREAM_RAW_VALUE;
+    ps->raw_depth = 1;
+    ps->in_string = 0;
+    return append_value(ps, c);
+  } else if (is_primitive_start(c)) {
+    ps->state = POLICYSTREAM_PRIMITIVE_VALUE;
+    return append_value(ps, c);
+  } else {
+    return 1;  // Also rejects empty elements and members
+  }
+
+  return 0;
+}
+
+static void start_key(policystream_t *ps) {
+  ps->key_len = 0;
+  ps->escape = 0;
+  ps->hex_left = 0;
+  ps->state = POLICYSTREAM_KEY;
+}
+
+static int end_array(policystream_t *ps) {
+  ps->return_state = POLICYSTREAM_AFTER_VALUE;
+  ps->state = POLICYSTREAM_AFTER_VALUE;
+
+  return ps->cb(ps->user, ps->key, ps->index, POLICYSTREAM_ARRAY_END, ps->value, 0);
+}
+
+static int after_value(policystream_t *ps, char c) {
+  if (ps->return_state == POLICYSTREAM_ELEMENT) {
+    if (c == ',') {
+      ps->state = POLICYSTREAM_ELEMENT;
+    } else if (c == ']') {
+      return end_array(ps);
+    } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+      return 1;
+    }
+  } else {
+    if (c == ',') {
+      ps->state = POLICYSTREAM_NEXT_KEY;
+    } else if (c == '}') {
+      ps->state = POLICYSTREAM_DONE;
+    } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int feed_char(policystream_t *ps, char c) {
+  switch (ps->state) {
+    case POLICYSTREAM_START:
+      if (c == '{') {
+        ps->state = POLICYSTREAM_KEY_OR_END;
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return 1;
+      }
+      break;
+    case POLICYSTREAM_KEY_OR_END:
+      if (c == '"') {
+        start_key(ps);
+      } else if (c == '}') {
+        ps->state = POLICYSTREAM_DONE;
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return 1;
+      }
+      break;
+    case POLICYSTREAM_NEXT_KEY:
+      if (c == '"') {
+        start_key(ps);
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return 1;
+      }
+      break;
+    case POLICYSTREAM_KEY:
+      switch (string_char(ps, c)) {
+        case -1:
+          return 1;
+        case 1:
+          ps->key[ps->key_len] = '\0';
+          ps->state = POLICYSTREAM_COLON;
+          break;
+        default:
+          // Keys longer than the buffer are truncated, they never match the keys of interest
+          if (ps->key_len < POLICYSTREAM_KEY_LEN - 1) ps->key[ps->key_len++] = c;
+          break;
+      }
+      break;
+    case POLICYSTREAM_COLON:
+      if (c == ':') {
+        ps->state = POLICYSTREAM_VALUE;
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return 1;
+      }
+      break;
+    case POLICYSTREAM_VALUE:
+      if (c == '[') {
+        ps->index = 0;
+        ps->return_state = POLICYSTREAM_ELEMENT;
+        ps->state = POLICYSTREAM_FIRST_ELEMENT;
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        ps->return_state = POLICYSTREAM_AFTER_VALUE;
+        return start_value(ps, c);
+      }
+      break;
+    case POLICYSTREAM_FIRST_ELEMENT:
+      if (c == ']') {
+        return end_array(ps);
+      } else if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return start_value(ps, c);
+      }
+      break;
+    case POLICYSTREAM_ELEMENT:
+      if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return start_value(ps, c);
+      }
+      break;
+    case POLICYSTREAM_STRING_VALUE:
+      switch (string_char(ps, c)) {
+        case -1:
+          return 1;
+        case 1:
+          return emit_value(ps, POLICYSTREAM_STRING);
+        default:
+          return append_value(ps, c);
+      }
+    case POLICYSTREAM_PRIMITIVE_VALUE:
+      if (c == ',' || c == '}' || c == ']' || POLICYSTREAM_IS_WHITESPACE(c)) {
+        if (!is_valid_primitive(ps->value, ps->value_len) || emit_value(ps, POLICYSTREAM_PRIMITIVE) != 0) {
+          return 1;
+        }
+        // The terminating character also belongs to the enclosing structure
+        return after_value(ps, c);
+      }
+      return append_value(ps, c);
+    case POLICYSTREAM_RAW_VALUE:
+      if (append_value(ps, c) != 0) {
+        return 1;
+      }
+      if (ps->in_string) {
+        int ret = string_char(ps, c);
+
+        if (ret < 0) return 1;
+        if (ret == 1) ps->in_string = 0;
+      } else if (c == '"') {
+        ps->in_string = 1;
+        ps->escape = 0;
+        ps->hex_left = 0;
+      } else if (c == '{' || c == '[') {
+        ps->raw_depth++;
+      } else if (c == '}' || c == ']') {
+        if (--ps->raw_depth == 0) {
+          return emit_value(ps, POLICYSTREAM_RAW);
+        }
+      }
+      break;
+    case POLICYSTREAM_AFTER_VALUE:
+      return after_value(ps, c);
+    case POLICYSTREAM_DONE:
+      if (!POLICYSTREAM_IS_WHITESPACE(c)) {
+        return 1;  // Nothing but whitespace may follow the document
+      }
+      break;
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+void policystream_init(policystream_t *ps, size_t value_max, policystream_cb_t cb, void *user) {
+  memset(ps, 0, sizeof(policystream_t));
+  ps->cb = cb;
+  ps->user = user;
+  ps->value_max = value_max;
+  ps->state = POLICYSTREAM_START;
+  ps->return_state = POLICYSTREAM_AFTER_VALUE;
+}
+
+int policystream_feed(policystream_t *ps, const char *chunk, size_t chunk_len) {
+  if (ps->error) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < chunk_len; i++) {
+    if (feed_char(ps, chunk[i]) != 0) {
+      ps->error = 1;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int policystream_finish(policystream_t *ps) { return (ps->error || ps->state != POLICYSTREAM_DONE) ? 1 : 0; }
+
+void policystream_release(policystream_t *ps) {
+  free(ps->value);
+  ps->value = NULL;
+  ps->value_len = 0;
+  ps->value_cap = 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the IOTA Access distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_stream_parser.h
+ * \brief
+ * Incremental parser for policy store responses
+ *
+ * \notes
+ * Consumes a JSON object in arbitrary chunks and reports every member of the
+ * top-level object as soon as it is complete. Members of arrays of scalars
+ * (e.g. the policy ID list) are reported one element at a time, objects are
+ * reported as raw JSON text. Memory use is bounded by the largest single value.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_STREAM_PARSER_H_
+#define _POLICY_STREAM_PARSER_H_
+
+#include <stddef.h>
+
+#define POLICYSTREAM_KEY_LEN 64
+
+typedef enum {
+  POLICYSTREAM_STRING,     /*!< string value, without quotes */
+  POLICYSTREAM_PRIMITIVE,  /*!< number, true, false or null */
+  POLICYSTREAM_RAW,        /*!< object or array, as raw JSON text */
+  POLICYSTREAM_ARRAY_END,  /*!< end of an array member, index holds the number of elements */
+} policystream_type_e;
+
+/**
+ * @brief Called for every recognized value
+ *
+ * @param[in] user User data passed to policystream_init
+ * @param[in] key Key of the top-level member
+ * @param[in] index Element index if the member is an array, -1 otherwise
+ * @param[in] type Value type
+ * @param[in] value Value, not null terminated
+ * @param[in] value_len Value length
+ *
+ * @return 0 to continue parsing, anything else to stop
+ */
+typedef int (*policystream_cb_t)(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                                 size_t value_len);
+
+typedef struct {
+  policystream_cb_t cb;
+  void *user;
+  int state;
+  int return_state;
+  int in_string;
+  int escape;
+  int hex_left;
+  int raw_depth;
+  int index;
+  int error;
+  char key[POLICYSTREAM_KEY_LEN];
+  size_t key_len;
+  char *value;
+  size_t value_len;
+  size_t value_cap;
+  size_t value_max;
+} policystream_t;
+
+/**
+ * @brief Initialize parser
+ *
+ * @param[out] ps Parser
+ * @param[in] value_max Largest accepted value, in bytes
+ * @param[in] cb Value callback
+ * @param[in] user User data for the callback
+ */
+void policystream_init(policystream_t *ps, size_t value_max, policystream_cb_t cb, void *user);
+
+/**
+ * @brief Feed next chunk of the document
+ *
+ * @return 0 on success, 1 on malformed input, oversized value or when stopped by the callback
+ */
+int policystream_feed(policystream_t *ps, const char *chunk, size_t chunk_len);
+
+/**
+ * @brief Check if the whole top-level object was consumed
+ *
+ * @return 0 if the document is complete, 1 otherwise
+ */
+int policystream_finish(policystream_t *ps);
+
+/**
+ * @brief Release parser resources
+ */
+void policystream_release(policystream_t *ps);
+
+#endif  // _POLICY_STREAM_PARSER_H_
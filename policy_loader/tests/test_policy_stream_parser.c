@@ -0,0 +1,212 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "unity/unity.h"
+
+#include "policy_stream_parser.h"
+
+#define TEST_VALUE_MAX 1024
+#define TEST_LOG_LEN 1024
+
+typedef struct {
+  char log[TEST_LOG_LEN];
+  size_t log_len;
+  int stop_at;
+  int calls;
+} test_values_t;
+
+static char const *test_document =
+    "{\"response\":[\"a\\\"b\", \"\\u00e9\" ,[1,\"]\"]],\n"
+    " \"version\" : -12.5e+3, \"flags\":[true,false,null],\"empty\":[],\"obj\":{\"k\":\"}\\\\\"}}\n";
+static char const *test_expected =
+    "response[0]s:a\\\"b;response[1]s:\\u00e9;response[2]r:[1,\"]\"];response[3]e:;version[-1]p:-12.5e+3;"
+    "flags[0]p:true;flags[1]p:false;flags[2]p:null;flags[3]e:;empty[0]e:;obj[-1]r:{\"k\":\"}\\\\\"};";
+
+static int record_cb(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                     size_t value_len) {
+  static char const types[] = {'s', 'p', 'r', 'e'};
+  test_values_t *values = (test_values_t *)user;
+  int len = snprintf(values->log + values->log_len, TEST_LOG_LEN - values->log_len, "%s[%d]%c:%.*s;", key, index,
+                     types[type], (int)value_len, value);
+
+  if (len > 0) values->log_len += len;
+  if (values->log_len >= TEST_LOG_LEN) values->log_len = TEST_LOG_LEN - 1;
+
+  return ++values->calls == values->stop_at;
+}
+
+// Parse the document fed in two chunks split at the given offset, returns 0 if it is accepted
+static int parse_split(const char *document, size_t split, size_t value_max, test_values_t *values) {
+  policystream_t ps;
+  size_t len = strlen(document);
+  int status;
+
+  policystream_init(&ps, value_max, record_cb, values);
+  status = policystream_feed(&ps, document, split) != 0 || policystream_feed(&ps, document + split, len - split) != 0 ||
+           policystream_finish(&ps) != 0;
+  policystream_release(&ps);
+
+  return status;
+}
+
+static int parse(const char *document) {
+  test_values_t values = {0};
+
+  return parse_split(document, strlen(document), TEST_VALUE_MAX, &values);
+}
+
+void test_parse_document(void) {
+  test_values_t values = {0};
+
+  TEST_ASSERT_EQUAL_INT(0, parse_split(test_document, strlen(test_document), TEST_VALUE_MAX, &values));
+  TEST_ASSERT_EQUAL_STRING(test_expected, values.log);
+}
+
+void test_parse_every_chunk_split(void) {
+  char message[32];
+
+  // Covers splits inside keys, literals, numbers, escapes and raw values
+  for (size_t split = 0; split <= strlen(test_document); split++) {
+    test_values_t values = {0};
+
+    snprintf(message, sizeof(message), "split at %zu", split);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, parse_split(test_document, split, TEST_VALUE_MAX, &values), message);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(test_expected, values.log, message);
+  }
+}
+
+void test_parse_byte_by_byte(void) {
+  test_values_t values = {0};
+  policystream_t ps;
+
+  policystream_init(&ps, TEST_VALUE_MAX, record_cb, &values);
+  for (size_t i = 0; i < strlen(test_document); i++) {
+    TEST_ASSERT_EQUAL_INT(0, policystream_feed(&ps, test_document + i, 1));
+  }
+  TEST_ASSERT_EQUAL_INT(0, policystream_finish(&ps));
+  policystream_release(&ps);
+  TEST_ASSERT_EQUAL_STRING(test_expected, values.log);
+}
+
+void test_reject_empty_elements(void) {
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"response\":[,,\"a\"]}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"response\":[\"a\",,\"b\"]}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"response\":[\"a\",]}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"response\":[,]}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1,}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{,\"a\":1}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1 2}"));
+}
+
+void test_reject_invalid_literals(void) {
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":tru}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":truex}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":nul}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":fals}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"response\":[tru]}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":01}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1.}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":.5}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":-}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1e}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1e+}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":+1}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":x}"));
+}
+
+void test_accept_literals(void) {
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":true}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":false}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":null}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":0}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":-0.5}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":12E-2}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":[1, 2 ,3 ]}"));
+}
+
+void test_reject_invalid_literal_split(void) {
+  test_values_t values = {0};
+  char const *document = "{\"a\":tru}";
+
+  TEST_ASSERT_EQUAL_INT(1, parse_split(document, 7, TEST_VALUE_MAX, &values));
+  TEST_ASSERT_EQUAL_INT(0, values.calls);
+}
+
+void test_reject_trailing_data(void) {
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1}}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1} x"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{}{}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":1} \r\n"));
+  TEST_ASSERT_EQUAL_INT(0, parse(" {}"));
+}
+
+void test_reject_invalid_strings(void) {
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":\"\\x\"}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":\"\\u12g4\"}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\\q\":1}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":{\"b\":\"\\q\"}}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":\"line\nbreak\"}"));
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"a\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\uABcd\"}"));
+}
+
+void test_reject_incomplete(void) {
+  TEST_ASSERT_EQUAL_INT(1, parse(""));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":1"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":\"b}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("{\"a\":[1,2}"));
+  TEST_ASSERT_EQUAL_INT(1, parse("[1]"));
+}
+
+void test_value_limit(void) {
+  test_values_t values = {0};
+
+  TEST_ASSERT_EQUAL_INT(1, parse_split("{\"a\":\"0123456789\"}", 3, 8, &values));
+  TEST_ASSERT_EQUAL_INT(0, values.calls);
+}
+
+void test_callback_stops(void) {
+  test_values_t values = {0};
+
+  values.stop_at = 2;
+  TEST_ASSERT_EQUAL_INT(1, parse_split(test_document, 0, TEST_VALUE_MAX, &values));
+  TEST_ASSERT_EQUAL_INT(2, values.calls);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_parse_document);
+  RUN_TEST(test_parse_every_chunk_split);
+  RUN_TEST(test_parse_byte_by_byte);
+  RUN_TEST(test_reject_empty_elements);
+  RUN_TEST(test_reject_invalid_literals);
+  RUN_TEST(test_accept_literals);
+  RUN_TEST(test_reject_invalid_literal_split);
+  RUN_TEST(test_reject_trailing_data);
+  RUN_TEST(test_reject_invalid_strings);
+  RUN_TEST(test_reject_incomplete);
+  RUN_TEST(test_value_limit);
+  RUN_TEST(test_callback_stops);
+
+  return UNITY_END();
+}
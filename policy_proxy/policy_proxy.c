@@ -0,0 +1,669 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_proxy.c
+ * \brief
+ * Caching proxy for the policy store protocol
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_proxy.h"
+#include "policy_proxy_logger.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config_manager.h"
+#include "policy_deflate.h"
+#include "policy_stream_parser.h"
+#include "policy_updater.h"
+#include "worker_pool.h"
+
+#define POLICY_PROXY_DEFAULT_BIND_ADDRESS "0.0.0.0"
+#define POLICY_PROXY_DEFAULT_PORT 6008
+#define POLICY_PROXY_DEFAULT_WORKERS 32
+#define POLICY_PROXY_DEFAULT_CACHE_LEN 256
+#define POLICY_PROXY_DEFAULT_LIST_TTL_MS 2000
+#define POLICY_PROXY_BACKLOG_LEN 16
+#define POLICY_PROXY_ACCEPT_SLICE_MS 500
+#define POLICY_PROXY_IO_TIMEOUT_MS 5000
+#define POLICY_PROXY_RECV_BUFF_LEN 256
+#define POLICY_PROXY_REQUEST_LEN 512
+// Policy lists grow with the number of policies of a device, a policy is at most 64 KB
+#define POLICY_PROXY_DEFAULT_RESPONSE_MAX_LEN (1024 * 1024)
+#define POLICY_PROXY_FIELD_LEN 96
+#define POLICY_PROXY_KEY_LEN 320
+#define POLICY_PROXY_POL_ID_LEN 64
+#define POLICY_PROXY_ADDRESS_LEN 64
+
+typedef struct {
+  char cmd[POLICY_PROXY_FIELD_LEN];
+  char policy_id[POLICY_PROXY_FIELD_LEN];
+  char store_version[POLICY_PROXY_FIELD_LEN];
+  char device_id[POLICY_PROXY_FIELD_LEN];
+  int wait_s;
+  int deflate;
+} policy_proxy_request_t;
+
+typedef struct {
+  char *data;
+  int len;
+  int cap;
+} policy_proxy_buffer_t;
+
+typedef struct {
+  char key[POLICY_PROXY_KEY_LEN];
+  char store_version[POLICY_PROXY_FIELD_LEN];  // policy lists only
+  char *response;
+  int response_len;
+  long long expires_ms;  // 0 for policies, which never change under the same ID
+  unsigned long long used;
+} policy_proxy_cache_entry_t;
+
+// Upstream request shared by every peer asking for the same thing at the same time
+typedef struct policy_proxy_flight {
+  char key[POLICY_PROXY_KEY_LEN];
+  int done;
+  int status;
+  char *response;
+  int response_len;
+  int users;
+  pthread_cond_t cond;
+  struct policy_proxy_flight *next;
+} policy_proxy_flight_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static policy_proxy_cache_entry_t *g_cache = NULL;
+static int g_cache_len = 0;
+static unsigned long long g_cache_tick = 0;
+static policy_proxy_flight_t *g_flights = NULL;
+static policyproxy_stats_t g_stats;
+static int g_list_ttl_ms = POLICY_PROXY_DEFAULT_LIST_TTL_MS;
+static int g_response_max_len = POLICY_PROXY_DEFAULT_RESPONSE_MAX_LEN;
+
+static worker_pool_t *g_pool = NULL;
+static pthread_t g_thread;
+static int g_listenfd = -1;
+static int g_running = 0;
+static volatile int g_end = 0;
+
+static long long time_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void copy_field(char *field, const char *value, size_t value_len) {
+  if (value_len < POLICY_PROXY_FIELD_LEN) {
+    memcpy(field, value, value_len);
+    field[value_len] = '\0';
+  }
+}
+
+static int request_cb(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                      size_t value_len) {
+  policy_proxy_request_t *request = (policy_proxy_request_t *)user;
+
+  if (index >= 0 || type == POLICYSTREAM_ARRAY_END) {
+    return 0;
+  }
+
+  if (strcmp(key, "cmd") == 0 && type == POLICYSTREAM_STRING) {
+    copy_field(request->cmd, value, value_len);
+  } else if (strcmp(key, "policyId") == 0 && type == POLICYSTREAM_STRING) {
+    copy_field(request->policy_id, value, value_len);
+  } else if (strcmp(key, "policyStoreId") == 0 && type == POLICYSTREAM_STRING) {
+    copy_field(request->store_version, value, value_len);
+  } else if (strcmp(key, "deviceId") == 0 && type == POLICYSTREAM_STRING) {
+    copy_field(request->device_id, value, value_len);
+  } else if (strcmp(key, "wait") == 0 && type == POLICYSTREAM_PRIMITIVE) {
+    request->wait_s = atoi(value);
+  } else if (strcmp(key, "accept") == 0 && type == POLICYSTREAM_STRING) {
+    request->deflate = value_len == strlen("deflate") && memcmp(value, "deflate", value_len) == 0;
+  }
+
+  return 0;
+}
+
+// Peers keep the connection open after the request, so it ends where the JSON object ends
+static int read_request(int fd, policy_proxy_request_t *request) {
+  policystream_t ps;
+  char recv_buff[POLICY_PROXY_RECV_BUFF_LEN];
+  long long deadline = time_now_ms() + POLICY_PROXY_IO_TIMEOUT_MS;
+  int total = 0;
+  int status = 1;
+
+  memset(request, 0, sizeof(policy_proxy_request_t));
+  policystream_init(&ps, POLICY_PROXY_REQUEST_LEN, request_cb, request);
+
+  while (!g_end && total < POLICY_PROXY_REQUEST_LEN) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    long long remaining = deadline - time_now_ms();
+    int len;
+
+    if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) {
+      break;
+    }
+
+    len = read(fd, recv_buff, POLICY_PROXY_RECV_BUFF_LEN);
+    if (len <= 0 || policystream_feed(&ps, recv_buff, len) != 0) {
+      break;
+    }
+    total += len;
+
+    if (policystream_finish(&ps) == 0) {
+      status = 0;
+      break;
+    }
+  }
+
+  policystream_release(&ps);
+
+  return status;
+}
+
+static int write_all(int fd, const char *data, int len) {
+  while (len > 0) {
+    int written = write(fd, data, len);
+
+    if (written <= 0) {
+      return 1;
+    }
+    data += written;
+    len -= written;
+  }
+
+  return 0;
+}
+
+static int response_buffer_cb(void *user, const char *chunk, int chunk_len) {
+  policy_proxy_buffer_t *buffer = (policy_proxy_buffer_t *)user;
+
+  if (buffer->len + chunk_len > g_response_max_len) {
+    log_error(policy_proxy_logger_id, "[%s:%d] response exceeds %d bytes.\n", __func__, __LINE__, g_response_max_len);
+    return 1;
+  }
+
+  if (buffer->len + chunk_len > buffer->cap) {
+    int new_cap = buffer->cap == 0 ? POLICY_PROXY_REQUEST_LEN : buffer->cap;
+    char *new_data = NULL;
+
+    while (new_cap < buffer->len + chunk_len) new_cap *= 2;
+    new_data = realloc(buffer->data, new_cap);
+    if (new_data == NULL) {
+      return 1;
+    }
+    buffer->data = new_data;
+    buffer->cap = new_cap;
+  }
+
+  memcpy(buffer->data + buffer->len, chunk, chunk_len);
+  buffer->len += chunk_len;
+
+  return 0;
+}
+
+typedef struct {
+  int error;
+  char store_version[POLICY_PROXY_FIELD_LEN];
+} policy_proxy_inspect_t;
+
+static int inspect_cb(void *user, const char *key, int index, policystream_type_e type, const char *value,
+                      size_t value_len) {
+  policy_proxy_inspect_t *inspect = (policy_proxy_inspect_t *)user;
+
+  if (strcmp(key, "error") == 0) {
+    inspect->error = 1;
+  } else if (strcmp(key, "policyStoreId") == 0 && type == POLICYSTREAM_STRING) {
+    copy_field(inspect->store_version, value, value_len);
+  }
+
+  return 0;
+}
+
+// Only complete, successful responses are cached
+static int inspect_response(const char *response, int response_len, char *store_version) {
+  policy_proxy_inspect_t inspect;
+  policystream_t ps;
+  int status;
+
+  memset(&inspect, 0, sizeof(inspect));
+  policystream_init(&ps, g_response_max_len, inspect_cb, &inspect);
+  status = policystream_feed(&ps, response, response_len) != 0 || policystream_finish(&ps) != 0 || inspect.error;
+  policystream_release(&ps);
+
+  if (status == 0) {
+    strcpy(store_version, inspect.store_version);
+  }
+
+  return status;
+}
+
+// Return a copy of the cached response, so the entry can be evicted while the copy is sent
+static char *cache_get(const char *key, int *response_len, char *store_version) {
+  long long now = time_now_ms();
+  char *response = NULL;
+
+  pthread_mutex_lock(&g_lock);
+  for (int i = 0; i < g_cache_len; i++) {
+    policy_proxy_cache_entry_t *entry = &g_cache[i];
+
+    if (entry->response == NULL || strcmp(entry->key, key) != 0) continue;
+    if (entry->expires_ms != 0 && entry->expires_ms <= now) break;
+
+    response = malloc(entry->response_len);
+    if (response != NULL) {
+      memcpy(response, entry->response, entry->response_len);
+      *response_len = entry->response_len;
+      strcpy(store_version, entry->store_version);
+      entry->used = ++g_cache_tick;
+    }
+    break;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return response;
+}
+
+// Insert or replace entry, evicting the least recently used one when the cache is full
+static void cache_put(const char *key, const char *store_version, const char *response, int response_len,
+                      int ttl_ms) {
+  policy_proxy_cache_entry_t *entry = NULL;
+  char *copy = malloc(response_len);
+
+  if (copy == NULL) {
+    return;
+  }
+  memcpy(copy, response, response_len);
+
+  pthread_mutex_lock(&g_lock);
+  for (int i = 0; i < g_cache_len; i++) {
+    if (g_cache[i].response != NULL && strcmp(g_cache[i].key, key) == 0) {
+      entry = &g_cache[i];
+      break;
+    }
+    if (entry == NULL || g_cache[i].response == NULL ||
+        (entry->response != NULL && g_cache[i].used < entry->used)) {
+      entry = &g_cache[i];
+    }
+  }
+
+  if (entry != NULL) {
+    free(entry->response);
+    strcpy(entry->key, key);
+    strcpy(entry->store_version, store_version);
+    entry->response = copy;
+    entry->response_len = response_len;
+    entry->expires_ms = ttl_ms > 0 ? time_now_ms() + ttl_ms : 0;
+    entry->used = ++g_cache_tick;
+    copy = NULL;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  free(copy);
+}
+
+static int fetch_upstream(policy_proxy_request_t *request, policy_proxy_buffer_t *buffer) {
+  if (strcmp(request->cmd, "get_policy") == 0) {
+    return policyupdater_get_policy_stream(request->policy_id, response_buffer_cb, buffer);
+  }
+
+  return policyupdater_wait_policy_list_stream(request->store_version, request->device_id, request->wait_s,
+                                               response_buffer_cb, buffer);
+}
+
+// Forward request upstream unless the same request is already in flight, in which case its response is shared
+static int fetch_coalesced(policy_proxy_request_t *request, const char *flight_key, const char *cache_key, int ttl_ms,
+                           char **response, int *response_len) {
+  policy_proxy_flight_t *flight = NULL;
+  int status;
+
+  pthread_mutex_lock(&g_lock);
+  for (flight = g_flights; flight != NULL; flight = flight->next) {
+    if (strcmp(flight->key, flight_key) == 0) break;
+  }
+
+  if (flight != NULL) {
+    g_stats.coalesced++;
+    flight->users++;
+    while (!flight->done) {
+      pthread_cond_wait(&flight->cond, &g_lock);
+    }
+  } else {
+    policy_proxy_buffer_t buffer = {NULL, 0, 0};
+    char store_version[POLICY_PROXY_FIELD_LEN] = {0};
+
+    flight = calloc(1, sizeof(policy_proxy_flight_t));
+    if (flight == NULL) {
+      pthread_mutex_unlock(&g_lock);
+      return 1;
+    }
+    strcpy(flight->key, flight_key);
+    flight->users = 1;
+    pthread_cond_init(&flight->cond, NULL);
+    flight->next = g_flights;
+    g_flights = flight;
+    g_stats.upstream++;
+    pthread_mutex_unlock(&g_lock);
+
+    status = fetch_upstream(request, &buffer);
+    if (status == 0 && inspect_response(buffer.data, buffer.len, store_version) == 0) {
+      cache_put(cache_key, store_version, buffer.data, buffer.len, ttl_ms);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    for (policy_proxy_flight_t **prev = &g_flights; *prev != NULL; prev = &(*prev)->next) {
+      if (*prev == flight) {
+        *prev = flight->next;
+        break;
+      }
+    }
+    if (status != 0) g_stats.upstream_failed++;
+    flight->status = status || buffer.len == 0;
+    flight->response = buffer.data;
+    flight->response_len = buffer.len;
+    flight->done = 1;
+    pthread_cond_broadcast(&flight->cond);
+  }
+
+  status = flight->status;
+  if (status == 0) {
+    *response = malloc(flight->response_len);
+    if (*response != NULL) {
+      memcpy(*response, flight->response, flight->response_len);
+      *response_len = flight->response_len;
+    } else {
+      status = 1;
+    }
+  }
+
+  if (--flight->users == 0) {
+    pthread_cond_destroy(&flight->cond);
+    free(flight->response);
+    free(flight);
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return status;
+}
+
+static int serve_policy(policy_proxy_request_t *request, char **response, int *response_len) {
+  char cache_key[POLICY_PROXY_KEY_LEN];
+  char store_version[POLICY_PROXY_FIELD_LEN];
+
+  if (strlen(request->policy_id) != POLICY_PROXY_POL_ID_LEN) {
+    return 1;
+  }
+
+  snprintf(cache_key, POLICY_PROXY_KEY_LEN, "policy:%s", request->policy_id);
+  *response = cache_get(cache_key, response_len, store_version);
+  if (*response != NULL) {
+    pthread_mutex_lock(&g_lock);
+    g_stats.cache_hits++;
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+  }
+
+  return fetch_coalesced(request, cache_key, cache_key, 0, response, response_len);
+}
+
+static int serve_policy_list(policy_proxy_request_t *request, char **response, int *response_len) {
+  char cache_key[POLICY_PROXY_KEY_LEN];
+  char flight_key[POLICY_PROXY_KEY_LEN];
+  char store_version[POLICY_PROXY_FIELD_LEN];
+
+  if (request->device_id[0] == '\0') {
+    return 1;
+  }
+
+  // A recent list answers plain requests, and long-polls from peers which do not have it yet
+  snprintf(cache_key, POLICY_PROXY_KEY_LEN, "list:%s", request->device_id);
+  *response = cache_get(cache_key, response_len, store_version);
+  if (*response != NULL) {
+    if (request->wait_s == 0 || strcmp(store_version, request->store_version) != 0) {
+      pthread_mutex_lock(&g_lock);
+      g_stats.cache_hits++;
+      pthread_mutex_unlock(&g_lock);
+      return 0;
+    }
+    free(*response);
+    *response = NULL;
+  }
+
+  snprintf(flight_key, POLICY_PROXY_KEY_LEN, "list:%s:%s:%d", request->device_id, request->store_version,
+           request->wait_s);
+
+  return fetch_coalesced(request, flight_key, cache_key, g_list_ttl_ms, response, response_len);
+}
+
+static void send_response(int fd, policy_proxy_request_t *request, const char *response, int response_len) {
+  char *compressed = NULL;
+  size_t compressed_len = 0;
+
+  if (request->deflate && policydeflate_compress(response, response_len, &compressed, &compressed_len) == 0) {
+    write_all(fd, compressed, compressed_len);
+    free(compressed);
+  } else {
+    write_all(fd, response, response_len);
+  }
+}
+
+static void connection_task(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  policy_proxy_request_t request;
+  char *response = NULL;
+  int response_len = 0;
+  int status = 1;
+
+  if (read_request(fd, &request) != 0) {
+    close(fd);
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  g_stats.requests++;
+  pthread_mutex_unlock(&g_lock);
+
+  if (strcmp(request.cmd, "get_policy") == 0) {
+    status = serve_policy(&request, &response, &response_len);
+  } else if (strcmp(request.cmd, "get_policy_list") == 0) {
+    status = serve_policy_list(&request, &response, &response_len);
+  } else {
+    const char *error = "{\"error\":\"unsupported command\"}";
+
+    send_response(fd, &request, error, strlen(error));
+    close(fd);
+    return;
+  }
+
+  if (status == 0) {
+    send_response(fd, &request, response, response_len);
+  } else {
+    const char *error = "{\"error\":\"policy store unavailable\"}";
+
+    log_error(policy_proxy_logger_id, "[%s:%d] %s request failed.\n", __func__, __LINE__, request.cmd);
+    send_response(fd, &request, error, strlen(error));
+  }
+
+  free(response);
+  close(fd);
+}
+
+static void *listener_thread(void *ptr) {
+  while (!g_end) {
+    struct pollfd pfd = {g_listenfd, POLLIN, 0};
+    int fd;
+
+    if (poll(&pfd, 1, POLICY_PROXY_ACCEPT_SLICE_MS) <= 0) {
+      continue;
+    }
+
+    fd = accept(g_listenfd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+
+    // Blocks while every worker is busy, which pushes back on peers through the listen backlog
+    if (worker_pool_submit(g_pool, connection_task, (void *)(intptr_t)fd) != 0) {
+      close(fd);
+    }
+  }
+
+  return NULL;
+}
+
+static int get_option_int(const char *key, int default_value) {
+  int value = default_value;
+
+  if (config_manager_get_option_int("proxy", key, &value) != CONFIG_MANAGER_OK) {
+    value = default_value;
+  }
+
+  return value;
+}
+
+int policyproxy_start() {
+  struct sockaddr_in serv_addr;
+  char bind_address[POLICY_PROXY_ADDRESS_LEN];
+  int one = 1;
+  int port, workers;
+
+  if (get_option_int("enable", 0) == 0) {
+    return 0;
+  }
+
+  logger_helper_init(LOGGER_INFO);
+  logger_init_policy_proxy(LOGGER_INFO);
+
+  // Peers are not authenticated, so the proxy should only listen on the interface of the trusted network
+  if (config_manager_get_option_string("proxy", "bind_address", bind_address, sizeof(bind_address)) !=
+      CONFIG_MANAGER_OK) {
+    strcpy(bind_address, POLICY_PROXY_DEFAULT_BIND_ADDRESS);
+  }
+  port = get_option_int("port", POLICY_PROXY_DEFAULT_PORT);
+  workers = get_option_int("workers", POLICY_PROXY_DEFAULT_WORKERS);
+  g_cache_len = get_option_int("cache_size", POLICY_PROXY_DEFAULT_CACHE_LEN);
+  g_list_ttl_ms = get_option_int("list_ttl_ms", POLICY_PROXY_DEFAULT_LIST_TTL_MS);
+  g_response_max_len = get_option_int("response_max_len", POLICY_PROXY_DEFAULT_RESPONSE_MAX_LEN);
+  if (workers <= 0) workers = POLICY_PROXY_DEFAULT_WORKERS;
+  if (g_cache_len <= 0) g_cache_len = POLICY_PROXY_DEFAULT_CACHE_LEN;
+  if (g_list_ttl_ms < 0) g_list_ttl_ms = 0;
+  if (g_response_max_len <= 0) g_response_max_len = POLICY_PROXY_DEFAULT_RESPONSE_MAX_LEN;
+
+  g_cache = calloc(g_cache_len, sizeof(policy_proxy_cache_entry_t));
+  if (g_cache == NULL) {
+    return 1;
+  }
+
+  memset(&serv_addr, 0, sizeof(serv_addr));
+  serv_addr.sin_family = AF_INET;
+  serv_addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, bind_address, &serv_addr.sin_addr) != 1) {
+    log_error(policy_proxy_logger_id, "[%s:%d] invalid bind address %s.\n", __func__, __LINE__, bind_address);
+    goto error;
+  }
+
+  g_listenfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (g_listenfd < 0) {
+    log_error(policy_proxy_logger_id, "[%s:%d] socket failed.\n", __func__, __LINE__);
+    goto error;
+  }
+  setsockopt(g_listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(g_listenfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) != 0 ||
+      listen(g_listenfd, POLICY_PROXY_BACKLOG_LEN) != 0) {
+    log_error(policy_proxy_logger_id, "[%s:%d] cannot listen on %s:%d.\n", __func__, __LINE__, bind_address, port);
+    goto error;
+  }
+
+  // Every pending long-poll of a peer holds a worker, so the pool is sized for the number of peers
+  g_pool = worker_pool_create(workers, workers);
+  if (g_pool == NULL) {
+    goto error;
+  }
+
+  g_end = 0;
+  if (pthread_create(&g_thread, NULL, listener_thread, NULL) != 0) {
+    worker_pool_destroy(&g_pool);
+    goto error;
+  }
+  g_running = 1;
+
+  log_info(policy_proxy_logger_id, "[%s:%d] serving policy store requests on %s:%d.\n", __func__, __LINE__,
+           bind_address, port);
+
+  return 0;
+
+error:
+  if (g_listenfd >= 0) close(g_listenfd);
+  g_listenfd = -1;
+  free(g_cache);
+  g_cache = NULL;
+
+  return 1;
+}
+
+void policyproxy_stop() {
+  if (!g_running) {
+    return;
+  }
+
+  g_end = 1;
+  pthread_join(g_thread, NULL);
+  close(g_listenfd);
+  g_listenfd = -1;
+
+  // Queued peers are still served; upstream requests return quickly once the updater is aborted
+  worker_pool_destroy(&g_pool);
+  g_running = 0;
+
+  log_info(policy_proxy_logger_id,
+           "[%s:%d] %lld requests, %lld cache hits, %lld coalesced, %lld upstream (%lld failed).\n", __func__,
+           __LINE__, g_stats.requests, g_stats.cache_hits, g_stats.coalesced, g_stats.upstream,
+           g_stats.upstream_failed);
+
+  for (int i = 0; i < g_cache_len; i++) {
+    free(g_cache[i].response);
+  }
+  free(g_cache);
+  g_cache = NULL;
+  g_cache_len = 0;
+
+  logger_destroy_policy_proxy();
+}
+
+void policyproxy_get_stats(policyproxy_stats_t *stats) {
+  pthread_mutex_lock(&g_lock);
+  *stats = g_stats;
+  pthread_mutex_unlock(&g_lock);
+}
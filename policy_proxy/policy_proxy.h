@@ -0,0 +1,75 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_proxy.h
+ * \brief
+ * Caching proxy for the policy store protocol
+ *
+ * \notes
+ * With [proxy] enable=1 this instance accepts get_policy and get_policy_list
+ * requests from LAN peers on [proxy] bind_address and port, so peers can use
+ * it as their policy_store_service_ip. Peers are not authenticated, anyone who
+ * reaches the port can read cached policies and load the upstream store, so
+ * bind_address should be the address of the trusted network only. Policies
+ * are immutable by ID and are served from a bounded LRU cache; policy lists
+ * are cached for list_ttl_ms. Concurrent identical upstream requests are
+ * coalesced into one, so a policy is fetched once per proxy. Policy lists are
+ * per device, so every peer still holds its own upstream long-poll. Peers
+ * still verify the owner's signature, the proxy forwards responses untouched.
+ * Responses are buffered up to [proxy] response_max_len bytes, larger ones
+ * are answered with an error.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_PROXY_H_
+#define _POLICY_PROXY_H_
+
+typedef struct {
+  long long requests;
+  long long cache_hits;
+  long long coalesced;
+  long long upstream;
+  long long upstream_failed;
+} policyproxy_stats_t;
+
+/**
+ * @brief Start proxy if enabled in configuration
+ *
+ * Upstream requests go through the policy updater, so the policy loader,
+ * which configures it, must be started first.
+ *
+ * @return 0 if the proxy is disabled or started, 1 on failure
+ */
+int policyproxy_start();
+
+/**
+ * @brief Stop proxy and release its cache
+ */
+void policyproxy_stop();
+
+/**
+ * @brief Copy proxy counters
+ */
+void policyproxy_get_stats(policyproxy_stats_t *stats);
+
+#endif  // _POLICY_PROXY_H_
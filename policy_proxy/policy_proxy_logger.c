@@ -0,0 +1,46 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_proxy_logger.c
+ * \brief
+ * Logger for Policy Proxy
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_proxy_logger.h"
+
+#define POLICY_PROXY_LOGGER_ID "policy_proxy"
+
+logger_id_t policy_proxy_logger_id;
+
+void logger_init_policy_proxy(logger_level_t level) {
+  policy_proxy_logger_id = logger_helper_enable(POLICY_PROXY_LOGGER_ID, level, true);
+  log_info(policy_proxy_logger_id, "[%s:%d] enable logger %s.\n", __func__, __LINE__, POLICY_PROXY_LOGGER_ID);
+}
+
+void logger_destroy_policy_proxy() {
+  log_info(policy_proxy_logger_id, "[%s:%d] destroy logger %s.\n", __func__, __LINE__, POLICY_PROXY_LOGGER_ID);
+  logger_helper_release(policy_proxy_logger_id);
+}
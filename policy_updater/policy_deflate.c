@@ -0,0 +1,221 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_deflate.c
+ * \brief
+ * Compression of policy store responses
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "policy_deflate.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define POLICYDEFLATE_OUT_LEN 4096
+#define POLICYDEFLATE_ZLIB_MAGIC 0x78
+
+/* POLICYDEFLATE_STATES */
+#define POLICYDEFLATE_UNKNOWN (0)
+#define POLICYDEFLATE_PLAIN (1)
+#define POLICYDEFLATE_COMPRESSED (2)
+#define POLICYDEFLATE_DONE (3)
+#define POLICYDEFLATE_ERROR (4)
+
+// Preset dictionary shared by devices and policy stores. Built from the policy and policy list
+// vocabulary; deflate favours the end of the dictionary, so the most frequent strings come last.
+// Changing it breaks compatibility with deployed stores, append a new version instead.
+static const char g_dictionary[] =
+    "{\"error\":\"policy not found\"}"
+    "\"obligation_deny\":{},\"obligation_grant\":{}"
+    "\"hash_function\":\"sha-256\",\"cost\":\"0.0\","
+    "\"type\":\"time\",\"value\":\"\"},{\"type\":\"time\",\"value\":\""
+    "\"operation\":\"leq\"},{\"attribute_list\":["
+    "\"operation\":\"geq\"},{\"attribute_list\":["
+    "\"type\":\"str\",\"value\":\"request.action.value\"},"
+    "\"type\":\"str\",\"value\":\"request.object.value\"},"
+    "\"type\":\"str\",\"value\":\"request.subject.value\"},"
+    "\"type\":\"str\",\"value\":\"request.subject.type\"},"
+    "\"type\":\"str\",\"value\":\"request.time.value\"},"
+    "\"type\":\"str\",\"value\":\"0x"
+    "\"operation\":\"or\"},\"operation\":\"and\"},"
+    "{\"cmd\":\"get_policy\",\"policyId\":\""
+    "{\"response\":\"ok\",\"policyStoreId\":\"0x"
+    "{\"response\":[\""
+    "\"],\"policyStoreId\":\"0x"
+    "{\"policy_id\":\"\",\"signature\":\"\",\"policy\":"
+    "{\"policy_object\":{\"policy_doc\":{\"attribute_list\":[{\"attribute_list\":["
+    "\"policy_goc\":{\"attribute_list\":[{\"attribute_list\":["
+    "{\"type\":\"str\",\"value\":\"request.subject.value\"},{\"type\":\"str\",\"value\":\"0x"
+    "\"}],\"operation\":\"eq\"},{\"attribute_list\":[{\"type\":\"str\",\"value\":\""
+    "\"}],\"operation\":\"eq\"}],\"operation\":\"and\"},";
+
+static int emit(policydeflate_t *pd, const char *data, int len) {
+  if (len > 0 && pd->cb(pd->user, data, len) != 0) {
+    pd->state = POLICYDEFLATE_ERROR;
+    return 1;
+  }
+
+  return 0;
+}
+
+static int start_inflate(policydeflate_t *pd) {
+  z_stream *zs = calloc(1, sizeof(z_stream));
+
+  if (zs == NULL || inflateInit(zs) != Z_OK) {
+    free(zs);
+    return 1;
+  }
+  pd->zs = zs;
+
+  return 0;
+}
+
+static int inflate_chunk(policydeflate_t *pd, const char *chunk, int chunk_len) {
+  z_stream *zs = (z_stream *)pd->zs;
+  char out[POLICYDEFLATE_OUT_LEN];
+
+  zs->next_in = (Bytef *)chunk;
+  zs->avail_in = chunk_len;
+
+  while (zs->avail_in > 0 && pd->state == POLICYDEFLATE_COMPRESSED) {
+    int status;
+
+    zs->next_out = (Bytef *)out;
+    zs->avail_out = POLICYDEFLATE_OUT_LEN;
+
+    status = inflate(zs, Z_NO_FLUSH);
+    if (status == Z_NEED_DICT) {
+      if (inflateSetDictionary(zs, (const Bytef *)g_dictionary, sizeof(g_dictionary) - 1) != Z_OK) {
+        pd->state = POLICYDEFLATE_ERROR;
+        return 1;
+      }
+      status = inflate(zs, Z_NO_FLUSH);
+    }
+
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+      pd->state = POLICYDEFLATE_ERROR;
+      return 1;
+    }
+    if (emit(pd, out, POLICYDEFLATE_OUT_LEN - zs->avail_out) != 0) {
+      return 1;
+    }
+    if (status == Z_STREAM_END) {
+      pd->state = POLICYDEFLATE_DONE;
+    }
+  }
+
+  return 0;
+}
+
+void policydeflate_init(policydeflate_t *pd, policyupdater_chunk_cb_t cb, void *user) {
+  memset(pd, 0, sizeof(policydeflate_t));
+  pd->state = POLICYDEFLATE_UNKNOWN;
+  pd->cb = cb;
+  pd->user = user;
+}
+
+int policydeflate_feed(void *ptr, const char *chunk, int chunk_len) {
+  policydeflate_t *pd = (policydeflate_t *)ptr;
+
+  if (chunk_len <= 0) {
+    return 0;
+  }
+
+  if (pd->state == POLICYDEFLATE_UNKNOWN) {
+    if ((unsigned char)chunk[0] == POLICYDEFLATE_ZLIB_MAGIC) {
+      if (start_inflate(pd) != 0) {
+        pd->state = POLICYDEFLATE_ERROR;
+        return 1;
+      }
+      pd->state = POLICYDEFLATE_COMPRESSED;
+    } else {
+      pd->state = POLICYDEFLATE_PLAIN;
+    }
+  }
+
+  switch (pd->state) {
+    case POLICYDEFLATE_PLAIN:
+      return emit(pd, chunk, chunk_len);
+    case POLICYDEFLATE_COMPRESSED:
+      return inflate_chunk(pd, chunk, chunk_len);
+    case POLICYDEFLATE_DONE:
+      return 0;  // Trailing data after the stream is ignored
+    default:
+      return 1;
+  }
+}
+
+int policydeflate_finish(policydeflate_t *pd) {
+  return (pd->state == POLICYDEFLATE_PLAIN || pd->state == POLICYDEFLATE_DONE) ? 0 : 1;
+}
+
+void policydeflate_release(policydeflate_t *pd) {
+  if (pd->zs != NULL) {
+    inflateEnd((z_stream *)pd->zs);
+    free(pd->zs);
+    pd->zs = NULL;
+  }
+}
+
+int policydeflate_compress(const char *in, size_t in_len, char **out, size_t *out_len) {
+  z_stream zs;
+  int status;
+
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit(&zs, Z_BEST_COMPRESSION) != Z_OK) {
+    return 1;
+  }
+
+  if (deflateSetDictionary(&zs, (const Bytef *)g_dictionary, sizeof(g_dictionary) - 1) != Z_OK) {
+    deflateEnd(&zs);
+    return 1;
+  }
+
+  *out_len = deflateBound(&zs, in_len);
+  *out = malloc(*out_len);
+  if (*out == NULL) {
+    deflateEnd(&zs);
+    return 1;
+  }
+
+  zs.next_in = (Bytef *)in;
+  zs.avail_in = in_len;
+  zs.next_out = (Bytef *)*out;
+  zs.avail_out = *out_len;
+
+  status = deflate(&zs, Z_FINISH);
+  *out_len = zs.total_out;
+  deflateEnd(&zs);
+
+  if (status != Z_STREAM_END) {
+    free(*out);
+    *out = NULL;
+    return 1;
+  }
+
+  return 0;
+}
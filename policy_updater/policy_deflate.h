@@ -0,0 +1,84 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_deflate.h
+ * \brief
+ * Compression of policy store responses
+ *
+ * \notes
+ * A device asks for a compressed response by adding "accept":"deflate" to its
+ * request. A policy store which supports it answers with a zlib stream built
+ * with the preset dictionary below, others answer with plain JSON. Responses
+ * are told apart by the first byte: JSON starts with '{' or whitespace, a zlib
+ * stream with 0x78.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _POLICY_DEFLATE_H_
+#define _POLICY_DEFLATE_H_
+
+#include <stddef.h>
+
+#include "policy_updater.h"
+
+typedef struct {
+  void *zs;
+  int state;
+  policyupdater_chunk_cb_t cb;
+  void *user;
+} policydeflate_t;
+
+/**
+ * @brief Initialize decoder which passes decompressed (or plain) response data to cb
+ */
+void policydeflate_init(policydeflate_t *pd, policyupdater_chunk_cb_t cb, void *user);
+
+/**
+ * @brief Feed next chunk of the response, signature matches policyupdater_chunk_cb_t
+ *
+ * @return 0 on success, 1 on corrupted stream or when stopped by cb
+ */
+int policydeflate_feed(void *pd, const char *chunk, int chunk_len);
+
+/**
+ * @brief Check that a compressed response was complete
+ *
+ * @return 0 if the response is complete or was not compressed, 1 otherwise
+ */
+int policydeflate_finish(policydeflate_t *pd);
+
+/**
+ * @brief Release decoder resources
+ */
+void policydeflate_release(policydeflate_t *pd);
+
+/**
+ * @brief Compress response, used by policy store implementations
+ *
+ * @param[out] out Allocated compressed data, freed by caller
+ *
+ * @return 0 on success, 1 on failure
+ */
+int policydeflate_compress(const char *in, size_t in_len, char **out, size_t *out_len);
+
+#endif  // _POLICY_DEFLATE_H_
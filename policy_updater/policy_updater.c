@@ -18,13 +18,19 @@
  */
 
 #include "policy_updater.h"
+#include "policy_deflate.h"
 #include "policy_updater_logger.h"
 
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "config_manager.h"
@@ -51,15 +57,60 @@
 #define POLICY_UPDATER_POL_ID_BUF_LEN 64
 #define POLICY_UPDATER_RESPONSE_LEN 2048
 #define POLICY_UPDATER_SERV_ADDR_LEN 100
-
-static char g_policy_updater_address[POLICY_UPDATER_ADDRESS_SIZE] = "\0";
-static int g_policy_updater_port = 6007;
+#define POLICY_UPDATER_RESPONSE_TIMEOUT_MS 10000
+#define POLICY_UPDATER_POLL_SLICE_MS 100
+#define POLICY_UPDATER_ENDPOINTS_LEN 512
+#define POLICY_UPDATER_DEFAULT_PORT 6007
+#define POLICY_UPDATER_COMPRESSION_LEN 16
+
+#define POLICY_UPDATER_MAX_ENDPOINTS 8
+#define POLICY_UPDATER_LATENCY_SAMPLES 32
+#define POLICY_UPDATER_MIN_LATENCY_SAMPLES 8
+#define POLICY_UPDATER_HEDGE_PERCENTILE 95
+#define POLICY_UPDATER_HEDGE_DEFAULT_MS 500
+#define POLICY_UPDATER_HEDGE_MIN_MS 20
+#define POLICY_UPDATER_DOWN_MIN_MS 1000
+#define POLICY_UPDATER_DOWN_MAX_MS 60000
+
+/* POLICY_UPDATER_ATTEMPT_STATES */
+#define POLICY_UPDATER_ATTEMPT_CONNECTING (0)
+#define POLICY_UPDATER_ATTEMPT_WAITING (1)
+#define POLICY_UPDATER_ATTEMPT_FAILED (2)
+
+typedef struct {
+  char host[POLICY_UPDATER_ADDRESS_SIZE];
+  int port;
+  int failures;            // consecutive failures
+  long long down_until_ms;  // endpoint is skipped until then, unless every endpoint is down
+  int latency_ms[POLICY_UPDATER_LATENCY_SAMPLES];  // time to first byte of recent responses
+  int latency_num;
+  int latency_next;
+} policy_updater_endpoint_t;
+
+typedef struct {
+  policy_updater_endpoint_t *endpoint;
+  int sockfd;
+  int state;
+  long long started_ms;
+} policy_updater_attempt_t;
+
+static policy_updater_endpoint_t g_endpoints[POLICY_UPDATER_MAX_ENDPOINTS];
+static int g_endpoints_num = 0;
+static int g_hedge_percentile = POLICY_UPDATER_HEDGE_PERCENTILE;
+static pthread_mutex_t g_endpoints_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static char g_user_address[POLICY_UPDATER_ADDRESS_SIZE] = "\0";
 static int g_user_port = 9998;
 
 static char g_module_name[] = "PolicyUpdater";
 
+static volatile int g_abort = 0;
+
+static int g_compression = 0;
+static long long g_bytes_sent = 0;
+static long long g_bytes_received = 0;
+static pthread_mutex_t g_traffic_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int hostname_to_ip(const char *hostname, char *ip_address);
 
 static ssize_t read_socket(void *ext, void *data, unsigned short len) {
@@ -72,77 +123,456 @@ static ssize_t write_socket(void *ext, void *data, unsigned short len) {
   return write(*sockfd, data, len);
 }
 
-static int get_tcp_response(void *ext, char *recv_buffer) {
+static void traffic_add(long long sent, long long received) {
+  pthread_mutex_lock(&g_traffic_lock);
+  g_bytes_sent += sent;
+  g_bytes_received += received;
+  pthread_mutex_unlock(&g_traffic_lock);
+}
+
+static long long time_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int read_tcp_stream(void *ext, int timeout_ms, policyupdater_chunk_cb_t cb, void *user) {
+  int *sockfd = (int *)ext;
+  char recv_buff[RECV_BUFF_LEN];
   int length = 0;
+  long long deadline = time_now_ms() + timeout_ms;
 
-  int num_of_chars = read_socket(ext, recv_buffer, 1);
+  // Read until the server closes the connection, the deadline expires or the updater is aborted
+  while (!g_abort) {
+    struct pollfd pfd = {*sockfd, POLLIN, 0};
+    long long remaining = deadline - time_now_ms();
 
-  while (num_of_chars == 1) {
-    length++;
-    num_of_chars = read_socket(ext, recv_buffer + length, 1);
+    if (remaining <= 0) {
+      log_error(policy_updater_logger_id, "[%s:%d] response timeout.\n", __func__, __LINE__);
+      return -1;
+    }
+
+    int status = poll(&pfd, 1, MIN(remaining, POLICY_UPDATER_POLL_SLICE_MS));
+    if (status < 0) {
+      return -1;
+    } else if (status == 0) {
+      continue;
+    }
+
+    int num_of_chars = read_socket(ext, recv_buff, RECV_BUFF_LEN);
+    if (num_of_chars <= 0) {
+      break;
+    }
+    traffic_add(0, num_of_chars);
+    if (cb(user, recv_buff, num_of_chars) != 0) {
+      return -1;
+    }
+    length += num_of_chars;
   }
 
-  recv_buffer[length] = '\0';
+  return g_abort ? -1 : length;
+}
+
+typedef struct {
+  char *buffer;
+  int buffer_len;
+  int length;
+} response_buffer_t;
+
+static int response_buffer_cb(void *user, const char *chunk, int chunk_len) {
+  response_buffer_t *response = (response_buffer_t *)user;
+  int len = MIN(chunk_len, response->buffer_len - 1 - response->length);
 
-  length++;
+  memcpy(response->buffer + response->length, chunk, len);
+  response->length += len;
 
-  return length;
+  return 0;
 }
 
-static int tcp_send(char *msg, int msg_length, char *rec, int *rec_length, char *servip, int port) {
-  int sockfd = 0;
+static int compare_int(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
 
-  char recv_buff[RECV_BUFF_LEN];
+// Must be called with g_endpoints_lock held
+static int endpoint_latency_percentile(policy_updater_endpoint_t *endpoint, int percentile) {
+  int sorted[POLICY_UPDATER_LATENCY_SAMPLES];
+
+  if (endpoint->latency_num == 0) {
+    return 0;
+  }
+
+  memcpy(sorted, endpoint->latency_ms, endpoint->latency_num * sizeof(int));
+  qsort(sorted, endpoint->latency_num, sizeof(int), compare_int);
+
+  return sorted[(endpoint->latency_num - 1) * percentile / 100];
+}
+
+// Must be called with g_endpoints_lock held
+static void endpoint_add_latency(policy_updater_endpoint_t *endpoint, int latency_ms) {
+  endpoint->latency_ms[endpoint->latency_next] = latency_ms;
+  endpoint->latency_next = (endpoint->latency_next + 1) % POLICY_UPDATER_LATENCY_SAMPLES;
+  if (endpoint->latency_num < POLICY_UPDATER_LATENCY_SAMPLES) endpoint->latency_num++;
+}
+
+static void endpoint_success(policy_updater_endpoint_t *endpoint, int latency_ms, int track_latency) {
+  pthread_mutex_lock(&g_endpoints_lock);
+  endpoint->failures = 0;
+  endpoint->down_until_ms = 0;
+  if (track_latency) endpoint_add_latency(endpoint, latency_ms);
+  pthread_mutex_unlock(&g_endpoints_lock);
+}
+
+// An endpoint which lost a hedged request was at least this slow, so it is not preferred next time
+static void endpoint_outrun(policy_updater_endpoint_t *endpoint, int elapsed_ms) {
+  pthread_mutex_lock(&g_endpoints_lock);
+  endpoint_add_latency(endpoint, elapsed_ms);
+  pthread_mutex_unlock(&g_endpoints_lock);
+}
+
+static void endpoint_failure(policy_updater_endpoint_t *endpoint) {
+  pthread_mutex_lock(&g_endpoints_lock);
+  endpoint->failures++;
+  endpoint->down_until_ms =
+      time_now_ms() + MIN(POLICY_UPDATER_DOWN_MIN_MS << MIN(endpoint->failures - 1, 6), POLICY_UPDATER_DOWN_MAX_MS);
+  log_info(policy_updater_logger_id, "[%s:%d] policy store %s:%d failed %d times in a row.\n", __func__, __LINE__,
+           endpoint->host, endpoint->port, endpoint->failures);
+  pthread_mutex_unlock(&g_endpoints_lock);
+}
+
+// Pick the fastest healthy endpoint not in tried_mask. Unless healthy_only is set, an endpoint which is down is
+// picked when nothing healthy is left, the one which recovers first
+static policy_updater_endpoint_t *pick_endpoint(unsigned int tried_mask, int healthy_only) {
+  policy_updater_endpoint_t *best = NULL;
+  int best_latency = 0;
+  long long now = time_now_ms();
+
+  pthread_mutex_lock(&g_endpoints_lock);
+  for (int i = 0; i < g_endpoints_num; i++) {
+    policy_updater_endpoint_t *endpoint = &g_endpoints[i];
+    int latency = endpoint_latency_percentile(endpoint, 50);
+
+    if ((tried_mask & (1u << i)) || endpoint->down_until_ms > now) {
+      continue;
+    }
+    if (best == NULL || latency < best_latency) {
+      best = endpoint;
+      best_latency = latency;
+    }
+  }
+
+  if (best == NULL && !healthy_only) {
+    for (int i = 0; i < g_endpoints_num; i++) {
+      if (!(tried_mask & (1u << i)) && (best == NULL || g_endpoints[i].down_until_ms < best->down_until_ms)) {
+        best = &g_endpoints[i];
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_endpoints_lock);
+
+  return best;
+}
+
+// Delay after which a second request is sent, the configured latency percentile of the primary endpoint
+static int hedge_delay_ms(policy_updater_endpoint_t *endpoint) {
+  int delay_ms = POLICY_UPDATER_HEDGE_DEFAULT_MS;
+
+  pthread_mutex_lock(&g_endpoints_lock);
+  if (endpoint->latency_num >= POLICY_UPDATER_MIN_LATENCY_SAMPLES) {
+    delay_ms = endpoint_latency_percentile(endpoint, g_hedge_percentile);
+    if (delay_ms < POLICY_UPDATER_HEDGE_MIN_MS) delay_ms = POLICY_UPDATER_HEDGE_MIN_MS;
+  }
+  pthread_mutex_unlock(&g_endpoints_lock);
+
+  return delay_ms;
+}
+
+static int attempt_start(policy_updater_attempt_t *attempt, policy_updater_endpoint_t *endpoint) {
+  char ip_address[POLICY_UPDATER_SERV_ADDR_LEN];
   struct sockaddr_in serv_addr;
 
-  memset(recv_buff, '0', sizeof(recv_buff));
-  if ((sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
-    log_error(policy_updater_logger_id, "[%s:%d] could not create socket.\n", __func__, __LINE__);
+  attempt->endpoint = endpoint;
+  attempt->sockfd = -1;
+  attempt->state = POLICY_UPDATER_ATTEMPT_FAILED;
+  attempt->started_ms = time_now_ms();
+
+  if (hostname_to_ip(endpoint->host, ip_address) != 0) {
+    log_error(policy_updater_logger_id, "[%s:%d] could not resolve policy store address %s.\n", __func__, __LINE__,
+              endpoint->host);
     return 1;
   }
 
-  memset(&serv_addr, '0', sizeof(serv_addr));
-
+  memset(&serv_addr, 0, sizeof(serv_addr));
   serv_addr.sin_family = AF_INET;
-  serv_addr.sin_port = htons(port);
+  serv_addr.sin_port = htons(endpoint->port);
+  if (inet_pton(AF_INET, ip_address, &serv_addr.sin_addr) <= 0) {
+    return 1;
+  }
 
-  if (inet_pton(AF_INET, servip, &serv_addr.sin_addr) <= 0) {
+  if ((attempt->sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    log_error(policy_updater_logger_id, "[%s:%d] could not create socket.\n", __func__, __LINE__);
     return 1;
   }
 
-  if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-    char buf[BUFF_LEN];
+  // Connect in the background, so a hedged request can be started while a host does not answer
+  fcntl(attempt->sockfd, F_SETFL, fcntl(attempt->sockfd, F_GETFL, 0) | O_NONBLOCK);
+  if (connect(attempt->sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0 && errno != EINPROGRESS) {
+    log_error(policy_updater_logger_id, "[%s:%d] connection with server failed.\n", __func__, __LINE__);
+    close(attempt->sockfd);
+    attempt->sockfd = -1;
+    return 1;
+  }
 
-    timemanager_get_time_string(buf, BUFF_LEN);
+  attempt->state = POLICY_UPDATER_ATTEMPT_CONNECTING;
 
-    log_error(policy_updater_logger_id, "[%s:%d] connection with server failed.\n", __func__, __LINE__);
+  return 0;
+}
 
-    return 1;
+static void attempt_close(policy_updater_attempt_t *attempt) {
+  if (attempt->sockfd >= 0) {
+    close(attempt->sockfd);
+    attempt->sockfd = -1;
   }
+}
+
+static void attempt_fail(policy_updater_attempt_t *attempt) {
+  attempt_close(attempt);
+  attempt->state = POLICY_UPDATER_ATTEMPT_FAILED;
+  endpoint_failure(attempt->endpoint);
+}
 
-  write_socket(&sockfd, msg, msg_length);
-  *rec_length = get_tcp_response(&sockfd, rec);
-  close(sockfd);
+// Handle poll events of an attempt, returns 1 once response data is available. An attempt whose connection fails or
+// is closed before the first response byte fails alone, a hedged attempt to another endpoint keeps going.
+static int attempt_progress(policy_updater_attempt_t *attempt, short revents, char *msg, int msg_length) {
+  if (attempt->state == POLICY_UPDATER_ATTEMPT_CONNECTING && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+
+    if (getsockopt(attempt->sockfd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0 || error != 0) {
+      log_error(policy_updater_logger_id, "[%s:%d] connection with server failed.\n", __func__, __LINE__);
+      attempt_fail(attempt);
+    } else if (write_socket(&attempt->sockfd, msg, msg_length) != msg_length) {
+      attempt_fail(attempt);
+    } else {
+      traffic_add(msg_length, 0);
+      attempt->state = POLICY_UPDATER_ATTEMPT_WAITING;
+    }
+  } else if (attempt->state == POLICY_UPDATER_ATTEMPT_WAITING && (revents & POLLIN)) {
+    char first_byte;
+    ssize_t peeked = recv(attempt->sockfd, &first_byte, 1, MSG_PEEK);
+
+    if (peeked > 0) {
+      return 1;
+    }
+    if (peeked == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      log_error(policy_updater_logger_id, "[%s:%d] connection closed before response.\n", __func__, __LINE__);
+      attempt_fail(attempt);
+    }
+  } else if (attempt->state == POLICY_UPDATER_ATTEMPT_WAITING && (revents & (POLLERR | POLLHUP | POLLNVAL))) {
+    log_error(policy_updater_logger_id, "[%s:%d] connection with server failed.\n", __func__, __LINE__);
+    attempt_fail(attempt);
+  }
 
   return 0;
 }
 
+// Send request to the policy store and stream the response to cb. Endpoints which cannot be reached are skipped
+// until one answers. With hedging, a second endpoint gets the same request if the first one takes longer than its
+// usual latency; the endpoint which answers first serves the response and the other request is dropped.
+static int tcp_send_stream(char *msg, int msg_length, int timeout_ms, int hedge, policyupdater_chunk_cb_t cb,
+                           void *user) {
+  unsigned int tried_mask = 0;
+  int endpoints_num;
+
+  pthread_mutex_lock(&g_endpoints_lock);
+  endpoints_num = g_endpoints_num;
+  pthread_mutex_unlock(&g_endpoints_lock);
+
+  for (int round = 0; round < endpoints_num && !g_abort; round++) {
+    policy_updater_attempt_t attempts[2];
+    policy_updater_endpoint_t *endpoint = pick_endpoint(tried_mask, 0);
+    long long deadline, hedge_at;
+    int attempts_num = 1;
+    int winner = -1;
+
+    if (endpoint == NULL) {
+      break;
+    }
+    tried_mask |= 1u << (endpoint - g_endpoints);
+
+    if (attempt_start(&attempts[0], endpoint) != 0) {
+      endpoint_failure(endpoint);
+      continue;
+    }
+
+    deadline = time_now_ms() + timeout_ms;
+    hedge_at = (hedge && endpoints_num > 1 && g_hedge_percentile > 0) ? time_now_ms() + hedge_delay_ms(endpoint)
+                                                                        : deadline;
+
+    while (winner < 0 && !g_abort) {
+      struct pollfd pfds[2];
+      long long now = time_now_ms();
+      int active = 0;
+
+      if (attempts_num == 1 && now >= hedge_at) {
+        policy_updater_endpoint_t *second = pick_endpoint(tried_mask, 1);
+
+        hedge_at = deadline;
+        if (second != NULL) {
+          tried_mask |= 1u << (second - g_endpoints);
+          log_debug(policy_updater_logger_id, "[%s:%d] hedging request to %s:%d.\n", __func__, __LINE__, second->host,
+                    second->port);
+          if (attempt_start(&attempts[1], second) != 0) {
+            endpoint_failure(second);
+          }
+          attempts_num = 2;
+        }
+      }
+
+      for (int i = 0; i < attempts_num; i++) {
+        pfds[i].fd = attempts[i].state == POLICY_UPDATER_ATTEMPT_FAILED ? -1 : attempts[i].sockfd;
+        pfds[i].events = attempts[i].state == POLICY_UPDATER_ATTEMPT_CONNECTING ? POLLOUT : POLLIN;
+        pfds[i].revents = 0;
+        active += pfds[i].fd >= 0;
+      }
+      if (active == 0) {
+        break;  // Fail over to the next endpoint right away
+      }
+      if (now >= deadline) {
+        log_error(policy_updater_logger_id, "[%s:%d] response timeout.\n", __func__, __LINE__);
+        for (int i = 0; i < attempts_num; i++) {
+          if (attempts[i].state != POLICY_UPDATER_ATTEMPT_FAILED) attempt_fail(&attempts[i]);
+        }
+        break;
+      }
+
+      if (poll(pfds, attempts_num, MIN(MIN(deadline, hedge_at) - now, POLICY_UPDATER_POLL_SLICE_MS)) < 0) {
+        break;
+      }
+
+      for (int i = 0; i < attempts_num && winner < 0; i++) {
+        if (pfds[i].fd >= 0 && pfds[i].revents && attempt_progress(&attempts[i], pfds[i].revents, msg, msg_length)) {
+          winner = i;
+        }
+      }
+    }
+
+    for (int i = 0; i < attempts_num; i++) {
+      if (i == winner) continue;
+      if (winner >= 0 && attempts[i].state != POLICY_UPDATER_ATTEMPT_FAILED) {
+        endpoint_outrun(attempts[i].endpoint, time_now_ms() - attempts[i].started_ms);
+      }
+      attempt_close(&attempts[i]);
+    }
+
+    if (winner >= 0) {
+      policy_updater_attempt_t *attempt = &attempts[winner];
+      int first_byte_ms = time_now_ms() - attempt->started_ms;
+      policydeflate_t deflate;
+      int length;
+
+      // Stores which do not support compression answer with plain JSON, which is passed through
+      policydeflate_init(&deflate, cb, user);
+      fcntl(attempt->sockfd, F_SETFL, fcntl(attempt->sockfd, F_GETFL, 0) & ~O_NONBLOCK);
+      length = read_tcp_stream(&attempt->sockfd, deadline - time_now_ms(), policydeflate_feed, &deflate);
+      attempt_close(attempt);
+      if (length > 0 && policydeflate_finish(&deflate) != 0) {
+        log_error(policy_updater_logger_id, "[%s:%d] corrupted compressed response.\n", __func__, __LINE__);
+        length = -1;
+      }
+      policydeflate_release(&deflate);
+
+      // Part of the response may already be consumed by cb, so there is no failover from here
+      if (length > 0) {
+        endpoint_success(attempt->endpoint, first_byte_ms, hedge);
+        return 0;
+      }
+      if (!g_abort) endpoint_failure(attempt->endpoint);
+      return 1;
+    }
+  }
+
+  return 1;
+}
+
+static int tcp_send_timeout(char *msg, int msg_length, char *rec, int *rec_length, int timeout_ms, int hedge) {
+  response_buffer_t response = {rec, POLICY_UPDATER_RESPONSE_LEN, 0};
+  int status = tcp_send_stream(msg, msg_length, timeout_ms, hedge, response_buffer_cb, &response);
+
+  rec[response.length] = '\0';
+  *rec_length = response.length + 1;
+
+  return status;
+}
+
+static int tcp_send(char *msg, int msg_length, char *rec, int *rec_length) {
+  return tcp_send_timeout(msg, msg_length, rec, rec_length, POLICY_UPDATER_RESPONSE_TIMEOUT_MS, 1);
+}
+
+// Parse comma separated list of host[:port] entries, port defaults to default_port
+static void parse_endpoints(const char *list, int default_port) {
+  const char *entry = list;
+
+  g_endpoints_num = 0;
+  while (*entry != '\0' && g_endpoints_num < POLICY_UPDATER_MAX_ENDPOINTS) {
+    policy_updater_endpoint_t *endpoint = &g_endpoints[g_endpoints_num];
+    const char *end = strchr(entry, ',');
+    const char *colon = NULL;
+    int len;
+
+    if (end == NULL) end = entry + strlen(entry);
+    while (entry < end && *entry == ' ') entry++;
+    len = end - entry;
+    while (len > 0 && entry[len - 1] == ' ') len--;
+
+    colon = memchr(entry, ':', len);
+    memset(endpoint, 0, sizeof(policy_updater_endpoint_t));
+    endpoint->port = colon != NULL ? atoi(colon + 1) : default_port;
+    if (colon != NULL) len = colon - entry;
+
+    if (len > 0 && len < POLICY_UPDATER_ADDRESS_SIZE && endpoint->port > 0) {
+      memcpy(endpoint->host, entry, len);
+      g_endpoints_num++;
+    }
+
+    entry = *end == ',' ? end + 1 : end;
+  }
+}
+
+// Ask for a compressed response, see policy_deflate.h
+static const char *accept_field() { return g_compression ? ",\"accept\":\"deflate\"" : ""; }
+
+static void format_policy_request(char *policy_request, const char *policy_id) {
+  snprintf(policy_request, POLICY_UPDATER_REQ_GET_LIST_SIZE, "{\"cmd\":\"get_policy\",\"policyId\":\"%.*s\"%s}",
+           POLICY_UPDATER_POL_ID_BUF_LEN, policy_id, accept_field());
+}
+
+static void format_policy_list_request(char *policy_request, const char *policy_store_version,
+                                       const char *device_id, int wait_s) {
+  if (wait_s > 0) {
+    // Long-poll: the policy store holds the request until the list changes or wait_s expires
+    snprintf(policy_request, POLICY_UPDATER_REQ_GET_LIST_SIZE,
+             "{\"cmd\":\"get_policy_list\",\"policyStoreId\":\"%s\",\"deviceId\":\"%s\",\"wait\":%d%s}",
+             policy_store_version, device_id, wait_s, accept_field());
+  } else {
+    snprintf(policy_request, POLICY_UPDATER_REQ_GET_LIST_SIZE,
+             "{\"cmd\":\"get_policy_list\",\"policyStoreId\":\"%s\",\"deviceId\":\"%s\"%s}", policy_store_version,
+             device_id, accept_field());
+  }
+}
+
 void policyupdater_get_policy(char *policy_id, char *p_policy) {
   char policy_request[POLICY_UPDATER_REQ_GET_LIST_SIZE] = {
       0,
   };
 
-  log_info(policy_updater_logger_id, "[%s:%d] asking for policy %.*s\n", __func__, __LINE__, POLICY_UPDATER_POL_ID_BUF_LEN, policy_id);
-  snprintf(policy_request, POLICY_UPDATER_REQ_GET_LIST_SIZE, "{\"cmd\":\"get_policy\",\"policyId\":\"%.*s\"}",
+  log_info(policy_updater_logger_id, "[%s:%d] asking for policy %.*s\n", __func__, __LINE__,
            POLICY_UPDATER_POL_ID_BUF_LEN, policy_id);
+  format_policy_request(policy_request, policy_id);
   int response_length;
   char response[POLICY_UPDATER_RESPONSE_LEN];
 
-  char policy_service_address[POLICY_UPDATER_SERV_ADDR_LEN];
-  hostname_to_ip(g_policy_updater_address, policy_service_address);
-
-  tcp_send(policy_request, strlen(policy_request), response, &response_length, policy_service_address,
-           g_policy_updater_port);
+  if (tcp_send(policy_request, strlen(policy_request), response, &response_length) != 0) {
+    p_policy[0] = '\0';
+    return;
+  }
 
   strncpy(p_policy, response, MIN((response_length + 1), (POLICY_UPDATER_RESPONSE_LEN - 1)));
 }
@@ -153,52 +583,73 @@ void policyupdater_init() {
   logger_init_policy_updater(LOGGER_INFO);
   logger_init_policy_updater(LOGGER_DEBUG);
 
-  config_manager_get_option_string("pap", "policy_store_service_ip", g_policy_updater_address,
-                                   POLICY_UPDATER_ADDRESS_SIZE);
-  config_manager_get_option_int("pap", "policy_store_service_port", &g_policy_updater_port);
+  char endpoints[POLICY_UPDATER_ENDPOINTS_LEN] = {0};
+  char compression[POLICY_UPDATER_COMPRESSION_LEN] = {0};
+  int port = POLICY_UPDATER_DEFAULT_PORT;
+
+  // policy_store_service_ip holds one or more comma separated host[:port] entries
+  config_manager_get_option_string("pap", "policy_store_service_ip", endpoints, POLICY_UPDATER_ENDPOINTS_LEN);
+  config_manager_get_option_int("pap", "policy_store_service_port", &port);
+  if (config_manager_get_option_int("pap", "hedge_percentile", &g_hedge_percentile) != CONFIG_MANAGER_OK)
+    g_hedge_percentile = POLICY_UPDATER_HEDGE_PERCENTILE;
+  if (g_hedge_percentile < 0 || g_hedge_percentile > 100) g_hedge_percentile = POLICY_UPDATER_HEDGE_PERCENTILE;
+
+  pthread_mutex_lock(&g_endpoints_lock);
+  parse_endpoints(endpoints, port);
+  pthread_mutex_unlock(&g_endpoints_lock);
   config_manager_get_option_string("pap", "user_ip", g_user_address, POLICY_UPDATER_ADDRESS_SIZE);
   config_manager_get_option_int("pap", "user_port", &g_user_port);
+
+  config_manager_get_option_string("pap", "compression", compression, POLICY_UPDATER_COMPRESSION_LEN);
+  g_compression = strcmp(compression, "deflate") == 0;
+}
+
+void policyupdater_set_compression(int enable) { g_compression = enable; }
+
+void policyupdater_get_traffic(long long *sent, long long *received) {
+  pthread_mutex_lock(&g_traffic_lock);
+  *sent = g_bytes_sent;
+  *received = g_bytes_received;
+  pthread_mutex_unlock(&g_traffic_lock);
 }
 
 int policyupdater_start() {}
 
 int policyupdater_stop() {}
 
+// getaddrinfo is used as requests may be issued from several threads
 static int hostname_to_ip(const char *hostname, char *ip_address) {
-  struct hostent *he;
-  struct in_addr **addr_list;
-  int i;
+  struct addrinfo hints;
+  struct addrinfo *result = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
 
-  he = gethostbyname(hostname);
-  if (he == NULL) {
+  if (getaddrinfo(hostname, NULL, &hints, &result) != 0 || result == NULL) {
     return 1;
   }
 
-  addr_list = (struct in_addr **)he->h_addr_list;
+  inet_ntop(AF_INET, &((struct sockaddr_in *)result->ai_addr)->sin_addr, ip_address, POLICY_UPDATER_SERV_ADDR_LEN);
+  freeaddrinfo(result);
 
-  for (i = 0; addr_list[i] != NULL; i++) {
-    strcpy(ip_address, inet_ntoa(*addr_list[i]));
-    return 0;
-  }
+  return 0;
 }
 
-unsigned int policyupdater_get_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
-                                           int *policy_list_len, int *new_policy_list_flag) {
+static int request_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
+                               int *policy_list_len, int *new_policy_list_flag, int wait_s) {
   char policy_request[POLICY_UPDATER_REQ_GET_LIST_SIZE];
   log_debug(policy_updater_logger_id, "[%s:%d] asking for policy list.\n", __func__, __LINE__);
   log_debug(policy_updater_logger_id, "[%s:%d] policy_store_version: %s\n", __func__, __LINE__, policy_store_version);
   log_debug(policy_updater_logger_id, "[%s:%d] device_id: %s\n", __func__, __LINE__, device_id);
-  snprintf(policy_request, POLICY_UPDATER_REQ_GET_LIST_SIZE,
-           "{\"cmd\":\"get_policy_list\",\"policyStoreId\":\"%s\",\"deviceId\":\"%s\"}", policy_store_version,
-           device_id);
+  format_policy_list_request(policy_request, policy_store_version, device_id, wait_s);
 
   int response_length;
   char response[POLICY_UPDATER_RESPONSE_LEN];
 
-  char policy_service_address[POLICY_UPDATER_SERV_ADDR_LEN];
-  hostname_to_ip(g_policy_updater_address, policy_service_address);
-  int res = tcp_send(policy_request, strlen(policy_request), response, &response_length, policy_service_address,
-                     g_policy_updater_port);
+  // Long-polls are held by the store on purpose, only plain requests are hedged
+  int res = tcp_send_timeout(policy_request, strlen(policy_request), response, &response_length,
+                             wait_s * 1000 + POLICY_UPDATER_RESPONSE_TIMEOUT_MS, wait_s == 0);
 
   if (res != 1) {
     strncpy(policy_list, response, POLICY_UPDATER_RESPONSE_LEN);
@@ -210,5 +661,43 @@ unsigned int policyupdater_get_policy_list(const char *policy_store_version, con
     *policy_list_len = strlen(policy_list);
   }
 
+  return res;
+}
+
+unsigned int policyupdater_get_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
+                                           int *policy_list_len, int *new_policy_list_flag) {
+  request_policy_list(policy_store_version, device_id, policy_list, policy_list_len, new_policy_list_flag, 0);
+
   return 0;
 }
+
+int policyupdater_wait_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
+                                   int *policy_list_len, int *new_policy_list_flag, int wait_s) {
+  return request_policy_list(policy_store_version, device_id, policy_list, policy_list_len, new_policy_list_flag,
+                             wait_s);
+}
+
+int policyupdater_get_policy_stream(const char *policy_id, policyupdater_chunk_cb_t cb, void *user) {
+  char policy_request[POLICY_UPDATER_REQ_GET_LIST_SIZE] = {
+      0,
+  };
+
+  log_info(policy_updater_logger_id, "[%s:%d] asking for policy %.*s\n", __func__, __LINE__,
+           POLICY_UPDATER_POL_ID_BUF_LEN, policy_id);
+  format_policy_request(policy_request, policy_id);
+
+  return tcp_send_stream(policy_request, strlen(policy_request), POLICY_UPDATER_RESPONSE_TIMEOUT_MS, 1, cb, user);
+}
+
+int policyupdater_wait_policy_list_stream(const char *policy_store_version, const char *device_id, int wait_s,
+                                          policyupdater_chunk_cb_t cb, void *user) {
+  char policy_request[POLICY_UPDATER_REQ_GET_LIST_SIZE];
+
+  log_debug(policy_updater_logger_id, "[%s:%d] asking for policy list.\n", __func__, __LINE__);
+  format_policy_list_request(policy_request, policy_store_version, device_id, wait_s);
+
+  return tcp_send_stream(policy_request, strlen(policy_request), wait_s * 1000 + POLICY_UPDATER_RESPONSE_TIMEOUT_MS,
+                         wait_s == 0, cb, user);
+}
+
+void policyupdater_abort() { g_abort = 1; }
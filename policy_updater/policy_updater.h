@@ -20,11 +20,72 @@
 #ifndef _POLICY_UPDATER_H_
 #define _POLICY_UPDATER_H_
 
+/**
+ * @brief Called for every chunk of a response as it arrives from the policy store.
+ *
+ * @return 0 to continue receiving, anything else to abort the request
+ */
+typedef int (*policyupdater_chunk_cb_t)(void *user, const char *chunk, int chunk_len);
+
+/**
+ * @brief Read policy store endpoints from configuration.
+ *
+ * [pap] policy_store_service_ip holds a comma separated list of host[:port] entries; the port
+ * defaults to policy_store_service_port. Requests go to the fastest healthy endpoint and fail over
+ * to the others. Short requests are hedged: if no answer arrives within the hedge_percentile
+ * latency of the endpoint, the request is also sent to the next endpoint and the first answer wins.
+ * Called once by policyloader_start, before any request is sent.
+ */
 void policyupdater_init();
 
+/**
+ * @brief Ask the policy store for compressed responses, overrides [pap] compression.
+ *
+ * Responses are decompressed transparently; stores which do not support compression keep answering with plain JSON.
+ */
+void policyupdater_set_compression(int enable);
+
+/**
+ * @brief Number of bytes sent to and received from policy stores, as seen on the wire.
+ */
+void policyupdater_get_traffic(long long *sent, long long *received);
+
 void policyupdater_get_policy(char *policy_id, char *policy_buff);
 
 unsigned int policyupdater_get_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
                                            int *policy_list_len, int *new_policy_list_flag);
 
+/**
+ * @brief Long-poll the policy store for the policy list.
+ *
+ * The request is held by the policy store until the policy list for the device differs from
+ * policy_store_version, or until wait_s seconds pass. A policy store that does not support
+ * long-polling answers right away, like for policyupdater_get_policy_list.
+ *
+ * @return 0 if a response was received, 1 on connection error or timeout
+ */
+int policyupdater_wait_policy_list(const char *policy_store_version, const char *device_id, char *policy_list,
+                                   int *policy_list_len, int *new_policy_list_flag, int wait_s);
+
+/**
+ * @brief Request a policy and hand the response to cb chunk by chunk, without size limit.
+ *
+ * @return 0 if a complete response was received, 1 otherwise
+ */
+int policyupdater_get_policy_stream(const char *policy_id, policyupdater_chunk_cb_t cb, void *user);
+
+/**
+ * @brief Long-poll for the policy list (see policyupdater_wait_policy_list) and hand the response to cb
+ * chunk by chunk, without size limit.
+ *
+ * @return 0 if a complete response was received, 1 otherwise
+ */
+int policyupdater_wait_policy_list_stream(const char *policy_store_version, const char *device_id, int wait_s,
+                                          policyupdater_chunk_cb_t cb, void *user);
+
+/**
+ * @brief Abort pending requests, used on shutdown so long-polls do not block.
+ */
+void policyupdater_abort();
+
 #endif /* _POLICY_UPDATER_H_ */
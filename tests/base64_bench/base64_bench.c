@@ -0,0 +1,123 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file base64_bench.c
+ * \brief
+ * Base64 throughput benchmark
+ *
+ * \notes
+ * Encodes and decodes buffers of typical policy store sizes (owner key,
+ * signature, small and large policies) with every implementation supported
+ * by the CPU and checks that the round trip is lossless.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64.h"
+
+#define BENCH_BYTES_PER_RUN (256 * 1024 * 1024)
+
+static const size_t g_sizes[] = {32, 64, 512, 4096, 65536};
+
+static const struct {
+  base64_impl_e impl;
+  const char *name;
+} g_impls[] = {
+    {BASE64_IMPL_SCALAR, "scalar"},
+    {BASE64_IMPL_SSSE3, "ssse3"},
+    {BASE64_IMPL_AVX2, "avx2"},
+};
+
+static double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  size_t max_size = g_sizes[sizeof(g_sizes) / sizeof(g_sizes[0]) - 1];
+  unsigned char *data = malloc(max_size);
+  unsigned char *decoded = malloc(max_size);
+  char *encoded = malloc(base64_encoded_len(max_size) + 1);
+  int ret = 0;
+
+  if (data == NULL || decoded == NULL || encoded == NULL) {
+    printf("allocation failed\n");
+    return 1;
+  }
+
+  srand(1);
+  for (size_t i = 0; i < max_size; i++) {
+    data[i] = rand();
+  }
+
+  printf("%-8s %8s %14s %14s\n", "impl", "size", "encode MB/s", "decode MB/s");
+
+  for (size_t m = 0; m < sizeof(g_impls) / sizeof(g_impls[0]); m++) {
+    if (base64_set_impl(g_impls[m].impl) != 0) {
+      printf("%-8s not supported\n", g_impls[m].name);
+      continue;
+    }
+
+    for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); s++) {
+      size_t size = g_sizes[s];
+      size_t encoded_len = base64_encoded_len(size);
+      size_t decoded_len = 0;
+      long iterations = BENCH_BYTES_PER_RUN / size;
+      double start, encode_s, decode_s;
+
+      start = now_s();
+      for (long i = 0; i < iterations; i++) {
+        base64_encode(data, size, encoded, encoded_len + 1);
+      }
+      encode_s = now_s() - start;
+
+      start = now_s();
+      for (long i = 0; i < iterations; i++) {
+        base64_decode(encoded, encoded_len, decoded, size, &decoded_len);
+      }
+      decode_s = now_s() - start;
+
+      if (decoded_len != size || memcmp(data, decoded, size) != 0) {
+        printf("%-8s %8zu round trip mismatch\n", g_impls[m].name, size);
+        ret = 1;
+        continue;
+      }
+
+      // Throughput is given in decoded (binary) bytes for both directions
+      printf("%-8s %8zu %14.1f %14.1f\n", g_impls[m].name, size, iterations * size / encode_s / 1e6,
+             iterations * size / decode_s / 1e6);
+    }
+  }
+
+  free(data);
+  free(decoded);
+  free(encoded);
+
+  return ret;
+}
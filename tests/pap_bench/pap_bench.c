@@ -0,0 +1,439 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file pap_bench.c
+ * \brief
+ * PAP storage plugin benchmark
+ *
+ * \notes
+ * Drives a storage plugin, optionally behind the cache plugin, through its
+ * callbacks in a scratch directory. Stores synthetic policies of the given
+ * size, reads them back in random order, looks up stored and missing IDs,
+ * lists all IDs through the plugin and through the backend's list_ids and
+ * cursor calls and deletes everything. Reports latency percentiles and
+ * throughput per operation, bytes on disk and RSS.
+ *
+ * usage: pap_bench [-b posix|sqlite] [-c (cache)] [-n policies] [-s object_size] [-t threads]
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config_manager.h"
+#include "pap_plugin.h"
+#include "pap_plugin_cache.h"
+#include "pap_plugin_posix.h"
+#include "pap_plugin_sqlite.h"
+#include "plugin.h"
+
+#define BENCH_DEFAULT_POLICIES 10000
+#define BENCH_DEFAULT_OBJECT_SIZE 1024
+#define BENCH_MAX_THREADS 64
+#define BENCH_GET_ALL_ROUNDS 10
+#define BENCH_CURSOR_BATCH 256
+#define BENCH_SIGNATURE_SEED (1ULL << 32)
+#define BENCH_OWNER_SEED (2ULL << 32)
+
+typedef enum {
+  BENCH_OP_PUT,
+  BENCH_OP_GET,
+  BENCH_OP_HAS,
+  BENCH_OP_DEL,
+} bench_op_e;
+
+typedef struct {
+  bench_op_e op;
+  int thread;
+} bench_task_t;
+
+static plugin_t g_plugin;
+static int g_num_policies = BENCH_DEFAULT_POLICIES;
+static int g_object_size = BENCH_DEFAULT_OBJECT_SIZE;
+static int g_threads = 1;
+static int *g_order = NULL;       // policy of each operation
+static double *g_latency = NULL;  // per operation, microseconds
+
+static double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Bytes which look random, derived from a seed
+static void hash_bytes(uint64_t seed, char *out, int len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (int i = 0; i < len; i += sizeof(hash)) {
+    hash = (hash ^ seed) * 0x100000001b3ULL;
+    hash ^= hash >> 29;
+    memcpy(out + i, &hash, len - i < (int)sizeof(hash) ? len - i : (int)sizeof(hash));
+  }
+}
+
+// Policy IDs are hashes in practice, a stored policy has an even number and a missing one an odd number
+static void policy_id(int n, char *id) { hash_bytes((uint64_t)n, id, PAP_POL_ID_MAX_LEN); }
+
+// Signed by a single owner, as policies of a device are
+static void policy_signature(int n, pap_policy_id_signature_t *signature) {
+  hash_bytes(BENCH_SIGNATURE_SEED + (uint64_t)n, signature->signature, PAP_SIGNATURE_LEN);
+  hash_bytes(BENCH_OWNER_SEED, signature->public_key, PAP_PUBLIC_KEY_LEN);
+  signature->signature_algorithm = PAP_ECDSA;
+}
+
+// A policy granting one subject, padded with an obligation to the requested size
+static int policy_object(int n, char *object) {
+  int len = sprintf(object,
+                    "{\"policy_doc\":{},\"policy_goc\":{\"operation\":\"eq\",\"attribute_list\":[{\"type\":\"str\","
+                    "\"value\":\"request.subject.value\"},{\"type\":\"str\",\"value\":\"subject%d\"}]},"
+                    "\"obligation_deny\":{},\"obligation_grant\":{\"pad\":\"",
+                    n);
+
+  for (; len < g_object_size - 3; len++) object[len] = 'a' + (n + len) % 26;
+  len += sprintf(object + len, "\"}}");
+
+  return len;
+}
+
+static void run_op(bench_op_e op, int n, char *object) {
+  pap_policy_t policy;
+  char id[PAP_POL_ID_MAX_LEN + 2] = {0};
+  pap_plugin_get_args_t get_args;
+  pap_plugin_has_args_t has_args;
+
+  memset(&policy, 0, sizeof(policy));
+  switch (op) {
+    case BENCH_OP_PUT:
+      policy_id(2 * n, policy.policy_id);
+      policy.policy_object.policy_object = object;
+      policy.policy_object.policy_object_size = policy_object(n, object);
+      strcpy(policy.policy_object.cost, "0.0");
+      policy_signature(n, &policy.policy_id_signature);
+      policy.hash_function = PAP_SHA_256;
+      plugin_call(&g_plugin, PAP_PLUGIN_PUT_CB, &policy);
+      break;
+    case BENCH_OP_GET:
+      // The plugin copies the ID into the policy, it must not be the same buffer
+      policy_id(2 * n, id);
+      policy.policy_object.policy_object = object;
+      policy.policy_object.policy_object_size = g_object_size + 64;
+      get_args.policy_id = id;
+      get_args.policy = &policy;
+      plugin_call(&g_plugin, PAP_PLUGIN_GET_CB, &get_args);
+      break;
+    case BENCH_OP_HAS:
+      // Every other lookup is for a policy that is not stored
+      policy_id(n, policy.policy_id);
+      has_args.policy_id = policy.policy_id;
+      has_args.does_have = 0;
+      plugin_call(&g_plugin, PAP_PLUGIN_HAS_CB, &has_args);
+      break;
+    case BENCH_OP_DEL:
+      policy_id(2 * n, policy.policy_id);
+      plugin_call(&g_plugin, PAP_PLUGIN_DEL_CB, policy.policy_id);
+      break;
+  }
+}
+
+static void *bench_thread(void *arg) {
+  bench_task_t *task = (bench_task_t *)arg;
+  char *object = malloc(g_object_size + 64);
+
+  for (int i = task->thread; object != NULL && i < g_num_policies; i += g_threads) {
+    double start = now_s();
+
+    run_op(task->op, g_order[i], object);
+    g_latency[i] = (now_s() - start) * 1e6;
+  }
+  free(object);
+
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void print_latency(const char *name, double *latency, int count, double elapsed) {
+  qsort(latency, count, sizeof(double), compare_double);
+  printf("%-8s %8d %12.0f %10.1f %10.1f %10.1f %10.1f\n", name, count, count / elapsed, latency[count / 2],
+         latency[(int)(count * 0.9)], latency[(int)(count * 0.99)], latency[count - 1]);
+}
+
+static void run_phase(const char *name, bench_op_e op) {
+  bench_task_t tasks[BENCH_MAX_THREADS];
+  pthread_t threads[BENCH_MAX_THREADS];
+  double start;
+
+  // Every phase visits the policies in a new random order
+  for (int i = g_num_policies - 1; i > 0; i--) {
+    int j = rand() % (i + 1), tmp = g_order[i];
+
+    g_order[i] = g_order[j];
+    g_order[j] = tmp;
+  }
+
+  start = now_s();
+  for (int t = 0; t < g_threads; t++) {
+    tasks[t].op = op;
+    tasks[t].thread = t;
+    pthread_create(&threads[t], NULL, bench_thread, &tasks[t]);
+  }
+  for (int t = 0; t < g_threads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  print_latency(name, g_latency, g_num_policies, now_s() - start);
+}
+
+static void run_get_all(void) {
+  double latency[BENCH_GET_ALL_ROUNDS];
+  double start = now_s();
+  int listed = 0;
+
+  for (int i = 0; i < BENCH_GET_ALL_ROUNDS; i++) {
+    pap_policy_id_list_t *list = NULL;
+    double op_start = now_s();
+
+    plugin_call(&g_plugin, PAP_PLUGIN_GET_ALL_CB, &list);
+    latency[i] = (now_s() - op_start) * 1e6;
+
+    listed = 0;
+    while (list != NULL) {
+      pap_policy_id_list_t *next = list->next;
+      free(list);
+      list = next;
+      listed++;
+    }
+  }
+
+  print_latency("get_all", latency, BENCH_GET_ALL_ROUNDS, now_s() - start);
+  if (listed != g_num_policies) {
+    printf("get_all listed %d of %d policies\n", listed, g_num_policies);
+  }
+}
+
+// Walk the stored IDs in batches through the backend cursor, returns the number of IDs
+static int cursor_walk(int sqlite) {
+  static char ids[BENCH_CURSOR_BATCH * PAP_POL_ID_MAX_LEN];
+  int count = 0, n;
+
+  if (sqlite) {
+    pap_plugin_sqlite_cursor_t cursor;
+
+    pap_plugin_sqlite_cursor_init(&cursor);
+    while ((n = pap_plugin_sqlite_cursor_next(&cursor, ids, BENCH_CURSOR_BATCH)) > 0) count += n;
+  } else {
+    pap_plugin_posix_cursor_t cursor;
+
+    pap_plugin_posix_cursor_init(&cursor);
+    while ((n = pap_plugin_posix_cursor_next(&cursor, ids, BENCH_CURSOR_BATCH)) > 0) count += n;
+    if (n < 0) return -1;
+  }
+
+  return count;
+}
+
+// Listing calls of the storage backend, they bypass the cache plugin but wait for its queued writes
+static void run_list_ids(int sqlite) {
+  double latency[BENCH_GET_ALL_ROUNDS];
+  double start = now_s();
+  int listed = 0;
+
+  for (int i = 0; i < BENCH_GET_ALL_ROUNDS; i++) {
+    char *ids = NULL;
+    double op_start = now_s();
+
+    if ((sqlite ? pap_plugin_sqlite_list_ids(&ids, &listed) : pap_plugin_posix_list_ids(&ids, &listed)) != 0) {
+      listed = -1;
+    }
+    latency[i] = (now_s() - op_start) * 1e6;
+    free(ids);
+  }
+
+  print_latency("list_ids", latency, BENCH_GET_ALL_ROUNDS, now_s() - start);
+  if (listed != g_num_policies) {
+    printf("list_ids listed %d of %d policies\n", listed, g_num_policies);
+  }
+
+  start = now_s();
+  for (int i = 0; i < BENCH_GET_ALL_ROUNDS; i++) {
+    double op_start = now_s();
+
+    listed = cursor_walk(sqlite);
+    latency[i] = (now_s() - op_start) * 1e6;
+  }
+
+  print_latency("cursor", latency, BENCH_GET_ALL_ROUNDS, now_s() - start);
+  if (listed != g_num_policies) {
+    printf("cursor listed %d of %d policies\n", listed, g_num_policies);
+  }
+}
+
+static long long g_disk_bytes = 0;
+
+static int add_size(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+  // Allocated blocks, sparse and preallocated files count as what they occupy
+  if (flag == FTW_F) g_disk_bytes += (long long)st->st_blocks * 512;
+  return 0;
+}
+
+static long long disk_bytes(const char *dir) {
+  g_disk_bytes = 0;
+  nftw(dir, add_size, 16, FTW_PHYS);
+  return g_disk_bytes;
+}
+
+static long rss_kib(void) {
+  FILE *f = fopen("/proc/self/statm", "r");
+  long size = 0, resident = 0;
+
+  if (f == NULL) {
+    return 0;
+  }
+  if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = 0;
+  fclose(f);
+
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) { return remove(path); }
+
+int main(int argc, char **argv) {
+  char scratch[] = "/tmp/pap_bench.XXXXXX";
+  const char *backend = "posix";
+  int (*initializer)(plugin_t *, void *) = pap_plugin_posix_initializer;
+  int cache = 0;
+  plugin_t storage;
+  struct rusage usage;
+  FILE *config = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:cn:s:t:")) != -1) {
+    switch (opt) {
+      case 'b':
+        backend = optarg;
+        break;
+      case 'c':
+        cache = 1;
+        break;
+      case 'n':
+        g_num_policies = atoi(optarg);
+        break;
+      case 's':
+        g_object_size = atoi(optarg);
+        break;
+      case 't':
+        g_threads = atoi(optarg);
+        break;
+      default:
+        g_num_policies = 0;
+        break;
+    }
+  }
+
+  if (strcmp(backend, "sqlite") == 0) {
+    initializer = pap_plugin_sqlite_initializer;
+  } else if (strcmp(backend, "posix") != 0) {
+    g_num_policies = 0;
+  }
+
+  // Smaller objects could not hold the policy the padding is added to
+  if (g_num_policies <= 0 || g_object_size < 256 || g_threads <= 0 || g_threads > BENCH_MAX_THREADS) {
+    fprintf(stderr, "usage: %s [-b posix|sqlite] [-c] [-n policies] [-s object_size >= 256] [-t threads <= %d]\n",
+            argv[0], BENCH_MAX_THREADS);
+    return 1;
+  }
+
+  // The plugins store policies relative to the working directory, start from an empty one
+  if (mkdtemp(scratch) == NULL || chdir(scratch) != 0) {
+    fprintf(stderr, "cannot create scratch directory\n");
+    return 1;
+  }
+
+  // Plugin defaults apply to everything else
+  config = fopen("config.ini", "w");
+  if (config == NULL) {
+    return 1;
+  }
+  fprintf(config, "[pap]\nstorage=%s\nsqlite_db=stored_policies.db\n", backend);
+  fclose(config);
+  config_manager_init("config.ini");
+
+  g_order = malloc(g_num_policies * sizeof(int));
+  g_latency = malloc(g_num_policies * sizeof(double));
+  if (g_order == NULL || g_latency == NULL) {
+    fprintf(stderr, "allocation failed\n");
+    return 1;
+  }
+  for (int i = 0; i < g_num_policies; i++) {
+    g_order[i] = i;
+  }
+  srand(1);
+
+  if (plugin_init(&storage, initializer, NULL) != 0 ||
+      (cache ? plugin_init(&g_plugin, pap_plugin_cache_initializer, &storage) : (g_plugin = storage, 0)) != 0) {
+    fprintf(stderr, "cannot initialize %s plugin\n", backend);
+    return 1;
+  }
+  if (cache) {
+    pap_plugin_posix_set_drain_cb(pap_plugin_cache_drain);
+    pap_plugin_sqlite_set_drain_cb(pap_plugin_cache_drain);
+  }
+
+  printf("%s%s: %d policies of %d B, %d threads\n", backend, cache ? " behind cache" : "", g_num_policies,
+         g_object_size, g_threads);
+  printf("%-8s %8s %12s %10s %10s %10s %10s\n", "op", "count", "ops/s", "p50 us", "p90 us", "p99 us", "max us");
+
+  run_phase("put", BENCH_OP_PUT);
+  run_phase("get", BENCH_OP_GET);
+  run_phase("has", BENCH_OP_HAS);
+  // Also waits for queued writes, so the disk usage below covers every policy
+  run_get_all();
+  run_list_ids(initializer == pap_plugin_sqlite_initializer);
+  printf("disk: %lld B stored (%.2f x object bytes), rss: %ld KiB\n", disk_bytes(scratch),
+         disk_bytes(scratch) / ((double)g_num_policies * g_object_size), rss_kib());
+  run_phase("del", BENCH_OP_DEL);
+
+  plugin_destroy(&g_plugin);
+  getrusage(RUSAGE_SELF, &usage);
+  printf("disk after delete: %lld B, peak rss: %ld KiB\n", disk_bytes(scratch), usage.ru_maxrss);
+
+  free(g_order);
+  free(g_latency);
+  nftw(scratch, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+  return 0;
+}
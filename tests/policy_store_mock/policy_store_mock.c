@@ -0,0 +1,448 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_store_mock.c
+ * \brief
+ * Local stand-in for the Access Policy Store
+ *
+ * \notes
+ * Serves get_policy_list (including long-polls) and get_policy for any
+ * device ID from a set of synthetic policies signed with a key derived from
+ * the seed, so the policy loader can be tested at scale without the real
+ * store. Policy IDs are the SHA-256 of the signed policy document. Latency,
+ * loss, link rate and periodic policy updates are configurable. The owner
+ * public key to put into config.ini is printed on start.
+ *
+ * usage: policy_store_mock [-p port] [-n policies] [-l latency_ms] [-j jitter_ms]
+ *                          [-x loss_percent] [-r link_kbit_s] [-u update_s] [-s seed]
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "base64.h"
+#include "policy_deflate.h"
+#include "sodium.h"
+
+#define MOCK_DEFAULT_PORT 6007
+#define MOCK_DEFAULT_POLICIES 1000
+#define MOCK_DEFAULT_SEED "policy_store_mock"
+#define MOCK_MAX_UPDATES 4096
+#define MOCK_POLICY_LEN 2048
+#define MOCK_POL_ID_LEN 64
+#define MOCK_REQUEST_LEN 512
+#define MOCK_CHUNK_LEN 1024
+#define MOCK_SIGNATURE_B64_LEN 88
+#define MOCK_PUBLIC_KEY_B64_LEN 44
+
+typedef struct {
+  char id[MOCK_POL_ID_LEN + 1];
+  int index;
+} mock_policy_id_t;
+
+typedef struct {
+  int port;
+  int latency_ms;
+  int jitter_ms;
+  int loss_percent;
+  int link_kbit_s;
+  int update_s;
+  unsigned char public_key[crypto_sign_PUBLICKEYBYTES];
+  unsigned char secret_key[crypto_sign_SECRETKEYBYTES];
+} mock_config_t;
+
+static mock_config_t g_config = {.port = MOCK_DEFAULT_PORT};
+
+// Policies [0, g_policies_num) are published, later ones are added by updates
+static mock_policy_id_t *g_ids = NULL;     // by index
+static mock_policy_id_t *g_sorted = NULL;  // by ID, for lookups
+static int g_policies_num = 0;
+static int g_capacity = 0;
+static int g_version = 1;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_version_changed = PTHREAD_COND_INITIALIZER;
+
+static long long g_requests = 0;
+static long long g_dropped = 0;
+static long long g_bytes_sent = 0;
+
+static volatile int g_end = 0;
+
+static void signal_handler(int signum) { g_end = 1; }
+
+static double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Policies are generated on request, only their IDs are kept in memory
+static int policy_document(int index, char *policy) {
+  return snprintf(
+      policy, MOCK_POLICY_LEN,
+      "{\"policy_object\":{\"policy_doc\":{\"attribute_list\":[{\"attribute_list\":[{\"type\":\"str\",\"value\":"
+      "\"request.subject.value\"},{\"type\":\"str\",\"value\":\"0x%040x\"}],\"operation\":\"eq\"},{\"attribute_list\":"
+      "[{\"type\":\"str\",\"value\":\"request.object.value\"},{\"type\":\"str\",\"value\":\"0x%040x\"}],\"operation\":"
+      "\"eq\"},{\"attribute_list\":[{\"type\":\"str\",\"value\":\"request.action.value\"},{\"type\":\"str\",\"value\":"
+      "\"action#%d\"}],\"operation\":\"eq\"},{\"attribute_list\":[{\"attribute_list\":[{\"type\":\"str\",\"value\":"
+      "\"request.time.value\"},{\"type\":\"time\",\"value\":\"%d\"}],\"operation\":\"geq\"},{\"attribute_list\":[{"
+      "\"type\":\"str\",\"value\":\"request.time.value\"},{\"type\":\"time\",\"value\":\"%d\"}],\"operation\":\"leq\"}"
+      "],\"operation\":\"and\"}],\"operation\":\"and\"},\"policy_goc\":{\"attribute_list\":[{\"attribute_list\":[{"
+      "\"type\":\"str\",\"value\":\"request.subject.value\"},{\"type\":\"str\",\"value\":\"0x%040x\"}],\"operation\":"
+      "\"eq\"}],\"operation\":\"and\"},\"obligation_deny\":{},\"obligation_grant\":{}},\"cost\":\"0.0\","
+      "\"hash_function\":\"sha-256\",\"policy_number\":%d}",
+      index * 7919u, index % 16, index % 4, 1600000000 + index, 1900000000 + index, index * 7919u, index);
+}
+
+static void policy_id(const char *policy, int policy_len, char *id) {
+  unsigned char hash[crypto_hash_sha256_BYTES];
+
+  crypto_hash_sha256(hash, (const unsigned char *)policy, policy_len);
+  for (int i = 0; i < crypto_hash_sha256_BYTES; i++) {
+    sprintf(id + 2 * i, "%02x", hash[i]);
+  }
+}
+
+static int compare_ids(const void *a, const void *b) {
+  return strcmp(((const mock_policy_id_t *)a)->id, ((const mock_policy_id_t *)b)->id);
+}
+
+static int generate_policies(int num) {
+  char policy[MOCK_POLICY_LEN];
+  int capacity = num + MOCK_MAX_UPDATES;
+
+  g_ids = calloc(capacity, sizeof(mock_policy_id_t));
+  g_sorted = calloc(capacity, sizeof(mock_policy_id_t));
+  if (g_ids == NULL || g_sorted == NULL) {
+    return 1;
+  }
+
+  for (int i = 0; i < capacity; i++) {
+    policy_id(policy, policy_document(i, policy), g_ids[i].id);
+    g_ids[i].index = i;
+  }
+  g_capacity = capacity;
+  memcpy(g_sorted, g_ids, num * sizeof(mock_policy_id_t));
+  qsort(g_sorted, num, sizeof(mock_policy_id_t), compare_ids);
+  g_policies_num = num;
+
+  return 0;
+}
+
+// Publish one more policy and bump the store version, waking up long-polls
+static void publish_update(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_policies_num < g_capacity) {
+    g_sorted[g_policies_num] = g_ids[g_policies_num];
+    g_policies_num++;
+    qsort(g_sorted, g_policies_num, sizeof(mock_policy_id_t), compare_ids);
+    g_version++;
+    pthread_cond_broadcast(&g_version_changed);
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+static char *format_policy(const char *id, int *len) {
+  mock_policy_id_t key;
+  mock_policy_id_t *found = NULL;
+  char policy[MOCK_POLICY_LEN];
+  unsigned char signature[crypto_sign_BYTES];
+  char signature_b64[MOCK_SIGNATURE_B64_LEN + 1];
+  char *response = NULL;
+  int policy_len;
+
+  memcpy(key.id, id, MOCK_POL_ID_LEN);
+  key.id[MOCK_POL_ID_LEN] = '\0';
+  pthread_mutex_lock(&g_lock);
+  found = bsearch(&key, g_sorted, g_policies_num, sizeof(mock_policy_id_t), compare_ids);
+  key.index = found != NULL ? found->index : -1;
+  pthread_mutex_unlock(&g_lock);
+
+  if (key.index < 0) {
+    response = strdup("{\"error\":\"policy not found\"}");
+    *len = strlen(response);
+    return response;
+  }
+
+  // Like the policy store, the signature covers the document including its null terminator
+  policy_len = policy_document(key.index, policy);
+  crypto_sign_detached(signature, NULL, (const unsigned char *)policy, policy_len + 1, g_config.secret_key);
+  base64_encode(signature, crypto_sign_BYTES, signature_b64, sizeof(signature_b64));
+
+  response = malloc(MOCK_POLICY_LEN + MOCK_SIGNATURE_B64_LEN + 64);
+  if (response != NULL) {
+    *len = sprintf(response, "{\"signature\":\"%s\",\"policy\":%s}", signature_b64, policy);
+  }
+
+  return response;
+}
+
+// Up to date devices get "ok", others the full list; long-polls are held until the version changes
+static char *format_policy_list(const char *request, int wait_s, int *len) {
+  const char *version = strstr(request, "\"policyStoreId\":\"");
+  char current[32];
+  char *response = NULL;
+  char *pos = NULL;
+
+  pthread_mutex_lock(&g_lock);
+  snprintf(current, sizeof(current), "0x%08x", g_version);
+  if (version != NULL && strncmp(version + strlen("\"policyStoreId\":\""), current, strlen(current)) == 0 &&
+      wait_s > 0) {
+    struct timespec deadline;
+    int held_version = g_version;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += wait_s;
+    while (g_version == held_version && !g_end) {
+      if (pthread_cond_timedwait(&g_version_changed, &g_lock, &deadline) != 0) break;
+    }
+    snprintf(current, sizeof(current), "0x%08x", g_version);
+  }
+
+  if (version != NULL && strncmp(version + strlen("\"policyStoreId\":\""), current, strlen(current)) == 0) {
+    response = malloc(sizeof(current) + 64);
+    *len = sprintf(response, "{\"response\":\"ok\",\"policyStoreId\":\"%s\"}", current);
+  } else {
+    response = malloc((size_t)g_policies_num * (MOCK_POL_ID_LEN + 3) + 64);
+    pos = response + sprintf(response, "{\"response\":[");
+    for (int i = 0; i < g_policies_num; i++) {
+      pos += sprintf(pos, "%s\"%s\"", i > 0 ? "," : "", g_ids[i].id);
+    }
+    pos += sprintf(pos, "],\"policyStoreId\":\"%s\"}", current);
+    *len = pos - response;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  return response;
+}
+
+// Write response at the configured link rate
+static void send_response(int fd, const char *data, int len) {
+  double start = now_s();
+  int sent = 0;
+
+  while (sent < len && !g_end) {
+    int chunk = len - sent < MOCK_CHUNK_LEN ? len - sent : MOCK_CHUNK_LEN;
+    int status;
+
+    if (g_config.link_kbit_s > 0) {
+      double wait = start + (sent + chunk) * 8.0 / (g_config.link_kbit_s * 1000.0) - now_s();
+      if (wait > 0) usleep(wait * 1e6);
+    }
+
+    status = write(fd, data + sent, chunk);
+    if (status <= 0) break;
+    sent += status;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  g_bytes_sent += sent;
+  pthread_mutex_unlock(&g_lock);
+}
+
+static void *connection_thread(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  char request[MOCK_REQUEST_LEN];
+  const char *id = NULL;
+  const char *wait = NULL;
+  char *response = NULL;
+  char *compressed = NULL;
+  size_t compressed_len = 0;
+  int len = 0;
+  int request_len = 0;
+
+  // Requests are small and sent at once, read until the closing brace
+  while (request_len < MOCK_REQUEST_LEN - 1) {
+    int status = read(fd, request + request_len, MOCK_REQUEST_LEN - 1 - request_len);
+
+    if (status <= 0) break;
+    request_len += status;
+    request[request_len] = '\0';
+    if (strchr(request, '}') != NULL) break;
+  }
+  request[request_len] = '\0';
+
+  pthread_mutex_lock(&g_lock);
+  g_requests++;
+  pthread_mutex_unlock(&g_lock);
+
+  if (g_config.loss_percent > 0 && rand() % 100 < g_config.loss_percent) {
+    pthread_mutex_lock(&g_lock);
+    g_dropped++;
+    pthread_mutex_unlock(&g_lock);
+    close(fd);
+    return NULL;
+  }
+
+  if (g_config.latency_ms > 0 || g_config.jitter_ms > 0) {
+    usleep((g_config.latency_ms + (g_config.jitter_ms > 0 ? rand() % g_config.jitter_ms : 0)) * 1000);
+  }
+
+  id = strstr(request, "\"policyId\":\"");
+  wait = strstr(request, "\"wait\":");
+  if (strstr(request, "\"get_policy_list\"") != NULL) {
+    response = format_policy_list(request, wait != NULL ? atoi(wait + strlen("\"wait\":")) : 0, &len);
+  } else if (strstr(request, "\"get_policy\"") != NULL && id != NULL &&
+             strlen(id + strlen("\"policyId\":\"")) >= MOCK_POL_ID_LEN) {
+    response = format_policy(id + strlen("\"policyId\":\""), &len);
+  } else {
+    response = strdup("{\"error\":\"unsupported command\"}");
+    len = strlen(response);
+  }
+
+  if (response != NULL) {
+    if (strstr(request, "\"accept\":\"deflate\"") != NULL &&
+        policydeflate_compress(response, len, &compressed, &compressed_len) == 0) {
+      send_response(fd, compressed, compressed_len);
+      free(compressed);
+    } else {
+      send_response(fd, response, len);
+    }
+    free(response);
+  }
+  close(fd);
+
+  return NULL;
+}
+
+static void *update_thread(void *arg) {
+  while (!g_end) {
+    for (int i = 0; i < g_config.update_s * 10 && !g_end; i++) usleep(100000);
+    if (!g_end) publish_update();
+  }
+
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  const char *seed_string = MOCK_DEFAULT_SEED;
+  unsigned char seed[crypto_sign_SEEDBYTES];
+  char public_key_b64[MOCK_PUBLIC_KEY_B64_LEN + 1];
+  struct sockaddr_in serv_addr;
+  pthread_t thread;
+  int num_policies = MOCK_DEFAULT_POLICIES;
+  int listenfd, opt, one = 1;
+
+  while ((opt = getopt(argc, argv, "p:n:l:j:x:r:u:s:")) != -1) {
+    switch (opt) {
+      case 'p':
+        g_config.port = atoi(optarg);
+        break;
+      case 'n':
+        num_policies = atoi(optarg);
+        break;
+      case 'l':
+        g_config.latency_ms = atoi(optarg);
+        break;
+      case 'j':
+        g_config.jitter_ms = atoi(optarg);
+        break;
+      case 'x':
+        g_config.loss_percent = atoi(optarg);
+        break;
+      case 'r':
+        g_config.link_kbit_s = atoi(optarg);
+        break;
+      case 'u':
+        g_config.update_s = atoi(optarg);
+        break;
+      case 's':
+        seed_string = optarg;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-p port] [-n policies] [-l latency_ms] [-j jitter_ms] [-x loss_percent] "
+                "[-r link_kbit_s] [-u update_s] [-s seed]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+
+  if (sodium_init() < 0 || num_policies <= 0) {
+    return 1;
+  }
+
+  // No SA_RESTART, so a signal interrupts accept
+  sigaction(SIGINT, &(struct sigaction){.sa_handler = signal_handler}, NULL);
+  sigaction(SIGTERM, &(struct sigaction){.sa_handler = signal_handler}, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  srand(time(NULL));
+
+  crypto_hash_sha256(seed, (const unsigned char *)seed_string, strlen(seed_string));
+  crypto_sign_seed_keypair(g_config.public_key, g_config.secret_key, seed);
+  base64_encode(g_config.public_key, crypto_sign_PUBLICKEYBYTES, public_key_b64, sizeof(public_key_b64));
+
+  printf("generating %d policies...\n", num_policies);
+  if (generate_policies(num_policies) != 0) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  memset(&serv_addr, 0, sizeof(serv_addr));
+  serv_addr.sin_family = AF_INET;
+  serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  serv_addr.sin_port = htons(g_config.port);
+
+  listenfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (listenfd < 0 || bind(listenfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) != 0 ||
+      listen(listenfd, SOMAXCONN) != 0) {
+    fprintf(stderr, "cannot listen on port %d\n", g_config.port);
+    return 1;
+  }
+
+  if (g_config.update_s > 0) {
+    pthread_create(&thread, NULL, update_thread, NULL);
+    pthread_detach(thread);
+  }
+
+  printf("policy store on port %d, owner_public_key=%s\n", g_config.port, public_key_b64);
+  fflush(stdout);
+
+  while (!g_end) {
+    int fd = accept(listenfd, NULL, NULL);
+
+    if (fd < 0) continue;
+    if (pthread_create(&thread, NULL, connection_thread, (void *)(intptr_t)fd) != 0) {
+      close(fd);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+
+  close(listenfd);
+  printf("%lld requests, %lld dropped, %lld bytes sent\n", g_requests, g_dropped, g_bytes_sent);
+
+  return 0;
+}
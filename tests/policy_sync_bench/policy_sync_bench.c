@@ -0,0 +1,211 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_sync_bench.c
+ * \brief
+ * End-to-end policy sync benchmark
+ *
+ * \notes
+ * Runs the policy loader with an empty PAP in a scratch directory against a
+ * policy store (normally tests/policy_store_mock) until every listed policy
+ * is installed, then reports sync time, pipeline stage times, read/write
+ * syscalls and bytes, bytes on the wire and peak RSS.
+ *
+ * usage: policy_sync_bench -k owner_public_key [-s host:port] [-n policies] [-w verify_workers]
+ *                          [-t timeout_s] [-c (compression)]
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "access.h"
+#include "checkpoint.h"
+#include "config_manager.h"
+#include "pap_plugin_posix.h"
+#include "policy_loader.h"
+#include "policy_updater.h"
+
+#define BENCH_DEFAULT_STORE "127.0.0.1:6007"
+#define BENCH_DEFAULT_POLICIES 1000
+#define BENCH_DEFAULT_TIMEOUT_S 600
+#define BENCH_POLL_US 10000
+
+typedef struct {
+  long long rchar;
+  long long wchar;
+  long long syscr;
+  long long syscw;
+} bench_io_t;
+
+static double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void read_io(bench_io_t *io) {
+  FILE *f = fopen("/proc/self/io", "r");
+  char key[32];
+  long long value;
+
+  memset(io, 0, sizeof(bench_io_t));
+  if (f == NULL) {
+    return;
+  }
+
+  while (fscanf(f, "%31[^:]: %lld\n", key, &value) == 2) {
+    if (strcmp(key, "rchar") == 0) io->rchar = value;
+    if (strcmp(key, "wchar") == 0) io->wchar = value;
+    if (strcmp(key, "syscr") == 0) io->syscr = value;
+    if (strcmp(key, "syscw") == 0) io->syscw = value;
+  }
+  fclose(f);
+}
+
+static double timeval_s(struct timeval *tv) { return tv->tv_sec + tv->tv_usec / 1e6; }
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) { return remove(path); }
+
+static void print_stage(const char *name, policyloader_stage_stats_t *stage) {
+  printf("  %-7s %7d done %5d failed %10.3f s busy %10.3f s waiting\n", name, stage->done, stage->failed,
+         stage->busy_us / 1e6, stage->wait_us / 1e6);
+}
+
+int main(int argc, char **argv) {
+  char scratch[] = "/tmp/policy_sync_bench.XXXXXX";
+  const char *store = BENCH_DEFAULT_STORE;
+  const char *owner_public_key = NULL;
+  int num_policies = BENCH_DEFAULT_POLICIES;
+  int timeout_s = BENCH_DEFAULT_TIMEOUT_S;
+  int verify_workers = 0;
+  int compression = 0;
+  access_ctx_t access_context;
+  policyloader_stats_t stats;
+  plugin_t plugin;
+  bench_io_t io_start, io_end;
+  struct rusage usage;
+  long long sent, received;
+  double start, elapsed;
+  FILE *config = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "k:s:n:w:t:c")) != -1) {
+    switch (opt) {
+      case 'k':
+        owner_public_key = optarg;
+        break;
+      case 's':
+        store = optarg;
+        break;
+      case 'n':
+        num_policies = atoi(optarg);
+        break;
+      case 'w':
+        verify_workers = atoi(optarg);
+        break;
+      case 't':
+        timeout_s = atoi(optarg);
+        break;
+      case 'c':
+        compression = 1;
+        break;
+      default:
+        owner_public_key = NULL;
+        break;
+    }
+  }
+
+  if (owner_public_key == NULL || num_policies <= 0) {
+    fprintf(stderr,
+            "usage: %s -k owner_public_key [-s host:port] [-n policies] [-w verify_workers] [-t timeout_s] [-c]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // The PAP stores policies relative to the working directory, start from an empty one
+  if (mkdtemp(scratch) == NULL || chdir(scratch) != 0) {
+    fprintf(stderr, "cannot create scratch directory\n");
+    return 1;
+  }
+
+  config = fopen("config.ini", "w");
+  if (config == NULL) {
+    return 1;
+  }
+  fprintf(config,
+          "[config]\ndevice_id=policy_sync_bench\nthread_sleep_period=1000\nowner_public_key=%s\n\n"
+          "[pap]\npolicy_store_service_ip=%s\nverify_workers=%d\nlong_poll_timeout=5\ncompression=%s\n",
+          owner_public_key, store, verify_workers, compression ? "deflate" : "none");
+  fclose(config);
+
+  config_manager_init("config.ini");
+  checkpoint_init("checkpoint.txt");
+  access_init(&access_context);
+  if (plugin_init(&plugin, pap_plugin_posix_initializer, NULL) == 0) {
+    access_register_pap_plugin(access_context, &plugin);
+  }
+
+  read_io(&io_start);
+  start = now_s();
+  policyloader_start();
+
+  do {
+    usleep(BENCH_POLL_US);
+    policyloader_get_stats(&stats);
+    elapsed = now_s() - start;
+  } while (!(stats.syncs > 0 && stats.in_sync && stats.policies >= num_policies) && elapsed < timeout_s);
+
+  read_io(&io_end);
+  policyupdater_get_traffic(&sent, &received);
+  policyloader_stop();
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("%s: %d of %d policies in %.3f s (%d sync rounds)\n", stats.policies >= num_policies ? "synced" : "timeout",
+         stats.policies, num_policies, elapsed, stats.syncs);
+  printf("last round:\n");
+  print_stage("fetch", &stats.fetch);
+  print_stage("parse", &stats.parse);
+  print_stage("verify", &stats.verify);
+  printf("syscalls: %lld read %lld write\n", io_end.syscr - io_start.syscr, io_end.syscw - io_start.syscw);
+  printf("io: %lld B read %lld B written (sockets and files)\n", io_end.rchar - io_start.rchar,
+         io_end.wchar - io_start.wchar);
+  printf("wire: %lld B sent %lld B received%s\n", sent, received, compression ? " (deflate)" : "");
+  printf("cpu: %.3f s user %.3f s system, %ld voluntary %ld involuntary context switches\n",
+         timeval_s(&usage.ru_utime), timeval_s(&usage.ru_stime), usage.ru_nvcsw, usage.ru_nivcsw);
+  printf("peak rss: %ld KiB\n", usage.ru_maxrss);
+
+  checkpoint_deinit();
+  access_deinit(access_context);
+  nftw(scratch, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+  return stats.policies >= num_policies ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file policy_transfer_bench.c
+ * \brief
+ * Policy sync transfer benchmark against a local policy store stand-in
+ *
+ * \notes
+ * Starts a minimal policy store on loopback which serves synthetic policies,
+ * compressed when the request asks for it, and throttles its responses to the
+ * given link rate. A full sync (policy list and every policy) is then run with
+ * and without compression, reporting bytes on the wire and sync time.
+ *
+ * usage: policy_transfer_bench [num_policies] [link_kbit_s]
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "base64.h"
+#include "config_manager.h"
+#include "policy_deflate.h"
+#include "policy_updater.h"
+
+#define BENCH_CONFIG_FILE "policy_transfer_bench.ini"
+#define BENCH_DEFAULT_POLICIES 200
+#define BENCH_DEFAULT_LINK_KBIT_S 1000
+#define BENCH_POLICY_LEN 2048
+#define BENCH_REQUEST_LEN 512
+#define BENCH_CHUNK_LEN 512
+#define BENCH_SIGNATURE_LEN 64
+#define BENCH_SIGNATURE_B64_LEN 88
+
+typedef struct {
+  int listen_fd;
+  int num_policies;
+  int link_kbit_s;
+  char **policies;
+  char *policy_list;
+} bench_store_t;
+
+static double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void policy_id(int index, char *id) { snprintf(id, 65, "%064x", index * 2654435761u); }
+
+// Signatures do not compress, so they are pseudo-random bytes rather than a constant
+static void synthetic_signature(int index, char *signature_b64) {
+  unsigned char signature[BENCH_SIGNATURE_LEN];
+  uint32_t state = index * 2654435761u + 1;
+
+  for (int i = 0; i < BENCH_SIGNATURE_LEN; i++) {
+    state = state * 1103515245u + 12345u;
+    signature[i] = state >> 24;
+  }
+  base64_encode(signature, BENCH_SIGNATURE_LEN, signature_b64, BENCH_SIGNATURE_B64_LEN + 1);
+}
+
+static char *synthetic_policy(int index) {
+  char *policy = malloc(BENCH_POLICY_LEN);
+  char signature_b64[BENCH_SIGNATURE_B64_LEN + 1];
+  char id[65];
+
+  policy_id(index, id);
+  synthetic_signature(index, signature_b64);
+  snprintf(policy, BENCH_POLICY_LEN,
+           "{\"signature\":\"%s\",\"policy\":{\"policy_object\":{\"policy_doc\":{\"attribute_list\":[{"
+           "\"attribute_list\":[{\"type\":\"str\",\"value\":\"request.subject.value\"},{\"type\":\"str\",\"value\":"
+           "\"0x%040x\"}],\"operation\":\"eq\"},{\"attribute_list\":[{\"type\":\"str\",\"value\":"
+           "\"request.object.value\"},{\"type\":\"str\",\"value\":\"0x%040x\"}],\"operation\":\"eq\"},{"
+           "\"attribute_list\":[{\"type\":\"str\",\"value\":\"request.action.value\"},{\"type\":\"str\",\"value\":"
+           "\"action#%d\"}],\"operation\":\"eq\"},{\"attribute_list\":[{\"attribute_list\":[{\"type\":\"str\","
+           "\"value\":\"request.time.value\"},{\"type\":\"time\",\"value\":\"%d\"}],\"operation\":\"geq\"},{"
+           "\"attribute_list\":[{\"type\":\"str\",\"value\":\"request.time.value\"},{\"type\":\"time\",\"value\":"
+           "\"%d\"}],\"operation\":\"leq\"}],\"operation\":\"and\"}],\"operation\":\"and\"},\"policy_goc\":{"
+           "\"attribute_list\":[{\"attribute_list\":[{\"type\":\"str\",\"value\":\"request.subject.value\"},{"
+           "\"type\":\"str\",\"value\":\"0x%040x\"}],\"operation\":\"eq\"}],\"operation\":\"and\"},"
+           "\"obligation_deny\":{},\"obligation_grant\":{}},\"policy_id\":\"%s\",\"cost\":\"0.0\","
+           "\"hash_function\":\"sha-256\"}}",
+           signature_b64, index * 7919u, index % 16, index % 4, 1600000000 + index, 1900000000 + index, index * 7919u,
+           id);
+
+  return policy;
+}
+
+// Write response at the configured link rate
+static void send_throttled(bench_store_t *store, int fd, const char *data, size_t len) {
+  double start = now_s();
+  size_t sent = 0;
+
+  while (sent < len) {
+    size_t chunk = len - sent < BENCH_CHUNK_LEN ? len - sent : BENCH_CHUNK_LEN;
+    double due = start + (sent + chunk) * 8.0 / (store->link_kbit_s * 1000.0);
+    double wait = due - now_s();
+    ssize_t status;
+
+    if (wait > 0) usleep(wait * 1e6);
+    status = write(fd, data + sent, chunk);
+    if (status <= 0) return;
+    sent += status;
+  }
+}
+
+static void serve_request(bench_store_t *store, int fd, const char *request) {
+  const char *response = "{\"error\":\"policy not found\"}";
+  const char *id = strstr(request, "\"policyId\":\"");
+  char *compressed = NULL;
+  size_t len;
+
+  if (strstr(request, "get_policy_list") != NULL) {
+    response = store->policy_list;
+  } else if (id != NULL) {
+    char wanted[65];
+    int index = -1;
+
+    id += strlen("\"policyId\":\"");
+    for (int i = 0; i < store->num_policies && index < 0; i++) {
+      policy_id(i, wanted);
+      if (strncmp(id, wanted, 64) == 0) index = i;
+    }
+    if (index >= 0) response = store->policies[index];
+  }
+
+  len = strlen(response);
+  if (strstr(request, "\"accept\":\"deflate\"") != NULL &&
+      policydeflate_compress(response, len, &compressed, &len) == 0) {
+    send_throttled(store, fd, compressed, len);
+    free(compressed);
+  } else {
+    send_throttled(store, fd, response, len);
+  }
+}
+
+static void *store_thread(void *ptr) {
+  bench_store_t *store = (bench_store_t *)ptr;
+
+  while (1) {
+    char request[BENCH_REQUEST_LEN];
+    int fd = accept(store->listen_fd, NULL, NULL);
+    ssize_t len;
+
+    if (fd < 0) break;
+
+    len = read(fd, request, BENCH_REQUEST_LEN - 1);
+    if (len > 0) {
+      request[len] = '\0';
+      serve_request(store, fd, request);
+    }
+    close(fd);
+  }
+
+  return NULL;
+}
+
+static int store_start(bench_store_t *store, pthread_t *thread) {
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  size_t list_len = store->num_policies * 67 + 128;
+  char *list = NULL;
+
+  store->policies = calloc(store->num_policies, sizeof(char *));
+  store->policy_list = list = malloc(list_len);
+  list += sprintf(list, "{\"response\":[");
+  for (int i = 0; i < store->num_policies; i++) {
+    char id[65];
+
+    store->policies[i] = synthetic_policy(i);
+    policy_id(i, id);
+    list += sprintf(list, "%s\"%s\"", i > 0 ? "," : "", id);
+  }
+  sprintf(list, "],\"policyStoreId\":\"0x%08x\"}", store->num_policies);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  store->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (store->listen_fd < 0 || bind(store->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(store->listen_fd, 16) != 0 || getsockname(store->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+    return 1;
+  }
+
+  pthread_create(thread, NULL, store_thread, store);
+
+  return ntohs(addr.sin_port);
+}
+
+static void store_stop(bench_store_t *store, pthread_t thread) {
+  shutdown(store->listen_fd, SHUT_RDWR);
+  close(store->listen_fd);
+  pthread_join(thread, NULL);
+
+  for (int i = 0; i < store->num_policies; i++) {
+    free(store->policies[i]);
+  }
+  free(store->policies);
+  free(store->policy_list);
+}
+
+typedef struct {
+  char ids[BENCH_DEFAULT_POLICIES * 100][65];
+  int num;
+  int in_list;
+  char id[65];
+  int id_len;
+  size_t bytes;
+} bench_sync_t;
+
+static int count_cb(void *user, const char *chunk, int chunk_len) {
+  ((bench_sync_t *)user)->bytes += chunk_len;
+  return 0;
+}
+
+// Collect policy IDs from the policy list response
+static int list_cb(void *user, const char *chunk, int chunk_len) {
+  bench_sync_t *sync = (bench_sync_t *)user;
+
+  sync->bytes += chunk_len;
+  for (int i = 0; i < chunk_len; i++) {
+    if (chunk[i] == '[') {
+      sync->in_list = 1;
+    } else if (chunk[i] == ']') {
+      sync->in_list = 0;
+    } else if (sync->in_list && chunk[i] == '"') {
+      if (sync->id_len < 0) {
+        sync->id_len = 0;
+      } else {
+        if (sync->id_len == 64) memcpy(sync->ids[sync->num++], sync->id, 65);
+        sync->id_len = -1;
+      }
+    } else if (sync->id_len >= 0 && sync->id_len < 64) {
+      sync->id[sync->id_len++] = chunk[i];
+      sync->id[sync->id_len] = '\0';
+    }
+  }
+
+  return 0;
+}
+
+static void run_sync(int compression, int num_policies) {
+  bench_sync_t *sync = calloc(1, sizeof(bench_sync_t));
+  long long sent_before, received_before, sent, received;
+  int failed = 0;
+  double start;
+
+  sync->id_len = -1;
+  policyupdater_set_compression(compression);
+  policyupdater_get_traffic(&sent_before, &received_before);
+  start = now_s();
+
+  if (policyupdater_wait_policy_list_stream("0x0", "bench", 0, list_cb, sync) != 0 || sync->num != num_policies) {
+    printf("%-8s policy list failed\n", compression ? "deflate" : "plain");
+    free(sync);
+    return;
+  }
+  for (int i = 0; i < sync->num; i++) {
+    failed += policyupdater_get_policy_stream(sync->ids[i], count_cb, sync) != 0;
+  }
+
+  policyupdater_get_traffic(&sent, &received);
+  printf("%-8s %6d policies %5d failed %10lld B sent %10lld B received %10zu B decoded %8.3f s\n",
+         compression ? "deflate" : "plain", sync->num, failed, sent - sent_before, received - received_before,
+         sync->bytes, now_s() - start);
+  free(sync);
+}
+
+int main(int argc, char **argv) {
+  bench_store_t store = {0};
+  pthread_t thread;
+  FILE *config = NULL;
+  int port;
+
+  store.num_policies = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_POLICIES;
+  store.link_kbit_s = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_LINK_KBIT_S;
+  if (store.num_policies <= 0 || store.num_policies > BENCH_DEFAULT_POLICIES * 100 || store.link_kbit_s <= 0) {
+    fprintf(stderr, "usage: %s [num_policies] [link_kbit_s]\n", argv[0]);
+    return 1;
+  }
+
+  port = store_start(&store, &thread);
+  if (port <= 1) {
+    fprintf(stderr, "failed to start policy store\n");
+    return 1;
+  }
+
+  config = fopen(BENCH_CONFIG_FILE, "w");
+  if (config == NULL) {
+    return 1;
+  }
+  fprintf(config, "[pap]\npolicy_store_service_ip=127.0.0.1:%d\ncompression=none\n", port);
+  fclose(config);
+  config_manager_init(BENCH_CONFIG_FILE);
+  policyupdater_init();
+
+  printf("%d policies, %d kbit/s link\n", store.num_policies, store.link_kbit_s);
+  run_sync(0, store.num_policies);
+  run_sync(1, store.num_policies);
+
+  unlink(BENCH_CONFIG_FILE);
+  store_stop(&store, thread);
+
+  return 0;
+}
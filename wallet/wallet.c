@@ -45,6 +45,7 @@ wallet_ctx_t *wallet_create(char const *const node_url, uint16_t port_number, ch
     ctx->mwm = node_mwm;
     ctx->security = DEFAULT_SECURITY_LEVEL;
     ctx->unused_idx = 0;
+    ctx->index_cb = NULL;
     if (flex_trits_from_trytes(ctx->seed, NUM_TRITS_HASH, seed, NUM_TRYTES_HASH, NUM_TRYTES_HASH) == 0) {
       log_error(wallet_logger_id, "[%s:%d] Converting seed to flex_trit failed.\n", __func__, __LINE__);
       wallet_destory(&ctx);
@@ -148,7 +149,12 @@ wallet_err_t wallet_get_address(wallet_ctx_t *const ctx, char *addr_buf, uint64_
   if ((ret = iota_client_get_new_address(ctx->iota_client, ctx->seed, opt, &addresses)) == RC_OK) {
     flex_trits_to_trytes((tryte_t *)addr_buf, NUM_TRYTES_ADDRESS, addresses->prev->hash, NUM_TRITS_ADDRESS,
                          NUM_TRITS_ADDRESS);
-    ctx->unused_idx = hash243_queue_count(addresses) - 1;
+    uint64_t unused_idx = hash243_queue_count(addresses) - 1;
+
+    if (unused_idx != ctx->unused_idx && ctx->index_cb != NULL) {
+      ctx->index_cb(unused_idx);
+    }
+    ctx->unused_idx = unused_idx;
     *index = ctx->unused_idx;
   } else {
     log_error(wallet_logger_id, "[%s:%d] New address failed: %s.\n", __func__, __LINE__, error_2_string(ret));
@@ -58,6 +58,8 @@ static char const *amazon_ca1_pem =
     "rqXRfboQnoZsG4q5WTP468SQvvG5\r\n"
     "-----END CERTIFICATE-----\r\n";
 
+typedef int (*wallet_index_cb)(uint64_t unused_idx);
+
 /**
  * @brief Wallet context
  *
@@ -69,6 +71,7 @@ typedef struct {
   uint64_t unused_idx;                  /*!< recent unused index of the address. */
   flex_trit_t seed[FLEX_TRIT_SIZE_243]; /*!< seed */
   iota_client_service_t *iota_client;   /*!< iota client service */
+  wallet_index_cb index_cb;             /*!< called with the new unused_idx whenever it changes, may be NULL */
 } wallet_ctx_t;
 
 typedef void (*balance_cb)(uint64_t start, uint64_t end);
@@ -0,0 +1,111 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file bounded_queue.c
+ * \brief
+ * Bounded blocking FIFO of fixed-size items
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "bounded_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int bounded_queue_init(bounded_queue_t *queue, int capacity, size_t item_size) {
+  if (queue == NULL || capacity <= 0 || item_size == 0) {
+    return 1;
+  }
+
+  queue->items = calloc(capacity, item_size);
+  if (queue->items == NULL) {
+    return 1;
+  }
+
+  queue->item_size = item_size;
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->count = 0;
+  queue->closed = 0;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->not_empty, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+
+  return 0;
+}
+
+int bounded_queue_push(bounded_queue_t *queue, const void *item) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == queue->capacity && !queue->closed) {
+    pthread_cond_wait(&queue->not_full, &queue->lock);
+  }
+  if (queue->closed) {
+    pthread_mutex_unlock(&queue->lock);
+    return 1;
+  }
+
+  memcpy(queue->items + (size_t)((queue->head + queue->count) % queue->capacity) * queue->item_size, item,
+         queue->item_size);
+  queue->count++;
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+
+  return 0;
+}
+
+int bounded_queue_pop(bounded_queue_t *queue, void *item) {
+  int status = 1;
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->closed) {
+    pthread_cond_wait(&queue->not_empty, &queue->lock);
+  }
+  if (queue->count > 0) {
+    memcpy(item, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    status = 0;
+  }
+  pthread_mutex_unlock(&queue->lock);
+
+  return status;
+}
+
+void bounded_queue_close(bounded_queue_t *queue) {
+  pthread_mutex_lock(&queue->lock);
+  queue->closed = 1;
+  pthread_cond_broadcast(&queue->not_empty);
+  pthread_cond_broadcast(&queue->not_full);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+void bounded_queue_destroy(bounded_queue_t *queue) {
+  pthread_mutex_destroy(&queue->lock);
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_cond_destroy(&queue->not_full);
+  free(queue->items);
+  queue->items = NULL;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file bounded_queue.h
+ * \brief
+ * Bounded blocking FIFO of fixed-size items
+ *
+ * \notes
+ * Items are copied in and out, so the queue never holds pointers into the
+ * caller's memory. Closing wakes every waiter; items already queued can still
+ * be taken.
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _BOUNDED_QUEUE_H_
+#define _BOUNDED_QUEUE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  char *items;
+  size_t item_size;
+  int capacity;
+  int head;
+  int count;
+  int closed;
+} bounded_queue_t;
+
+/**
+ * @brief Initialize queue
+ *
+ * @param[in] capacity Maximum number of queued items
+ * @param[in] item_size Size of an item in bytes
+ *
+ * @return 0 on success, 1 on failure
+ */
+int bounded_queue_init(bounded_queue_t *queue, int capacity, size_t item_size);
+
+/**
+ * @brief Append a copy of item, blocking while the queue is full
+ *
+ * @return 0 on success, 1 if the queue is closed
+ */
+int bounded_queue_push(bounded_queue_t *queue, const void *item);
+
+/**
+ * @brief Remove oldest item into item, blocking while the queue is empty
+ *
+ * @return 0 on success, 1 once the queue is closed and drained
+ */
+int bounded_queue_pop(bounded_queue_t *queue, void *item);
+
+/**
+ * @brief Reject further items and wake up all waiting producers and consumers
+ */
+void bounded_queue_close(bounded_queue_t *queue);
+
+/**
+ * @brief Release queue resources
+ */
+void bounded_queue_destroy(bounded_queue_t *queue);
+
+#endif  // _BOUNDED_QUEUE_H_
@@ -0,0 +1,175 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file worker_pool.c
+ * \brief
+ * Fixed-size pool of worker threads with a bounded task queue
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#include "worker_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bounded_queue.h"
+
+#define WORKER_POOL_MAX_WORKERS 64
+
+typedef struct {
+  worker_pool_task_t task;
+  void *arg;
+} worker_pool_item_t;
+
+struct worker_pool {
+  bounded_queue_t queue;
+  pthread_mutex_t lock;  // guards pending and end
+  pthread_cond_t idle;
+  int pending;
+  int end;
+  int num_workers;
+  pthread_t workers[WORKER_POOL_MAX_WORKERS];
+};
+
+static void task_done(worker_pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  if (--pool->pending == 0) {
+    pthread_cond_broadcast(&pool->idle);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static void *worker_thread(void *ptr) {
+  worker_pool_t *pool = (worker_pool_t *)ptr;
+  worker_pool_item_t item;
+
+  // The queue hands out what was submitted before it was closed, then fails
+  while (bounded_queue_pop(&pool->queue, &item) == 0) {
+    item.task(item.arg);
+    task_done(pool);
+  }
+
+  return NULL;
+}
+
+worker_pool_t *worker_pool_create(int num_workers, int queue_len) {
+  worker_pool_t *pool = NULL;
+
+  if (num_workers <= 0) {
+    num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (num_workers <= 0) num_workers = 1;
+  if (num_workers > WORKER_POOL_MAX_WORKERS) num_workers = WORKER_POOL_MAX_WORKERS;
+  if (queue_len <= 0) queue_len = num_workers;
+
+  pool = calloc(1, sizeof(worker_pool_t));
+  if (pool == NULL) {
+    return NULL;
+  }
+
+  if (bounded_queue_init(&pool->queue, queue_len, sizeof(worker_pool_item_t)) != 0) {
+    free(pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+
+  for (int i = 0; i < num_workers; i++) {
+    if (pthread_create(&pool->workers[i], NULL, worker_thread, pool) != 0) {
+      break;
+    }
+    pool->num_workers++;
+  }
+
+  if (pool->num_workers == 0) {
+    worker_pool_destroy(&pool);
+  }
+
+  return pool;
+}
+
+int worker_pool_submit(worker_pool_t *pool, worker_pool_task_t task, void *arg) {
+  worker_pool_item_t item = {task, arg};
+
+  if (pool == NULL || task == NULL) {
+    return 1;
+  }
+
+  // Counted before it is queued, so a wait cannot miss a task a worker already took
+  pthread_mutex_lock(&pool->lock);
+  if (pool->end) {
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+  }
+  pool->pending++;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (bounded_queue_push(&pool->queue, &item) != 0) {
+    task_done(pool);
+    return 1;
+  }
+
+  return 0;
+}
+
+void worker_pool_wait(worker_pool_t *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+int worker_pool_size(worker_pool_t *pool) { return pool == NULL ? 0 : pool->num_workers; }
+
+void worker_pool_destroy(worker_pool_t **pool) {
+  worker_pool_t *p = NULL;
+
+  if (pool == NULL || *pool == NULL) {
+    return;
+  }
+  p = *pool;
+
+  pthread_mutex_lock(&p->lock);
+  p->end = 1;
+  pthread_mutex_unlock(&p->lock);
+  bounded_queue_close(&p->queue);
+
+  for (int i = 0; i < p->num_workers; i++) {
+    pthread_join(p->workers[i], NULL);
+  }
+
+  bounded_queue_destroy(&p->queue);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->idle);
+  free(p);
+  *pool = NULL;
+}
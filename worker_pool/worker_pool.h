@@ -0,0 +1,71 @@
+/*
+ * This file is part of the IOTA Access Distribution
+ * (https://github.com/iotaledger/access)
+ *
+ * Copyright (c) 2020 IOTA Stiftung
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/****************************************************************************
+ * \project IOTA Access
+ * \file worker_pool.h
+ * \brief
+ * Fixed-size pool of worker threads with a bounded task queue
+ *
+ * \notes
+ *
+ * \history
+ * 19.10.2026. Initial version.
+ ****************************************************************************/
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+typedef void (*worker_pool_task_t)(void *arg);
+
+typedef struct worker_pool worker_pool_t;
+
+/**
+ * @brief Create worker pool and start its threads
+ *
+ * @param[in] num_workers Number of worker threads, 0 for one per online CPU
+ * @param[in] queue_len Maximum number of queued tasks
+ *
+ * @return worker pool, NULL on failure
+ */
+worker_pool_t *worker_pool_create(int num_workers, int queue_len);
+
+/**
+ * @brief Queue a task, blocking while the queue is full
+ *
+ * @return 0 on success, 1 on failure
+ */
+int worker_pool_submit(worker_pool_t *pool, worker_pool_task_t task, void *arg);
+
+/**
+ * @brief Block until all submitted tasks are finished
+ */
+void worker_pool_wait(worker_pool_t *pool);
+
+/**
+ * @brief Number of worker threads in the pool
+ */
+int worker_pool_size(worker_pool_t *pool);
+
+/**
+ * @brief Finish queued tasks, stop threads and release the pool
+ */
+void worker_pool_destroy(worker_pool_t **pool);
+
+#endif  // _WORKER_POOL_H_